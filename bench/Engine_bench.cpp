@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include "OrderFlow.h"
+#include "../src/MatchingEngine.h"
+
+#include <thread>
+#include <vector>
+
+/*
+Aggregate MatchingEngine throughput as shards are added.
+
+The same seeded stream is spread over 'range(1)' instruments and pushed through
+an engine with 'range(0)' shards. The benchmark thread is the gateway: it submits
+every command, drains the trade rings, and stops the clock once every shard has
+applied everything. Expect near-linear scaling until shards outnumber free cores.
+*/
+
+namespace {
+
+void BM_Engine_Throughput(benchmark::State& state) {
+    std::size_t shards = static_cast<std::size_t>(state.range(0));
+    InstrumentId instruments = static_cast<InstrumentId>(state.range(1));
+    constexpr std::size_t kMessagesPerInstrument = 20000;
+
+    //One independent stream per instrument, interleaved round-robin
+    std::vector<std::vector<FlowMessage>> streams;
+    for (InstrumentId i = 0; i < instruments; ++i) {
+        FlowConfig flow;
+        flow.seed = 1000 + i;
+        streams.push_back(OrderFlow(flow).generate(kMessagesPerInstrument));
+    }
+    std::vector<EngineCommand> commands;
+    commands.reserve(kMessagesPerInstrument * instruments);
+    for (std::size_t m = 0; m < kMessagesPerInstrument; ++m) {
+        for (InstrumentId i = 0; i < instruments; ++i) {
+            const FlowMessage& message = streams[i][m];
+            commands.push_back(message.kind == FlowMessage::Kind::New
+                ? EngineCommand::newOrder(i, message.order)
+                : EngineCommand::cancel(i, message.cancelId));
+        }
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        EngineConfig config;
+        config.shards = shards;
+        config.pinThreads = true;
+        config.firstCpu = 1;
+        MatchingEngine engine(config);
+        for (InstrumentId i = 0; i < instruments; ++i)
+            engine.addInstrument(i);
+        engine.start();
+        state.ResumeTiming();
+
+        uint64_t fills = 0;
+        auto countFill = [&fills](const EngineTrade&) { ++fills; };
+        for (const EngineCommand& command : commands) {
+            while (!engine.submit(command))
+                engine.pollTrades(countFill);
+        }
+        while (engine.processedCount() < commands.size())
+            engine.pollTrades(countFill);
+        engine.pollTrades(countFill);
+        benchmark::DoNotOptimize(fills);
+
+        state.PauseTiming();
+        engine.stop();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * commands.size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_Engine_Throughput)
+    ->ArgsProduct({{1, 2, 4, 8}, {64}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
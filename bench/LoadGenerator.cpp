@@ -0,0 +1,267 @@
+#include "Replay.h"
+
+#include "OrderFlow.h"
+#include "../src/LatencyHistogram.h"
+#include "../src/Protocol.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr InstrumentId kInstrument = 1;
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    uint16_t port = 9001;
+    std::string unixPath;               //Connect here instead of TCP if set
+    std::size_t connections = 1;
+    std::size_t messages = 200'000;     //Per connection
+    std::size_t window = 32;            //Requests in flight per connection
+    uint64_t seed = 42;
+};
+
+LoadOptions parseOptions(int argc, char** argv) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&](const char* name) -> const char* {
+            std::size_t length = std::strlen(name);
+            if (std::strncmp(argv[i], name, length) == 0 && argv[i][length] == '=')
+                return argv[i] + length + 1;
+            return nullptr;
+        };
+        if (const char* v = value("--host"))
+            options.host = v;
+        else if (const char* v = value("--port"))
+            options.port = static_cast<uint16_t>(std::strtoul(v, nullptr, 10));
+        else if (const char* v = value("--unix"))
+            options.unixPath = v;
+        else if (const char* v = value("--connections"))
+            options.connections = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--messages"))
+            options.messages = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--window"))
+            options.window = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--seed"))
+            options.seed = std::strtoull(v, nullptr, 10);
+    }
+    if (options.window == 0)
+        options.window = 1;
+    return options;
+}
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+int connectTo(const LoadOptions& options) {
+    int fd;
+    if (!options.unixPath.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options.unixPath.c_str(), sizeof(address.sun_path) - 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+            return fd;
+    } else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.port);
+        ::inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+    }
+    if (fd >= 0)
+        ::close(fd);
+    throw std::runtime_error(std::string("cannot connect to the gateway: ") + std::strerror(errno));
+}
+
+//What one connection measured
+struct ConnectionResult {
+    LatencyHistogram roundTrip;     //Request sent to its first ack, in ns
+    uint64_t trades = 0;
+    uint64_t rejects = 0;
+    std::string error;
+};
+
+/*
+One connection: keeps up to 'window' requests in flight, writing each refill
+with one send(), and times every request from its send to its ack.
+
+The gateway answers a connection's requests in order, and every request gets
+at least one ack for its order ID, so the oldest request in flight is answered
+by the first ack that carries its ID. Anything else (trade reports, the extra
+Cancelled ack of an order self-trade prevention cut short) is not a response.
+*/
+void runConnection(const LoadOptions& options, std::size_t index, std::atomic<std::size_t>& ready,
+    const std::atomic<bool>& go, ConnectionResult& result) {
+    struct InFlight {
+        uint64_t orderId;
+        uint64_t sentNs;
+    };
+
+    int fd = -1;
+    try {
+        fd = connectTo(options);
+    } catch (const std::exception& error) {
+        result.error = error.what();
+        ready.fetch_add(1);
+        return;
+    }
+
+    FlowConfig flowConfig;
+    flowConfig.seed = options.seed + index;
+    OrderFlow flow(flowConfig);
+    //Every generator numbers its orders from 1: give each connection its own range
+    uint64_t idBase = static_cast<uint64_t>(index + 1) << 40;
+
+    std::vector<InFlight> inFlight(options.window);
+    std::size_t head = 0;
+    std::size_t outstanding = 0;
+    std::vector<uint8_t> out(options.window * protocol::kMaxMessageSize);
+    std::vector<uint8_t> in(64 * 1024);
+    std::size_t buffered = 0;
+
+    struct Reports {
+        std::vector<InFlight>& inFlight;
+        std::size_t& head;
+        std::size_t& outstanding;
+        ConnectionResult& result;
+        uint64_t now = 0;
+
+        void onAck(const protocol::AckMessage& message) {
+            if (outstanding == 0 || inFlight[head].orderId != message.orderId)
+                return;
+            result.roundTrip.record(now - inFlight[head].sentNs);
+            if (message.status == protocol::AckStatus::Rejected)
+                ++result.rejects;
+            head = (head + 1) % inFlight.size();
+            --outstanding;
+        }
+        void onTrade(const protocol::TradeReportMessage&) { ++result.trades; }
+    } reports{inFlight, head, outstanding, result};
+
+    ready.fetch_add(1);
+    while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    std::size_t sent = 0;
+    try {
+        while (sent < options.messages || outstanding > 0) {
+            if (outstanding < options.window && sent < options.messages) {
+                protocol::MessageWriter writer(out.data(), out.size());
+                uint64_t now = nowNs();
+                while (outstanding < options.window && sent < options.messages) {
+                    FlowMessage message = flow.next();
+                    uint64_t orderId;
+                    if (message.kind == FlowMessage::Kind::Cancel) {
+                        orderId = idBase + message.cancelId;
+                        writer.writeCancel(kInstrument, orderId);
+                    } else {
+                        message.order.orderId += idBase;
+                        orderId = message.order.orderId;
+                        writer.writeNewOrder(kInstrument, message.order);
+                    }
+                    inFlight[(head + outstanding) % inFlight.size()] = {orderId, now};
+                    ++outstanding;
+                    ++sent;
+                }
+                for (std::size_t done = 0; done < writer.size();) {
+                    ssize_t n = ::send(fd, writer.data() + done, writer.size() - done, MSG_NOSIGNAL);
+                    if (n <= 0)
+                        throw std::runtime_error("send failed");
+                    done += static_cast<std::size_t>(n);
+                }
+            }
+
+            ssize_t n = ::recv(fd, in.data() + buffered, in.size() - buffered, 0);
+            if (n <= 0)
+                throw std::runtime_error("the gateway closed the connection");
+            reports.now = nowNs();
+            buffered += static_cast<std::size_t>(n);
+            std::size_t used = protocol::decodeReports(in.data(), buffered, reports);
+            std::memmove(in.data(), in.data() + used, buffered - used);
+            buffered -= used;
+        }
+    } catch (const std::exception& error) {
+        result.error = error.what();
+    }
+    ::close(fd);
+}
+
+void printRow(const char* name, const LatencyHistogram& histogram) {
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    std::printf("%-12s %12llu %9.1f %9.1f %9.1f %9.1f %10.1f\n", name,
+        static_cast<unsigned long long>(histogram.count()),
+        us(histogram.percentile(50.0)), us(histogram.percentile(90.0)), us(histogram.percentile(99.0)),
+        us(histogram.percentile(99.9)), us(histogram.max()));
+}
+
+} // namespace
+
+int runLoadGenerator(int argc, char** argv) {
+    LoadOptions options = parseOptions(argc, argv);
+
+    std::vector<ConnectionResult> results(options.connections);
+    std::atomic<std::size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (std::size_t c = 0; c < options.connections; ++c)
+        threads.emplace_back([&, c] { runConnection(options, c, ready, go, results[c]); });
+    while (ready.load() < options.connections)
+        std::this_thread::yield();
+
+    uint64_t start = nowNs();
+    go.store(true, std::memory_order_release);
+    for (std::thread& thread : threads)
+        thread.join();
+    double seconds = static_cast<double>(nowNs() - start) / 1e9;
+
+    LatencyHistogram all;
+    uint64_t trades = 0;
+    uint64_t rejects = 0;
+    for (const ConnectionResult& result : results) {
+        if (!result.error.empty()) {
+            std::fprintf(stderr, "agora-core-bench --loadgen: %s\n", result.error.c_str());
+            return 1;
+        }
+        all.merge(result.roundTrip);
+        trades += result.trades;
+        rejects += result.rejects;
+    }
+
+    std::printf("Gateway load: %zu connections x %zu messages, window %zu, over %s\n", options.connections,
+        options.messages, options.window,
+        options.unixPath.empty() ? ("tcp " + options.host + ":" + std::to_string(options.port)).c_str() : ("unix " + options.unixPath).c_str());
+    std::printf("Throughput: %.0f messages/s (%.2f s); %llu trade reports, %llu rejects\n\n",
+        static_cast<double>(all.count()) / seconds, seconds,
+        static_cast<unsigned long long>(trades), static_cast<unsigned long long>(rejects));
+    std::printf("%-12s %12s %9s %9s %9s %9s %10s\n", "rtt (us)", "count", "p50", "p90", "p99", "p99.9", "max");
+    printRow("all", all);
+    if (results.size() > 1)
+        for (std::size_t c = 0; c < results.size(); ++c) {
+            char label[32];
+            std::snprintf(label, sizeof(label), "conn %zu", c);
+            printRow(label, results[c].roundTrip);
+        }
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "Replay.h"
+
+#include "../src/CycleClock.h"
+#include "../src/LatencyHistogram.h"
+#include "../src/OrderBook.h"
+#include "../src/SharedMarketData.h"
+#include "../src/SharedMarketDataPublisher.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+struct ShmOptions {
+    std::size_t readers = 2;
+    std::size_t messages = 1'000'000;
+    uint64_t intervalNs = 1000;     //Gap between publishes; 0 publishes flat out
+    std::size_t depthLevels = 10;
+};
+
+ShmOptions parseOptions(int argc, char** argv) {
+    ShmOptions options;
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&](const char* name) -> const char* {
+            std::size_t length = std::strlen(name);
+            if (std::strncmp(argv[i], name, length) == 0 && argv[i][length] == '=')
+                return argv[i] + length + 1;
+            return nullptr;
+        };
+        if (const char* v = value("--shm-readers"))
+            options.readers = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--messages"))
+            options.messages = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--interval-ns"))
+            options.intervalNs = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--depth"))
+            options.depthLevels = std::strtoull(v, nullptr, 10);
+    }
+    return options;
+}
+
+//What one reader saw
+struct ReaderResult {
+    LatencyHistogram tradeLatency;  //Publish to delivery, in CycleClock ticks
+    LatencyHistogram depthCopy;     //One readDepth() call, in CycleClock ticks
+    uint64_t delivered = 0;
+    uint64_t missed = 0;
+};
+
+void printRow(const char* name, const LatencyHistogram& histogram, double nsPerTick) {
+    auto ns = [&](uint64_t ticks) { return static_cast<double>(ticks) * nsPerTick; };
+    std::printf("%-16s %12llu %10.0f %10.0f %10.0f %12.0f\n", name,
+        static_cast<unsigned long long>(histogram.count()),
+        ns(histogram.percentile(50.0)), ns(histogram.percentile(99.0)),
+        ns(histogram.percentile(99.9)), ns(histogram.max()));
+}
+
+} // namespace
+
+int runSharedMemoryBench(int argc, char** argv) {
+    ShmOptions options = parseOptions(argc, argv);
+    double nsPerTick = CycleClock::calibrate();
+    uint64_t intervalTicks = static_cast<uint64_t>(static_cast<double>(options.intervalNs) / nsPerTick);
+
+    std::string name = "/agora-bench-md-" + std::to_string(::getpid());
+    SharedMarketDataConfig config;
+    config.depthLevels = options.depthLevels;
+    SharedMarketDataPublisher publisher(name, 1, config);
+
+    //A book with some depth, so every publishDepth() copies real levels
+    OrderBook book;
+    for (uint64_t i = 0; i < 2 * options.depthLevels; ++i) {
+        book.processOrder(Order(2 * i + 1, OrderSide::BUY, 100, 1000 - static_cast<Price>(i)));
+        book.processOrder(Order(2 * i + 2, OrderSide::SELL, 100, 1001 + static_cast<Price>(i)));
+    }
+
+    //Readers are threads mapping the region by name, exactly as another process would
+    std::vector<ReaderResult> results(options.readers);
+    std::atomic<std::size_t> attached{0};
+    std::vector<std::thread> readers;
+    for (std::size_t r = 0; r < options.readers; ++r) {
+        readers.emplace_back([&, r] {
+            SharedMarketDataReader reader(name);
+            ReaderResult& result = results[r];
+            SharedDepth depth;
+            attached.fetch_add(1);
+            while (reader.nextTrade() <= options.messages) {
+                uint64_t start = CycleClock::now();
+                reader.readDepth(depth);
+                result.depthCopy.record(CycleClock::now() - start);
+                //Each trade carries its publish timestamp in place of a price
+                result.delivered += reader.pollTrades([&](const Trade& trade) {
+                    result.tradeLatency.record(CycleClock::now() - static_cast<uint64_t>(trade.price));
+                });
+            }
+            result.missed = reader.missedTrades();
+        });
+    }
+    while (attached.load() < options.readers)
+        std::this_thread::yield();
+
+    LatencyHistogram publishCost;
+    uint64_t next = CycleClock::now();
+    for (std::size_t i = 1; i <= options.messages; ++i) {
+        while (CycleClock::now() < next) {
+        }
+        uint64_t start = CycleClock::now();
+        publisher.publishDepth(book);
+        publisher.publishTrade(Trade(i, 1, 2, static_cast<Price>(CycleClock::now()), 1));
+        publishCost.record(CycleClock::now() - start);
+        next = start + intervalTicks;
+    }
+    for (std::thread& reader : readers)
+        reader.join();
+
+    std::printf("Shared-memory market data: 1 writer, %zu readers, %zu publishes (depth %zu + 1 trade) every %llu ns\n",
+        options.readers, options.messages, options.depthLevels, static_cast<unsigned long long>(options.intervalNs));
+    std::printf("Hardware threads: %u%s\n\n", std::thread::hardware_concurrency(),
+        std::thread::hardware_concurrency() <= options.readers ? " (readers share cores with the writer: latencies include scheduling)" : "");
+    std::printf("%-16s %12s %10s %10s %10s %12s\n", "latency (ns)", "count", "p50", "p99", "p99.9", "max");
+    printRow("publish", publishCost, nsPerTick);
+    for (std::size_t r = 0; r < results.size(); ++r) {
+        std::string reader = "reader " + std::to_string(r);
+        printRow((reader + " trade").c_str(), results[r].tradeLatency, nsPerTick);
+        printRow((reader + " depth").c_str(), results[r].depthCopy, nsPerTick);
+        if (results[r].missed > 0)
+            std::printf("%-16s %12llu trades overwritten before they were read\n", "", static_cast<unsigned long long>(results[r].missed));
+    }
+    return 0;
+}
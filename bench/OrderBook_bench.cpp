@@ -0,0 +1,496 @@
+#include <benchmark/benchmark.h>
+#include "OrderFlow.h"
+#include "PerfCounters.h"
+#include "../src/OrderBook.h"
+#include "../src/PrefixSum.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*
+OrderBook microbenchmarks.
+
+Each benchmark times one book operation per iteration. Setup that has to be
+repeated (refilling a book that the benchmark drains) runs in batches with the
+timer paused, so its cost is amortised out of the numbers.
+*/
+
+namespace {
+
+//Prices in ticks
+constexpr Price kMid = 10000;
+constexpr Price kTick = 1;
+
+//A trade sink that only keeps the optimiser honest
+struct CountingSink {
+    uint64_t quantity = 0;
+    void operator()(const Trade& trade) { quantity += trade.quantity; }
+};
+
+//Fills 'levels' ask levels above the mid (and as many bid levels below it)
+//with 'perLevel' orders each. Returns the next free order ID.
+uint64_t buildBook(OrderBook& book, int levels, int perLevel, uint64_t nextId = 1) {
+    CountingSink sink;
+    for (int level = 1; level <= levels; ++level) {
+        for (int i = 0; i < perLevel; ++i) {
+            book.processOrder(Order(nextId++, OrderSide::SELL, 100, kMid + level * kTick), sink);
+            book.processOrder(Order(nextId++, OrderSide::BUY, 100, kMid - level * kTick), sink);
+        }
+    }
+    return nextId;
+}
+
+OrderBookConfig benchConfig() {
+    OrderBookConfig config;
+    config.orderCapacity = 1 << 20;
+    return config;
+}
+
+//A passive order that rests without matching, on top of a book 'range(0)' levels deep
+void BM_ProcessOrder_Resting(benchmark::State& state) {
+    OrderBook book(benchConfig());
+    uint64_t nextId = buildBook(book, static_cast<int>(state.range(0)), 4);
+    CountingSink sink;
+
+    constexpr int kBatch = 4096;
+    std::vector<uint64_t> added;
+    added.reserve(kBatch);
+    int level = 0;
+    for (auto _ : state) {
+        uint64_t id = nextId++;
+        book.processOrder(Order(id, OrderSide::BUY, 100, kMid - (1 + level) * kTick), sink);
+        level = (level + 1) % 8;
+        added.push_back(id);
+        if (added.size() == kBatch) {
+            state.PauseTiming();
+            for (uint64_t addedId : added)
+                book.cancelOrder(addedId);
+            added.clear();
+            state.ResumeTiming();
+        }
+    }
+    benchmark::DoNotOptimize(sink.quantity);
+    state.SetItemsProcessed(state.iterations());
+}
+
+//An aggressive order that exactly fills the oldest order at the touch
+void BM_ProcessOrder_SingleFill(benchmark::State& state) {
+    OrderBook book(benchConfig());
+    constexpr int kBatch = 4096;
+    uint64_t nextId = buildBook(book, 1, kBatch);
+    int left = kBatch;
+    CountingSink sink;
+
+    for (auto _ : state) {
+        book.processOrder(Order(nextId++, OrderSide::BUY, 100, kMid + kTick), sink);
+        if (--left == 0) {
+            state.PauseTiming();
+            for (int i = 0; i < kBatch; ++i)
+                book.processOrder(Order(nextId++, OrderSide::SELL, 100, kMid + kTick), sink);
+            left = kBatch;
+            state.ResumeTiming();
+        }
+    }
+    benchmark::DoNotOptimize(sink.quantity);
+    state.SetItemsProcessed(state.iterations());
+}
+
+//BM_ProcessOrder_SingleFill per order type, through the compile-time entry point.
+//Limit here against BM_ProcessOrder_SingleFill (run-time dispatch) is the cost of the type switch.
+template <OrderType Type>
+void BM_ProcessOrder_SingleFillTyped(benchmark::State& state) {
+    OrderBook book(benchConfig());
+    constexpr int kBatch = 4096;
+    uint64_t nextId = buildBook(book, 1, kBatch);
+    int left = kBatch;
+    CountingSink sink;
+
+    for (auto _ : state) {
+        book.processOrderAs<Type>(Order(nextId++, OrderSide::BUY, 100, kMid + kTick, Type), sink);
+        if (--left == 0) {
+            state.PauseTiming();
+            for (int i = 0; i < kBatch; ++i)
+                book.processOrder(Order(nextId++, OrderSide::SELL, 100, kMid + kTick), sink);
+            left = kBatch;
+            state.ResumeTiming();
+        }
+    }
+    benchmark::DoNotOptimize(sink.quantity);
+    state.SetItemsProcessed(state.iterations());
+}
+
+//An aggressive order that sweeps 'range(0)' whole levels of 'range(1)' orders each.
+//The book is refilled with the timer paused after every sweep; Pause/ResumeTiming
+//leaves a small fixed residue in each iteration, so compare these runs to each other.
+void BM_ProcessOrder_WalkBook(benchmark::State& state) {
+    int levels = static_cast<int>(state.range(0));
+    int perLevel = static_cast<int>(state.range(1));
+    OrderBook book(benchConfig());
+    CountingSink sink;
+    uint64_t nextId = 1;
+
+    auto refill = [&] {
+        for (int level = 1; level <= levels; ++level)
+            for (int i = 0; i < perLevel; ++i)
+                book.processOrder(Order(nextId++, OrderSide::SELL, 100, kMid + level * kTick), sink);
+    };
+    refill();
+
+    uint32_t sweep = static_cast<uint32_t>(levels * perLevel * 100);
+    for (auto _ : state) {
+        book.processOrder(Order(nextId++, OrderSide::BUY, sweep, kMid + levels * kTick), sink);
+        state.PauseTiming();
+        refill();
+        state.ResumeTiming();
+    }
+    benchmark::DoNotOptimize(sink.quantity);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["fills/s"] = benchmark::Counter(static_cast<double>(state.iterations()) * levels * perLevel, benchmark::Counter::kIsRate);
+}
+
+//Cancelling a resting order, scattered through a book 'range(0)' levels deep
+void BM_CancelOrder_Hit(benchmark::State& state) {
+    int levels = static_cast<int>(state.range(0));
+    constexpr int kPerLevel = 16;
+    OrderBook book(benchConfig());
+    uint64_t firstId = 1;
+    uint64_t nextId = buildBook(book, levels, kPerLevel, firstId);
+    uint64_t total = nextId - firstId;
+
+    //Cancel in a prime stride so consecutive cancels hit different levels
+    //and every order is visited exactly once per pass
+    constexpr uint64_t stride = 7919;
+    uint64_t k = 0;
+    uint64_t cancelled = 0;
+    for (auto _ : state) {
+        book.cancelOrder(firstId + (k * stride) % total);
+        ++k;
+        if (++cancelled == total) {
+            state.PauseTiming();
+            firstId = nextId;
+            nextId = buildBook(book, levels, kPerLevel, firstId);
+            cancelled = 0;
+            k = 0;
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+//Cancelling an ID that is not in the book (already filled or cancelled)
+void BM_CancelOrder_Miss(benchmark::State& state) {
+    OrderBook book(benchConfig());
+    uint64_t nextId = buildBook(book, static_cast<int>(state.range(0)), 16);
+    for (auto _ : state)
+        book.cancelOrder(nextId++);
+    state.SetItemsProcessed(state.iterations());
+}
+
+//Add-then-cancel round trip deep inside a book of 'range(0)' levels x 'range(1)' orders
+void BM_DeepBook_AddCancel(benchmark::State& state) {
+    int levels = static_cast<int>(state.range(0));
+    OrderBook book(benchConfig());
+    uint64_t nextId = buildBook(book, levels, static_cast<int>(state.range(1)));
+    CountingSink sink;
+    int level = 0;
+    for (auto _ : state) {
+        uint64_t id = nextId++;
+        book.processOrder(Order(id, OrderSide::SELL, 100, kMid + (1 + level) * kTick), sink);
+        book.cancelOrder(id);
+        level = (level + 37) % levels;
+    }
+    benchmark::DoNotOptimize(sink.quantity);
+    state.SetItemsProcessed(state.iterations());
+}
+
+//Amending a resting order in a book 100 levels deep: range(0) == 0 reduces its quantity,
+//1 moves it one tick. Compare with BM_Amend_CancelNew, the only way to amend before modifyOrder.
+void BM_Amend_Modify(benchmark::State& state) {
+    OrderBook book(benchConfig());
+    uint64_t id = buildBook(book, 100, 16);
+    book.processOrder(Order(id, OrderSide::BUY, UINT32_MAX, kMid - 50 * kTick));
+    bool reprice = state.range(0) == 1;
+    uint32_t quantity = UINT32_MAX;
+    Price price = kMid - 50 * kTick;
+    for (auto _ : state) {
+        if (reprice)
+            price = price == kMid - 50 * kTick ? kMid - 51 * kTick : kMid - 50 * kTick;
+        else
+            --quantity;
+        book.modifyOrder(id, price, quantity);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_Amend_CancelNew(benchmark::State& state) {
+    OrderBook book(benchConfig());
+    uint64_t id = buildBook(book, 100, 16);
+    book.processOrder(Order(id, OrderSide::BUY, UINT32_MAX, kMid - 50 * kTick));
+    bool reprice = state.range(0) == 1;
+    uint32_t quantity = UINT32_MAX;
+    Price price = kMid - 50 * kTick;
+    CountingSink sink;
+    for (auto _ : state) {
+        if (reprice)
+            price = price == kMid - 50 * kTick ? kMid - 51 * kTick : kMid - 50 * kTick;
+        else
+            --quantity;
+        book.cancelOrder(id);
+        book.processOrder(Order(id, OrderSide::BUY, quantity, price), sink);
+    }
+    benchmark::DoNotOptimize(sink.quantity);
+    state.SetItemsProcessed(state.iterations());
+}
+
+//A realistic mix of both sides, resting, crossing and cancelling (OrderFlow), per message.
+//Both sides interleave unpredictably, which is what exposes side-dependent branches.
+//Reports branch misses and instructions per message where hardware counters are available.
+void BM_MixedFlow(benchmark::State& state) {
+    constexpr std::size_t kMessages = 1 << 18;
+    std::vector<FlowMessage> messages = OrderFlow().generate(kMessages);
+    PerfCounters counters;
+    uint64_t branchMisses = 0;
+    uint64_t instructions = 0;
+    CountingSink sink;
+    for (auto _ : state) {
+        state.PauseTiming();
+        OrderBook book(benchConfig());
+        counters.start();
+        state.ResumeTiming();
+        for (const FlowMessage& message : messages) {
+            if (message.kind == FlowMessage::Kind::New)
+                book.processOrder(message.order, sink);
+            else
+                book.cancelOrder(message.cancelId);
+        }
+        state.PauseTiming();
+        counters.stop();
+        branchMisses += counters.branchMisses();
+        instructions += counters.instructions();
+        state.ResumeTiming();
+    }
+    benchmark::DoNotOptimize(sink.quantity);
+    double total = static_cast<double>(state.iterations()) * kMessages;
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kMessages));
+    if (counters.available()) {
+        state.counters["branch-misses/msg"] = static_cast<double>(branchMisses) / total;
+        state.counters["instructions/msg"] = static_cast<double>(instructions) / total;
+    }
+}
+
+//RiskGate::check alone, on orders spread over 1000 accounts that all have resting exposure
+void BM_RiskCheck(benchmark::State& state) {
+    RiskConfig config;
+    config.priceBand = 1000;
+    config.defaults = RiskLimits{10'000, 1'000'000, 10'000'000'000};
+    RiskGate gate(config);
+    gate.onTrade(kMid);
+    std::vector<Order> orders;
+    for (uint64_t i = 0; i < 4096; ++i) {
+        Order order(i + 1, i % 2 ? OrderSide::BUY : OrderSide::SELL, 1 + static_cast<uint32_t>(i * 37 % 500),
+            kMid + static_cast<Price>(i * 13 % 200) - 100);
+        order.owner = static_cast<OwnerId>(1 + i * 7919 % 1000);
+        gate.onResting(order.owner, order.price, order.quantity);
+        orders.push_back(order);
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gate.check(orders[i]));
+        i = (i + 1) & 4095;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+//OrderFlow spread over 1000 accounts, without a risk gate (range(0) == 0) or with one
+//that checks every new order before it reaches the book and has its counters kept current
+//by the book. The difference between the two is the gate's cost per message.
+void BM_RiskGateFlow(benchmark::State& state) {
+    constexpr std::size_t kMessages = 1 << 18;
+    FlowConfig config;
+    config.owners = 1000;
+    std::vector<FlowMessage> messages = OrderFlow(config).generate(kMessages);
+
+    RiskConfig riskConfig;
+    riskConfig.priceBand = 1000;
+    riskConfig.defaults = RiskLimits{10'000, 1'000'000, 10'000'000'000};
+    for (OwnerId owner = 1; owner <= 1000; owner += 10)
+        riskConfig.accounts.push_back({owner, RiskLimits{5'000, 500'000, 5'000'000'000}});
+
+    bool gated = state.range(0) != 0;
+    CountingSink sink;
+    uint64_t rejected = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        OrderBook book(benchConfig());
+        RiskGate gate(riskConfig);
+        if (gated)
+            book.setRiskGate(&gate);
+        state.ResumeTiming();
+        for (const FlowMessage& message : messages) {
+            if (message.kind != FlowMessage::Kind::New) {
+                book.cancelOrder(message.cancelId);
+            } else if (!gated || gate.check(message.order) == RiskCheck::Passed) {
+                book.processOrder(message.order, sink);
+            } else {
+                ++rejected;
+            }
+        }
+    }
+    benchmark::DoNotOptimize(sink.quantity);
+    state.counters["rejected"] = static_cast<double>(rejected) / static_cast<double>(state.iterations());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kMessages));
+}
+
+//Cancel-heavy realistic flow (OrderFlow, 90% cancels) into a book far larger than the
+//caches, applied one call at a time (range(0) == 0) or through processBatch in bursts
+//of range(0) commands, with eager (range(1) == 0) or lazy cancels. Per message.
+void BM_CancelHeavyFlow(benchmark::State& state) {
+    std::size_t burst = static_cast<std::size_t>(state.range(0));
+    OrderBookConfig bookConfig = benchConfig();
+    bookConfig.cancelMode = state.range(1) ? CancelMode::Lazy : CancelMode::Eager;
+    constexpr std::size_t kMessages = 1 << 18;
+
+    //Seed the book deep, so cancels land on cold index slots and nodes
+    FlowConfig config;
+    config.cancelRatio = 0.9;
+    config.maxDepthTicks = 2000;
+    config.depthDecay = 0.01;
+    OrderFlow flow(config);
+    std::vector<BookCommand> commands;
+    commands.reserve(kMessages);
+    for (std::size_t i = 0; i < kMessages; ++i) {
+        FlowMessage message = flow.next();
+        commands.push_back(message.kind == FlowMessage::Kind::New
+            ? BookCommand::newOrder(message.order) : BookCommand::cancel(message.cancelId));
+    }
+
+    CountingSink sink;
+    for (auto _ : state) {
+        state.PauseTiming();
+        OrderBook book(bookConfig);
+        for (uint64_t i = 0; i < 500'000; ++i)
+            book.processOrder(Order(UINT64_MAX / 2 + i, i % 2 ? OrderSide::BUY : OrderSide::SELL, 10,
+                i % 2 ? kMid - 2001 - static_cast<Price>(i % 3000) : kMid + 2001 + static_cast<Price>(i % 3000)), sink);
+        state.ResumeTiming();
+
+        if (burst == 0) {
+            for (const BookCommand& command : commands) {
+                if (command.type == BookCommand::Type::NewOrder)
+                    book.processOrder(command.order, sink);
+                else
+                    book.cancelOrder(command.order.orderId);
+            }
+        } else {
+            for (std::size_t i = 0; i < commands.size(); i += burst)
+                book.processBatch(commands.data() + i, std::min(burst, commands.size() - i), sink);
+        }
+    }
+    benchmark::DoNotOptimize(sink.quantity);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kMessages));
+}
+
+//Prefix sum over one curve of 'range(0)' ticks: scalar loop (range(1) == 0) or the
+//dispatched kernel (AVX2 where the CPU has it)
+void BM_PrefixSum(benchmark::State& state) {
+    std::vector<uint64_t> totals(static_cast<std::size_t>(state.range(0)));
+    for (std::size_t i = 0; i < totals.size(); ++i)
+        totals[i] = i * 7 % 1000;
+    std::vector<uint64_t> curve(totals.size());
+    for (auto _ : state) {
+        curve = totals;
+        if (state.range(1))
+            prefixSum(curve.data(), curve.size());
+        else
+            prefixSumScalar(curve.data(), curve.size());
+        benchmark::DoNotOptimize(curve.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//A call auction collecting 'range(0)' limit orders whose prices cross over 'range(1)' ticks
+//around the mid, then the price determination alone (range(2) == 0) or the whole uncross
+void BM_AuctionUncross(benchmark::State& state) {
+    std::size_t orders = static_cast<std::size_t>(state.range(0));
+    Price spread = static_cast<Price>(state.range(1));
+    bool fill = state.range(2) != 0;
+    OrderBookConfig bookConfig = benchConfig();
+    bookConfig.orderCapacity = orders;
+
+    CountingSink sink;
+    for (auto _ : state) {
+        state.PauseTiming();
+        OrderBook book(bookConfig);
+        book.startAuction();
+        uint64_t seed = 1;
+        for (uint64_t i = 0; i < orders; ++i) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            Price offset = static_cast<Price>((seed >> 33) % static_cast<uint64_t>(spread)) - spread / 2;
+            book.processOrder(Order(i + 1, i % 2 ? OrderSide::BUY : OrderSide::SELL, 1 + static_cast<uint32_t>(seed >> 58), kMid + offset), sink);
+        }
+        state.ResumeTiming();
+
+        AuctionResult result = fill ? book.uncrossAuction(kMid, sink) : book.indicativeAuction(kMid);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(orders));
+}
+
+//Top-N depth snapshot of one side of a book 1000 levels deep
+void BM_GetDepth(benchmark::State& state) {
+    OrderBook book(benchConfig());
+    buildBook(book, 1000, 16);
+    std::vector<DepthLevel> levels(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        std::size_t count = book.getDepth(OrderSide::BUY, levels.size(), levels.data());
+        benchmark::DoNotOptimize(count);
+        benchmark::DoNotOptimize(levels.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+//Add-then-cancel round trip with an incremental depth feed attached and published after each command
+void BM_DeepBook_AddCancelWithDepthFeed(benchmark::State& state) {
+    int levels = static_cast<int>(state.range(0));
+    OrderBook book(benchConfig());
+    uint64_t nextId = buildBook(book, levels, 16);
+    DepthPublisher publisher;
+    book.setDepthPublisher(&publisher);
+    CountingSink sink;
+    uint64_t updates = 0;
+    auto count = [&updates](const DepthUpdate&) { ++updates; };
+    int level = 0;
+    for (auto _ : state) {
+        uint64_t id = nextId++;
+        book.processOrder(Order(id, OrderSide::SELL, 100, kMid + (1 + level) * kTick), sink);
+        publisher.publish(book, count);
+        book.cancelOrder(id);
+        publisher.publish(book, count);
+        level = (level + 37) % levels;
+    }
+    benchmark::DoNotOptimize(updates);
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_ProcessOrder_Resting)->Arg(1)->Arg(100)->Arg(1000);
+BENCHMARK(BM_ProcessOrder_SingleFill);
+BENCHMARK_TEMPLATE(BM_ProcessOrder_SingleFillTyped, OrderType::Limit);
+BENCHMARK_TEMPLATE(BM_ProcessOrder_SingleFillTyped, OrderType::Market);
+BENCHMARK_TEMPLATE(BM_ProcessOrder_SingleFillTyped, OrderType::ImmediateOrCancel);
+BENCHMARK_TEMPLATE(BM_ProcessOrder_SingleFillTyped, OrderType::FillOrKill);
+BENCHMARK(BM_ProcessOrder_WalkBook)->Args({1, 1})->Args({5, 4})->Args({20, 10});
+BENCHMARK(BM_CancelOrder_Hit)->Arg(1)->Arg(100)->Arg(1000);
+BENCHMARK(BM_CancelOrder_Miss)->Arg(100);
+BENCHMARK(BM_DeepBook_AddCancel)->Args({100, 10})->Args({1000, 50});
+BENCHMARK(BM_Amend_Modify)->Arg(0)->Arg(1);
+BENCHMARK(BM_Amend_CancelNew)->Arg(0)->Arg(1);
+BENCHMARK(BM_MixedFlow)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CancelHeavyFlow)->Args({0, 0})->Args({16, 0})->Args({64, 0})->Args({0, 1})->Args({64, 1})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RiskCheck);
+BENCHMARK(BM_RiskGateFlow)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PrefixSum)->Args({4096, 0})->Args({4096, 1})->Args({65536, 0})->Args({65536, 1});
+BENCHMARK(BM_AuctionUncross)->Args({200'000, 2000, 0})->Args({200'000, 2000, 1})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_GetDepth)->Arg(5)->Arg(10)->Arg(50);
+BENCHMARK(BM_DeepBook_AddCancelWithDepthFeed)->Arg(100);
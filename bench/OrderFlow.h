@@ -0,0 +1,122 @@
+#pragma once
+
+#include "../src/Order.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+//One message of a synthetic order stream
+struct FlowMessage {
+    enum class Kind : uint8_t { New, Cancel, Modify, Stop };
+
+    Kind kind;
+    Order order;        //Kind::New, Kind::Stop: the order. Kind::Modify: orderId, new price and quantity.
+    uint64_t cancelId;  //Valid for Kind::Cancel
+    Price triggerPrice = 0; //Valid for Kind::Stop
+};
+
+//Shape of the generated stream
+struct FlowConfig {
+    uint64_t seed = 42;
+    int64_t startTicks = 10000;     //Initial mid, in ticks
+    double cancelRatio = 0.5;       //Share of messages that are cancels
+    double marketableRatio = 0.05;  //Share of new orders priced through the opposite touch
+    double depthDecay = 0.25;       //Geometric decay of order placement away from the touch
+    int64_t maxDepthTicks = 200;    //Furthest a passive order is placed from the mid
+    uint32_t maxQuantity = 500;
+
+    //Off by default, so the streams the benchmarks replay never change
+    double modifyRatio = 0.0;       //Share of messages that amend a live order
+    double typedRatio = 0.0;        //Share of new orders that are market/IOC/FOK/post-only
+    uint32_t owners = 0;            //Owners new orders are spread over, each order with a random
+                                    //self-trade prevention mode (0: orders have no owner)
+    double stopRatio = 0.0;         //Share of new orders that are stops (market) or stop-limits,
+                                    //triggered where the order would have been priced
+};
+
+/*
+Deterministic, seeded generator of a realistic-looking order stream.
+
+The mid price does a slow random walk. Passive orders cluster near the touch
+(geometrically fewer orders further away), a small share of orders cross the
+spread, and cancels target a uniformly random order that the generator has
+sent and not yet cancelled. The same seed always yields the same stream.
+*/
+class OrderFlow {
+    public:
+        explicit OrderFlow(const FlowConfig& config = FlowConfig{})
+            : config_{config}, rng_{config.seed}, mid_{config.startTicks} {}
+
+        FlowMessage next() {
+            std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+            if (!live_.empty() && unit(rng_) < config_.cancelRatio) {
+                //Swap-remove a random live ID
+                std::size_t i = std::uniform_int_distribution<std::size_t>(0, live_.size() - 1)(rng_);
+                uint64_t id = live_[i];
+                live_[i] = live_.back();
+                live_.pop_back();
+                return {FlowMessage::Kind::Cancel, Order{}, id};
+            }
+
+            if (config_.modifyRatio > 0.0 && !live_.empty() && unit(rng_) < config_.modifyRatio) {
+                //Half shrink in place, half move a tick or two (which may cross)
+                uint64_t id = live_[std::uniform_int_distribution<std::size_t>(0, live_.size() - 1)(rng_)];
+                int64_t ticks = mid_ + std::uniform_int_distribution<int64_t>(-3, 3)(rng_);
+                uint32_t quantity = std::uniform_int_distribution<uint32_t>(0, config_.maxQuantity)(rng_);
+                return {FlowMessage::Kind::Modify, Order(id, OrderSide::BUY, quantity, ticks), 0};
+            }
+
+            //Drift the mid one tick now and then
+            if (unit(rng_) < 0.01)
+                mid_ += unit(rng_) < 0.5 ? -1 : 1;
+
+            OrderSide side = unit(rng_) < 0.5 ? OrderSide::BUY : OrderSide::SELL;
+            int64_t distance = std::min<int64_t>(std::geometric_distribution<int64_t>(config_.depthDecay)(rng_) + 1, config_.maxDepthTicks);
+            if (unit(rng_) < config_.marketableRatio)
+                distance = -distance;
+
+            int64_t ticks = side == OrderSide::BUY ? mid_ - distance : mid_ + distance;
+            uint32_t quantity = std::uniform_int_distribution<uint32_t>(1, config_.maxQuantity)(rng_);
+            uint64_t id = nextId_++;
+            live_.push_back(id);
+
+            OrderType type = OrderType::Limit;
+            if (config_.typedRatio > 0.0 && unit(rng_) < config_.typedRatio)
+                type = static_cast<OrderType>(std::uniform_int_distribution<int>(1, 4)(rng_));
+            Order order(id, side, quantity, ticks, type);
+            if (config_.owners > 0) {
+                order.owner = std::uniform_int_distribution<OwnerId>(1, config_.owners)(rng_);
+                order.selfTrade = static_cast<SelfTradePrevention>(std::uniform_int_distribution<int>(0, 2)(rng_));
+            }
+            if (config_.stopRatio > 0.0 && unit(rng_) < config_.stopRatio) {
+                //A buy stop above the mid or a sell stop below it, set off when the price gets there
+                Price trigger = side == OrderSide::BUY ? mid_ + distance : mid_ - distance;
+                order.price = side == OrderSide::BUY ? trigger + 2 : trigger - 2;
+                order.type = unit(rng_) < 0.5 ? OrderType::Market : OrderType::Limit;
+                return {FlowMessage::Kind::Stop, order, 0, trigger};
+            }
+            return {FlowMessage::Kind::New, order, 0};
+        }
+
+        //Generates 'count' messages up front, so a replay measures the book and not the generator
+        std::vector<FlowMessage> generate(std::size_t count) {
+            std::vector<FlowMessage> messages;
+            messages.reserve(count);
+            for (std::size_t i = 0; i < count; ++i)
+                messages.push_back(next());
+            return messages;
+        }
+
+    private:
+        FlowConfig config_;
+        std::mt19937_64 rng_;
+        int64_t mid_;
+        uint64_t nextId_ = 1;
+
+        //IDs sent and not yet cancelled (some may have been filled by the book)
+        std::vector<uint64_t> live_;
+};
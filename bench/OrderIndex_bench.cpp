@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+#include "../src/OrderIndex.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*
+OrderIndex vs the std::unordered_map it replaced in OrderBook::orderMap_.
+
+Every benchmark keeps 'range(0)' live orders with monotonically increasing IDs,
+which is the shape of a real book: new IDs come in at the top, old ones get
+cancelled or filled.
+*/
+
+namespace {
+
+struct StdMap {
+    std::unordered_map<uint64_t, uint32_t> map;
+    explicit StdMap(std::size_t n) { map.reserve(n); }
+    void insert(uint64_t key, uint32_t value) { map[key] = value; }
+    const uint32_t* find(uint64_t key) const {
+        auto it = map.find(key);
+        return it == map.end() ? nullptr : &it->second;
+    }
+    void erase(uint64_t key) { map.erase(key); }
+};
+
+struct FlatIndex {
+    OrderIndex<uint32_t> index;
+    explicit FlatIndex(std::size_t n) : index(n) {}
+    void insert(uint64_t key, uint32_t value) { index.insert(key, value); }
+    const uint32_t* find(uint64_t key) const { return index.find(key); }
+    void erase(uint64_t key) { index.erase(key); }
+};
+
+//Steady state: one new order in, the oldest cancelled
+template <typename Index>
+void BM_InsertCancel(benchmark::State& state) {
+    std::size_t live = static_cast<std::size_t>(state.range(0));
+    Index index(live * 2);
+    uint64_t next = 1;
+    for (; next <= live; ++next)
+        index.insert(next, static_cast<uint32_t>(next));
+
+    for (auto _ : state) {
+        index.insert(next, static_cast<uint32_t>(next));
+        index.erase(next - live);
+        ++next;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+//Cancel lookups scattered over the live IDs
+template <typename Index>
+void BM_FindHit(benchmark::State& state) {
+    std::size_t live = static_cast<std::size_t>(state.range(0));
+    Index index(live);
+    for (uint64_t id = 1; id <= live; ++id)
+        index.insert(id, static_cast<uint32_t>(id));
+
+    uint64_t id = 1;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.find(id));
+        //Stride through the IDs so consecutive lookups hit unrelated slots
+        id = (id + 7919) % live + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+//Cancels for orders that were already filled or cancelled
+template <typename Index>
+void BM_FindMiss(benchmark::State& state) {
+    std::size_t live = static_cast<std::size_t>(state.range(0));
+    Index index(live);
+    for (uint64_t id = 1; id <= live; ++id)
+        index.insert(id, static_cast<uint32_t>(id));
+
+    uint64_t id = live + 1;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.find(id));
+        ++id;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_InsertCancel, StdMap)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_InsertCancel, FlatIndex)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_FindHit, StdMap)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_FindHit, FlatIndex)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_FindMiss, StdMap)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_FindMiss, FlatIndex)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
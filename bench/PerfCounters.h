@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+User-space hardware counters (branch misses, instructions) for the calling thread,
+read through perf_event_open.
+
+Counters are unavailable in most VMs and containers, and wherever
+kernel.perf_event_paranoid forbids them; available() is then false and every read
+returns 0, so callers can report "n/a" instead of failing.
+*/
+class PerfCounters {
+    public:
+        PerfCounters() {
+            branchMisses_ = open(PERF_COUNT_HW_BRANCH_MISSES);
+            instructions_ = open(PERF_COUNT_HW_INSTRUCTIONS);
+        }
+
+        ~PerfCounters() {
+#if defined(__linux__)
+            if (branchMisses_ >= 0)
+                ::close(branchMisses_);
+            if (instructions_ >= 0)
+                ::close(instructions_);
+#endif
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        bool available() const { return branchMisses_ >= 0 && instructions_ >= 0; }
+
+        void start() {
+            control(branchMisses_, PERF_EVENT_IOC_RESET);
+            control(instructions_, PERF_EVENT_IOC_RESET);
+            control(branchMisses_, PERF_EVENT_IOC_ENABLE);
+            control(instructions_, PERF_EVENT_IOC_ENABLE);
+        }
+
+        void stop() {
+            control(branchMisses_, PERF_EVENT_IOC_DISABLE);
+            control(instructions_, PERF_EVENT_IOC_DISABLE);
+        }
+
+        uint64_t branchMisses() const { return read(branchMisses_); }
+        uint64_t instructions() const { return read(instructions_); }
+
+    private:
+#if defined(__linux__)
+        static int open(uint64_t config) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        static void control(int fd, unsigned long request) {
+            if (fd >= 0)
+                ::ioctl(fd, request, 0);
+        }
+
+        static uint64_t read(int fd) {
+            uint64_t value = 0;
+            if (fd < 0 || ::read(fd, &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value)))
+                return 0;
+            return value;
+        }
+#else
+        static int open(uint64_t) { return -1; }
+        static void control(int, unsigned long) {}
+        static uint64_t read(int) { return 0; }
+#endif
+
+        int branchMisses_;
+        int instructions_;
+};
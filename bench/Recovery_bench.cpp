@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include "OrderFlow.h"
+#include "../src/Journal.h"
+#include "../src/OrderBook.h"
+#include "../src/Snapshot.h"
+
+#include <cstdio>
+#include <string>
+
+/*
+Recovery throughput: how long a restart takes for a book of a given depth.
+
+Each benchmark builds its input once (a book with N resting orders, or a journal
+of N commands) and times only the load path, reporting orders/commands per second.
+*/
+
+namespace {
+
+//A book with 'count' resting orders spread over a couple of thousand levels per side
+BookSnapshot deepSnapshot(std::size_t count) {
+    OrderBookConfig config;
+    config.orderCapacity = count;
+    OrderBook book(config);
+    for (std::size_t i = 0; i < count; ++i) {
+        Price level = static_cast<Price>(1 + i % 2000);
+        bool buy = i % 2 == 0;
+        book.processOrder(Order(i + 1, buy ? OrderSide::BUY : OrderSide::SELL, 100, buy ? 10000 - level : 10000 + level), [](const Trade&) {});
+    }
+    BookSnapshot snapshot;
+    book.captureSnapshot(snapshot);
+    return snapshot;
+}
+
+} // namespace
+
+//Read the snapshot file and rebuild the book from it
+static void BM_SnapshotLoad(benchmark::State& state) {
+    std::size_t count = static_cast<std::size_t>(state.range(0));
+    std::string path = "agora_bench_snapshot.bin";
+    writeSnapshot(path, deepSnapshot(count));
+    for (auto _ : state) {
+        OrderBook book;
+        book.restoreSnapshot(readSnapshot(path));
+        benchmark::DoNotOptimize(book.getBids().size());
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_SnapshotLoad)->Arg(1 << 20)->Arg(4 << 20)->Unit(benchmark::kMillisecond);
+
+//Copy a live book into a snapshot buffer: the only part that holds up matching
+static void BM_SnapshotCapture(benchmark::State& state) {
+    std::size_t count = static_cast<std::size_t>(state.range(0));
+    OrderBook book;
+    book.restoreSnapshot(deepSnapshot(count));
+    BookSnapshot snapshot;
+    for (auto _ : state) {
+        book.captureSnapshot(snapshot);
+        benchmark::DoNotOptimize(snapshot.orders.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_SnapshotCapture)->Arg(1 << 20)->Arg(4 << 20)->Unit(benchmark::kMillisecond);
+
+//Replay a journal of realistic flow into an empty book
+static void BM_JournalReplay(benchmark::State& state) {
+    std::size_t count = static_cast<std::size_t>(state.range(0));
+    std::string path = "agora_bench_journal.bin";
+    std::remove(path.c_str());
+    {
+        JournalConfig config;
+        config.fsync = FsyncPolicy::None;
+        Journal journal(path, config);
+        OrderFlow flow;
+        for (std::size_t i = 0; i < count; ++i) {
+            FlowMessage message = flow.next();
+            if (message.kind == FlowMessage::Kind::New)
+                journal.appendNewOrder(message.order);
+            else
+                journal.appendCancel(message.cancelId);
+        }
+    }
+    for (auto _ : state) {
+        OrderBook book;
+        RecoveryStats stats = recoverBook(book, "agora_bench_no_snapshot.bin", path);
+        benchmark::DoNotOptimize(stats.lastSequence);
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+}
+BENCHMARK(BM_JournalReplay)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+//Append + group commit of 64-command batches, per command
+static void BM_JournalAppend(benchmark::State& state) {
+    std::string path = "agora_bench_journal_append.bin";
+    std::remove(path.c_str());
+    JournalConfig config;
+    config.fsync = static_cast<FsyncPolicy>(state.range(0));
+    Journal journal(path, config);
+    Order order(1, OrderSide::BUY, 100, 10000);
+    for (auto _ : state) {
+        for (int i = 0; i < 64; ++i) {
+            ++order.orderId;
+            journal.appendNewOrder(order);
+        }
+        journal.commit();
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_JournalAppend)->Arg(static_cast<int>(FsyncPolicy::None))->Arg(static_cast<int>(FsyncPolicy::Interval))->Arg(static_cast<int>(FsyncPolicy::EveryCommit));
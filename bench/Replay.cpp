@@ -0,0 +1,130 @@
+#include "Replay.h"
+
+#include "OrderFlow.h"
+#include "PerfCounters.h"
+#include "../src/CycleClock.h"
+#include "../src/LatencyHistogram.h"
+#include "../src/OrderBook.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct ReplayOptions {
+    std::size_t messages = 5'000'000;
+    std::size_t warmup = 500'000;
+    FlowConfig flow;
+};
+
+ReplayOptions parseOptions(int argc, char** argv) {
+    ReplayOptions options;
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&](const char* name) -> const char* {
+            std::size_t length = std::strlen(name);
+            if (std::strncmp(argv[i], name, length) == 0 && argv[i][length] == '=')
+                return argv[i] + length + 1;
+            return nullptr;
+        };
+        if (const char* v = value("--messages"))
+            options.messages = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--warmup"))
+            options.warmup = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--seed"))
+            options.flow.seed = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--cancel-ratio"))
+            options.flow.cancelRatio = std::strtod(v, nullptr);
+        else if (const char* v = value("--marketable-ratio"))
+            options.flow.marketableRatio = std::strtod(v, nullptr);
+    }
+    return options;
+}
+
+void printRow(const char* name, const LatencyHistogram& histogram, double nsPerTick) {
+    auto ns = [&](uint64_t ticks) { return static_cast<double>(ticks) * nsPerTick; };
+    std::printf("%-14s %12llu %10.0f %10.0f %10.0f %10.0f %12.0f\n", name,
+        static_cast<unsigned long long>(histogram.count()),
+        ns(histogram.percentile(50.0)), ns(histogram.percentile(99.0)),
+        ns(histogram.percentile(99.9)), ns(histogram.percentile(99.99)), ns(histogram.max()));
+}
+
+} // namespace
+
+int runReplay(int argc, char** argv) {
+    ReplayOptions options = parseOptions(argc, argv);
+    double nsPerTick = CycleClock::calibrate();
+
+    OrderFlow flow(options.flow);
+    std::vector<FlowMessage> messages = flow.generate(options.warmup + options.messages);
+
+    OrderBookConfig config;
+    config.orderCapacity = 1 << 20;
+    OrderBook book(config);
+
+    LatencyHistogram resting;
+    LatencyHistogram crossing;
+    LatencyHistogram cancels;
+    uint64_t fills = 0;
+    uint64_t filledQuantity = 0;
+    auto sink = [&](const Trade& trade) {
+        ++fills;
+        filledQuantity += trade.quantity;
+    };
+
+    PerfCounters counters;
+    auto wallStart = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < messages.size(); ++i) {
+        const FlowMessage& message = messages[i];
+        bool timed = i >= options.warmup;
+        if (i == options.warmup) {
+            wallStart = std::chrono::steady_clock::now();
+            counters.start();
+        }
+
+        if (message.kind == FlowMessage::Kind::New) {
+            uint64_t fillsBefore = fills;
+            uint64_t start = CycleClock::now();
+            book.processOrder(message.order, sink);
+            uint64_t elapsed = CycleClock::now() - start;
+            if (timed)
+                (fills == fillsBefore ? resting : crossing).record(elapsed);
+        } else {
+            uint64_t start = CycleClock::now();
+            book.cancelOrder(message.cancelId);
+            uint64_t elapsed = CycleClock::now() - start;
+            if (timed)
+                cancels.record(elapsed);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    counters.stop();
+
+    LatencyHistogram all;
+    all.merge(resting);
+    all.merge(crossing);
+    all.merge(cancels);
+
+    std::printf("Replay: %zu messages (+%zu warmup), seed %llu, cancel ratio %.2f\n",
+        options.messages, options.warmup, static_cast<unsigned long long>(options.flow.seed), options.flow.cancelRatio);
+    std::printf("Throughput: %.2f M msgs/s, %llu fills, %llu filled qty, %zu bid / %zu ask levels left\n\n",
+        static_cast<double>(options.messages) / seconds / 1e6,
+        static_cast<unsigned long long>(fills), static_cast<unsigned long long>(filledQuantity),
+        book.getBids().size(), book.getAsks().size());
+    //Includes the timing and histogram code around each operation, so compare runs, not absolutes
+    if (counters.available())
+        std::printf("Per message: %.2f branch misses, %.0f instructions\n\n",
+            static_cast<double>(counters.branchMisses()) / static_cast<double>(options.messages),
+            static_cast<double>(counters.instructions()) / static_cast<double>(options.messages));
+    else
+        std::printf("Per message: branch misses / instructions n/a (no hardware counters)\n\n");
+    std::printf("%-14s %12s %10s %10s %10s %10s %12s\n", "latency (ns)", "count", "p50", "p99", "p99.9", "p99.99", "max");
+    printRow("new resting", resting, nsPerTick);
+    printRow("new crossing", crossing, nsPerTick);
+    printRow("cancel", cancels, nsPerTick);
+    printRow("all", all, nsPerTick);
+    return 0;
+}
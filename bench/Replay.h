@@ -0,0 +1,18 @@
+#pragma once
+
+//Replays a seeded synthetic order stream through an OrderBook, timing every
+//operation, and prints latency percentiles. Returns a process exit code.
+int runReplay(int argc, char** argv);
+
+//Records a seeded synthetic stream as a binary order-entry capture (--record-session=FILE),
+//or mmaps a capture and pushes it through an OrderEntrySession (--session=FILE).
+int runSessionReplay(int argc, char** argv);
+
+//One writer publishing depth and trades into shared memory, N reader threads consuming
+//them through the reader library; prints publish cost and publish-to-read latency.
+int runSharedMemoryBench(int argc, char** argv);
+
+//Load-generator client for agora-core-app: N connections over loopback TCP or a Unix
+//socket, each keeping a window of requests in flight; prints throughput and round-trip
+//latency percentiles.
+int runLoadGenerator(int argc, char** argv);
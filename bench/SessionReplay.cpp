@@ -0,0 +1,136 @@
+#include "Replay.h"
+
+#include "OrderFlow.h"
+#include "../src/OrderEntrySession.h"
+#include "../src/Protocol.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr InstrumentId kInstrument = 1;
+
+//Encodes a seeded synthetic stream as order-entry wire messages
+std::vector<uint8_t> encodeFlow(std::size_t count, uint64_t seed) {
+    FlowConfig config;
+    config.seed = seed;
+    OrderFlow flow(config);
+
+    std::vector<uint8_t> bytes(count * protocol::kMaxMessageSize);
+    protocol::MessageWriter writer(bytes.data(), bytes.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        FlowMessage message = flow.next();
+        if (message.kind == FlowMessage::Kind::New)
+            writer.writeNewOrder(kInstrument, message.order);
+        else
+            writer.writeCancel(kInstrument, message.cancelId);
+    }
+    bytes.resize(writer.size());
+    return bytes;
+}
+
+//Counts outbound bytes without sending them anywhere
+struct NullFlush {
+    std::size_t* bytes;
+    void operator()(const uint8_t*, std::size_t size) { *bytes += size; }
+};
+
+//Decodes and applies a whole buffer, returning the number of report bytes produced
+std::size_t applySession(const uint8_t* data, std::size_t size) {
+    OrderBookConfig config;
+    config.orderCapacity = 1 << 20;
+    OrderBook book(config);
+    std::size_t reportBytes = 0;
+    alignas(8) static uint8_t out[64 * 1024];
+    OrderEntrySession<NullFlush> session(book, kInstrument, out, sizeof(out), NullFlush{&reportBytes});
+    session.onData(data, size);
+    session.flush();
+    return reportBytes;
+}
+
+const char* option(int argc, char** argv, const char* name) {
+    std::size_t length = std::strlen(name);
+    for (int i = 1; i < argc; ++i)
+        if (std::strncmp(argv[i], name, length) == 0 && argv[i][length] == '=')
+            return argv[i] + length + 1;
+    return nullptr;
+}
+
+int recordSession(const char* path, std::size_t messages, uint64_t seed) {
+    std::vector<uint8_t> bytes = encodeFlow(messages, seed);
+    std::FILE* file = std::fopen(path, "wb");
+    if (file == nullptr || std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size()) {
+        std::fprintf(stderr, "session: cannot write %s\n", path);
+        if (file != nullptr)
+            std::fclose(file);
+        return 1;
+    }
+    std::fclose(file);
+    std::printf("Recorded %zu messages (%zu bytes) to %s\n", messages, bytes.size(), path);
+    return 0;
+}
+
+int replaySession(const char* path) {
+    int fd = ::open(path, O_RDONLY);
+    struct stat info {};
+    if (fd < 0 || ::fstat(fd, &info) != 0 || info.st_size == 0) {
+        std::fprintf(stderr, "session: cannot open %s\n", path);
+        if (fd >= 0)
+            ::close(fd);
+        return 1;
+    }
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+
+    //Map the capture and decode it where it lies: no read() copies, no parsing buffers
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::fprintf(stderr, "session: cannot map %s\n", path);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::size_t reportBytes = applySession(static_cast<const uint8_t*>(mapped), size);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::munmap(mapped, size);
+
+    std::printf("Session: %zu bytes in, %zu bytes of reports out, %.3f s\n", size, reportBytes, seconds);
+    std::printf("Throughput: %.1f MB/s in\n", static_cast<double>(size) / seconds / 1e6);
+    return 0;
+}
+
+} // namespace
+
+int runSessionReplay(int argc, char** argv) {
+    const char* messages = option(argc, argv, "--messages");
+    const char* seed = option(argc, argv, "--seed");
+    if (const char* path = option(argc, argv, "--record-session"))
+        return recordSession(path, messages ? std::strtoull(messages, nullptr, 10) : 5'000'000,
+            seed ? std::strtoull(seed, nullptr, 10) : 42);
+    if (const char* path = option(argc, argv, "--session"))
+        return replaySession(path);
+    std::fprintf(stderr, "session: expected --session=FILE or --record-session=FILE\n");
+    return 1;
+}
+
+//Decode + match + encode for a pre-encoded stream, per message
+static void BM_SessionDecodeAndMatch(benchmark::State& state) {
+    std::size_t count = static_cast<std::size_t>(state.range(0));
+    std::vector<uint8_t> bytes = encodeFlow(count, 42);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(applySession(bytes.data(), bytes.size()));
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(count));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes.size()));
+}
+BENCHMARK(BM_SessionDecodeAndMatch)->Arg(100'000);
@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+#include "Replay.h"
+
+#include <cstring>
+
+/*
+agora-core-bench
+
+  agora-core-bench [--benchmark_* flags]   Google Benchmark microbenchmarks
+  agora-core-bench --replay [--messages=N] [--warmup=N] [--seed=N]
+                   [--cancel-ratio=R] [--marketable-ratio=R]
+                                           Seeded order-stream replay with latency percentiles
+  agora-core-bench --record-session=FILE [--messages=N] [--seed=N]
+                                           Writes a synthetic binary order-entry capture
+  agora-core-bench --session=FILE          Replays a capture through the protocol decoder
+  agora-core-bench --shm-readers=N [--messages=N] [--interval-ns=N] [--depth=N]
+                                           Shared-memory market data, 1 writer and N readers
+  agora-core-bench --loadgen [--host=A --port=N | --unix=PATH] [--connections=N]
+                   [--messages=N] [--window=N] [--seed=N]
+                                           Round-trip latency and throughput against agora-core-app
+*/
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], "--replay") == 0)
+            return runReplay(argc, argv);
+        else if (std::strncmp(argv[i], "--session=", 10) == 0 || std::strncmp(argv[i], "--record-session=", 17) == 0)
+            return runSessionReplay(argc, argv);
+        else if (std::strncmp(argv[i], "--shm-readers=", 14) == 0)
+            return runSharedMemoryBench(argc, argv);
+        else if (std::strcmp(argv[i], "--loadgen") == 0)
+            return runLoadGenerator(argc, argv);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "ReferenceBook.h"
+#include "../bench/OrderFlow.h"
+#include "../src/OrderBook.h"
+#include "../src/Snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+Differential testing: the same command stream through OrderBook and ReferenceBook.
+
+Each book runs the whole stream on its own (so both can be timed), recording every
+trade and the result of every command. The two records are then compared, then the
+books' final resting orders. Any difference is a bug in one of them.
+*/
+namespace differential {
+
+//What one book did with a stream
+struct Run {
+    std::vector<Trade> trades;
+    std::vector<uint32_t> results;      //Per command: cancelled quantity (new orders) or 0/1 (cancel, modify)
+    std::vector<Order> resting;         //Final book, in snapshot order
+    std::vector<StopOrder> stops;       //Final pending stops, in snapshot order
+    double seconds = 0.0;
+};
+
+//Outcome of a comparison: empty 'mismatch' means the books agreed
+struct Report {
+    std::size_t commands = 0;
+    std::size_t trades = 0;
+    std::size_t resting = 0;
+    double optimizedSeconds = 0.0;
+    double referenceSeconds = 0.0;
+    std::string mismatch;
+
+    bool ok() const { return mismatch.empty(); }
+};
+
+//Turns a generated flow message into the book's command format
+inline BookCommand toCommand(const FlowMessage& message) {
+    switch (message.kind) {
+        case FlowMessage::Kind::New:
+            return BookCommand::newOrder(message.order);
+        case FlowMessage::Kind::Cancel:
+            return BookCommand::cancel(message.cancelId);
+        case FlowMessage::Kind::Stop:
+            return BookCommand::newStop(message.order, message.triggerPrice);
+        default:
+            return BookCommand::modify(message.order.orderId, message.order.price, message.order.quantity);
+    }
+}
+
+//A seeded stream using every kind of command and order type
+inline std::vector<BookCommand> generateCommands(const FlowConfig& config, std::size_t count) {
+    OrderFlow flow(config);
+    std::vector<BookCommand> commands;
+    commands.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        commands.push_back(toCommand(flow.next()));
+    return commands;
+}
+
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline Run runOptimized(const std::vector<BookCommand>& commands, const OrderBookConfig& config = OrderBookConfig{}) {
+    Run run;
+    run.results.reserve(commands.size());
+    OrderBook book(config);
+    auto sink = [&run](const Trade& trade) { run.trades.push_back(trade); };
+
+    auto start = std::chrono::steady_clock::now();
+    for (const BookCommand& command : commands) {
+        switch (command.type) {
+            case BookCommand::Type::NewOrder:
+                run.results.push_back(book.processOrder(command.order, sink));
+                break;
+            case BookCommand::Type::Cancel:
+                run.results.push_back(book.cancelOrder(command.order.orderId));
+                break;
+            case BookCommand::Type::Modify:
+                run.results.push_back(book.modifyOrder(command.order.orderId, command.order.price, command.order.quantity, sink));
+                break;
+            case BookCommand::Type::NewStop:
+                book.placeStop(command.order, command.triggerPrice);
+                run.results.push_back(0);
+                break;
+        }
+    }
+    run.seconds = secondsSince(start);
+
+    BookSnapshot snapshot;
+    book.captureSnapshot(snapshot);
+    run.resting = std::move(snapshot.orders);
+    run.stops = std::move(snapshot.stops);
+    return run;
+}
+
+//Same stream through OrderBook::processBatch. Per-command results are not available there.
+inline Run runBatched(const std::vector<BookCommand>& commands) {
+    Run run;
+    OrderBook book;
+    auto start = std::chrono::steady_clock::now();
+    book.processBatch(commands.data(), commands.size(), [&run](const Trade& trade) { run.trades.push_back(trade); });
+    run.seconds = secondsSince(start);
+
+    BookSnapshot snapshot;
+    book.captureSnapshot(snapshot);
+    run.resting = std::move(snapshot.orders);
+    run.stops = std::move(snapshot.stops);
+    return run;
+}
+
+inline Run runReference(const std::vector<BookCommand>& commands) {
+    Run run;
+    run.results.reserve(commands.size());
+    ReferenceBook book;
+    auto sink = [&run](const Trade& trade) { run.trades.push_back(trade); };
+
+    auto start = std::chrono::steady_clock::now();
+    for (const BookCommand& command : commands) {
+        switch (command.type) {
+            case BookCommand::Type::NewOrder:
+                run.results.push_back(book.processOrder(command.order, sink));
+                break;
+            case BookCommand::Type::Cancel:
+                run.results.push_back(book.cancelOrder(command.order.orderId));
+                break;
+            case BookCommand::Type::Modify:
+                run.results.push_back(book.modifyOrder(command.order.orderId, command.order.price, command.order.quantity, sink));
+                break;
+            case BookCommand::Type::NewStop:
+                book.placeStop(command.order, command.triggerPrice);
+                run.results.push_back(0);
+                break;
+        }
+    }
+    run.seconds = secondsSince(start);
+    run.resting = book.restingOrders();
+    run.stops = book.pendingStops();
+    return run;
+}
+
+inline std::string describe(const Trade& trade) {
+    char text[128];
+    std::snprintf(text, sizeof(text), "trade %llu: buy %llu sell %llu %lld x %u",
+        static_cast<unsigned long long>(trade.tradeId), static_cast<unsigned long long>(trade.buyOrderId),
+        static_cast<unsigned long long>(trade.sellOrderId), static_cast<long long>(trade.price), trade.quantity);
+    return text;
+}
+
+inline std::string describe(const Order& order) {
+    char text[128];
+    std::snprintf(text, sizeof(text), "order %llu: %s %lld x %u",
+        static_cast<unsigned long long>(order.orderId), order.side == OrderSide::BUY ? "buy" : "sell",
+        static_cast<long long>(order.price), order.quantity);
+    return text;
+}
+
+//First difference in trades or final book between two runs, or an empty string
+inline std::string diffBooks(const Run& optimized, const Run& reference) {
+    std::size_t trades = std::min(optimized.trades.size(), reference.trades.size());
+    for (std::size_t i = 0; i < trades; ++i) {
+        const Trade& a = optimized.trades[i];
+        const Trade& b = reference.trades[i];
+        if (a.tradeId != b.tradeId || a.buyOrderId != b.buyOrderId || a.sellOrderId != b.sellOrderId
+            || a.price != b.price || a.quantity != b.quantity)
+            return describe(a) + ", reference " + describe(b);
+    }
+    if (optimized.trades.size() != reference.trades.size())
+        return std::to_string(optimized.trades.size()) + " trades, reference " + std::to_string(reference.trades.size());
+
+    std::size_t resting = std::min(optimized.resting.size(), reference.resting.size());
+    for (std::size_t i = 0; i < resting; ++i) {
+        const Order& a = optimized.resting[i];
+        const Order& b = reference.resting[i];
+        if (a.orderId != b.orderId || a.side != b.side || a.price != b.price || a.quantity != b.quantity)
+            return "resting " + describe(a) + ", reference " + describe(b);
+    }
+    if (optimized.resting.size() != reference.resting.size())
+        return std::to_string(optimized.resting.size()) + " resting orders, reference " + std::to_string(reference.resting.size());
+
+    std::size_t stops = std::min(optimized.stops.size(), reference.stops.size());
+    for (std::size_t i = 0; i < stops; ++i) {
+        const StopOrder& a = optimized.stops[i];
+        const StopOrder& b = reference.stops[i];
+        if (a.order.orderId != b.order.orderId || a.triggerPrice != b.triggerPrice)
+            return "stop " + describe(a.order) + ", reference " + describe(b.order);
+    }
+    if (optimized.stops.size() != reference.stops.size())
+        return std::to_string(optimized.stops.size()) + " stops, reference " + std::to_string(reference.stops.size());
+    return {};
+}
+
+//Runs both books over 'commands' (the optimized one three times: per command, batched,
+//and per command with lazy cancels) and reports the first difference, if any
+inline Report compare(const std::vector<BookCommand>& commands) {
+    Run optimized = runOptimized(commands);
+    Run reference = runReference(commands);
+
+    Report report;
+    report.commands = commands.size();
+    report.trades = reference.trades.size();
+    report.resting = reference.resting.size();
+    report.optimizedSeconds = optimized.seconds;
+    report.referenceSeconds = reference.seconds;
+
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        if (optimized.results[i] != reference.results[i]) {
+            report.mismatch = "command " + std::to_string(i) + ": result " + std::to_string(optimized.results[i])
+                + ", reference " + std::to_string(reference.results[i]);
+            return report;
+        }
+    }
+    report.mismatch = diffBooks(optimized, reference);
+    if (report.ok()) {
+        std::string batched = diffBooks(runBatched(commands), reference);
+        if (!batched.empty())
+            report.mismatch = "processBatch: " + batched;
+    }
+    if (report.ok()) {
+        OrderBookConfig config;
+        config.cancelMode = CancelMode::Lazy;
+        Run lazy = runOptimized(commands, config);
+        std::string mismatch = lazy.results != reference.results ? "per-command results differ" : diffBooks(lazy, reference);
+        if (!mismatch.empty())
+            report.mismatch = "lazy cancel: " + mismatch;
+    }
+    return report;
+}
+
+/*
+Decodes arbitrary bytes into a valid command stream, for fuzzing.
+
+Every 8-byte chunk is one command. New orders get fresh sequential IDs and a
+quantity of at least 1; cancels and modifies pick an ID already sent (it may
+since have filled or been cancelled, which the books must also agree on).
+Prices stay within a narrow band so orders actually meet, new orders get one
+of a handful of owners so self-trade prevention comes up often, and a quarter of
+them are stops triggered a few ticks from their price.
+*/
+inline std::vector<BookCommand> decodeCommands(const uint8_t* data, std::size_t size) {
+    std::vector<BookCommand> commands;
+    commands.reserve(size / 8);
+    uint64_t nextId = 1;
+    for (std::size_t offset = 0; offset + 8 <= size; offset += 8) {
+        const uint8_t* bytes = data + offset;
+        Price price = 1000 + static_cast<int8_t>(bytes[1]) / 8;
+        uint32_t quantity = static_cast<uint32_t>(bytes[2]) | static_cast<uint32_t>(bytes[3]) << 8;
+        OwnerId owner = bytes[6] >> 5;     //0 (none) to 7
+        uint64_t known = nextId > 1 ? 1 + (static_cast<uint64_t>(bytes[4]) | static_cast<uint64_t>(bytes[5]) << 8) % (nextId - 1) : 0;
+
+        switch (bytes[0] % 4) {
+            case 0:
+            case 1: {
+                OrderSide side = bytes[6] & 1 ? OrderSide::SELL : OrderSide::BUY;
+                OrderType type = static_cast<OrderType>((bytes[7] % 8) < 4 ? 0 : bytes[7] % 8 - 3);
+                Order order(nextId++, side, quantity % 1000 + 1, price, type);
+                order.owner = owner;
+                order.selfTrade = static_cast<SelfTradePrevention>((bytes[6] >> 1) % 3);
+                if (bytes[7] >> 6 == 3)
+                    commands.push_back(BookCommand::newStop(order, price + ((bytes[7] >> 3) & 7) - 3));
+                else
+                    commands.push_back(BookCommand::newOrder(order));
+                break;
+            }
+            case 2:
+                if (known != 0)
+                    commands.push_back(BookCommand::cancel(known));
+                break;
+            default:
+                if (known != 0)
+                    commands.push_back(BookCommand::modify(known, price, quantity % 1000));
+                break;
+        }
+    }
+    return commands;
+}
+
+} // namespace differential
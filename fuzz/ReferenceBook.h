@@ -0,0 +1,287 @@
+#pragma once
+
+#include "../src/Order.h"
+#include "../src/Trade.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+/*
+The simplest possible order book, as an oracle for the real one.
+
+Sorted std::maps of FIFO deques and a hash map from ID to side/price, with every
+rule spelled out once in the most obvious way. It has to be easy to convince
+yourself this is right; speed does not matter.
+
+Same contract as OrderBook: unique order IDs, quantities above zero.
+*/
+class ReferenceBook {
+    public:
+        //Returns the quantity cancelled rather than filled or rested, like OrderBook::processOrder
+        uint32_t processOrder(const Order& newOrder, const std::function<void(const Trade&)>& sink) {
+            traded_ = false;
+            uint32_t cancelled = execute(newOrder, sink);
+            fireStops(sink);
+            return cancelled;
+        }
+
+        void placeStop(const Order& order, Price triggerPrice) {
+            stops_.push_back(StopOrder{order, triggerPrice});
+        }
+
+        bool cancelOrder(uint64_t orderId) {
+            auto found = where_.find(orderId);
+            if (found == where_.end()) {
+                auto stop = std::find_if(stops_.begin(), stops_.end(), [orderId](const StopOrder& s) { return s.order.orderId == orderId; });
+                if (stop == stops_.end())
+                    return false;
+                stops_.erase(stop);
+                return true;
+            }
+            remove(orderId, found->second.first, found->second.second);
+            return true;
+        }
+
+        bool modifyOrder(uint64_t orderId, Price newPrice, uint32_t newQuantity, const std::function<void(const Trade&)>& sink) {
+            traded_ = false;
+            bool modified = amend(orderId, newPrice, newQuantity, sink);
+            fireStops(sink);
+            return modified;
+        }
+
+        //Resting orders in priority order: asks LOWEST first, then bids HIGHEST first, oldest first
+        std::vector<Order> restingOrders() const {
+            std::vector<Order> orders;
+            for (const auto& [price, queue] : asks_)
+                orders.insert(orders.end(), queue.begin(), queue.end());
+            for (const auto& [price, queue] : bids_)
+                orders.insert(orders.end(), queue.begin(), queue.end());
+            return orders;
+        }
+
+        //Pending stops in snapshot order: buys then sells, each by trigger from LOWEST, oldest first
+        std::vector<StopOrder> pendingStops() const {
+            std::vector<StopOrder> stops;
+            for (OrderSide side : {OrderSide::BUY, OrderSide::SELL})
+                for (const StopOrder& stop : stops_)
+                    if (stop.order.side == side)
+                        stops.push_back(stop);
+            std::stable_sort(stops.begin(), stops.end(), [](const StopOrder& a, const StopOrder& b) {
+                return a.order.side != b.order.side ? a.order.side == OrderSide::BUY : a.triggerPrice < b.triggerPrice;
+            });
+            return stops;
+        }
+
+    private:
+        using Asks = std::map<Price, std::deque<Order>>;
+        using Bids = std::map<Price, std::deque<Order>, std::greater<Price>>;
+
+        uint32_t execute(const Order& newOrder, const std::function<void(const Trade&)>& sink) {
+            Order order = newOrder;
+            bool rests = order.type == OrderType::Limit || order.type == OrderType::PostOnly;
+
+            if (order.type == OrderType::FillOrKill && available(order) < order.quantity)
+                return order.quantity;
+            if (order.type == OrderType::PostOnly && crosses(order))
+                return order.quantity;
+
+            Outcome outcome = match(order, sink);
+            if (order.quantity == 0)
+                return 0;
+            if (rests && !outcome.cancelledNewest) {
+                rest(order);
+                return 0;
+            }
+            return order.quantity;
+        }
+
+        bool amend(uint64_t orderId, Price newPrice, uint32_t newQuantity, const std::function<void(const Trade&)>& sink) {
+            auto found = where_.find(orderId);
+            if (found == where_.end())
+                return false;
+            if (newQuantity == 0)
+                return cancelOrder(orderId);
+
+            OrderSide side = found->second.first;
+            Price price = found->second.second;
+            std::deque<Order>& queue = side == OrderSide::BUY ? bids_[price] : asks_[price];
+            auto it = std::find_if(queue.begin(), queue.end(), [orderId](const Order& o) { return o.orderId == orderId; });
+
+            //Reducing at the same price keeps the order where it is
+            if (newPrice == price && newQuantity <= it->quantity) {
+                it->quantity = newQuantity;
+                return true;
+            }
+
+            //Anything else is: take it out, then treat it as a new limit order at the new terms
+            Order order = *it;
+            remove(orderId, side, price);
+            order.price = newPrice;
+            order.quantity = newQuantity;
+            //A post-only order still may not take liquidity: crossing cancels it
+            if (order.type == OrderType::PostOnly && crosses(order))
+                return true;
+            Order asLimit = order;
+            asLimit.type = OrderType::Limit;
+            Outcome outcome = match(asLimit, sink);
+            if (asLimit.quantity > 0 && !outcome.cancelledNewest) {
+                order.quantity = asLimit.quantity;
+                rest(order);
+            }
+            return true;
+        }
+
+        //Once an order is done: if it traded, every stop its last trade price reaches becomes a
+        //new order - buys by trigger from lowest, then sells from highest, oldest first at each
+        //trigger - and the stops those orders' trades reach queue up behind them
+        void fireStops(const std::function<void(const Trade&)>& sink) {
+            std::deque<Order> queue;
+            if (traded_)
+                takeReached(lastTradePrice_, queue);
+            while (!queue.empty()) {
+                Order order = queue.front();
+                queue.pop_front();
+                traded_ = false;
+                execute(order, sink);
+                if (traded_)
+                    takeReached(lastTradePrice_, queue);
+            }
+        }
+
+        void takeReached(Price tradePrice, std::deque<Order>& queue) {
+            std::vector<StopOrder> buys, sells, waiting;
+            for (const StopOrder& stop : stops_) {
+                if (stop.order.side == OrderSide::BUY && tradePrice >= stop.triggerPrice)
+                    buys.push_back(stop);
+                else if (stop.order.side == OrderSide::SELL && tradePrice <= stop.triggerPrice)
+                    sells.push_back(stop);
+                else
+                    waiting.push_back(stop);
+            }
+            stops_ = waiting;
+            std::stable_sort(buys.begin(), buys.end(), [](const StopOrder& a, const StopOrder& b) { return a.triggerPrice < b.triggerPrice; });
+            std::stable_sort(sells.begin(), sells.end(), [](const StopOrder& a, const StopOrder& b) { return a.triggerPrice > b.triggerPrice; });
+            for (const StopOrder& stop : buys)
+                queue.push_back(stop.order);
+            for (const StopOrder& stop : sells)
+                queue.push_back(stop.order);
+        }
+
+        bool reaches(const Order& order, Price level) const {
+            if (order.type == OrderType::Market)
+                return true;
+            return order.side == OrderSide::BUY ? order.price >= level : order.price <= level;
+        }
+
+        bool crosses(const Order& order) const {
+            if (order.side == OrderSide::BUY)
+                return !asks_.empty() && reaches(order, asks_.begin()->first);
+            return !bids_.empty() && reaches(order, bids_.begin()->first);
+        }
+
+        bool sameOwner(const Order& order, const Order& resting) const {
+            return order.owner != kNoOwner && resting.owner == order.owner;
+        }
+
+        //Quantity the order could fill on the other side at prices it accepts. Its own orders
+        //either get cancelled out of the way (CancelOldest) or end the fill.
+        uint64_t available(const Order& order) const {
+            uint64_t total = 0;
+            auto add = [&](const auto& levels) {
+                for (const auto& [price, queue] : levels) {
+                    if (!reaches(order, price))
+                        return;
+                    for (const Order& resting : queue) {
+                        if (!sameOwner(order, resting))
+                            total += resting.quantity;
+                        else if (order.selfTrade != SelfTradePrevention::CancelOldest && total < order.quantity)
+                            return;
+                    }
+                }
+            };
+            if (order.side == OrderSide::BUY)
+                add(asks_);
+            else
+                add(bids_);
+            return total;
+        }
+
+        //What self-trade prevention did to an incoming order
+        struct Outcome {
+            bool cancelledNewest = false;   //CancelNewest hit: the rest is cancelled
+        };
+
+        //Trades 'order' against the other side, best price first, oldest first
+        Outcome match(Order& order, const std::function<void(const Trade&)>& sink) {
+            Outcome outcome;
+            while (order.quantity > 0 && crosses(order)) {
+                std::deque<Order>& queue = order.side == OrderSide::BUY ? asks_.begin()->second : bids_.begin()->second;
+                Order& resting = queue.front();
+                uint32_t quantity = std::min(order.quantity, resting.quantity);
+                if (sameOwner(order, resting)) {
+                    if (order.selfTrade == SelfTradePrevention::CancelNewest) {
+                        outcome.cancelledNewest = true;
+                        return outcome;
+                    }
+                    if (order.selfTrade == SelfTradePrevention::CancelOldest) {
+                        remove(resting.orderId, resting.side, resting.price);
+                        continue;
+                    }
+                    order.quantity -= quantity;
+                    resting.quantity -= quantity;
+                    if (resting.quantity == 0)
+                        remove(resting.orderId, resting.side, resting.price);
+                    continue;
+                }
+                if (order.side == OrderSide::BUY)
+                    sink(Trade(nextTradeId_++, order.orderId, resting.orderId, resting.price, quantity));
+                else
+                    sink(Trade(nextTradeId_++, resting.orderId, order.orderId, resting.price, quantity));
+                traded_ = true;
+                lastTradePrice_ = resting.price;
+                order.quantity -= quantity;
+                resting.quantity -= quantity;
+                if (resting.quantity == 0)
+                    remove(resting.orderId, resting.side, resting.price);
+            }
+            return outcome;
+        }
+
+        void rest(const Order& order) {
+            if (order.side == OrderSide::BUY)
+                bids_[order.price].push_back(order);
+            else
+                asks_[order.price].push_back(order);
+            where_[order.orderId] = {order.side, order.price};
+        }
+
+        void remove(uint64_t orderId, OrderSide side, Price price) {
+            auto erase = [&](auto& levels) {
+                auto level = levels.find(price);
+                std::deque<Order>& queue = level->second;
+                queue.erase(std::find_if(queue.begin(), queue.end(), [orderId](const Order& o) { return o.orderId == orderId; }));
+                if (queue.empty())
+                    levels.erase(level);
+            };
+            if (side == OrderSide::BUY)
+                erase(bids_);
+            else
+                erase(asks_);
+            where_.erase(orderId);
+        }
+
+        Asks asks_;
+        Bids bids_;
+        std::unordered_map<uint64_t, std::pair<OrderSide, Price>> where_;
+        uint64_t nextTradeId_ = 1;
+
+        //Stops in the order they were placed, and the last trade of the order being processed
+        std::vector<StopOrder> stops_;
+        bool traded_ = false;
+        Price lastTradePrice_ = 0;
+};
@@ -0,0 +1,53 @@
+#include "Differential.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+agora-core-diff: seeded differential runs of OrderBook against ReferenceBook.
+
+  agora-core-diff [--messages=N] [--seed=N] [--seeds=K]
+
+Runs K streams of N messages (seeds N, N+1, ...), mixing new orders of every
+type, stops, cancels and amends. Exits non-zero on the first disagreement.
+*/
+int main(int argc, char** argv) {
+    std::size_t messages = 1'000'000;
+    uint64_t seed = 1;
+    uint64_t seeds = 1;
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&](const char* name) -> const char* {
+            std::size_t length = std::strlen(name);
+            if (std::strncmp(argv[i], name, length) == 0 && argv[i][length] == '=')
+                return argv[i] + length + 1;
+            return nullptr;
+        };
+        if (const char* v = value("--messages"))
+            messages = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--seed"))
+            seed = std::strtoull(v, nullptr, 10);
+        else if (const char* v = value("--seeds"))
+            seeds = std::strtoull(v, nullptr, 10);
+    }
+
+    std::printf("%-8s %12s %12s %10s %14s %14s\n", "seed", "messages", "trades", "resting", "optimized/s", "reference/s");
+    for (uint64_t s = seed; s < seed + seeds; ++s) {
+        FlowConfig config;
+        config.seed = s;
+        config.cancelRatio = 0.4;
+        config.modifyRatio = 0.15;
+        config.typedRatio = 0.2;
+        config.owners = 20;
+        config.stopRatio = 0.05;
+        differential::Report report = differential::compare(differential::generateCommands(config, messages));
+
+        std::printf("%-8llu %12zu %12zu %10zu %14.0f %14.0f\n", static_cast<unsigned long long>(s), report.commands,
+            report.trades, report.resting, report.commands / report.optimizedSeconds, report.commands / report.referenceSeconds);
+        if (!report.ok()) {
+            std::fprintf(stderr, "seed %llu: MISMATCH at %s\n", static_cast<unsigned long long>(s), report.mismatch.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
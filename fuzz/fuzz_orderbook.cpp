@@ -0,0 +1,14 @@
+#include "Differential.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+//libFuzzer entry point: any input is a valid command stream, and both books must agree on it
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size) {
+    differential::Report report = differential::compare(differential::decodeCommands(data, size));
+    if (!report.ok()) {
+        std::fprintf(stderr, "MISMATCH at %s\n", report.mismatch.c_str());
+        std::abort();
+    }
+    return 0;
+}
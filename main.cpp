@@ -1,6 +1,83 @@
+#include "src/Gateway.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+
+#include <pthread.h>
+
+/*
+agora-core-app: the order-entry gateway
+
+  agora-core-app [--host=A] [--port=N] [--no-tcp] [--unix=PATH] [--backend=auto|epoll|io_uring]
+                 [--instrument=N] [--orders=N] [--risk=FILE]
+
+Serves one book until SIGINT or SIGTERM. Drive it with agora-core-bench --loadgen.
+*/
+int main(int argc, char** argv) {
+    GatewayConfig config;
+    config.port = 9001;
+    config.book.orderCapacity = 1 << 20;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            auto value = [&](const char* name) -> const char* {
+                std::size_t length = std::strlen(name);
+                if (std::strncmp(argv[i], name, length) == 0 && argv[i][length] == '=')
+                    return argv[i] + length + 1;
+                return nullptr;
+            };
+            if (const char* v = value("--host"))
+                config.host = v;
+            else if (const char* v = value("--port"))
+                config.port = static_cast<uint16_t>(std::strtoul(v, nullptr, 10));
+            else if (std::strcmp(argv[i], "--no-tcp") == 0)
+                config.listenTcp = false;
+            else if (const char* v = value("--unix"))
+                config.unixPath = v;
+            else if (const char* v = value("--instrument"))
+                config.instrument = static_cast<InstrumentId>(std::strtoul(v, nullptr, 10));
+            else if (const char* v = value("--orders"))
+                config.book.orderCapacity = std::strtoull(v, nullptr, 10);
+            else if (const char* v = value("--risk"))
+                config.risk = RiskConfig::load(v);
+            else if (const char* v = value("--backend")) {
+                if (std::strcmp(v, "epoll") == 0)
+                    config.backend = IoBackend::Epoll;
+                else if (std::strcmp(v, "io_uring") == 0)
+                    config.backend = IoBackend::IoUring;
+                else if (std::strcmp(v, "auto") != 0)
+                    throw std::runtime_error(std::string("unknown backend ") + v);
+            } else {
+                throw std::runtime_error(std::string("unknown option ") + argv[i]);
+            }
+        }
+
+        //Blocked before any thread starts, so only sigwait() below sees them
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        Gateway gateway(config);
+        gateway.start();
+        std::cout << "Agora Core gateway: instrument " << config.instrument << ", "
+            << (gateway.backend() == IoBackend::IoUring ? "io_uring" : "epoll");
+        if (config.listenTcp)
+            std::cout << ", tcp " << config.host << ":" << gateway.port();
+        if (!config.unixPath.empty())
+            std::cout << ", unix " << config.unixPath;
+        std::cout << std::endl;
 
-int main() {
-    std::cout << "Agora Core Application" << std::endl;
+        int signal;
+        sigwait(&signals, &signal);
+        gateway.stop();
+        std::cout << "Stopped" << std::endl;
+    } catch (const std::exception& error) {
+        std::cerr << "agora-core-app: " << error.what() << std::endl;
+        return 1;
+    }
     return 0;
-}
\ No newline at end of file
+}
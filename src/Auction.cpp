@@ -0,0 +1,80 @@
+#include "Auction.h"
+#include "PrefixSum.h"
+
+#include <algorithm>
+
+void AuctionCurves::reset(Price first, Price last) {
+    first_ = first;
+    last_ = last;
+    std::size_t ticks = last >= first ? static_cast<std::size_t>(last - first) + 1 : 0;
+    demand_.assign(ticks, 0);
+    supply_.assign(ticks, 0);
+}
+
+void AuctionCurves::accumulate() {
+    prefixSum(demand_.data(), demand_.size());
+    prefixSum(supply_.data(), supply_.size());
+}
+
+AuctionResult AuctionCurves::equilibrium(Price referencePrice) const {
+    std::size_t ticks = supply_.size();
+    const uint64_t* demand = demand_.data();
+    const uint64_t* supply = supply_.data();
+
+    //Pass 1: the best volume, and the smallest surplus among the prices that reach it
+    uint64_t bestVolume = 0;
+    uint64_t bestSurplus = 0;
+    for (std::size_t i = 0; i < ticks; ++i) {
+        uint64_t d = demand[ticks - 1 - i];
+        uint64_t s = supply[i];
+        uint64_t volume = std::min(d, s);
+        uint64_t surplus = d > s ? d - s : s - d;
+        if (volume > bestVolume || (volume == bestVolume && surplus < bestSurplus)) {
+            bestVolume = volume;
+            bestSurplus = surplus;
+        }
+    }
+    if (bestVolume == 0)
+        return {};
+
+    //Pass 2: among the prices tied on both, which sides the surplus falls on and the
+    //candidates each remaining rule would pick
+    bool allBuySurplus = true;
+    bool allSellSurplus = true;
+    Price lowest = 0;
+    Price highest = 0;
+    Price nearest = 0;
+    uint64_t nearestDistance = 0;
+    bool found = false;
+    for (std::size_t i = 0; i < ticks; ++i) {
+        uint64_t d = demand[ticks - 1 - i];
+        uint64_t s = supply[i];
+        uint64_t surplus = d > s ? d - s : s - d;
+        if (std::min(d, s) != bestVolume || surplus != bestSurplus)
+            continue;
+
+        Price price = first_ + static_cast<Price>(i);
+        allBuySurplus &= d > s;
+        allSellSurplus &= s > d;
+        uint64_t distance = price > referencePrice
+            ? static_cast<uint64_t>(price - referencePrice)
+            : static_cast<uint64_t>(referencePrice - price);
+        if (!found) {
+            lowest = price;
+            nearest = price;
+            nearestDistance = distance;
+            found = true;
+        } else if (distance < nearestDistance) {
+            //Ascending scan: on equal distance the lower price stays
+            nearest = price;
+            nearestDistance = distance;
+        }
+        highest = price;
+    }
+
+    AuctionResult result;
+    result.price = allBuySurplus ? highest : allSellSurplus ? lowest : nearest;
+    result.volume = bestVolume;
+    result.imbalance = static_cast<int64_t>(demandAt(result.price)) - static_cast<int64_t>(supplyAt(result.price));
+    return result;
+}
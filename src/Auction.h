@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Order.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Whether new orders match as they arrive or queue up for a call auction
+enum class TradingPhase : uint8_t {
+    Continuous, //Orders match one at a time as they arrive (the default)
+    Auction     //Limit orders rest without matching, even crossed, until OrderBook::uncrossAuction
+};
+
+//Outcome of a call auction's price determination
+struct AuctionResult {
+    Price price = 0;            //Equilibrium price; only meaningful when volume > 0
+    uint64_t volume = 0;        //Quantity that executes at 'price'
+    int64_t imbalance = 0;      //Buy minus sell quantity willing to trade at 'price' (> 0: buy surplus)
+    std::size_t trades = 0;     //Fills made by the uncross (0 for an indicative result)
+};
+
+/*
+The cumulative bid and ask curves of a crossed book over the ticks [first, last] the
+two sides overlap on, and the price they pick.
+
+Demand at p is everything bid at or above p, supply everything offered at or below
+it. Both are filled in as per-tick totals laid out so that each curve is a single
+forward prefix sum over a contiguous array: asks in ascending tick order, bids in
+descending order. The equilibrium is then chosen with the usual call-auction rules:
+  1. the most executable volume, min(demand, supply);
+  2. then the smallest surplus |demand - supply|;
+  3. then, if every remaining price has a buy surplus, the highest; if every one has
+     a sell surplus, the lowest;
+  4. otherwise the price nearest the reference price (the lower one if two are).
+*/
+class AuctionCurves {
+    public:
+        //Zeroes the curves for ticks [first, last]
+        void reset(Price first, Price last);
+
+        std::size_t ticks() const { return supply_.size(); }
+
+        //Per-tick totals to fill in before accumulate(): bids(i) is the tick last - i,
+        //asks(i) the tick first + i
+        uint64_t* bids() { return demand_.data(); }
+        uint64_t* asks() { return supply_.data(); }
+
+        //Turns the per-tick totals into the cumulative curves
+        void accumulate();
+
+        uint64_t demandAt(Price tick) const { return demand_[static_cast<std::size_t>(last_ - tick)]; }
+        uint64_t supplyAt(Price tick) const { return supply_[static_cast<std::size_t>(tick - first_)]; }
+
+        //Applies the rules above. Volume 0 if the curves never meet.
+        AuctionResult equilibrium(Price referencePrice) const;
+
+    private:
+        Price first_ = 0;
+        Price last_ = -1;
+        std::vector<uint64_t> demand_;
+        std::vector<uint64_t> supply_;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+
+#include <cstdint>
+
+//Set to 1 (CMake option AGORA_BOOK_STATS=ON) to compile the instrumentation into the book.
+//Off, every hook is an empty inline function and the book carries no stats at all.
+#ifndef AGORA_BOOK_STATS
+#define AGORA_BOOK_STATS 0
+#endif
+
+//Plain event counts kept by one book
+struct BookCounters {
+    uint64_t ordersReceived = 0;    //New orders accepted for processing
+    uint64_t ordersRested = 0;      //New or amended orders (or remainders) added to a level
+    uint64_t ordersCancelled = 0;   //Remainders cancelled by the order type (market, IOC, FOK, post-only)
+    uint64_t fills = 0;             //Trades
+    uint64_t filledQuantity = 0;
+    uint64_t levelsCreated = 0;
+    uint64_t levelsDestroyed = 0;
+    uint64_t cancelHits = 0;
+    uint64_t cancelMisses = 0;      //Cancels of orders that were not resting
+    uint64_t modifyHits = 0;        //Amends applied (an amend to quantity 0 counts as a cancel)
+    uint64_t modifyMisses = 0;
+    uint64_t aggressiveOrders = 0;  //Orders (including crossing amends) that reached the matching loop
+    uint64_t levelsWalked = 0;      //Opposite levels traded against, summed over aggressive orders
+    uint64_t selfTradesPrevented = 0;
+    uint64_t tombstonesReclaimed = 0;   //Lazily cancelled nodes unlinked and freed (CancelMode::Lazy)
+    uint64_t stopsTriggered = 0;
+
+    void merge(const BookCounters& other) {
+        ordersReceived += other.ordersReceived;
+        ordersRested += other.ordersRested;
+        ordersCancelled += other.ordersCancelled;
+        fills += other.fills;
+        filledQuantity += other.filledQuantity;
+        levelsCreated += other.levelsCreated;
+        levelsDestroyed += other.levelsDestroyed;
+        cancelHits += other.cancelHits;
+        cancelMisses += other.cancelMisses;
+        modifyHits += other.modifyHits;
+        modifyMisses += other.modifyMisses;
+        aggressiveOrders += other.aggressiveOrders;
+        levelsWalked += other.levelsWalked;
+        selfTradesPrevented += other.selfTradesPrevented;
+        tombstonesReclaimed += other.tombstonesReclaimed;
+        stopsTriggered += other.stopsTriggered;
+    }
+};
+
+/*
+Hot-path instrumentation of one OrderBook.
+
+Every book owns its stats and only the thread driving the book writes them:
+plain increments, no atomics, no sharing. Readers aggregate copies on demand
+with merge() (see OrderBook::collectStats and MatchingEngine::collectStats).
+Latencies are in CycleClock ticks; multiply by CycleClock::calibrate() for ns.
+*/
+struct BookStats {
+    BookCounters counters;
+
+    //Distribution of levels walked per aggressive order
+    LatencyHistogram levelsWalkedPerOrder;
+
+    //Cycles spent in each public operation
+    LatencyHistogram processOrderCycles;
+    LatencyHistogram cancelOrderCycles;
+    LatencyHistogram modifyOrderCycles;
+
+    void merge(const BookStats& other) {
+        counters.merge(other.counters);
+        levelsWalkedPerOrder.merge(other.levelsWalkedPerOrder);
+        processOrderCycles.merge(other.processOrderCycles);
+        cancelOrderCycles.merge(other.cancelOrderCycles);
+        modifyOrderCycles.merge(other.modifyOrderCycles);
+    }
+
+    void reset() {
+        counters = BookCounters{};
+        levelsWalkedPerOrder.reset();
+        processOrderCycles.reset();
+        cancelOrderCycles.reset();
+        modifyOrderCycles.reset();
+    }
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+Cheapest available timestamp for timing single operations.
+
+On x86 this is rdtsc (~20 cycles, no syscall); elsewhere it falls back to
+std::chrono::steady_clock. calibrate() measures how many nanoseconds one tick
+is, so results can always be reported in nanoseconds.
+*/
+class CycleClock {
+    public:
+        static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+        }
+
+        //Nanoseconds per tick, measured against steady_clock over 'window'
+        static double calibrate(std::chrono::milliseconds window = std::chrono::milliseconds(50)) {
+            auto wallStart = std::chrono::steady_clock::now();
+            uint64_t tickStart = now();
+            std::this_thread::sleep_for(window);
+            uint64_t tickEnd = now();
+            auto wallEnd = std::chrono::steady_clock::now();
+            double nanos = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(wallEnd - wallStart).count());
+            return nanos / static_cast<double>(tickEnd - tickStart);
+        }
+};
@@ -0,0 +1,61 @@
+#include "EventLog.h"
+
+#include <chrono>
+#include <stdexcept>
+
+EventLog::EventLog(const std::string& path, std::size_t ringCapacity)
+    : ring_{ringCapacity}, file_{std::fopen(path.c_str(), "wb")} {
+    if (file_ == nullptr)
+        throw std::runtime_error("EventLog: cannot open " + path);
+    //The writer already hands over whole batches; unbuffered, fwrite's result is what reached the file
+    std::setvbuf(file_, nullptr, _IONBF, 0);
+    writer_ = std::thread(&EventLog::writerLoop, this);
+}
+
+EventLog::~EventLog() {
+    running_.store(false, std::memory_order_release);
+    writer_.join();
+    std::fclose(file_);
+}
+
+void EventLog::writerLoop() {
+    std::vector<BookEvent> batch(1024);
+    for (;;) {
+        //Read the flag before draining so nothing recorded before shutdown is missed
+        bool running = running_.load(std::memory_order_acquire);
+        std::size_t count = ring_.popBatch(batch.data(), batch.size());
+        if (count > 0) {
+            std::size_t stored = std::fwrite(batch.data(), sizeof(BookEvent), count, file_);
+            if (stored != count)
+                writeFailures_.fetch_add(count - stored, std::memory_order_relaxed);
+            //Failed ones count as handled too, so flush() does not wait for them forever
+            written_.fetch_add(count, std::memory_order_release);
+            continue;
+        }
+        std::fflush(file_);
+        flushed_.store(written_.load(std::memory_order_relaxed), std::memory_order_release);
+        if (!running)
+            return;
+        //Idle: back off instead of spinning on a core the matching thread may want
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+void EventLog::flush() {
+    //Everything recorded so far has either been written or dropped
+    uint64_t target = sequence_ - dropped();
+    while (flushed_.load(std::memory_order_acquire) < target)
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+std::vector<BookEvent> EventLog::readFile(const std::string& path) {
+    std::vector<BookEvent> events;
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        throw std::runtime_error("EventLog: cannot open " + path);
+    BookEvent event;
+    while (std::fread(&event, sizeof(BookEvent), 1, file) == 1)
+        events.push_back(event);
+    std::fclose(file);
+    return events;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Order.h"
+#include "SpscRing.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Set to 0 (CMake option AGORA_EVENT_LOG=OFF) to compile every event-log hook out of the book
+#ifndef AGORA_EVENT_LOG
+#define AGORA_EVENT_LOG 1
+#endif
+
+enum class BookEventType : uint8_t {
+    OrderAccepted,  //A new order reached the book
+    Trade,          //orderId traded against the resting otherOrderId
+    OrderCancelled, //A resting order was cancelled
+    CancelRejected, //Cancel for an order ID that is not resting (unknown, filled or already cancelled)
+    OrderModified,  //A resting order was amended to 'price' with 'quantity' left
+    SelfTradePrevented, //orderId would have traded 'quantity' with its own resting otherOrderId
+    StopAccepted,   //A stop order is waiting for a trade at 'price' (its trigger)
+    StopTriggered   //A stop order was triggered and enters the book at 'price' (its limit)
+};
+
+//Something the book did, as the EventLog writes it to disk: 40 bytes each, back to back,
+//in the order the matching thread recorded them
+struct BookEvent {
+    uint64_t sequence;      //Assigned by the EventLog, starts at 1 and has no gaps unless events were dropped
+    uint64_t orderId;
+    uint64_t otherOrderId;  //Resting side of a Trade, 0 otherwise
+    Price price;
+    uint32_t quantity;
+    BookEventType type;
+    OrderSide side;
+};
+
+static_assert(sizeof(BookEvent) == 40, "BookEvent is an on-disk record");
+
+/*
+Asynchronous binary event journal.
+
+The matching thread calls record(), which is one copy into a lock-free SPSC ring:
+no syscalls, no locks, no allocation. A background writer thread drains the ring
+in batches and fwrite()s the records to disk. If the writer falls behind and the
+ring fills, events are dropped (and counted) rather than ever stalling matching.
+Events the disk refuses (full, I/O error) are counted as well, and never retried.
+
+record() must only be called from one thread (the book's matching thread).
+*/
+class EventLog {
+    public:
+        //Opens 'path' for writing and starts the writer thread. Throws std::runtime_error on failure.
+        explicit EventLog(const std::string& path, std::size_t ringCapacity = 1 << 16);
+
+        //Drains every recorded event to disk, then stops the writer thread
+        ~EventLog();
+
+        EventLog(const EventLog&) = delete;
+        EventLog& operator=(const EventLog&) = delete;
+
+        void record(BookEventType type, uint64_t orderId, uint64_t otherOrderId, OrderSide side, Price price, uint32_t quantity) {
+            BookEvent event{++sequence_, orderId, otherOrderId, price, quantity, type, side};
+            if (!ring_.tryPush(event))
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //Number of events lost because the ring was full
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+        //Number of events lost because writing them out failed (e.g. the disk is full)
+        uint64_t writeFailures() const { return writeFailures_.load(std::memory_order_relaxed); }
+
+        //Blocks until everything recorded so far has been written and flushed.
+        //Called from the recording thread.
+        void flush();
+
+        //Reads back a journal written by an EventLog
+        static std::vector<BookEvent> readFile(const std::string& path);
+
+    private:
+        void writerLoop();
+
+        SpscRing<BookEvent> ring_;
+        std::FILE* file_;
+        uint64_t sequence_ = 0;
+        std::atomic<uint64_t> dropped_{0};
+        std::atomic<uint64_t> writeFailures_{0};
+        std::atomic<uint64_t> written_{0};
+        std::atomic<uint64_t> flushed_{0};
+        std::atomic<bool> running_{true};
+        std::thread writer_;
+};
@@ -0,0 +1,429 @@
+#include "EventLoop.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+//What an io_uring completion was for, in the low byte of its user_data (the fd is above it)
+enum UringOp : uint8_t {
+    kOpIgnore = 0,  //Cancel requests
+    kOpRead = 1,    //accept, recv or the eventfd read, depending on the descriptor
+    kOpPollOut = 2
+};
+
+uint64_t userData(int fd, UringOp op) {
+    return static_cast<uint64_t>(fd) << 8 | op;
+}
+
+} // namespace
+
+//The three shared mappings of an io_uring, and our side of its indices
+struct EventLoop::Uring {
+    int fd = -1;
+
+    void* sqRing = MAP_FAILED;
+    std::size_t sqRingSize = 0;
+    void* cqRing = MAP_FAILED;
+    std::size_t cqRingSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    std::size_t sqesSize = 0;
+
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+
+    //Next free submission slot; published to the kernel by enter()
+    unsigned tail = 0;
+
+    ~Uring() {
+        if (sqes != MAP_FAILED)
+            ::munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing)
+            ::munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED)
+            ::munmap(sqRing, sqRingSize);
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    //A zeroed submission entry, submitting what is queued first if the ring is full
+    io_uring_sqe* next() {
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries)
+            enter(0);
+        unsigned index = tail & sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        ++tail;
+        return sqe;
+    }
+
+    //Submits everything queued and waits for at least 'waitFor' completions
+    void enter(unsigned waitFor) {
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+        unsigned pending = tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        if (pending == 0 && waitFor == 0)
+            return;
+        //EINTR only cuts the wait short; whatever was not consumed goes with the next call
+        ::syscall(__NR_io_uring_enter, fd, pending, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    }
+};
+
+EventLoop::EventLoop(IoBackend backend) : backend_{backend} {
+    if (backend != IoBackend::Epoll && setupUring()) {
+        backend_ = IoBackend::IoUring;
+        return;
+    }
+    if (backend == IoBackend::IoUring)
+        throw std::runtime_error("EventLoop: io_uring is not available");
+    backend_ = IoBackend::Epoll;
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0)
+        throw std::runtime_error("EventLoop: epoll_create1 failed");
+}
+
+EventLoop::~EventLoop() {
+    //Tearing the ring down first cancels whatever it still has queued on these descriptors
+    uring_.reset();
+    for (std::size_t fd = 0; fd < watches_.size(); ++fd)
+        if (watches_[fd].type != Watch::Type::None)
+            ::close(static_cast<int>(fd));
+    if (epollFd_ >= 0)
+        ::close(epollFd_);
+}
+
+bool EventLoop::ioUringSupported() {
+    io_uring_params params{};
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, 4, &params));
+    if (fd < 0)
+        return false;
+    ::close(fd);
+    return (params.features & IORING_FEAT_FAST_POLL) != 0;
+}
+
+bool EventLoop::setupUring() {
+    auto ring = std::make_unique<Uring>();
+    io_uring_params params{};
+    ring->fd = static_cast<int>(::syscall(__NR_io_uring_setup, 1024, &params));
+    if (ring->fd < 0 || (params.features & IORING_FEAT_FAST_POLL) == 0)
+        return false;
+
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single)
+        ring->sqRingSize = ring->cqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+    ring->sqRing = ::mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED)
+        return false;
+    ring->cqRing = single ? ring->sqRing
+        : ::mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cqRing == MAP_FAILED)
+        return false;
+    ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return false;
+    ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+    uint8_t* sq = static_cast<uint8_t*>(ring->sqRing);
+    uint8_t* cq = static_cast<uint8_t*>(ring->cqRing);
+    ring->sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sqEntries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    ring->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    ring->tail = *ring->sqTail;
+    uring_ = std::move(ring);
+    return true;
+}
+
+EventLoop::Watch& EventLoop::watch(int fd) {
+    if (static_cast<std::size_t>(fd) >= watches_.size())
+        watches_.resize(static_cast<std::size_t>(fd) + 1);
+    return watches_[static_cast<std::size_t>(fd)];
+}
+
+void EventLoop::release(int fd) {
+    Watch& w = watches_[static_cast<std::size_t>(fd)];
+    w.type = Watch::Type::None;
+    w.writable = false;
+    w.closing = false;
+    w.inFlight = 0;
+}
+
+void EventLoop::addListener(int fd) {
+    watch(fd).type = Watch::Type::Listener;
+    if (uring_) {
+        queueRead(fd);
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0)
+        throw std::runtime_error("EventLoop: cannot watch listener");
+}
+
+void EventLoop::addConnection(int fd) {
+    Watch& w = watch(fd);
+    w.type = Watch::Type::Connection;
+    w.buffer.resize(kReceiveBuffer);
+    if (uring_) {
+        queueRead(fd);
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0)
+        throw std::runtime_error("EventLoop: cannot watch connection");
+}
+
+void EventLoop::addWakeup(int fd) {
+    Watch& w = watch(fd);
+    w.type = Watch::Type::Wakeup;
+    w.buffer.resize(sizeof(uint64_t));
+    if (uring_) {
+        queueRead(fd);
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0)
+        throw std::runtime_error("EventLoop: cannot watch eventfd");
+}
+
+void EventLoop::watchWritable(int fd) {
+    Watch& w = watch(fd);
+    if (w.writable || w.type != Watch::Type::Connection)
+        return;
+    w.writable = true;
+    if (uring_) {
+        queuePollOut(fd);
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLOUT;
+    event.data.fd = fd;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &event);
+}
+
+void EventLoop::close(int fd) {
+    if (static_cast<std::size_t>(fd) >= watches_.size() || watches_[fd].type == Watch::Type::None || watches_[fd].closing)
+        return;
+    if (!uring_) {
+        ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        release(fd);
+        return;
+    }
+
+    //The kernel may still be reading into this descriptor's buffer: cancel, and close it
+    //once the last operation has completed
+    Watch& w = watches_[fd];
+    if (w.inFlight == 0) {
+        ::close(fd);
+        release(fd);
+        return;
+    }
+    w.closing = true;
+    for (UringOp op : {kOpRead, kOpPollOut}) {
+        io_uring_sqe* sqe = uring_->next();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = userData(fd, op);
+        sqe->user_data = kOpIgnore;
+    }
+}
+
+long EventLoop::send(int fd, const iovec* iov, int count) {
+    msghdr message{};
+    message.msg_iov = const_cast<iovec*>(iov);
+    message.msg_iovlen = static_cast<std::size_t>(count);
+    ssize_t sent = ::sendmsg(fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent >= 0)
+        return sent;
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+}
+
+std::size_t EventLoop::wait(IoEvent* events, std::size_t max, bool block) {
+    //Connections reported Closed last time are done with now
+    for (int fd : closed_)
+        close(fd);
+    closed_.clear();
+    return uring_ ? waitUring(events, max, block) : waitEpoll(events, max, block);
+}
+
+std::size_t EventLoop::waitEpoll(IoEvent* events, std::size_t max, bool block) {
+    constexpr std::size_t kBatch = 256;
+    epoll_event ready[kBatch];
+    //A connection can yield two events (Writable and Data)
+    int count = ::epoll_wait(epollFd_, ready, static_cast<int>(std::min(kBatch, max / 2)), block ? -1 : 0);
+    std::size_t produced = 0;
+    for (int i = 0; i < count; ++i) {
+        int fd = ready[i].data.fd;
+        Watch& w = watches_[fd];
+        switch (w.type) {
+            case Watch::Type::Listener: {
+                int accepted = ::accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (accepted >= 0)
+                    events[produced++] = {IoEvent::Kind::Accepted, accepted, fd, nullptr, 0};
+                break;
+            }
+            case Watch::Type::Wakeup: {
+                uint64_t value;
+                if (::read(fd, &value, sizeof(value)) == sizeof(value))
+                    events[produced++] = {IoEvent::Kind::Wakeup, fd, fd, nullptr, 0};
+                break;
+            }
+            case Watch::Type::Connection: {
+                if ((ready[i].events & EPOLLOUT) && w.writable) {
+                    w.writable = false;
+                    epoll_event event{};
+                    event.events = EPOLLIN | EPOLLRDHUP;
+                    event.data.fd = fd;
+                    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &event);
+                    events[produced++] = {IoEvent::Kind::Writable, fd, fd, nullptr, 0};
+                }
+                if (ready[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    ssize_t received = ::recv(fd, w.buffer.data(), w.buffer.size(), 0);
+                    if (received > 0) {
+                        events[produced++] = {IoEvent::Kind::Data, fd, fd, w.buffer.data(), static_cast<std::size_t>(received)};
+                    } else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                        ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+                        closed_.push_back(fd);
+                        events[produced++] = {IoEvent::Kind::Closed, fd, fd, nullptr, 0};
+                    }
+                }
+                break;
+            }
+            case Watch::Type::None:
+                break;
+        }
+    }
+    return produced;
+}
+
+void EventLoop::queueRead(int fd) {
+    Watch& w = watches_[fd];
+    io_uring_sqe* sqe = uring_->next();
+    sqe->fd = fd;
+    sqe->user_data = userData(fd, kOpRead);
+    switch (w.type) {
+        case Watch::Type::Listener:
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            break;
+        case Watch::Type::Connection:
+            sqe->opcode = IORING_OP_RECV;
+            sqe->addr = reinterpret_cast<uint64_t>(w.buffer.data());
+            sqe->len = static_cast<uint32_t>(w.buffer.size());
+            break;
+        default:
+            sqe->opcode = IORING_OP_READ;
+            sqe->addr = reinterpret_cast<uint64_t>(w.buffer.data());
+            sqe->len = sizeof(uint64_t);
+            break;
+    }
+    ++w.inFlight;
+}
+
+void EventLoop::queuePollOut(int fd) {
+    io_uring_sqe* sqe = uring_->next();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = userData(fd, kOpPollOut);
+    ++watches_[fd].inFlight;
+}
+
+std::size_t EventLoop::waitUring(IoEvent* events, std::size_t max, bool block) {
+    for (int fd : rearm_) {
+        const Watch& w = watches_[fd];
+        if (w.type != Watch::Type::None && !w.closing)
+            queueRead(fd);
+    }
+    rearm_.clear();
+
+    Uring& ring = *uring_;
+    bool ready = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE) != *ring.cqHead;
+    ring.enter(block && !ready ? 1 : 0);
+
+    std::size_t produced = 0;
+    unsigned head = *ring.cqHead;
+    unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail && produced < max; ++head) {
+        const io_uring_cqe& cqe = ring.cqes[head & ring.cqMask];
+        UringOp op = static_cast<UringOp>(cqe.user_data & 0xFF);
+        if (op == kOpIgnore)
+            continue;
+        int fd = static_cast<int>(cqe.user_data >> 8);
+        int result = cqe.res;
+        Watch& w = watches_[fd];
+        --w.inFlight;
+        if (w.closing) {
+            if (w.inFlight == 0) {
+                ::close(fd);
+                release(fd);
+            }
+            continue;
+        }
+
+        if (op == kOpPollOut) {
+            w.writable = false;
+            events[produced++] = {IoEvent::Kind::Writable, fd, fd, nullptr, 0};
+            continue;
+        }
+        bool retry = result == -EAGAIN || result == -EINTR || result == -ENOBUFS;
+        switch (w.type) {
+            case Watch::Type::Listener:
+                if (result >= 0)
+                    events[produced++] = {IoEvent::Kind::Accepted, result, fd, nullptr, 0};
+                rearm_.push_back(fd);
+                break;
+            case Watch::Type::Wakeup:
+                if (result > 0)
+                    events[produced++] = {IoEvent::Kind::Wakeup, fd, fd, nullptr, 0};
+                rearm_.push_back(fd);
+                break;
+            case Watch::Type::Connection:
+                if (result > 0) {
+                    events[produced++] = {IoEvent::Kind::Data, fd, fd, w.buffer.data(), static_cast<std::size_t>(result)};
+                    rearm_.push_back(fd);
+                } else if (retry) {
+                    rearm_.push_back(fd);
+                } else {
+                    closed_.push_back(fd);
+                    events[produced++] = {IoEvent::Kind::Closed, fd, fd, nullptr, 0};
+                }
+                break;
+            case Watch::Type::None:
+                break;
+        }
+    }
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+    return produced;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <sys/uio.h>
+
+//Which kernel interface an EventLoop waits on
+enum class IoBackend : uint8_t {
+    Auto,   //io_uring if the kernel allows it, epoll otherwise
+    Epoll,
+    IoUring
+};
+
+//Something that happened on a descriptor registered with an EventLoop
+struct IoEvent {
+    enum class Kind : uint8_t {
+        Accepted,   //'fd' is a new connection accepted on listener 'source'. Not watched until addConnection(fd).
+        Data,       //[data, data + size) arrived on connection 'fd'. Valid until the next wait().
+        Closed,     //The peer closed connection 'fd', or it failed. The loop closes the descriptor.
+        Writable,   //Connection 'fd' can take more bytes (after watchWritable)
+        Wakeup      //The wakeup eventfd was written
+    };
+
+    Kind kind;
+    int fd;
+    int source;
+    const uint8_t* data;
+    std::size_t size;
+};
+
+/*
+Non-blocking socket event loop over epoll or io_uring (raw system calls: no liburing).
+
+Both backends look the same to the caller. wait() fills an array of IoEvents;
+reads happen inside the loop, into a receive buffer per connection that the
+loop owns, so a Data event hands over bytes that are already in memory.
+
+ - epoll: level-triggered readiness, then one accept4()/recv() per ready
+   descriptor per wait().
+ - io_uring: accept, recv and eventfd reads stay queued in the kernel. Every
+   wait() is one io_uring_enter() that submits the re-armed operations and
+   collects their completions, so a busy loop makes one system call per batch,
+   not one per socket. Requires Linux 5.7+ (IORING_FEAT_FAST_POLL).
+
+Sends are synchronous, vectored sendmsg() calls in both backends: on a
+non-blocking connected socket they take what fits at once, and a caller that
+gets a short write asks for a Writable event and sends the rest then.
+
+A loop and everything it returns belong to one thread.
+*/
+class EventLoop {
+    public:
+        //Throws std::runtime_error if 'backend' is unavailable (Auto never is)
+        explicit EventLoop(IoBackend backend = IoBackend::Auto);
+        ~EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        //True if this kernel (and sandbox) lets us set up an io_uring
+        static bool ioUringSupported();
+
+        //The backend in use: never Auto
+        IoBackend backend() const { return backend_; }
+
+        //Starts accepting on a listening socket (non-blocking). Accepted descriptors are
+        //non-blocking and close-on-exec.
+        void addListener(int fd);
+
+        //Starts reading a connection
+        void addConnection(int fd);
+
+        //Reports the eventfd 'fd' as Wakeup events; the loop reads (resets) it
+        void addWakeup(int fd);
+
+        //Asks for one Writable event once 'fd' can take more bytes
+        void watchWritable(int fd);
+
+        //Stops watching connection 'fd' and closes it. No further events are reported for it.
+        void close(int fd);
+
+        //Writes as much of 'iov' as the socket takes. Returns the bytes written, 0 if it took
+        //nothing, or -1 if the connection failed (it then shows up as Closed).
+        long send(int fd, const iovec* iov, int count);
+
+        //Waits for events (or only collects those ready if 'block' is false), writes up to
+        //'max' of them to 'events' and returns how many
+        std::size_t wait(IoEvent* events, std::size_t max, bool block);
+
+    private:
+        //Per-descriptor state, indexed by fd
+        struct Watch {
+            enum class Type : uint8_t { None, Listener, Connection, Wakeup };
+            Type type = Type::None;
+            bool writable = false;      //Writable event wanted
+            bool closing = false;       //io_uring: close() called, waiting for operations in flight
+            uint8_t inFlight = 0;       //io_uring: operations queued on it
+            std::vector<uint8_t> buffer;
+        };
+
+        Watch& watch(int fd);
+        void release(int fd);
+
+        std::size_t waitEpoll(IoEvent* events, std::size_t max, bool block);
+        std::size_t waitUring(IoEvent* events, std::size_t max, bool block);
+
+        //io_uring plumbing
+        struct Uring;
+        bool setupUring();
+        void queueRead(int fd);
+        void queuePollOut(int fd);
+
+        IoBackend backend_;
+        int epollFd_ = -1;
+        std::unique_ptr<Uring> uring_;
+        std::vector<Watch> watches_;
+
+        //Descriptors whose Closed event was reported: closed on the next wait()
+        std::vector<int> closed_;
+
+        //io_uring: descriptors whose read/accept completed, queued again on the next wait()
+        //(a Data event's bytes must stay put until then)
+        std::vector<int> rearm_;
+
+        static constexpr std::size_t kReceiveBuffer = 64 * 1024;
+};
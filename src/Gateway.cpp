@@ -0,0 +1,423 @@
+#include "Gateway.h"
+
+#include "OrderEntrySession.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t kBatch = 64;
+
+//A non-blocking listening socket bound to 'address', or throws naming 'what'
+int listenOn(int family, const sockaddr* address, socklen_t length, const std::string& what) {
+    int fd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw std::runtime_error("Gateway: cannot create a socket for " + what);
+    int one = 1;
+    if (family == AF_INET)
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (::bind(fd, address, length) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Gateway: cannot listen on " + what + ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+} // namespace
+
+struct Gateway::BookSession {
+    BookSession(Gateway& gateway, uint32_t id)
+        : id{id}, session{gateway.book_, gateway.config_.instrument, out, sizeof(out), ReportSink{&gateway, id}, id} {}
+
+    uint32_t id;
+    bool touched = false;
+    alignas(8) uint8_t out[kMaxReport];
+    OrderEntrySession<ReportSink> session;
+};
+
+Gateway::Gateway(const GatewayConfig& config)
+    : config_{config}, book_{config.book}, loop_{config.backend},
+      commands_{config.ringCapacity}, reports_{config.ringCapacity} {
+    if (config_.risk) {
+        risk_.emplace(*config_.risk);
+        book_.setRiskGate(&*risk_);
+    }
+
+    //Everything handed to the loop is closed by it, whatever happens next
+    ioWake_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ioWake_ < 0)
+        throw std::runtime_error("Gateway: eventfd failed");
+    loop_.addWakeup(ioWake_);
+
+    if (config_.listenTcp) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(config_.port);
+        std::string what = config_.host + ":" + std::to_string(config_.port);
+        if (::inet_pton(AF_INET, config_.host.c_str(), &address.sin_addr) != 1)
+            throw std::runtime_error("Gateway: bad IPv4 address " + config_.host);
+        int fd = listenOn(AF_INET, reinterpret_cast<sockaddr*>(&address), sizeof(address), what);
+        loop_.addListener(fd);
+        socklen_t length = sizeof(address);
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+        port_ = ntohs(address.sin_port);
+    }
+    if (!config_.unixPath.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (config_.unixPath.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("Gateway: Unix socket path too long: " + config_.unixPath);
+        std::memcpy(address.sun_path, config_.unixPath.c_str(), config_.unixPath.size() + 1);
+        ::unlink(config_.unixPath.c_str());
+        loop_.addListener(listenOn(AF_UNIX, reinterpret_cast<sockaddr*>(&address), sizeof(address), config_.unixPath));
+    }
+
+    bookWake_ = ::eventfd(0, EFD_CLOEXEC);
+    if (bookWake_ < 0)
+        throw std::runtime_error("Gateway: eventfd failed");
+}
+
+Gateway::~Gateway() {
+    stop();
+    ::close(bookWake_);
+    if (!config_.unixPath.empty())
+        ::unlink(config_.unixPath.c_str());
+}
+
+void Gateway::start() {
+    if (started_)
+        throw std::logic_error("Gateway: already started");
+    started_ = true;
+    ioRunning_.store(true);
+    bookRunning_.store(true);
+    bookThread_ = std::thread([this] { runBook(); });
+    ioThread_ = std::thread([this] { runIo(); });
+}
+
+void Gateway::stop() {
+    if (!ioThread_.joinable())
+        return;
+    //The I/O thread goes first, so the book thread sees every command it pushed
+    ioRunning_.store(false);
+    uint64_t one = 1;
+    ::write(ioWake_, &one, sizeof(one));
+    ioThread_.join();
+    bookRunning_.store(false);
+    ::write(bookWake_, &one, sizeof(one));
+    bookThread_.join();
+}
+
+void Gateway::wakeBook() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (bookWaiting_.load(std::memory_order_relaxed) && bookWaiting_.exchange(false)) {
+        uint64_t one = 1;
+        ::write(bookWake_, &one, sizeof(one));
+    }
+}
+
+void Gateway::wakeIo() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ioWaiting_.load(std::memory_order_relaxed) && ioWaiting_.exchange(false)) {
+        uint64_t one = 1;
+        ::write(ioWake_, &one, sizeof(one));
+    }
+}
+
+//I/O thread
+
+void Gateway::runIo() {
+    IoEvent events[4 * kBatch];
+    while (ioRunning_.load(std::memory_order_relaxed)) {
+        drainReports();
+        for (uint32_t session : closeRequests_)
+            if (const int* fd = sessionFds_.find(session))
+                dropConnection(*fd, true);
+        closeRequests_.clear();
+
+        //Sleep only if the book has nothing for us: it rings once it sees the flag
+        ioWaiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool block = reports_.empty() && ioRunning_.load(std::memory_order_relaxed);
+        std::size_t count = loop_.wait(events, sizeof(events) / sizeof(events[0]), block);
+        ioWaiting_.store(false, std::memory_order_relaxed);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const IoEvent& event = events[i];
+            switch (event.kind) {
+                case IoEvent::Kind::Accepted:
+                    onAccepted(event.fd);
+                    break;
+                case IoEvent::Kind::Data:
+                    onData(event.fd, event.data, event.size);
+                    break;
+                case IoEvent::Kind::Closed:
+                    //The loop closes the descriptor itself
+                    dropConnection(event.fd, false);
+                    break;
+                case IoEvent::Kind::Writable:
+                    sendPending(event.fd);
+                    break;
+                case IoEvent::Kind::Wakeup:
+                    break;
+            }
+        }
+        if (commandsPushed_) {
+            commandsPushed_ = false;
+            wakeBook();
+        }
+    }
+}
+
+void Gateway::onAccepted(int fd) {
+    //Reports are written whole and at once: never hold them back (fails harmlessly on Unix sockets)
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (static_cast<std::size_t>(fd) >= connections_.size())
+        connections_.resize(static_cast<std::size_t>(fd) + 1);
+    Connection& connection = connections_[fd];
+    connection.session = nextSession_++;
+    sessionFds_.insert(connection.session, fd);
+    loop_.addConnection(fd);
+
+    Command command;
+    command.session = connection.session;
+    command.kind = Command::Kind::Open;
+    pushCommand(command);
+}
+
+void Gateway::onData(int fd, const uint8_t* data, std::size_t size) {
+    Connection& connection = connections_[fd];
+    if (connection.session == 0)
+        return;
+    uint32_t session = connection.session;
+    auto forward = [this, session](const protocol::MessageHeader& header, const uint8_t* bytes) {
+        if (header.length > kMaxCommand)
+            throw protocol::ProtocolError("protocol: bad message length");
+        Command command;
+        command.session = session;
+        command.kind = Command::Kind::Message;
+        std::memcpy(command.bytes, bytes, header.length);
+        pushCommand(command);
+    };
+
+    try {
+        //Usually the reads end on a message boundary and nothing is copied
+        if (connection.input.empty()) {
+            std::size_t used = protocol::detail::frame(data, size, forward);
+            connection.input.assign(data + used, data + size);
+        } else {
+            connection.input.insert(connection.input.end(), data, data + size);
+            std::size_t used = protocol::detail::frame(connection.input.data(), connection.input.size(), forward);
+            connection.input.erase(connection.input.begin(), connection.input.begin() + static_cast<std::ptrdiff_t>(used));
+        }
+    } catch (const protocol::ProtocolError&) {
+        dropConnection(fd, true);
+    }
+}
+
+void Gateway::dropConnection(int fd, bool closeFd) {
+    Connection& connection = connections_[fd];
+    if (connection.session == 0)
+        return;
+    //The book cancels the session's orders; it ignores this if it dropped the session first
+    Command command;
+    command.session = connection.session;
+    command.kind = Command::Kind::Close;
+    pushCommand(command);
+
+    sessionFds_.erase(connection.session);
+    connection.session = 0;
+    connection.input.clear();
+    connection.output.clear();
+    connection.gather.clear();
+    if (closeFd)
+        loop_.close(fd);
+}
+
+void Gateway::pushCommand(const Command& command) {
+    //The book may itself be waiting for room for its reports: keep taking them meanwhile
+    while (!commands_.tryPush(command)) {
+        wakeBook();
+        drainReports();
+    }
+    commandsPushed_ = true;
+}
+
+void Gateway::drainReports() {
+    Report batch[kBatch];
+    std::size_t count;
+    do {
+        count = reports_.popBatch(batch, kBatch);
+        for (std::size_t i = 0; i < count; ++i) {
+            Report& report = batch[i];
+            const int* fd = sessionFds_.find(report.session);
+            if (fd == nullptr)
+                continue;
+            if (report.size > 0) {
+                Connection& connection = connections_[*fd];
+                if (connection.gather.empty())
+                    gathered_.push_back(*fd);
+                connection.gather.push_back({report.bytes, report.size});
+            }
+            //Not closed here: a caller may be in the middle of this connection's input
+            if (report.close)
+                closeRequests_.push_back(report.session);
+        }
+        for (int fd : gathered_)
+            sendGathered(fd);
+        gathered_.clear();
+    } while (count == kBatch);
+}
+
+void Gateway::sendGathered(int fd) {
+    Connection& connection = connections_[fd];
+    long sent = 0;
+    //Earlier bytes still waiting go first: queue behind them
+    if (connection.output.empty()) {
+        sent = loop_.send(fd, connection.gather.data(), static_cast<int>(connection.gather.size()));
+        if (sent < 0) {
+            //Reported as Closed by the loop shortly
+            connection.gather.clear();
+            return;
+        }
+    }
+    bool wasEmpty = connection.output.empty();
+    for (const iovec& part : connection.gather) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(part.iov_base);
+        std::size_t skip = std::min(static_cast<std::size_t>(sent), part.iov_len);
+        sent -= static_cast<long>(skip);
+        connection.output.insert(connection.output.end(), bytes + skip, bytes + part.iov_len);
+    }
+    connection.gather.clear();
+    if (wasEmpty && !connection.output.empty())
+        loop_.watchWritable(fd);
+}
+
+void Gateway::sendPending(int fd) {
+    Connection& connection = connections_[fd];
+    if (connection.session == 0 || connection.output.empty())
+        return;
+    iovec part{connection.output.data(), connection.output.size()};
+    long sent = loop_.send(fd, &part, 1);
+    if (sent < 0) {
+        connection.output.clear();
+        return;
+    }
+    connection.output.erase(connection.output.begin(), connection.output.begin() + sent);
+    if (!connection.output.empty())
+        loop_.watchWritable(fd);
+}
+
+//Book thread
+
+void Gateway::runBook() {
+    Command batch[kBatch];
+    while (true) {
+        std::size_t count = commands_.popBatch(batch, kBatch);
+        if (count == 0) {
+            if (!bookRunning_.load(std::memory_order_acquire))
+                break;
+            bookWaiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (commands_.empty() && bookRunning_.load(std::memory_order_relaxed)) {
+                uint64_t value;
+                ::read(bookWake_, &value, sizeof(value));
+            }
+            bookWaiting_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+            apply(batch[i]);
+        for (uint32_t slot : touched_) {
+            if (BookSession* session = sessions_[slot].get()) {
+                session->touched = false;
+                session->session.flush();
+            }
+        }
+        touched_.clear();
+        wakeIo();
+    }
+}
+
+void Gateway::apply(const Command& command) {
+    if (command.kind == Command::Kind::Open) {
+        uint32_t slot;
+        if (freeSlots_.empty()) {
+            slot = static_cast<uint32_t>(sessions_.size());
+            sessions_.emplace_back();
+        } else {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+        sessions_[slot] = std::make_unique<BookSession>(*this, command.session);
+        sessionSlots_.insert(command.session, slot);
+        return;
+    }
+
+    const uint32_t* found = sessionSlots_.find(command.session);
+    if (found == nullptr)
+        return;
+    uint32_t slot = *found;
+    if (command.kind == Command::Kind::Close) {
+        closeSession(slot);
+        return;
+    }
+
+    BookSession& session = *sessions_[slot];
+    const auto& header = *reinterpret_cast<const protocol::MessageHeader*>(command.bytes);
+    try {
+        session.session.onData(command.bytes, header.length);
+    } catch (const protocol::ProtocolError&) {
+        closeSession(slot);
+        pushReport(command.session, nullptr, 0, true);
+        return;
+    } catch (const std::invalid_argument&) {
+        //The book refused this one order before changing anything; the gateway carries on.
+        //Anything else (bad_alloc mid-match) may follow reports already sent, so it is fatal.
+        session.session.rejectMessage(command.bytes, protocol::RejectReason::BookError);
+    } catch (const std::out_of_range&) {
+        session.session.rejectMessage(command.bytes, protocol::RejectReason::BookError);
+    } catch (const std::length_error&) {
+        session.session.rejectMessage(command.bytes, protocol::RejectReason::BookError);
+    }
+    if (!session.touched) {
+        session.touched = true;
+        touched_.push_back(slot);
+    }
+}
+
+void Gateway::closeSession(uint32_t slot) {
+    BookSession& session = *sessions_[slot];
+    session.session.flush();
+    session.session.disconnect();
+    sessionSlots_.erase(session.id);
+    sessions_[slot].reset();
+    freeSlots_.push_back(slot);
+}
+
+void Gateway::pushReport(uint32_t session, const uint8_t* data, std::size_t size, bool close) {
+    Report report;
+    report.session = session;
+    report.size = static_cast<uint16_t>(size);
+    report.close = close;
+    if (size > 0)
+        std::memcpy(report.bytes, data, size);
+    //Full: the I/O thread is behind. Once it has gone (stop()) there is no one left to tell.
+    while (!reports_.tryPush(report)) {
+        if (!bookRunning_.load(std::memory_order_relaxed))
+            return;
+        wakeIo();
+        std::this_thread::yield();
+    }
+}
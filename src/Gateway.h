@@ -0,0 +1,186 @@
+#pragma once
+
+#include "EventLoop.h"
+#include "OrderBook.h"
+#include "OrderIndex.h"
+#include "Protocol.h"
+#include "RiskGate.h"
+#include "SpscRing.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct GatewayConfig {
+    //TCP listener. Port 0 picks a free port (see Gateway::port()).
+    bool listenTcp = true;
+    std::string host = "127.0.0.1";
+    uint16_t port = 0;
+
+    //Also listen on this Unix stream socket if not empty. A stale socket file is replaced.
+    std::string unixPath;
+
+    InstrumentId instrument = 1;
+    OrderBookConfig book;
+
+    //Risk limits for the book. Accounts are session numbers: 1 for the first connection, and so on.
+    std::optional<RiskConfig> risk;
+
+    IoBackend backend = IoBackend::Auto;
+
+    //Capacity of the inbound command ring and the outbound report ring
+    std::size_t ringCapacity = 1 << 16;
+};
+
+/*
+Order-entry gateway: one OrderBook served to many client connections over
+TCP and/or Unix sockets, speaking the binary protocol in Protocol.h.
+
+Two threads, connected by two SPSC rings:
+ - The I/O thread runs an EventLoop (epoll or io_uring). It accepts
+   connections, cuts their byte streams into messages and pushes each one to
+   the book thread as a fixed-size command. Reports coming back are grouped by
+   connection and written with one vectored send per connection per batch; a
+   connection that cannot take them all gets the rest when it is writable.
+ - The book thread owns the book and one OrderEntrySession per connection, so
+   matching stays single-threaded and lock-free. A session's acks and trade
+   reports are pushed back once per batch of commands (or when its 240-byte
+   buffer fills).
+
+Each connection's orders are owned by its session number, so self-trade
+prevention applies within a connection and a disconnect cancels everything the
+connection left resting. A malformed stream drops the connection. An order the
+book refuses by throwing (invalid_argument, out_of_range, length_error: always
+before it changes anything) is answered with a BookError reject, and the gateway
+carries on. Any other exception, such as bad_alloc, escapes the book thread and
+terminates the process.
+
+A thread with nothing to do sleeps on an eventfd. The other side only writes
+the eventfd if the sleeper said it was going to sleep, so a busy gateway makes
+no wakeup system calls.
+*/
+class Gateway {
+    public:
+        //Creates the book and binds the listeners. Throws std::runtime_error if a socket
+        //cannot be set up or the backend is unavailable.
+        explicit Gateway(const GatewayConfig& config = GatewayConfig{});
+
+        //Stops the threads if they are still running
+        ~Gateway();
+
+        Gateway(const Gateway&) = delete;
+        Gateway& operator=(const Gateway&) = delete;
+
+        //Starts serving. Throws std::logic_error if called twice.
+        void start();
+
+        //Finishes every command already received, then joins both threads. Connections are
+        //closed when the Gateway is destroyed; their orders stay in the book.
+        void stop();
+
+        //The bound TCP port (0 without a TCP listener)
+        uint16_t port() const { return port_; }
+
+        IoBackend backend() const { return loop_.backend(); }
+
+        //Direct access to the book. Only safe while the gateway is stopped.
+        const OrderBook& book() const { return book_; }
+
+    private:
+        //Largest inbound message, and what a session may write per report
+        static constexpr std::size_t kMaxCommand = sizeof(protocol::NewOrderMessage);
+        static constexpr std::size_t kMaxReport = 240;
+
+        //I/O thread -> book thread
+        struct Command {
+            enum class Kind : uint8_t { Open, Message, Close };
+
+            uint32_t session;
+            Kind kind;
+            alignas(8) uint8_t bytes[kMaxCommand];
+        };
+
+        //Book thread -> I/O thread: report bytes for one connection
+        struct Report {
+            uint32_t session;
+            uint16_t size;
+            bool close;     //The session was dropped: close the connection after sending
+            alignas(8) uint8_t bytes[kMaxReport];
+        };
+
+        //I/O thread state of one connection, indexed by fd
+        struct Connection {
+            uint32_t session = 0;           //0: not open
+            std::vector<uint8_t> input;     //A partial message waiting for the rest
+            std::vector<uint8_t> output;    //Report bytes the socket has not taken yet
+            std::vector<iovec> gather;      //This batch's reports, sent together
+        };
+
+        //Pushes a session's report bytes to the I/O thread
+        struct ReportSink {
+            Gateway* gateway;
+            uint32_t session;
+            void operator()(const uint8_t* data, std::size_t size) { gateway->pushReport(session, data, size, false); }
+        };
+
+        //Book thread state of one connection
+        struct BookSession;
+
+        void runIo();
+        void onAccepted(int fd);
+        void onData(int fd, const uint8_t* data, std::size_t size);
+        void dropConnection(int fd, bool closeFd);
+        void pushCommand(const Command& command);
+        void drainReports();
+        void sendGathered(int fd);
+        void sendPending(int fd);
+
+        void runBook();
+        void apply(const Command& command);
+        void closeSession(uint32_t slot);
+        void pushReport(uint32_t session, const uint8_t* data, std::size_t size, bool close);
+
+        //Rings the other thread's eventfd if it is asleep or about to be
+        void wakeBook();
+        void wakeIo();
+
+        GatewayConfig config_;
+        OrderBook book_;
+        std::optional<RiskGate> risk_;
+        EventLoop loop_;
+        uint16_t port_ = 0;
+
+        SpscRing<Command> commands_;
+        SpscRing<Report> reports_;
+
+        //I/O thread
+        std::vector<Connection> connections_;
+        OrderIndex<int> sessionFds_;
+        uint32_t nextSession_ = 1;
+        std::vector<int> gathered_;             //Connections with reports in this batch
+        std::vector<uint32_t> closeRequests_;   //Sessions the book dropped, closed between batches
+        bool commandsPushed_ = false;
+
+        //Book thread
+        std::vector<std::unique_ptr<BookSession>> sessions_;
+        OrderIndex<uint32_t> sessionSlots_;
+        std::vector<uint32_t> freeSlots_;
+        std::vector<uint32_t> touched_;         //Sessions to flush at the end of this batch
+
+        //Doorbells: a sleeper sets its flag, re-checks its ring, then blocks on its eventfd
+        int ioWake_ = -1;
+        int bookWake_ = -1;
+        alignas(64) std::atomic<bool> ioWaiting_{false};
+        alignas(64) std::atomic<bool> bookWaiting_{false};
+        std::atomic<bool> ioRunning_{false};
+        std::atomic<bool> bookRunning_{false};
+
+        bool started_ = false;
+        std::thread ioThread_;
+        std::thread bookThread_;
+};
@@ -0,0 +1,110 @@
+#include "Journal.h"
+
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Journal::Journal(const std::string& path, const JournalConfig& config)
+    : config_{config}, fd_{::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644)} {
+    if (fd_ < 0)
+        throw std::runtime_error("Journal: cannot open " + path);
+
+    //Continue after the last whole record, cutting off a torn one
+    struct stat info {};
+    if (::fstat(fd_, &info) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Journal: cannot stat " + path);
+    }
+    off_t whole = info.st_size - info.st_size % static_cast<off_t>(sizeof(JournalRecord));
+    if (whole != info.st_size && ::ftruncate(fd_, whole) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Journal: cannot truncate " + path);
+    }
+    if (whole > 0) {
+        JournalRecord last;
+        if (::pread(fd_, &last, sizeof(last), whole - static_cast<off_t>(sizeof(last))) != static_cast<ssize_t>(sizeof(last))) {
+            ::close(fd_);
+            throw std::runtime_error("Journal: cannot read " + path);
+        }
+        sequence_ = last.sequence;
+    }
+
+    std::size_t records = config_.batchBytes / sizeof(JournalRecord);
+    batch_.reserve(records == 0 ? 1 : records);
+    lastSync_ = std::chrono::steady_clock::now();
+}
+
+Journal::~Journal() {
+    //Destructors must not throw; a failed final commit is lost like any crash would be
+    try {
+        commit();
+    } catch (const std::runtime_error&) {
+    }
+    ::close(fd_);
+}
+
+void Journal::writeBatch() {
+    const char* data = reinterpret_cast<const char*>(batch_.data());
+    std::size_t left = batch_.size() * sizeof(JournalRecord);
+    while (left > 0) {
+        ssize_t written = ::write(fd_, data, left);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Journal: write failed");
+        }
+        data += written;
+        left -= static_cast<std::size_t>(written);
+    }
+    if (!batch_.empty())
+        dirty_ = true;
+    batch_.clear();
+}
+
+void Journal::commit() {
+    writeBatch();
+    if (!dirty_ || config_.fsync == FsyncPolicy::None)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    if (config_.fsync == FsyncPolicy::Interval && now - lastSync_ < config_.fsyncInterval)
+        return;
+    if (::fdatasync(fd_) != 0)
+        throw std::runtime_error("Journal: fdatasync failed");
+    dirty_ = false;
+    lastSync_ = now;
+}
+
+Journal::MappedFile::MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return;
+        throw std::runtime_error("Journal: cannot open " + path);
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Journal: cannot stat " + path);
+    }
+    if (info.st_size > 0) {
+        void* mapped = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Journal: cannot map " + path);
+        }
+        ::madvise(mapped, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+        data_ = mapped;
+        size_ = static_cast<std::size_t>(info.st_size);
+    }
+    ::close(fd);
+}
+
+Journal::MappedFile::~MappedFile() {
+    if (data_ != nullptr)
+        ::munmap(data_, size_);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Order.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//What commit() does after writing a batch to the journal file
+enum class FsyncPolicy : uint8_t {
+    None,       //Leave it to the OS page cache: survives a process crash, not a power cut
+    EveryCommit,//fdatasync on every commit() that wrote something (group commit)
+    Interval    //fdatasync at most once per JournalConfig::fsyncInterval
+};
+
+struct JournalConfig {
+    //Appends are buffered up to this many bytes before they are written out
+    std::size_t batchBytes = 64 * 1024;
+
+    FsyncPolicy fsync = FsyncPolicy::EveryCommit;
+    std::chrono::microseconds fsyncInterval{1000};
+};
+
+enum class JournalCommand : uint8_t {
+    NewOrder,
+    Cancel,
+    Modify,
+    CancelAllForOwner,
+    NewStop,            //OrderBook::placeStop; a Cancel also reaches a pending stop
+    StartAuction,       //OrderBook::startAuction
+    UncrossAuction      //OrderBook::uncrossAuction at 'price' as the reference price
+};
+
+//One command for a book, written before the book applies it. A journal file holds nothing
+//else: 48-byte records in sequence order, which replay() maps and walks by position.
+struct JournalRecord {
+    uint64_t sequence;  //Starts at 1, no gaps
+    uint64_t orderId;
+    Price price;        //NewOrder, NewStop and Modify; the reference price for UncrossAuction
+    Price triggerPrice; //NewStop only
+    uint32_t quantity;  //NewOrder, NewStop and Modify
+    JournalCommand command;
+    OrderSide side;     //NewOrder and NewStop
+    uint8_t flags;      //NewOrder and NewStop
+    OrderType type;     //NewOrder and NewStop
+    OwnerId owner;      //NewOrder, NewStop and CancelAllForOwner
+    SelfTradePrevention selfTrade;  //NewOrder and NewStop
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(JournalRecord) == 48, "JournalRecord is an on-disk record");
+
+/*
+Write-ahead journal of the commands applied to one OrderBook.
+
+append*() copies a record into an in-memory batch: no syscalls. commit() writes
+the whole batch with one write() and then syncs according to the FsyncPolicy,
+so a caller that commits once per inbound packet (before sending its acks) gets
+group commit: one fsync covers every command in the batch.
+
+Unlike EventLog this runs on the caller's thread: a command is only durable once
+commit() returns, and nothing is ever dropped.
+
+Reopening an existing journal continues its sequence after the last whole record;
+a torn record at the end (crash mid-write) is cut off.
+*/
+class Journal {
+    public:
+        //Opens or creates 'path' for appending. Throws std::runtime_error on failure.
+        explicit Journal(const std::string& path, const JournalConfig& config = JournalConfig{});
+
+        //Commits whatever is still buffered
+        ~Journal();
+
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        //Each returns the sequence number given to the command
+        uint64_t appendNewOrder(const Order& order) {
+            return append(newOrder(JournalCommand::NewOrder, order, 0));
+        }
+        uint64_t appendNewStop(const Order& order, Price triggerPrice) {
+            return append(newOrder(JournalCommand::NewStop, order, triggerPrice));
+        }
+        uint64_t appendCancel(uint64_t orderId) {
+            return append(command(JournalCommand::Cancel, orderId, 0, 0, kNoOwner));
+        }
+        uint64_t appendModify(uint64_t orderId, Price newPrice, uint32_t newQuantity) {
+            return append(command(JournalCommand::Modify, orderId, newPrice, newQuantity, kNoOwner));
+        }
+        uint64_t appendCancelAllForOwner(OwnerId owner) {
+            return append(command(JournalCommand::CancelAllForOwner, 0, 0, 0, owner));
+        }
+        uint64_t appendStartAuction() {
+            return append(command(JournalCommand::StartAuction, 0, 0, 0, kNoOwner));
+        }
+        uint64_t appendUncrossAuction(Price referencePrice) {
+            return append(command(JournalCommand::UncrossAuction, 0, referencePrice, 0, kNoOwner));
+        }
+
+        //Writes the buffered batch and syncs it per the policy. Throws std::runtime_error on I/O failure.
+        void commit();
+
+        //Sequence of the last appended (not necessarily committed) command, 0 if none
+        uint64_t lastSequence() const { return sequence_; }
+
+        //Calls fn(const JournalRecord&) for every whole record with a sequence above
+        //'afterSequence', in order, and returns how many it visited. The file is mapped,
+        //not read, so replaying a long journal is bounded by memory bandwidth.
+        //Throws std::runtime_error if a sequence is missing: the first record visited must be
+        //afterSequence + 1 and each one after it the next. Records before the gap have been
+        //visited by then.
+        template <typename Fn>
+        static std::size_t replay(const std::string& path, uint64_t afterSequence, Fn&& fn) {
+            MappedFile file(path);
+            const JournalRecord* records = static_cast<const JournalRecord*>(file.data());
+            std::size_t count = file.size() / sizeof(JournalRecord);
+
+            //Sequences are dense, so the first record to replay can be found by position
+            std::size_t first = 0;
+            if (count > 0 && afterSequence >= records[0].sequence)
+                first = static_cast<std::size_t>(afterSequence - records[0].sequence + 1);
+            uint64_t expected = afterSequence + 1;
+            for (std::size_t i = first; i < count; ++i, ++expected) {
+                if (records[i].sequence != expected)
+                    throw std::runtime_error("Journal: sequence gap in " + path);
+                fn(records[i]);
+            }
+            return first < count ? count - first : 0;
+        }
+
+    private:
+        static JournalRecord newOrder(JournalCommand type, const Order& order, Price triggerPrice) {
+            return JournalRecord{0, order.orderId, order.price, triggerPrice, order.quantity, type, order.side, order.flags, order.type,
+                order.owner, order.selfTrade, {}};
+        }
+        static JournalRecord command(JournalCommand type, uint64_t orderId, Price price, uint32_t quantity, OwnerId owner) {
+            return JournalRecord{0, orderId, price, 0, quantity, type, OrderSide::BUY, 0, OrderType::Limit, owner, SelfTradePrevention::CancelNewest, {}};
+        }
+
+        //Read-only mapping of a whole file; an empty or missing file maps to nothing
+        class MappedFile {
+            public:
+                explicit MappedFile(const std::string& path);
+                ~MappedFile();
+                MappedFile(const MappedFile&) = delete;
+                MappedFile& operator=(const MappedFile&) = delete;
+
+                const void* data() const { return data_; }
+                std::size_t size() const { return size_; }
+
+            private:
+                void* data_ = nullptr;
+                std::size_t size_ = 0;
+        };
+
+        uint64_t append(JournalRecord record) {
+            record.sequence = ++sequence_;
+            if (batch_.size() == batch_.capacity())
+                writeBatch();
+            batch_.push_back(record);
+            return record.sequence;
+        }
+
+        void writeBatch();
+
+        JournalConfig config_;
+        int fd_;
+        uint64_t sequence_ = 0;
+        bool dirty_ = false;    //Written since the last fdatasync
+        std::chrono::steady_clock::time_point lastSync_;
+        std::vector<JournalRecord> batch_;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/*
+HDR-style log-linear latency histogram.
+
+Values below 128 get a bucket each. Above that, every power of two is split into
+64 linear sub-buckets, so any recorded value is reported within 1/64 (~1.6%) of
+its true value, from a few nanoseconds up to hours, in a fixed ~30 KB of counters.
+record() is a count-leading-zeros, a shift and an increment: cheap enough to call
+around every single operation of a replay.
+*/
+class LatencyHistogram {
+    public:
+        LatencyHistogram() : counts_(kBuckets, 0) {}
+
+        void record(uint64_t value) {
+            ++counts_[indexOf(value)];
+            ++count_;
+            min_ = std::min(min_, value);
+            max_ = std::max(max_, value);
+        }
+
+        void merge(const LatencyHistogram& other) {
+            for (std::size_t i = 0; i < kBuckets; ++i)
+                counts_[i] += other.counts_[i];
+            count_ += other.count_;
+            min_ = std::min(min_, other.min_);
+            max_ = std::max(max_, other.max_);
+        }
+
+        void reset() {
+            std::fill(counts_.begin(), counts_.end(), 0);
+            count_ = 0;
+            min_ = std::numeric_limits<uint64_t>::max();
+            max_ = 0;
+        }
+
+        uint64_t count() const { return count_; }
+        uint64_t min() const { return count_ == 0 ? 0 : min_; }
+        uint64_t max() const { return max_; }
+
+        //Smallest recorded bucket value such that 'percentile'% of samples are <= it (e.g. 99.9)
+        uint64_t percentile(double percentile) const {
+            if (count_ == 0)
+                return 0;
+            uint64_t target = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5);
+            target = std::max<uint64_t>(1, std::min(target, count_));
+            uint64_t seen = 0;
+            for (std::size_t i = 0; i < kBuckets; ++i) {
+                seen += counts_[i];
+                if (seen >= target)
+                    return std::min(upperBound(i), max_);
+            }
+            return max_;
+        }
+
+    private:
+        static constexpr unsigned kSubBits = 6;                    //64 sub-buckets per power of two
+        static constexpr uint64_t kLinear = uint64_t{2} << kSubBits; //Values below 128 are exact
+        static constexpr std::size_t kBuckets = kLinear + (64 - kSubBits - 1) * (std::size_t{1} << kSubBits);
+
+        static std::size_t indexOf(uint64_t value) {
+            if (value < kLinear)
+                return static_cast<std::size_t>(value);
+            unsigned magnitude = 63 - static_cast<unsigned>(__builtin_clzll(value)); //>= kSubBits + 1
+            unsigned shift = magnitude - kSubBits;
+            uint64_t sub = (value >> shift) - (uint64_t{1} << kSubBits);
+            return static_cast<std::size_t>(kLinear + (magnitude - kSubBits - 1) * (uint64_t{1} << kSubBits) + sub);
+        }
+
+        //Largest value that maps to bucket 'index'
+        static uint64_t upperBound(std::size_t index) {
+            if (index < kLinear)
+                return index;
+            std::size_t rest = index - kLinear;
+            unsigned magnitude = static_cast<unsigned>(rest >> kSubBits) + kSubBits + 1;
+            unsigned shift = magnitude - kSubBits;
+            uint64_t sub = (rest & ((std::size_t{1} << kSubBits) - 1)) + (uint64_t{1} << kSubBits);
+            return ((sub + 1) << shift) - 1;
+        }
+
+        std::vector<uint64_t> counts_;
+        uint64_t count_ = 0;
+        uint64_t min_ = std::numeric_limits<uint64_t>::max();
+        uint64_t max_ = 0;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Order.h"
+#include "OrderIndex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class OrderBook;
+
+//Aggregated state of one price level
+struct DepthLevel {
+    Price price;
+    uint64_t quantity;      //Total remaining quantity resting at this price
+    uint32_t orderCount;
+};
+
+//One change to the L2 book
+struct DepthUpdate {
+    enum class Action : uint8_t { Add, Update, Delete };
+
+    Action action;
+    OrderSide side;
+    Price price;
+    uint64_t quantity;      //New aggregate, 0 for Delete
+    uint32_t orderCount;    //New aggregate, 0 for Delete
+};
+
+/*
+Incremental L2 depth feed for one OrderBook.
+
+While a command runs, the book tells the publisher which levels it is about to
+change (and what they looked like before the first change). publish() then emits
+one Add/Update/Delete per level whose aggregates actually changed, reading the
+new values straight from the level headers: nothing is walked and nothing is
+diffed beyond the levels the command touched.
+
+Attach with OrderBook::setDepthPublisher() and call publish() after each command
+(or batch of commands), on the book's thread.
+*/
+class DepthPublisher {
+    public:
+        //Called by the book before it changes a level. 'existed' is false for a level about to be created.
+        void noteLevel(OrderSide side, Price price, uint64_t quantity, uint32_t orderCount, bool existed) {
+            //Sweeps and repeated fills hit the same level back to back
+            if (!dirty_.empty() && dirty_.back().side == side && dirty_.back().price == price)
+                return;
+            if (!dirtyIndex_.insert(levelKey(side, price), static_cast<uint32_t>(dirty_.size())))
+                return;
+            dirty_.push_back({side, existed, price, quantity, orderCount});
+        }
+
+        //Levels touched since the last publish()
+        std::size_t pending() const { return dirty_.size(); }
+
+        //Calls fn(const DepthUpdate&) for every level that changed since the last call, in the
+        //order they were first touched, and returns how many updates were emitted.
+        //Defined in OrderBook.h.
+        template <typename Fn>
+        std::size_t publish(const OrderBook& book, Fn&& fn);
+
+    private:
+        //A level as it was before the first change in this round
+        struct Touched {
+            OrderSide side;
+            bool existed;
+            Price price;
+            uint64_t quantity;
+            uint32_t orderCount;
+        };
+
+        //One key per (side, price). Book prices stay within PriceLadder::kMaxTick of zero, so
+        //the offset keeps every key below OrderIndex's reserved kEmptyKey.
+        static uint64_t levelKey(OrderSide side, Price price) {
+            return ((static_cast<uint64_t>(price) + (uint64_t{1} << 62)) << 1) | static_cast<uint64_t>(side);
+        }
+
+        std::vector<Touched> dirty_;
+        OrderIndex<uint32_t> dirtyIndex_;   //Level key -> its entry in dirty_
+};
@@ -0,0 +1,215 @@
+#include "MatchingEngine.h"
+
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+void pinCurrentThread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    //Best effort: an unavailable CPU just leaves the thread unpinned
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+//Spin briefly when a ring is empty/full, then start yielding the core
+void backoff(unsigned& spins) {
+    if (++spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+        return;
+    }
+    std::this_thread::yield();
+}
+
+} // namespace
+
+MatchingEngine::MatchingEngine(const EngineConfig& config)
+    : config_{config} {
+    std::size_t shards = config.shards == 0 ? 1 : config.shards;
+    for (std::size_t i = 0; i < shards; ++i)
+        shards_.push_back(std::make_unique<Shard>(config.commandRingCapacity, config.tradeRingCapacity));
+}
+
+MatchingEngine::~MatchingEngine() {
+    stop();
+}
+
+void MatchingEngine::addInstrument(InstrumentId instrument, const OrderBookConfig& bookConfig) {
+    if (running_.load(std::memory_order_relaxed))
+        throw std::logic_error("MatchingEngine: addInstrument after start");
+    if (shardIndex_.contains(instrument))
+        throw std::logic_error("MatchingEngine: duplicate instrument");
+
+    //Least-loaded shard by book count; ties go to the lowest shard number
+    std::size_t target = 0;
+    for (std::size_t i = 1; i < shards_.size(); ++i)
+        if (shards_[i]->books.size() < shards_[target]->books.size())
+            target = i;
+
+    Shard& shard = *shards_[target];
+    shard.bookIndex.insert(instrument, static_cast<uint32_t>(shard.books.size()));
+    shard.books.push_back(std::make_unique<OrderBook>(bookConfig));
+    shardIndex_.insert(instrument, static_cast<uint32_t>(target));
+}
+
+void MatchingEngine::start() {
+    if (running_.exchange(true))
+        return;
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+        Shard& shard = *shards_[i];
+        shard.worker = std::thread([this, &shard, i] { runShard(shard, i); });
+    }
+}
+
+void MatchingEngine::stop() {
+    if (!running_.exchange(false))
+        return;
+    for (auto& shard : shards_)
+        shard->worker.join();
+}
+
+bool MatchingEngine::submit(const EngineCommand& command) {
+    const uint32_t* shard = shardIndex_.find(command.instrument);
+    if (shard == nullptr)
+        throw std::out_of_range("MatchingEngine: unknown instrument");
+    return shards_[*shard]->commands.tryPush(command);
+}
+
+std::size_t MatchingEngine::shardOf(InstrumentId instrument) const {
+    const uint32_t* shard = shardIndex_.find(instrument);
+    if (shard == nullptr)
+        throw std::out_of_range("MatchingEngine: unknown instrument");
+    return *shard;
+}
+
+uint64_t MatchingEngine::processedCount() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_)
+        total += shard->processed.load(std::memory_order_acquire);
+    return total;
+}
+
+uint64_t MatchingEngine::rejectedCount() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_)
+        total += shard->rejected.load(std::memory_order_acquire);
+    return total;
+}
+
+void MatchingEngine::collectStats(BookStats& out) {
+    if (!AGORA_BOOK_STATS)
+        return;
+
+    //Stopped: the books are ours to read
+    if (!running_.load(std::memory_order_acquire)) {
+        for (const auto& shard : shards_)
+            for (const auto& book : shard->books)
+                book->collectStats(out);
+        return;
+    }
+
+    //Running: ask every shard first, so they all copy in parallel, then gather the replies
+    std::vector<uint64_t> requests;
+    requests.reserve(shards_.size());
+    for (auto& shard : shards_)
+        requests.push_back(shard->statsRequested.fetch_add(1, std::memory_order_release) + 1);
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+        Shard& shard = *shards_[i];
+        unsigned spins = 0;
+        while (shard.statsServed.load(std::memory_order_acquire) != requests[i])
+            backoff(spins);
+        out.merge(shard.statsReply);
+    }
+}
+
+void MatchingEngine::serveStats(Shard& shard) {
+    uint64_t request = shard.statsRequested.load(std::memory_order_acquire);
+    shard.statsReply.reset();
+    for (const auto& book : shard.books)
+        book->collectStats(shard.statsReply);
+    shard.statsServed.store(request, std::memory_order_release);
+}
+
+const OrderBook& MatchingEngine::book(InstrumentId instrument) const {
+    const Shard& shard = *shards_[shardOf(instrument)];
+    return *shard.books[*shard.bookIndex.find(instrument)];
+}
+
+void MatchingEngine::apply(Shard& shard, const EngineCommand& command) {
+    const uint32_t* index = shard.bookIndex.find(command.instrument);
+    if (index == nullptr)
+        return;
+    OrderBook& book = *shard.books[*index];
+
+    if (command.type == EngineCommand::Type::Cancel) {
+        book.cancelOrder(command.order.orderId);
+        return;
+    }
+    if (command.type == EngineCommand::Type::CancelAllForOwner) {
+        book.cancelAllForOwner(command.order.owner);
+        return;
+    }
+
+    auto publish = [&shard, &command](const Trade& trade) {
+        //Never drop a fill: wait for the publisher to make room
+        EngineTrade published{command.instrument, trade};
+        unsigned spins = 0;
+        while (!shard.trades.tryPush(published))
+            backoff(spins);
+    };
+
+    //The book refuses a command before changing anything, so a refused one is only counted.
+    //Anything else (bad_alloc growing the pool mid-match) is not a refusal and stops the shard.
+    try {
+        if (command.type == EngineCommand::Type::Modify)
+            book.modifyOrder(command.order.orderId, command.order.price, command.order.quantity, publish);
+        else
+            book.processOrder(command.order, publish);
+    } catch (const std::invalid_argument&) {
+        shard.rejected.fetch_add(1, std::memory_order_relaxed);
+    } catch (const std::out_of_range&) {
+        shard.rejected.fetch_add(1, std::memory_order_relaxed);
+    } catch (const std::length_error&) {
+        shard.rejected.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MatchingEngine::runShard(Shard& shard, std::size_t shardNumber) {
+    if (config_.pinThreads)
+        pinCurrentThread(config_.firstCpu + static_cast<int>(shardNumber));
+
+    constexpr std::size_t kBatch = 256;
+    std::vector<EngineCommand> batch(kBatch);
+    unsigned spins = 0;
+    for (;;) {
+        //Read the flag before draining so everything submitted before stop() is applied
+        bool running = running_.load(std::memory_order_acquire);
+
+        //One relaxed load per batch; the stats themselves are only copied when asked for
+        if (AGORA_BOOK_STATS && shard.statsRequested.load(std::memory_order_relaxed) != shard.statsServed.load(std::memory_order_relaxed))
+            serveStats(shard);
+
+        std::size_t count = shard.commands.popBatch(batch.data(), kBatch);
+        if (count == 0) {
+            if (!running)
+                return;
+            backoff(spins);
+            continue;
+        }
+        spins = 0;
+        for (std::size_t i = 0; i < count; ++i)
+            apply(shard, batch[i]);
+        shard.processed.fetch_add(count, std::memory_order_release);
+    }
+}
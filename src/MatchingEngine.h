@@ -0,0 +1,167 @@
+#pragma once
+
+#include "BookStats.h"
+#include "Order.h"
+#include "OrderBook.h"
+#include "OrderIndex.h"
+#include "SpscRing.h"
+#include "Trade.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//An inbound instruction for one instrument's book
+struct EngineCommand {
+    enum class Type : uint8_t { NewOrder, Cancel, Modify, CancelAllForOwner };
+
+    Type type;
+    InstrumentId instrument;
+    Order order;        //NewOrder: the order. Cancel: only order.orderId. Modify: orderId, new price and quantity.
+                        //CancelAllForOwner: only order.owner.
+
+    static EngineCommand newOrder(InstrumentId instrument, const Order& order) {
+        return {Type::NewOrder, instrument, order};
+    }
+    static EngineCommand cancel(InstrumentId instrument, uint64_t orderId) {
+        return {Type::Cancel, instrument, Order(orderId, OrderSide::BUY, 0, 0)};
+    }
+    static EngineCommand modify(InstrumentId instrument, uint64_t orderId, Price newPrice, uint32_t newQuantity) {
+        return {Type::Modify, instrument, Order(orderId, OrderSide::BUY, newQuantity, newPrice)};
+    }
+    static EngineCommand cancelAllForOwner(InstrumentId instrument, OwnerId owner) {
+        EngineCommand command{Type::CancelAllForOwner, instrument, Order(0, OrderSide::BUY, 0, 0)};
+        command.order.owner = owner;
+        return command;
+    }
+};
+
+//A fill published by the engine, tagged with its instrument
+struct EngineTrade {
+    InstrumentId instrument;
+    Trade trade;
+};
+
+struct EngineConfig {
+    //Number of worker threads. Each owns a disjoint set of books.
+    std::size_t shards = 1;
+
+    //Capacity of each shard's inbound command ring and outbound trade ring
+    std::size_t commandRingCapacity = 1 << 16;
+    std::size_t tradeRingCapacity = 1 << 16;
+
+    //Pin shard i to CPU (firstCpu + i). Ignored where thread affinity is not supported.
+    bool pinThreads = false;
+    int firstCpu = 0;
+};
+
+/*
+Multi-instrument matching engine.
+
+Books are sharded across worker threads. Every shard owns its books outright and
+is fed by its own lock-free SPSC command ring, so all matching is single-threaded
+per book and takes no locks. Fills go out on a per-shard SPSC trade ring.
+
+Threading contract:
+ - addInstrument() only before start().
+ - submit() from one thread (the gateway thread).
+ - pollTrades() from one thread (the publisher thread; may be the gateway thread).
+*/
+class MatchingEngine {
+    public:
+        explicit MatchingEngine(const EngineConfig& config = EngineConfig{});
+
+        //Stops the workers if they are still running
+        ~MatchingEngine();
+
+        MatchingEngine(const MatchingEngine&) = delete;
+        MatchingEngine& operator=(const MatchingEngine&) = delete;
+
+        //Creates the book for 'instrument' on the least-loaded shard.
+        //Throws std::logic_error if called after start() or for a duplicate instrument.
+        void addInstrument(InstrumentId instrument, const OrderBookConfig& bookConfig = OrderBookConfig{});
+
+        void start();
+
+        //Lets the workers finish every command already submitted, then joins them
+        void stop();
+
+        //Queues a command for its instrument's shard. Returns false if that shard's ring is
+        //full (the caller retries). Throws std::out_of_range for an unknown instrument.
+        bool submit(const EngineCommand& command);
+
+        //Hands every published fill to fn(const EngineTrade&). Returns how many there were.
+        template <typename Fn>
+        std::size_t pollTrades(Fn&& fn);
+
+        std::size_t shardCount() const { return shards_.size(); }
+        std::size_t shardOf(InstrumentId instrument) const;
+
+        //Commands every shard has finished applying. Used to wait for the engine to go idle.
+        uint64_t processedCount() const;
+
+        //Of those, commands a book refused by throwing: an order that found the pool full under
+        //PoolExhaustion::Throw, a price outside its book's ladder window or a reserved order ID.
+        //The book is left unchanged and the shard carries on. Other exceptions are not caught.
+        uint64_t rejectedCount() const;
+
+        //Adds every book's instrumentation (see BookStats) into 'out'. While the engine runs,
+        //each shard copies its books' stats between two batches, so the hot path stays free of
+        //atomics; this waits for all shards to answer. Call from one thread, not during stop().
+        //Leaves 'out' unchanged unless built with AGORA_BOOK_STATS.
+        void collectStats(BookStats& out);
+
+        //Direct access to a book. Only safe while the engine is stopped.
+        const OrderBook& book(InstrumentId instrument) const;
+
+    private:
+        struct Shard {
+            Shard(std::size_t commandCapacity, std::size_t tradeCapacity)
+                : commands{commandCapacity}, trades{tradeCapacity} {}
+
+            SpscRing<EngineCommand> commands;
+            SpscRing<EngineTrade> trades;
+
+            //Instrument -> index into books. Read only by this shard's worker once started.
+            OrderIndex<uint32_t> bookIndex;
+            std::vector<std::unique_ptr<OrderBook>> books;
+
+            alignas(64) std::atomic<uint64_t> processed{0};
+            std::atomic<uint64_t> rejected{0};
+            std::thread worker;
+
+            //Stats scraping: collectStats() bumps statsRequested, the worker merges its books
+            //into statsReply between batches and then publishes statsServed
+            alignas(64) std::atomic<uint64_t> statsRequested{0};
+            std::atomic<uint64_t> statsServed{0};
+            BookStats statsReply;
+        };
+
+        void runShard(Shard& shard, std::size_t shardNumber);
+        static void apply(Shard& shard, const EngineCommand& command);
+        static void serveStats(Shard& shard);
+
+        EngineConfig config_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+
+        //Instrument -> shard number, read by the submitting thread
+        OrderIndex<uint32_t> shardIndex_;
+
+        std::atomic<bool> running_{false};
+};
+
+template <typename Fn>
+std::size_t MatchingEngine::pollTrades(Fn&& fn) {
+    std::size_t count = 0;
+    EngineTrade trade;
+    for (auto& shard : shards_) {
+        while (shard->trades.tryPop(trade)) {
+            fn(static_cast<const EngineTrade&>(trade));
+            ++count;
+        }
+    }
+    return count;
+}
@@ -1,15 +1,72 @@
 #pragma once
 
+#include <cmath>
 #include <cstdint>
+#include <type_traits>
 
-enum class OrderSide {BUY, SELL};
+//Prices are fixed-point: an integer number of ticks of the instrument's tick size
+using Price = int64_t;
 
+//Converts an external decimal price to ticks and back, e.g. 10.25 with a 0.01 tick is 1025.
+//Prices are expected to sit on the tick grid; anything else snaps to the nearest tick.
+inline Price priceToTicks(double price, double tickSize) { return static_cast<Price>(std::llround(price / tickSize)); }
+inline double ticksToPrice(Price ticks, double tickSize) { return static_cast<double>(ticks) * tickSize; }
+
+//Identifies one tradable instrument (and so one OrderBook)
+using InstrumentId = uint32_t;
+
+enum class OrderSide : uint8_t {BUY, SELL};
+
+//How an order treats whatever it cannot fill on arrival
+enum class OrderType : uint8_t {
+    Limit,              //Matches up to its price, the rest rests in the book
+    Market,             //Matches at any price, the rest is cancelled
+    ImmediateOrCancel,  //Matches up to its price, the rest is cancelled
+    FillOrKill,         //Fills completely up to its price, or is cancelled without trading
+    PostOnly            //Rests without matching, or is cancelled if it would cross
+};
+
+//Identifies the participant (firm or session) an order belongs to. 0 means none.
+using OwnerId = uint32_t;
+constexpr OwnerId kNoOwner = 0;
+
+//What happens when an order would trade against a resting order with the same owner.
+//The incoming order's mode applies. Orders without an owner never trigger it.
+enum class SelfTradePrevention : uint8_t {
+    CancelNewest,   //Cancel the rest of the incoming order; the resting order is untouched
+    CancelOldest,   //Cancel the resting order and keep matching
+    DecrementBoth   //Take the smaller quantity off both without trading, and keep matching
+};
+
+//32 bytes. Resting, it is split: the 32-byte OrderNode keeps what matching reads,
+//and the owner and self-trade mode sit in a parallel array beside the pool (see OrderPool.h)
 struct Order {
     uint64_t orderId;
-    OrderSide side;
+    Price price;
     uint32_t quantity;
-    double price;
+    OwnerId owner;
+    OrderSide side;
+    OrderType type;
+    SelfTradePrevention selfTrade;
+    uint8_t flags;      //Instruction bits for the session layer; the book ignores them
+
+    Order() = default;
+
+    Order(uint64_t id, OrderSide orderSide, uint32_t qty, Price p, OrderType orderType = OrderType::Limit)
+        : orderId{id}, price{p}, quantity{qty}, owner{kNoOwner}, side{orderSide}, type{orderType},
+        selfTrade{SelfTradePrevention::CancelNewest}, flags{0} {}
+
+    //Catch callers still passing a decimal price: convert with priceToTicks first
+    template <typename Decimal, typename = std::enable_if_t<std::is_floating_point_v<Decimal>>>
+    Order(uint64_t id, OrderSide orderSide, uint32_t qty, Decimal p, OrderType orderType = OrderType::Limit) = delete;
+};
+
+static_assert(sizeof(Order) == 32, "Order must stay 32 bytes");
 
-    Order(uint64_t id, OrderSide orderSide, uint32_t qty, double p)
-        : orderId{id}, side{orderSide}, quantity{qty}, price{p} {} 
-};
\ No newline at end of file
+//An order held back until the market trades through 'triggerPrice': a buy stop waits for a
+//trade at or above it, a sell stop for one at or below it. Then 'order' enters the book as
+//usual - a Market order makes a plain stop, a Limit order (at order.price) a stop-limit.
+struct StopOrder {
+    Order order;
+    Price triggerPrice;
+};
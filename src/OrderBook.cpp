@@ -1,180 +1,451 @@
 #include "OrderBook.h"
-#include <iostream>
+
+OrderBook::OrderBook(const OrderBookConfig& config)
+    : config_{config},
+    pool_{config.orderCapacity, config.onPoolExhausted},
+    asks_{config.ladderTicks, config.maxLadderTicks},
+    bids_{config.ladderTicks, config.maxLadderTicks},
+    buyStops_{kStopLadderTicks, config.maxLadderTicks},
+    sellStops_{kStopLadderTicks, config.maxLadderTicks} {
+    orderMap_.reserve(config.orderCapacity);
+}
 
 std::vector<Trade> OrderBook::processOrder(const Order& newOrder) {
     //Create a new instance called trades
     std::vector<Trade> trades;
+    processOrder(newOrder, trades);
+    return trades;
+}
 
-    if (newOrder.side == OrderSide::BUY) {
-        // Logic for a new buy order
-        /*
-        1. Check: if anyone IS NOT selling 
-        or trade is NOT possible (buy price is less than the lowest ask price) 
-        then rest it in the bids_ book
-        */
-        if (asks_.empty() || newOrder.price < asks_.begin()->first) {
-            auto& bidList = bids_[newOrder.price];
-            bidList.push_back(newOrder);
-            orderMap_[newOrder.orderId] = std::prev(bidList.end());
-            return trades;
-        }
+uint32_t OrderBook::processOrder(const Order& newOrder, std::vector<Trade>& trades) {
+    return processOrder(newOrder, [&trades](const Trade& trade) { trades.push_back(trade); });
+}
 
-        //Otherwise, a trade possible!
-        std::cout << "Match is possible!" << std::endl;
-        matchOrders(newOrder, trades);
+bool OrderBook::modifyOrder(uint64_t orderId, Price newPrice, uint32_t newQuantity) {
+    return modifyOrder(orderId, newPrice, newQuantity, [](const Trade&) {});
+}
+
+AuctionResult OrderBook::uncrossAuction(Price referencePrice, std::vector<Trade>& trades) {
+    return uncrossAuction(referencePrice, [&trades](const Trade& trade) { trades.push_back(trade); });
+}
+
+AuctionResult OrderBook::indicativeAuction(Price referencePrice) const {
+    AuctionCurves curves;
+    if (!buildAuctionCurves(curves))
+        return {};
+    return curves.equilibrium(referencePrice);
+}
 
+bool OrderBook::buildAuctionCurves(AuctionCurves& curves) const {
+    if (bids_.empty() || asks_.empty())
+        return false;
+    Price first = asks_.lowest();
+    Price last = bids_.highest();
+    if (first > last)
+        return false;
+
+    //Only ticks in [first, last] can be the price: below the best ask nothing is offered,
+    //above the best bid nothing is bid. And with no bid above 'last' and no ask below
+    //'first', the levels inside the range make up both curves there.
+    curves.reset(first, last);
+    uint64_t* bids = curves.bids();
+    uint64_t* asks = curves.asks();
+    bids_.forEachTick(first, last, [bids, last](int64_t tick, const PriceLevel& level) {
+        bids[last - tick] = level.totalQuantity;
+    });
+    asks_.forEachTick(first, last, [asks, first](int64_t tick, const PriceLevel& level) {
+        asks[tick - first] = level.totalQuantity;
+    });
+    curves.accumulate();
+    return true;
+}
+
+void OrderBook::restOrder(PriceLadder<PriceLevel>& book, const Order& order) {
+    if (depthPublisher_ != nullptr)
+        noteLevel(order.side, order.price, book.find(order.price));
+    //Level first: if the ladder cannot take the price, nothing has changed yet. Levels hold
+    //handles, so the pool growing below does not disturb them.
+    PriceLevel& level = book[order.price];
+    OrderHandle handle = allocateFor(book, level, order, order.price);
+    level.pushBack(pool_, handle);
+    count(&BookCounters::levelsCreated, level.count == 1);
+    orderMap_.insert(order.orderId, handle);
+    linkOwner(handle);
+    noteExposure(order, order.quantity);
+}
+
+OrderHandle OrderBook::allocateFor(PriceLadder<PriceLevel>& ladder, const PriceLevel& level, const Order& order, Price tick) {
+    try {
+        return pool_.allocate(order);
+    } catch (...) {
+        //Take back a level created just for this order
+        if (level.count == 0)
+            ladder.erase(tick);
+        throw;
     }
-    
-    else if (newOrder.side == OrderSide::SELL) {
-        //Logic for a new sell order
-
-        /*
-        Check: if there isn't a buy order
-        or sell price is HIGHER than the largest buy price (Trade is not possible),
-        then rest it in the asks_ book
-        */
-        if (bids_.empty() || newOrder.price > bids_.begin()->first) {
-            auto& askList = asks_[newOrder.price];
-            askList.push_back(newOrder);
-            orderMap_[newOrder.orderId] = std::prev(askList.end());
-            return trades;
+}
+
+void OrderBook::linkOwner(OrderIndex<OwnerList>& lists, OrderHandle handle) {
+    OwnerId owner = pool_.owner(handle);
+    if (owner == kNoOwner)
+        return;
+    auto side = static_cast<std::size_t>(pool_[handle].side);
+    //Newest first: the new node becomes the head of the owner's list
+    OwnerList* list = lists.find(owner);
+    if (list == nullptr) {
+        OwnerList first{handle, {0, 0}};
+        first.linked[side] = 1;
+        lists.insert(owner, first);
+        return;
+    }
+    pool_.ownerEntry(handle).next = list->head;
+    pool_.ownerEntry(list->head).prev = handle;
+    list->head = handle;
+    ++list->linked[side];
+}
+
+void OrderBook::unlinkOwner(OrderIndex<OwnerList>& lists, OrderHandle handle) {
+    OwnerEntry& links = pool_.ownerEntry(handle);
+    OwnerId owner = links.owner;
+    if (owner == kNoOwner)
+        return;
+    if (links.prev == kNullOrder && links.next == kNullOrder) {
+        lists.erase(owner);
+        return;
+    }
+    OwnerList& list = *lists.find(owner);
+    --list.linked[static_cast<std::size_t>(pool_[handle].side)];
+    if (links.prev != kNullOrder)
+        pool_.ownerEntry(links.prev).next = links.next;
+    else
+        list.head = links.next;
+    if (links.next != kNullOrder)
+        pool_.ownerEntry(links.next).prev = links.prev;
+    links.prev = kNullOrder;
+    links.next = kNullOrder;
+}
+
+bool OrderBook::cancelOrder(uint64_t orderId) {
+    uint64_t start = statsClock();
+
+    // 1. O(1) lookup to find the order's location
+    const OrderHandle* found = orderMap_.find(orderId);
+
+    // Order ID not found (or only a tombstone), maybe it was already filled or cancelled.
+    // Record the rejected cancel in the event log and leave the book untouched.
+    if (found == nullptr || pool_[*found].dead) {
+        //Not resting: it may be a pending stop
+        if (const PendingStop* stop = stopMap_.empty() ? nullptr : stopMap_.find(orderId)) {
+            const OrderNode& order = pool_[stop->handle];
+            logEvent(BookEventType::OrderCancelled, orderId, 0, order.side, order.price, order.quantity);
+            removeStop(stop->handle, stop->triggerPrice);
+            count(&BookCounters::cancelHits);
+            recordCycles(&BookStats::cancelOrderCycles, start);
+            return true;
         }
+        logEvent(BookEventType::CancelRejected, orderId, 0, OrderSide::BUY, 0, 0);
+        count(&BookCounters::cancelMisses);
+        recordCycles(&BookStats::cancelOrderCycles, start);
+        return false;
+    }
+
+    // 2. Get the handle of the order's node in the pool
+    OrderHandle handle = *found;
+
+    // 3. Get the order's data to know which book to look in
+    const OrderNode& order = pool_[handle];
+    
+    // 4. Unlink the order from the correct book, at the order's price level
+    PriceLadder<PriceLevel>& book = order.side == OrderSide::BUY ? bids_ : asks_;
+    auto& level = *book.find(order.price);
+    noteLevel(order.side, order.price, &level);
+    logEvent(BookEventType::OrderCancelled, orderId, 0, order.side, order.price, order.quantity);
+    noteExposure(handle, -static_cast<int64_t>(order.quantity));
 
-        //Otherwise, a trade is possible
-        std::cout << "Match is possible!" << std::endl;
-        matchOrders(newOrder, trades);
-        
+    // Lazy: leave the node linked as a tombstone, out of the level's totals
+    if (config_.cancelMode == CancelMode::Lazy) {
+        level.markDead(pool_, handle);
+        ++tombstones_;
+        if (level.empty())
+            retireLevel(book, order.price, level);
+        else if (level.dead > kCompactAfter && level.dead > level.count)
+            compactLevel(level);
+        count(&BookCounters::cancelHits);
+        recordCycles(&BookStats::cancelOrderCycles, start);
+        return true;
     }
 
-    return trades;
+    level.erase(pool_, handle);
+    // If the price level is now empty, remove it
+    if (level.empty())
+        retireLevel(book, order.price, level);
 
+    // 5. O(1) cleanup of the map and give the node back to the pool
+    unlinkOwner(handle);
+    orderMap_.erase(orderId);
+    pool_.release(handle);
+    count(&BookCounters::cancelHits);
+    recordCycles(&BookStats::cancelOrderCycles, start);
+    return true;
 }
 
-void OrderBook::matchOrders(Order orderToMatch, std::vector<Trade>& trades) {
-    //Logic for fulfilling orders
-
-    /*
-    If the order was a buy, enter the buy loop
-    */
-    if (orderToMatch.side == OrderSide::BUY) {
-        /*
-        Continue to complete orders until the current order no longer has quantity nor
-        the buying price is less than the ask price
-        */
-        while (orderToMatch.quantity > 0 && !asks_.empty() && orderToMatch.price >= asks_.begin()->first) {
-            //Grab all the orders at the beginning of the asks_ book (SAME price)
-            auto& bestAskLevel = asks_.begin()->second;
-
-            //Get the oldest order from that level
-            auto& oldestAsk = bestAskLevel.front();
-            
-            //Find the lowest trade quantity between both orders
-            uint32_t tradeQuantity = std::min(orderToMatch.quantity, oldestAsk.quantity);
-                     
-            trades.emplace_back(orderToMatch.orderId, oldestAsk.orderId, oldestAsk.price, tradeQuantity);
-
-            //Subtract the quantity for both orders
-            orderToMatch.quantity -= tradeQuantity;
-            oldestAsk.quantity -= tradeQuantity;
-
-            //If the oldestAsk quantity is zero, remove it from the book and map
-            if (oldestAsk.quantity == 0) {
-                orderMap_.erase(oldestAsk.orderId);
-                bestAskLevel.pop_front();
-            }
-                
-            //If the level is empty, remove the level as well
-            if (bestAskLevel.empty())
-                asks_.erase(asks_.begin());
-        }
+std::size_t OrderBook::cancelAllForOwner(OwnerId owner) {
+    if (owner == kNoOwner)
+        return 0;
+
+    //Pending stops first: each one leaves the owner's list as it goes
+    std::size_t cancelled = 0;
+    while (const OwnerList* stops = ownerStops_.find(owner)) {
+        OrderHandle stop = stops->head;
+        const OrderNode& order = pool_[stop];
+        logEvent(BookEventType::OrderCancelled, order.orderId, 0, order.side, order.price, order.quantity);
+        count(&BookCounters::cancelHits);
+        removeStop(stop, stopMap_.find(order.orderId)->triggerPrice);
+        ++cancelled;
+    }
+
+    const OwnerList* list = ownerOrders_.find(owner);
+    if (list == nullptr)
+        return cancelled;
 
-        //If the orderToMatch hasn't been fulfilled, rest it in the book and map
-        if (orderToMatch.quantity > 0) {
-            auto& bidList = bids_[orderToMatch.price];
-            bidList.push_back(orderToMatch);
-            orderMap_[orderToMatch.orderId] = std::prev(bidList.end());
+    //Free the owner's tombstones first, so retiring a level below can never free a node
+    //further down the list being walked
+    if (tombstones_ != 0) {
+        for (OrderHandle handle = list->head; handle != kNullOrder;) {
+            const OrderNode& node = pool_[handle];
+            OrderHandle next = pool_.ownerEntry(handle).next;
+            if (node.dead)
+                reclaim(*(node.side == OrderSide::BUY ? bids_ : asks_).find(node.price), handle);
+            handle = next;
         }
+        list = ownerOrders_.find(owner);
+        if (list == nullptr)
+            return cancelled;
+    }
+
+    //Walk the owner's list once; every node on it is dropped, so the links need no fixing up
+    for (OrderHandle handle = list->head; handle != kNullOrder;) {
+        const OrderNode& order = pool_[handle];
+        OrderHandle next = pool_.ownerEntry(handle).next;
+
+        PriceLadder<PriceLevel>& book = order.side == OrderSide::BUY ? bids_ : asks_;
+        auto& level = *book.find(order.price);
+        noteLevel(order.side, order.price, &level);
+        level.erase(pool_, handle);
+        if (level.empty())
+            retireLevel(book, order.price, level);
+        logEvent(BookEventType::OrderCancelled, order.orderId, 0, order.side, order.price, order.quantity);
+        noteExposure(handle, -static_cast<int64_t>(order.quantity));
+        count(&BookCounters::cancelHits);
 
+        orderMap_.erase(order.orderId);
+        pool_.release(handle);
+        handle = next;
+        ++cancelled;
     }
+    ownerOrders_.erase(owner);
+    return cancelled;
+}
 
-    /*
-    If the order was an ask, enter the ask loop
-    */
-    else if (orderToMatch.side == OrderSide::SELL) {
-        /*
-        Continue to complete orders until the current order no longer has quantity nor
-        the selling price is GREATER than the buy price
-        */
-        while (orderToMatch.quantity > 0 && !bids_.empty() && orderToMatch.price <= bids_.begin()->first) {
-            //Grab all the orders at the beginning of the bids_ book (SAME price)
-            auto& bestBidLevel = bids_.begin()->second;
-
-            //Get the oldest order from that level
-            auto& oldestBid = bestBidLevel.front();
-            
-            //Find the lowest trade quantity between both orders
-            uint32_t tradeQuantity = std::min(orderToMatch.quantity, oldestBid.quantity);
-            
-            trades.emplace_back(orderToMatch.orderId, oldestBid.orderId, oldestBid.price, tradeQuantity);
-
-            //Subtract the quantity for both orders
-            orderToMatch.quantity -= tradeQuantity;
-            oldestBid.quantity -= tradeQuantity;
-
-            //If the oldestAsk quantity is zero, remove it from the book
-            if (oldestBid.quantity == 0) {
-                orderMap_.erase(oldestBid.orderId); //Clean up the map
-                bestBidLevel.pop_front();
-            }
-                
-            //If the level is empty, remove the level as well
-            if (bestBidLevel.empty())
-                bids_.erase(bids_.begin());
-        }
+void OrderBook::reclaimOrThrow() {
+    //Tombstones hold nodes: free them before giving up
+    if (tombstones_ != 0)
+        compact();
+    if (pool_.exhausted())
+        throw std::length_error("OrderBook: order pool is full");
+}
 
-        //If the orderToMatch hasn't been fulfilled, rest it in the book and map
-        if (orderToMatch.quantity > 0) {
-            auto& askList = asks_[orderToMatch.price];
-            askList.push_back(orderToMatch);
-            orderMap_[orderToMatch.orderId] = std::prev(askList.end());
-        }
+void OrderBook::placeStop(const Order& order, Price triggerPrice) {
+    if (order.orderId == kReservedOrderId)
+        throw std::invalid_argument("OrderBook: order ID is reserved");
+    bool rests = order.type == OrderType::Limit || order.type == OrderType::PostOnly;
+    if (!(order.side == OrderSide::BUY ? buyStops_ : sellStops_).fits(triggerPrice) || (rests && !acceptsPrice(order.side, order.price)))
+        throw std::out_of_range("OrderBook: stop price outside the ladder window");
+    if (pool_.exhausted())
+        reclaimOrThrow();
+    queueStop(order, triggerPrice);
+    logEvent(BookEventType::StopAccepted, order.orderId, 0, order.side, triggerPrice, order.quantity);
+}
 
+void OrderBook::queueStop(const Order& order, Price triggerPrice) {
+    PriceLadder<PriceLevel>& stops = order.side == OrderSide::BUY ? buyStops_ : sellStops_;
+    PriceLevel& level = stops[triggerPrice];
+    OrderHandle handle = allocateFor(stops, level, order, triggerPrice);
+    level.pushBack(pool_, handle);
+    if (order.side == OrderSide::BUY)
+        buyStopFloor_ = std::min(buyStopFloor_, triggerPrice);
+    else
+        sellStopCeiling_ = std::max(sellStopCeiling_, triggerPrice);
+    stopMap_.insert(order.orderId, PendingStop{handle, triggerPrice});
+    linkOwner(ownerStops_, handle);
+}
+
+void OrderBook::removeStop(OrderHandle handle, Price triggerPrice) {
+    const OrderNode& order = pool_[handle];
+    bool buy = order.side == OrderSide::BUY;
+    PriceLadder<PriceLevel>& stops = buy ? buyStops_ : sellStops_;
+    PriceLevel& level = *stops.find(triggerPrice);
+    level.erase(pool_, handle);
+    if (level.empty()) {
+        stops.erase(triggerPrice);
+        if (buy)
+            buyStopFloor_ = stops.empty() ? kNoBuyStop : stops.lowest();
+        else
+            sellStopCeiling_ = stops.empty() ? kNoSellStop : stops.highest();
     }
+    unlinkOwner(ownerStops_, handle);
+    stopMap_.erase(order.orderId);
+    pool_.release(handle);
 }
 
-void OrderBook::cancelOrder(uint64_t orderId) {
-    // 1. O(1) lookup to find the order's location
-    auto it = orderMap_.find(orderId);
+void OrderBook::popStops(Price tradePrice) {
+    //Each trigger level goes over whole: its nodes are queued in order and the level dropped
+    auto take = [this](PriceLadder<PriceLevel>& stops, Price trigger) {
+        PriceLevel& level = *stops.find(trigger);
+        for (OrderHandle handle = level.head; handle != kNullOrder; handle = pool_[handle].next)
+            triggered_.push_back(handle);
+        level = PriceLevel{};
+        stops.erase(trigger);
+    };
+    while (buyStopFloor_ <= tradePrice) {
+        take(buyStops_, buyStopFloor_);
+        buyStopFloor_ = buyStops_.empty() ? kNoBuyStop : buyStops_.lowest();
+    }
+    while (sellStopCeiling_ >= tradePrice) {
+        take(sellStops_, sellStopCeiling_);
+        sellStopCeiling_ = sellStops_.empty() ? kNoSellStop : sellStops_.highest();
+    }
+}
 
-    // Order ID not found, maybe it was already filled or cancelled.
-    // In a real system, you might log this. For now, we just return.
-    if (it == orderMap_.end()) {
-        //TODO: ADD SOMETHING TO DO MORE THAN JUST RETURN
-        return;
+void OrderBook::reclaim(PriceLevel& level, OrderHandle handle) {
+    level.eraseDead(pool_, handle);
+    unlinkOwner(handle);
+    //The ID may have been reused by a newer order since; only drop our own entry
+    uint64_t orderId = pool_[handle].orderId;
+    const OrderHandle* entry = orderMap_.find(orderId);
+    if (entry != nullptr && *entry == handle)
+        orderMap_.erase(orderId);
+    pool_.release(handle);
+    --tombstones_;
+    count(&BookCounters::tombstonesReclaimed);
+}
+
+void OrderBook::compactLevel(PriceLevel& level) {
+    for (OrderHandle handle = level.head; handle != kNullOrder && level.dead != 0;) {
+        OrderHandle next = pool_[handle].next;
+        if (pool_[handle].dead)
+            reclaim(level, handle);
+        handle = next;
     }
+}
 
-    // 2. Get the iterator to the order in the std::list
-    auto& orderIterator = it->second;
+std::size_t OrderBook::compact() {
+    std::size_t before = tombstones_;
+    for (PriceLadder<PriceLevel>* book : {&bids_, &asks_}) {
+        if (tombstones_ == 0 || book->empty())
+            continue;
+        int64_t tick = book->lowest();
+        do {
+            PriceLevel& level = *book->find(tick);
+            if (level.dead != 0)
+                compactLevel(level);
+        } while (tombstones_ != 0 && book->next(tick, tick));
+    }
+    return before - tombstones_;
+}
 
-    // 3. Get the order's data to know which book to look in
-    const Order& order = *orderIterator;
-    
-    // 4. Erase the order from the correct book
-    if (order.side == OrderSide::BUY) {
-        // Get the list at the order's price and erase the order using its iterator
-        bids_.at(order.price).erase(orderIterator);
-        // If the price level is now empty, remove it
-        if (bids_.at(order.price).empty()) {
-            bids_.erase(order.price);
-        }
-    } 
-    else if (order.side == OrderSide::SELL) {
-        asks_.at(order.price).erase(orderIterator);
-        if (asks_.at(order.price).empty()) {
-            asks_.erase(order.price);
-        }
+const Order* OrderBook::findOrder(uint64_t orderId) const {
+    const OrderHandle* found = orderMap_.find(orderId);
+    if (found == nullptr || pool_[*found].dead)
+        return nullptr;
+    foundOrder_ = pool_.order(*found);
+    return &foundOrder_;
+}
+
+const Order* OrderBook::findStop(uint64_t orderId) const {
+    const PendingStop* stop = stopMap_.empty() ? nullptr : stopMap_.find(orderId);
+    if (stop == nullptr)
+        return nullptr;
+    foundStop_ = pool_.order(stop->handle);
+    return &foundStop_;
+}
+
+void OrderBook::captureSnapshot(BookSnapshot& snapshot) const {
+    snapshot.nextTradeId = nextTradeId_;
+    snapshot.phase = phase_;
+    snapshot.orders.clear();
+    snapshot.orders.reserve(pool_.size());
+    for (const auto& [price, level] : getAsks())
+        for (const Order& order : level)
+            snapshot.orders.push_back(order);
+    for (const auto& [price, level] : getBids())
+        for (const Order& order : level)
+            snapshot.orders.push_back(order);
+
+    snapshot.stops.clear();
+    snapshot.stops.reserve(stopMap_.size());
+    for (const PriceLadder<PriceLevel>* stops : {&buyStops_, &sellStops_}) {
+        if (stops->empty())
+            continue;
+        int64_t tick = stops->lowest();
+        do {
+            for (const Order& order : PriceLevelView(*stops->find(tick), pool_))
+                snapshot.stops.push_back(StopOrder{order, tick});
+        } while (stops->next(tick, tick));
     }
+}
+
+void OrderBook::restoreSnapshot(const BookSnapshot& snapshot) {
+    if (!orderMap_.empty() || !stopMap_.empty())
+        throw std::logic_error("OrderBook: can only restore a snapshot into an empty book");
+
+    //Size everything once up front instead of growing step by step
+    pool_.reserve(snapshot.orders.size() + snapshot.stops.size());
+    orderMap_.reserve(snapshot.orders.size());
 
-    // 5. O(1) cleanup of the map
-    orderMap_.erase(it);
-}
\ No newline at end of file
+    //Resting never matches, so every order goes back as-is, in its original queue position,
+    //even in a book snapshotted crossed mid-auction
+    for (const Order& order : snapshot.orders)
+        restOrder(order.side == OrderSide::BUY ? bids_ : asks_, order);
+    for (const StopOrder& stop : snapshot.stops)
+        queueStop(stop.order, stop.triggerPrice);
+    nextTradeId_ = snapshot.nextTradeId;
+    phase_ = snapshot.phase;
+}
+
+bool OrderBook::getLevel(OrderSide side, Price price, DepthLevel& out) const {
+    const PriceLevel* level = (side == OrderSide::BUY ? bids_ : asks_).find(price);
+    if (level == nullptr)
+        return false;
+    out = DepthLevel{price, level->totalQuantity, level->count};
+    return true;
+}
+
+std::size_t OrderBook::getDepth(OrderSide side, std::size_t maxLevels, DepthLevel* out) const {
+    const PriceLadder<PriceLevel>& book = side == OrderSide::BUY ? bids_ : asks_;
+    if (book.empty() || maxLevels == 0)
+        return 0;
+
+    //Bids are walked from HIGHEST to LOWEST, asks from LOWEST to HIGHEST
+    int64_t tick = side == OrderSide::BUY ? book.highest() : book.lowest();
+    std::size_t count = 0;
+    do {
+        const PriceLevel& level = *book.find(tick);
+        out[count++] = DepthLevel{tick, level.totalQuantity, level.count};
+    } while (count < maxLevels && (side == OrderSide::BUY ? book.prev(tick, tick) : book.next(tick, tick)));
+    return count;
+}
+
+void OrderBook::collectStats(BookStats& out) const {
+#if AGORA_BOOK_STATS
+    out.merge(stats_);
+#else
+    (void)out;
+#endif
+}
+
+void OrderBook::resetStats() {
+#if AGORA_BOOK_STATS
+    stats_.reset();
+#endif
+}
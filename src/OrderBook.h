@@ -1,33 +1,1052 @@
+#pragma once
+
+#include "Auction.h"
+#include "BookStats.h"
+#include "CycleClock.h"
+#include "EventLog.h"
+#include "MarketData.h"
 #include "Order.h"
 #include "Trade.h"
+#include "OrderIndex.h"
+#include "OrderPool.h"
+#include "PriceLadder.h"
+#include "PriceLevel.h"
+#include "RiskGate.h"
+#include "Snapshot.h"
 
-#include <unordered_map>
-#include <map>
-#include <list>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
+//How cancelOrder takes an order off the book
+enum class CancelMode {
+    Eager,  //Unlink the node from its level and free it at once
+    Lazy    //Only mark the node dead and take it out of its level's totals. The node is
+            //unlinked and freed later: when matching reaches it, when its level empties,
+            //or when its level is mostly dead (see OrderBook::compact)
+};
+
+//Per-instrument settings for an OrderBook
+struct OrderBookConfig {
+    //Initial number of ticks each side's ladder spans around the first price it sees
+    std::size_t ladderTicks = 4096;
+
+    //Widest range of prices, in ticks, that one side may hold at once (resting orders, and
+    //stop triggers separately). An order that would stretch its side further is refused with
+    //std::out_of_range, which keeps each ladder's array to about twice this many levels.
+    std::size_t maxLadderTicks = PriceLadder<PriceLevel>::kDefaultMaxSpan;
+
+    //Number of resting orders preallocated in the order pool
+    std::size_t orderCapacity = 16384;
+
+    //What happens when more than orderCapacity orders are resting at once
+    PoolExhaustion onPoolExhausted = PoolExhaustion::Grow;
+
+    //Lazy cancels touch only the index entry, the node and the level header, never the
+    //node's neighbours; depth, best prices and everything else observable stay the same
+    CancelMode cancelMode = CancelMode::Eager;
+};
+
+//One instruction for OrderBook::processBatch
+struct BookCommand {
+    enum class Type : uint8_t { NewOrder, Cancel, Modify, NewStop };
+
+    Type type;
+    Order order;        //NewOrder, NewStop: the order. Cancel: only order.orderId. Modify: orderId, new price and quantity.
+    Price triggerPrice = 0; //NewStop only
+
+    static BookCommand newOrder(const Order& order) { return {Type::NewOrder, order}; }
+    static BookCommand newStop(const Order& order, Price triggerPrice) { return {Type::NewStop, order, triggerPrice}; }
+    static BookCommand cancel(uint64_t orderId) { return {Type::Cancel, Order(orderId, OrderSide::BUY, 0, 0)}; }
+    static BookCommand modify(uint64_t orderId, Price newPrice, uint32_t newQuantity) {
+        return {Type::Modify, Order(orderId, OrderSide::BUY, newQuantity, newPrice)};
+    }
+};
+
 class OrderBook {
     private:
-        //Asks: sorts from LOWEST price to HIGHEST price (default behavior)
-        std::map<double, std::list<Order>> asks_;
+        OrderBookConfig config_;
+
+        //Every resting order lives in this pool; levels link them by handle
+        OrderPool pool_;
+
+        //Asks: the best (LOWEST) price is asks_.lowest()
+        PriceLadder<PriceLevel> asks_;
+
+        //Bids: the best (HIGHEST) price is bids_.highest()
+        PriceLadder<PriceLevel> bids_;
+
+        // Maps a unique OrderID to the handle of that Order's node in the pool.
+        OrderIndex<OrderHandle> orderMap_;
+
+        //An owner's list: its newest order (the rest hang off the nodes' owner links) and how
+        //many of its nodes are on each side, indexed by OrderSide. canFill reads the counts.
+        struct OwnerList {
+            OrderHandle head;
+            uint32_t linked[2];
+        };
+
+        //Maps an owner to its list of resting orders. Orders without an owner are not tracked.
+        OrderIndex<OwnerList> ownerOrders_;
+
+        //Pending stops, queued by trigger price in their own ladders, apart from bids_/asks_.
+        //Their nodes come from pool_, so a triggered stop always finds a free node to rest in.
+        PriceLadder<PriceLevel> buyStops_;
+        PriceLadder<PriceLevel> sellStops_;
+        static constexpr std::size_t kStopLadderTicks = 256;
+
+        //Maps a pending stop's ID to its node and trigger price
+        struct PendingStop {
+            OrderHandle handle;
+            Price triggerPrice;
+        };
+        OrderIndex<PendingStop> stopMap_;
+
+        //Owner lists of pending stops, kept like ownerOrders_
+        OrderIndex<OwnerList> ownerStops_;
+
+        //The nearest triggers: lowest buy stop and highest sell stop, or values no trade price
+        //reaches. After an order trades, comparing its last price with these is all stops cost.
+        static constexpr Price kNoBuyStop = std::numeric_limits<Price>::max();
+        static constexpr Price kNoSellStop = std::numeric_limits<Price>::min();
+        Price buyStopFloor_ = kNoBuyStop;
+        Price sellStopCeiling_ = kNoSellStop;
+
+        //Stops triggered and waiting to be processed, in order. While they are (firingStops_),
+        //an order that trades through another trigger leaves its last price here instead of
+        //starting a nested round.
+        std::vector<OrderHandle> triggered_;
+        bool firingStops_ = false;
+        bool stopsReached_ = false;
+        Price stopTradePrice_ = 0;
+
+        //Lazily cancelled nodes still linked in their levels
+        std::size_t tombstones_ = 0;
+
+        //A level's tombstones are swept once there are more than this many and they
+        //outnumber its live orders, so each sweep frees at least half of what it walks
+        static constexpr uint32_t kCompactAfter = 32;
+
+        //Continuous matching, or a call auction collecting orders until the uncross
+        TradingPhase phase_ = TradingPhase::Continuous;
+
+        //This book's trade ID sequence. Per book, so books on different threads share nothing.
+        uint64_t nextTradeId_ = 1;
+
+        //Optional journal of everything the book does. Not owned.
+        EventLog* eventLog_ = nullptr;
+
+        //Optional incremental depth feed. Not owned.
+        DepthPublisher* depthPublisher_ = nullptr;
+
+        //Optional pre-trade risk counters, kept current by the book. Not owned.
+        RiskGate* riskGate_ = nullptr;
+        //findOrder/findStop hand back pointers to these: a resting order is rebuilt from its node and owner entry
+        mutable Order foundOrder_;
+        mutable Order foundStop_;
+
+#if AGORA_BOOK_STATS
+        //Hot-path counters and latencies, written only by the thread driving this book
+        BookStats stats_;
+#endif
+
+        //Tells the depth publisher (if any) that the level at 'price' is about to change
+        void noteLevel(OrderSide side, Price price, const PriceLevel* level) {
+            if (depthPublisher_ != nullptr) {
+                if (level != nullptr)
+                    depthPublisher_->noteLevel(side, price, level->totalQuantity, level->count, true);
+                else
+                    depthPublisher_->noteLevel(side, price, 0, 0, false);
+            }
+        }
+
+        //Tells the risk gate (if any) that a resting order gained (> 0) or lost (< 0) 'quantity'
+        void noteExposure(const Order& order, int64_t quantity) {
+            if (riskGate_ != nullptr)
+                riskGate_->onResting(order.owner, order.price, quantity);
+        }
+
+        //Same, for the order in a node (at its current price)
+        void noteExposure(OrderHandle handle, int64_t quantity) {
+            if (riskGate_ != nullptr)
+                riskGate_->onResting(pool_.owner(handle), pool_[handle].price, quantity);
+        }
+
+        void noteTrade(Price price) {
+            if (riskGate_ != nullptr)
+                riskGate_->onTrade(price);
+        }
+
+        //One predictable branch when no log is attached; nothing at all when compiled out
+        void logEvent(BookEventType type, uint64_t orderId, uint64_t otherOrderId, OrderSide side, Price price, uint32_t quantity) {
+#if AGORA_EVENT_LOG
+            if (eventLog_ != nullptr)
+                eventLog_->record(type, orderId, otherOrderId, side, price, quantity);
+#else
+            (void)type; (void)orderId; (void)otherOrderId; (void)side; (void)price; (void)quantity;
+#endif
+        }
+
+        //Instrumentation hooks: a plain increment or histogram update with AGORA_BOOK_STATS,
+        //nothing at all (not even the clock read) without it
+        void count(uint64_t BookCounters::*counter, uint64_t amount = 1) {
+#if AGORA_BOOK_STATS
+            stats_.counters.*counter += amount;
+#else
+            (void)counter; (void)amount;
+#endif
+        }
+
+        static uint64_t statsClock() {
+#if AGORA_BOOK_STATS
+            return CycleClock::now();
+#else
+            return 0;
+#endif
+        }
+
+        void recordCycles(LatencyHistogram BookStats::*histogram, uint64_t start) {
+#if AGORA_BOOK_STATS
+            (stats_.*histogram).record(CycleClock::now() - start);
+#else
+            (void)histogram; (void)start;
+#endif
+        }
 
-        //Bids: sorts from HIGHEST price to LOWEST price (std::greater)
-        std::map<double, std::list<Order>, std::greater<double>> bids_;
+        void recordWalk(uint64_t levels) {
+#if AGORA_BOOK_STATS
+            ++stats_.counters.aggressiveOrders;
+            stats_.counters.levelsWalked += levels;
+            stats_.levelsWalkedPerOrder.record(levels);
+#else
+            (void)levels;
+#endif
+        }
 
-        // Maps a unique OrderID to an iterator pointing to that Order in its list.
-        std::unordered_map<uint64_t, std::list<Order>::iterator> orderMap_;
+        //Helper function to put an order at the back of its price level
+        void restOrder(PriceLadder<PriceLevel>& book, const Order& order);
 
-        //Helper function to handle matching logic
-        void matchOrders(Order orderToMatch, std::vector<Trade>& trades);
+        //Allocates a node for an order about to join 'level' (at 'tick' in 'ladder'). If that
+        //throws, a level created for the order is erased again before the exception goes on.
+        OrderHandle allocateFor(PriceLadder<PriceLevel>& ladder, const PriceLevel& level, const Order& order, Price tick);
+
+        //Add a resting node to, or take it off, its owner's list (no-ops for orders without an owner)
+        void linkOwner(OrderHandle handle) { linkOwner(ownerOrders_, handle); }
+        void unlinkOwner(OrderHandle handle) { unlinkOwner(ownerOrders_, handle); }
+
+        //Same, for the owner lists in 'lists' (ownerOrders_ or ownerStops_)
+        void linkOwner(OrderIndex<OwnerList>& lists, OrderHandle handle);
+        void unlinkOwner(OrderIndex<OwnerList>& lists, OrderHandle handle);
+
+        //Frees tombstones if the pool is full, then throws std::length_error if it still is
+        void reclaimOrThrow();
+
+        //Queues a stop at the back of its trigger level and indexes it
+        void queueStop(const Order& order, Price triggerPrice);
+
+        //Takes a pending stop off its ladder, index and owner list, and frees its node
+        void removeStop(OrderHandle handle, Price triggerPrice);
+
+        //Moves every stop 'tradePrice' reaches onto triggered_: buy stops from the lowest
+        //trigger up, then sell stops from the highest down, oldest first at each trigger
+        void popStops(Price tradePrice);
+
+        //Feeds the stops an order's last trade at 'tradePrice' reached back in as new orders,
+        //one at a time, including any that those orders' own trades reach
+        template <typename TradeSink>
+        void triggerStops(Price tradePrice, TradeSink& sink);
+
+        //Unlinks a tombstone from 'level' and its owner's list, drops its index entry and frees it
+        void reclaim(PriceLevel& level, OrderHandle handle);
+
+        //Reclaims every tombstone on 'level'
+        void compactLevel(PriceLevel& level);
+
+        //Takes a level without live orders off its ladder, freeing any tombstones left on it
+        void retireLevel(PriceLadder<PriceLevel>& book, Price price, PriceLevel& level) {
+            if (level.dead != 0)
+                compactLevel(level);
+            book.erase(price);
+            count(&BookCounters::levelsDestroyed);
+        }
+
+        //Takes a fully filled resting order off its level, index and owner list and frees its node
+        void removeFilled(PriceLevel& level, OrderHandle handle) {
+            unlinkOwner(handle);
+            orderMap_.erase(pool_[handle].orderId);
+            level.erase(pool_, handle);
+            pool_.release(handle);
+        }
+
+        //Oldest live order on a level, freeing any lazily cancelled ones ahead of it
+        OrderHandle liveHead(PriceLevel& level) {
+            OrderHandle handle = level.head;
+            while (pool_[handle].dead) {
+                reclaim(level, handle);
+                handle = level.head;
+            }
+            return handle;
+        }
+
+        //Fills 'curves' with both sides' totals over the ticks where the best bid and ask
+        //overlap. Returns false (and leaves 'curves' alone) if the book is not crossed.
+        bool buildAuctionCurves(AuctionCurves& curves) const;
+
+        //Everything that differs between a buy and a sell: which ladder the order rests in,
+        //which one it takes from, and how prices compare. Specialised below the class.
+        template <OrderSide Side>
+        struct SideTraits;
+
+        //True if an order on 'Side' at 'price' would trade against the opposite side now
+        template <OrderSide Side, OrderType Type = OrderType::Limit>
+        bool crosses(Price price) const;
+
+        //Runs a new order of a known type and side: crossing check, matching, then rest or cancel
+        template <OrderType Type, OrderSide Side, typename TradeSink>
+        uint32_t processSide(const Order& newOrder, TradeSink& sink);
+
+        //The matching kernel: one loop, compiled once per side and order type.
+        //Returns the quantity cancelled instead of filled or rested (0 for a Limit order).
+        //Self-trade decrements are not in it: they go to the sink (see reportSelfTrade).
+        template <OrderType Type, OrderSide Side, typename TradeSink>
+        uint32_t matchOrders(Order orderToMatch, TradeSink& sink);
+
+        //Where an order goes once it can no longer match: Limit and PostOnly orders rest,
+        //every other type has its remainder cancelled. Returns the quantity cancelled.
+        template <OrderType Type>
+        uint32_t restOrCancel(PriceLadder<PriceLevel>& book, const Order& order) {
+            if constexpr (Type == OrderType::Limit || Type == OrderType::PostOnly) {
+                restOrder(book, order);
+                count(&BookCounters::ordersRested);
+                return 0;
+            } else {
+                return cancelRemainder(order);
+            }
+        }
+
+        //Hands a self-trade prevention step to 'sink', if it takes one
+        template <typename TradeSink>
+        static void reportSelfTrade(TradeSink& sink, uint64_t orderId, OwnerId owner, uint32_t removed, uint32_t remaining, bool resting) {
+            if constexpr (std::is_invocable_v<TradeSink&, const SelfTradeAction&>)
+                sink(SelfTradeAction{orderId, owner, removed, remaining, resting});
+        }
+
+        uint32_t cancelRemainder(const Order& order) {
+            logEvent(BookEventType::OrderCancelled, order.orderId, 0, order.side, order.price, order.quantity);
+            count(&BookCounters::ordersCancelled);
+            return order.quantity;
+        }
+
+        //True if the opposite side holds at least order.quantity at prices the order accepts.
+        //Sums level totals, never walks the orders on a level, unless the order's owner has
+        //orders on that side: then it counts what self-trade prevention would let it fill.
+        template <OrderSide Side>
+        bool canFill(const Order& order) const;
 
     public:
-        //It will take a new order and process it against the book
+        //Order ID the book's indexes reserve for free slots; no order or stop may use it
+        static constexpr uint64_t kReservedOrderId = OrderIndex<OrderHandle>::kEmptyKey;
+
+        explicit OrderBook(const OrderBookConfig& config = OrderBookConfig{});
+
+        //It will take a new order and process it against the book.
+        //Every fill is handed to 'sink' as sink(const Trade&) the moment it happens, so
+        //nothing is allocated per order and the compiler can inline the sink. A sink that
+        //can also be called as sink(const SelfTradeAction&) is told of every self-trade
+        //prevention step, on the resting order or this one, in the same order.
+        //What happens to the part that does not fill depends on newOrder.type (see OrderType).
+        //Returns the quantity that was cancelled rather than filled or rested: the remainder of a
+        //market or IOC order, all of a killed FOK or a crossing post-only order, or the rest of
+        //an order stopped by CancelNewest. A DecrementBoth cut is not in it (only in the sink's
+        //SelfTradeAction). 0 for a limit order that did not meet CancelNewest.
+        //Throws std::invalid_argument if the order ID is kReservedOrderId, std::length_error if
+        //the order pool is full and configured not to grow, and std::out_of_range if a limit or
+        //post-only order's price fails acceptsPrice(); each before anything changes.
+        template <typename TradeSink>
+        uint32_t processOrder(const Order& newOrder, TradeSink&& sink);
+
+        //Same, with the order type fixed at compile time so there is no dispatch at all.
+        //newOrder.type is ignored.
+        template <OrderType Type, typename TradeSink>
+        uint32_t processOrderAs(const Order& newOrder, TradeSink&& sink);
+
+        //Same, appending the trades to a caller-owned buffer that can be reused across orders
+        uint32_t processOrder(const Order& newOrder, std::vector<Trade>& trades);
+
+        //Same, returning the trades in a fresh vector
         std::vector<Trade> processOrder(const Order& newOrder);
 
-        //It will cancel an order inside the orderbook
-        void cancelOrder(uint64_t orderId);
+        //It will cancel an order inside the orderbook.
+        //Returns false if the order is not resting (unknown, already filled or cancelled).
+        //With CancelMode::Lazy the order's node stays behind as a tombstone (see compact()).
+        bool cancelOrder(uint64_t orderId);
+
+        //Frees every tombstone left by lazy cancels and returns how many there were.
+        //Costs O(levels + orders); meant for quiet periods. The book also frees tombstones
+        //by itself as it goes, and all of them before refusing an order for a full pool.
+        std::size_t compact();
+
+        //Lazily cancelled orders not freed yet (always 0 with CancelMode::Eager)
+        std::size_t tombstones() const { return tombstones_; }
+
+        //Cancels every resting order of 'owner', e.g. when its session disconnects.
+        //Costs O(that owner's orders): it follows the owner's list, never scans the book.
+        //Returns how many orders were cancelled.
+        std::size_t cancelAllForOwner(OwnerId owner);
+
+        //Amends a resting order to 'newPrice' with 'newQuantity' left to fill.
+        // - Same price, same or lower quantity: done in place, the order keeps its queue position.
+        // - New price or higher quantity: the order moves to the back of its (new) level in one
+        //   step. If the new price crosses, it matches like a new order and fills go to 'sink';
+        //   a post-only order is cancelled instead, as it would be on arrival.
+        // - A quantity of 0 cancels the order.
+        //Returns false (and changes nothing) if the order is not resting.
+        //Throws std::out_of_range (changing nothing) if a new price fails acceptsPrice().
+        template <typename TradeSink>
+        bool modifyOrder(uint64_t orderId, Price newPrice, uint32_t newQuantity, TradeSink&& sink);
+
+        //Same, for amends that are not expected to cross; any fills are discarded
+        bool modifyOrder(uint64_t orderId, Price newPrice, uint32_t newQuantity);
+
+        //Holds 'order' as a stop until a trade prints at or through 'triggerPrice' (see
+        //StopOrder), then processes it like processOrder. Only trades after this call count.
+        //Stops wait apart from the book: they are not in getBids/getAsks, depth or findOrder,
+        //and cannot be amended, but cancelOrder and cancelAllForOwner remove them.
+        //Once an order has finished matching, the stops its last trade price reaches enter
+        //the book one by one, in popStops order; stops reached by their trades queue up
+        //behind them. Their fills go to the sink of the call that set them off.
+        //Throws std::invalid_argument if the order ID is kReservedOrderId, std::length_error if
+        //the order pool is full and configured not to grow, and std::out_of_range if the trigger
+        //or (for a stop-limit) the limit price is outside its ladder's window. A triggered stop-limit whose price no longer fits is cancelled.
+        void placeStop(const Order& order, Price triggerPrice);
+
+        //Stops placed and not yet triggered or cancelled
+        std::size_t pendingStops() const { return stopMap_.size(); }
+
+        //Starts a call auction. Until uncrossAuction, limit orders rest as they arrive even
+        //where they cross, and amends re-queue without matching. Orders of every other type
+        //(market, IOC, FOK, post-only) would only ever match on arrival, so they are
+        //cancelled in full. Does nothing if an auction is already running.
+        void startAuction() { phase_ = TradingPhase::Auction; }
+
+        TradingPhase phase() const { return phase_; }
+
+        //The price and volume an uncross would execute at right now (see AuctionCurves for
+        //the rules; 'referencePrice', typically the last trade, breaks the final tie).
+        //Costs O(ticks between the best ask and the best bid); the book is not changed.
+        AuctionResult indicativeAuction(Price referencePrice) const;
+
+        //Ends the auction: executes the equilibrium volume at the single equilibrium price,
+        //bids from the highest down against asks from the lowest up, oldest first within a
+        //level, handing each fill to 'sink'. The book is left uncrossed and back in
+        //continuous matching; stops reached by the auction price then go off like after
+        //any trade. Self-trade prevention is not applied to auction fills.
+        //The phase is part of a snapshot, so a book restored from one taken mid-auction
+        //resumes the auction. Journal both transitions (Journal::appendStartAuction and
+        //appendUncrossAuction) for recovery to replay them.
+        template <typename TradeSink>
+        AuctionResult uncrossAuction(Price referencePrice, TradeSink&& sink);
+
+        //Same, appending the trades to 'trades'
+        AuctionResult uncrossAuction(Price referencePrice, std::vector<Trade>& trades);
+
+        //Applies 'count' commands in order, with exactly the semantics of the individual calls
+        //(fills go to 'sink'; cancels/modifies of orders that are not resting do nothing).
+        //While it works through the batch it prefetches the index slot, node and level header
+        //of upcoming cancels and modifies, so their cache misses overlap earlier commands.
+        //With a DepthPublisher attached, one publish() after the batch emits a single
+        //coalesced delta for the whole batch. Emptied levels still leave the ladder at once:
+        //that is one bitmap bit, and deferring it would leave empty levels where matching,
+        //stop triggers and the best price would see them mid-batch.
+        //Throws like processOrder; commands before the failing one stay applied.
+        template <typename TradeSink>
+        void processBatch(const BookCommand* commands, std::size_t count, TradeSink&& sink);
+
+        //True if an order on 'side' could rest at 'price': the prices resting on that side, plus
+        //this one, span at most OrderBookConfig::maxLadderTicks. Costs one range check for a
+        //price near the ones already there.
+        bool acceptsPrice(OrderSide side, Price price) const {
+            return (side == OrderSide::BUY ? bids_ : asks_).fits(price);
+        }
+
+        //Returns the resting order with this ID (remaining quantity), or nullptr.
+        //The pointer is to a copy the book keeps for this call: the next findOrder overwrites it.
+        const Order* findOrder(uint64_t orderId) const;
+
+        //Returns the pending stop with this ID, or nullptr. Same rules as findOrder (its own copy).
+        const Order* findStop(uint64_t orderId) const;
+
+        //Copies the resting orders, in priority order, the pending stops, the trade ID
+        //sequence and the trading phase into 'snapshot'.
+        //Reuses the snapshot's buffer, so periodic snapshots do not allocate once it has grown.
+        void captureSnapshot(BookSnapshot& snapshot) const;
+
+        //Loads a snapshot into this book, preserving time priority (of stops too) and the phase.
+        //Throws std::logic_error unless the book is empty.
+        void restoreSnapshot(const BookSnapshot& snapshot);
+
+        //Attaches (or with nullptr, detaches) an event journal. The log must outlive the book
+        //or be detached first, and is written from the thread that drives this book.
+        void setEventLog(EventLog* eventLog) { eventLog_ = eventLog; }
+
+        //Attaches (or with nullptr, detaches) an incremental depth feed. Same rules as setEventLog.
+        void setDepthPublisher(DepthPublisher* publisher) { depthPublisher_ = publisher; }
+
+        //Attaches (or with nullptr, detaches) a risk gate, whose per-account counters the book
+        //then keeps current. Attach it to an empty book, or the orders already resting are
+        //not counted. Same rules as setEventLog. The book applies no risk limits itself: see RiskGate.
+        void setRiskGate(RiskGate* riskGate) { riskGate_ = riskGate; }
+        RiskGate* riskGate() const { return riskGate_; }
+
+        //Aggregates of the level at 'price' on 'side', in O(1). Returns false if there is no such level.
+        bool getLevel(OrderSide side, Price price, DepthLevel& out) const;
+
+        //Writes up to 'maxLevels' levels of 'side', best first, into 'out' and returns how many.
+        //Costs O(maxLevels): it reads level headers only, never the orders queued on them.
+        std::size_t getDepth(OrderSide side, std::size_t maxLevels, DepthLevel* out) const;
+
+        //Adds this book's instrumentation (see BookStats) into 'out', so several books can be
+        //summed into one. Leaves 'out' unchanged unless built with AGORA_BOOK_STATS.
+        //Like everything else here, call it from the thread that drives the book.
+        void collectStats(BookStats& out) const;
+
+        //Zeroes this book's instrumentation
+        void resetStats();
 
         //Getters and Setters
-        const std::map<double, std::list<Order>, std::greater<double>>& getBids() const { return bids_; }
-        const std::map<double, std::list<Order>>& getAsks() const { return asks_; }
-};
\ No newline at end of file
+        //Bids are viewed from HIGHEST price to LOWEST, asks from LOWEST to HIGHEST
+        BookSideView getBids() const { return {bids_, pool_, true}; }
+        BookSideView getAsks() const { return {asks_, pool_, false}; }
+};
+
+//Matching is templated on the trade sink, so its definitions live in the header
+
+template <typename TradeSink>
+uint32_t OrderBook::processOrder(const Order& newOrder, TradeSink&& sink) {
+    //Limit orders are tested first, so the common path costs one predictable compare.
+    //Every other type gets a matching loop compiled for it.
+    if (newOrder.type == OrderType::Limit)
+        return processOrderAs<OrderType::Limit>(newOrder, sink);
+    switch (newOrder.type) {
+        case OrderType::Market:
+            return processOrderAs<OrderType::Market>(newOrder, sink);
+        case OrderType::ImmediateOrCancel:
+            return processOrderAs<OrderType::ImmediateOrCancel>(newOrder, sink);
+        case OrderType::FillOrKill:
+            return processOrderAs<OrderType::FillOrKill>(newOrder, sink);
+        case OrderType::PostOnly:
+            return processOrderAs<OrderType::PostOnly>(newOrder, sink);
+        default:
+            return processOrderAs<OrderType::Limit>(newOrder, sink);
+    }
+}
+
+template <OrderType Type, typename TradeSink>
+uint32_t OrderBook::processOrderAs(const Order& newOrder, TradeSink&& sink) {
+    //Refuse the order up front, before any state changes, if it could not rest.
+    //Orders that never rest do not need a free node.
+    if (newOrder.orderId == kReservedOrderId)
+        throw std::invalid_argument("OrderBook: order ID is reserved");
+    if constexpr (Type == OrderType::Limit || Type == OrderType::PostOnly) {
+        if (!acceptsPrice(newOrder.side, newOrder.price))
+            throw std::out_of_range("OrderBook: price outside the ladder window");
+        if (pool_.exhausted())
+            reclaimOrThrow();
+    }
+
+    uint64_t start = statsClock();
+    count(&BookCounters::ordersReceived);
+    logEvent(BookEventType::OrderAccepted, newOrder.orderId, 0, newOrder.side, newOrder.price, newOrder.quantity);
+
+    //The only run-time side check: from here on each side runs its own specialised code
+    uint32_t cancelled = newOrder.side == OrderSide::BUY
+        ? processSide<Type, OrderSide::BUY>(newOrder, sink)
+        : processSide<Type, OrderSide::SELL>(newOrder, sink);
+    recordCycles(&BookStats::processOrderCycles, start);
+    return cancelled;
+}
+
+//A buy rests in the bids and takes from the asks, best (LOWEST) ask first
+template <>
+struct OrderBook::SideTraits<OrderSide::BUY> {
+    template <typename Book>
+    static auto& book(Book& orderBook) { return orderBook.bids_; }
+    template <typename Book>
+    static auto& opposite(Book& orderBook) { return orderBook.asks_; }
+
+    static int64_t best(const PriceLadder<PriceLevel>& opposite) { return opposite.lowest(); }
+    //Next opposite level, moving away from the touch
+    static bool next(const PriceLadder<PriceLevel>& opposite, int64_t& tick) { return opposite.next(tick, tick); }
+
+    //True if a buy at 'price' reaches an ask at 'level'
+    static bool reaches(Price price, Price level) { return price >= level; }
+
+    static Trade trade(uint64_t tradeId, const Order& incoming, const OrderNode& resting, uint32_t quantity) {
+        return Trade(tradeId, incoming.orderId, resting.orderId, resting.price, quantity);
+    }
+};
+
+//A sell rests in the asks and takes from the bids, best (HIGHEST) bid first
+template <>
+struct OrderBook::SideTraits<OrderSide::SELL> {
+    template <typename Book>
+    static auto& book(Book& orderBook) { return orderBook.asks_; }
+    template <typename Book>
+    static auto& opposite(Book& orderBook) { return orderBook.bids_; }
+
+    static int64_t best(const PriceLadder<PriceLevel>& opposite) { return opposite.highest(); }
+    static bool next(const PriceLadder<PriceLevel>& opposite, int64_t& tick) { return opposite.prev(tick, tick); }
+
+    //True if a sell at 'price' reaches a bid at 'level'
+    static bool reaches(Price price, Price level) { return price <= level; }
+
+    static Trade trade(uint64_t tradeId, const Order& incoming, const OrderNode& resting, uint32_t quantity) {
+        return Trade(tradeId, resting.orderId, incoming.orderId, resting.price, quantity);
+    }
+};
+
+template <OrderSide Side, OrderType Type>
+bool OrderBook::crosses(Price price) const {
+    using Traits = SideTraits<Side>;
+    const auto& opposite = Traits::opposite(*this);
+    //A market order crosses whenever anyone is on the other side
+    return !opposite.empty() && (Type == OrderType::Market || Traits::reaches(price, Traits::best(opposite)));
+}
+
+template <OrderSide Side>
+bool OrderBook::canFill(const Order& order) const {
+    using Traits = SideTraits<Side>;
+    const auto& opposite = Traits::opposite(*this);
+    if (opposite.empty())
+        return false;
+
+    //Only an owner with orders on the opposite side can meet itself there (lazily cancelled
+    //ones still count until they are freed, which only costs a walk)
+    constexpr auto kOppositeSide = static_cast<std::size_t>(Side == OrderSide::BUY ? OrderSide::SELL : OrderSide::BUY);
+    const OwnerList* own = order.owner == kNoOwner ? nullptr : ownerOrders_.find(order.owner);
+    bool selfTrades = own != nullptr && own->linked[kOppositeSide] != 0;
+
+    //Walk the opposite side from the touch up to the order's limit
+    uint64_t available = 0;
+    int64_t tick = Traits::best(opposite);
+    do {
+        if (!Traits::reaches(order.price, tick))
+            return false;
+        const PriceLevel& level = *opposite.find(tick);
+        if (!selfTrades) {
+            available += level.totalQuantity;
+        } else {
+            //Its own orders are cancelled out of the way (CancelOldest) or stop it filling
+            for (OrderHandle handle = level.head; handle != kNullOrder; handle = pool_[handle].next) {
+                if (pool_[handle].dead)
+                    continue;
+                if (pool_.owner(handle) != order.owner)
+                    available += pool_[handle].quantity;
+                else if (order.selfTrade != SelfTradePrevention::CancelOldest)
+                    return false;
+                if (available >= order.quantity)
+                    return true;
+            }
+        }
+        if (available >= order.quantity)
+            return true;
+    } while (Traits::next(opposite, tick));
+    return false;
+}
+
+template <OrderType Type, OrderSide Side, typename TradeSink>
+uint32_t OrderBook::processSide(const Order& newOrder, TradeSink& sink) {
+    //Call auction: nothing matches before the uncross, so only limit orders have a use
+    if (phase_ == TradingPhase::Auction) {
+        if constexpr (Type == OrderType::Limit)
+            return restOrCancel<Type>(SideTraits<Side>::book(*this), newOrder);
+        else
+            return cancelRemainder(newOrder);
+    }
+
+    //Fill-or-kill: check the level totals first, so a killed order never trades
+    if constexpr (Type == OrderType::FillOrKill) {
+        if (!canFill<Side>(newOrder))
+            return cancelRemainder(newOrder);
+    }
+
+    /*
+    Check: if there is nobody on the other side
+    or a trade is NOT possible (a buy below the lowest ask, a sell above the highest bid)
+    then rest it in its own book (or cancel it, for types that never rest)
+    */
+    if (!crosses<Side, Type>(newOrder.price))
+        return restOrCancel<Type>(SideTraits<Side>::book(*this), newOrder);
+
+    //Otherwise, a trade is possible! Unless the order is only allowed to add liquidity.
+    if constexpr (Type == OrderType::PostOnly)
+        return cancelRemainder(newOrder);
+    else
+        return matchOrders<Type, Side>(newOrder, sink);
+}
+
+template <typename TradeSink>
+void OrderBook::processBatch(const BookCommand* commands, std::size_t count, TradeSink&& sink) {
+    //How far ahead each prefetch stage runs. Each stage needs the previous one's line,
+    //so they are spaced to give every miss a few commands' worth of time to land.
+    constexpr std::size_t kIndexAhead = 12;
+    constexpr std::size_t kNodeAhead = 8;
+    constexpr std::size_t kLevelAhead = 4;
+
+    auto targetsResting = [](const BookCommand& command) {
+        return command.type == BookCommand::Type::Cancel || command.type == BookCommand::Type::Modify;
+    };
+
+    //Handles found by stage 2, kept for stage 3 a few commands later instead of looking the
+    //order up again. One may be stale by then (its order cancelled in between); that only
+    //costs a wasted prefetch, as a handle always names some node.
+    OrderHandle handles[kNodeAhead];
+    auto fetchNode = [&](std::size_t at) {
+        handles[at % kNodeAhead] = kNullOrder;
+        if (targetsResting(commands[at])) {
+            if (const OrderHandle* found = orderMap_.find(commands[at].order.orderId)) {
+                pool_.prefetch(*found);
+                handles[at % kNodeAhead] = *found;
+            }
+        }
+    };
+    for (std::size_t at = kLevelAhead; at < kNodeAhead && at < count; ++at)
+        fetchNode(at);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        //Stage 1: the index slot of a cancel/modify further down the batch
+        if (i + kIndexAhead < count && targetsResting(commands[i + kIndexAhead]))
+            orderMap_.prefetch(commands[i + kIndexAhead].order.orderId);
+
+        //Stage 2: its slot should be cached by now, so look the handle up and fetch the node
+        if (i + kNodeAhead < count)
+            fetchNode(i + kNodeAhead);
+
+        //Stage 3: the node gives the price, so fetch the level header the command will update
+        if (i + kLevelAhead < count) {
+            OrderHandle handle = handles[(i + kLevelAhead) % kNodeAhead];
+            if (handle != kNullOrder) {
+                const OrderNode& node = pool_[handle];
+                (node.side == OrderSide::BUY ? bids_ : asks_).prefetch(node.price);
+            }
+        }
+
+        const BookCommand& command = commands[i];
+        switch (command.type) {
+            case BookCommand::Type::NewOrder:
+                processOrder(command.order, sink);
+                break;
+            case BookCommand::Type::Cancel:
+                cancelOrder(command.order.orderId);
+                break;
+            case BookCommand::Type::Modify:
+                modifyOrder(command.order.orderId, command.order.price, command.order.quantity, sink);
+                break;
+            case BookCommand::Type::NewStop:
+                placeStop(command.order, command.triggerPrice);
+                break;
+        }
+    }
+}
+
+template <typename TradeSink>
+bool OrderBook::modifyOrder(uint64_t orderId, Price newPrice, uint32_t newQuantity, TradeSink&& sink) {
+    const OrderHandle* found = orderMap_.find(orderId);
+    if (found == nullptr || pool_[*found].dead) {
+        count(&BookCounters::modifyMisses);
+        return false;
+    }
+    if (newQuantity == 0)
+        return cancelOrder(orderId);
+    const OrderNode& current = pool_[*found];
+    if (newPrice != current.price && !acceptsPrice(current.side, newPrice))
+        throw std::out_of_range("OrderBook: price outside the ladder window");
+
+    uint64_t start = statsClock();
+    count(&BookCounters::modifyHits);
+
+    OrderHandle handle = *found;
+    OrderNode& order = pool_[handle];
+    PriceLadder<PriceLevel>& book = order.side == OrderSide::BUY ? bids_ : asks_;
+    PriceLevel& level = *book.find(order.price);
+    noteLevel(order.side, order.price, &level);
+    logEvent(BookEventType::OrderModified, orderId, 0, order.side, newPrice, newQuantity);
+
+    //A pure reduction keeps time priority: adjust the order and its level's total in place
+    if (newPrice == order.price && newQuantity <= order.quantity) {
+        noteExposure(handle, -static_cast<int64_t>(order.quantity - newQuantity));
+        level.totalQuantity -= order.quantity - newQuantity;
+        order.quantity = newQuantity;
+        recordCycles(&BookStats::modifyOrderCycles, start);
+        return true;
+    }
+
+    //Otherwise it loses priority. Unlink it from its level, keeping the node and its index entry.
+    level.erase(pool_, handle);
+    if (level.empty())
+        retireLevel(book, order.price, level);
+    noteExposure(handle, -static_cast<int64_t>(order.quantity));
+    order.price = newPrice;
+    order.quantity = newQuantity;
+
+    bool crossing = phase_ == TradingPhase::Continuous
+        && (order.side == OrderSide::BUY ? crosses<OrderSide::BUY>(newPrice) : crosses<OrderSide::SELL>(newPrice));
+    if (!crossing) {
+        //Re-queue the same node at the back of the new level: no allocation, no index update
+        if (depthPublisher_ != nullptr)
+            noteLevel(order.side, newPrice, book.find(newPrice));
+        PriceLevel& newLevel = book[newPrice];
+        newLevel.pushBack(pool_, handle);
+        noteExposure(handle, newQuantity);
+        count(&BookCounters::ordersRested);
+        count(&BookCounters::levelsCreated, newLevel.count == 1);
+        recordCycles(&BookStats::modifyOrderCycles, start);
+        return true;
+    }
+
+    //It crosses: give the node back and match it like a new order (any remainder rests).
+    //A post-only order never takes liquidity, so it is cancelled like a crossing new one.
+    Order amended = pool_.order(handle);
+    unlinkOwner(handle);
+    orderMap_.erase(orderId);
+    pool_.release(handle);
+    if (amended.type == OrderType::PostOnly)
+        cancelRemainder(amended);
+    else if (amended.side == OrderSide::BUY)
+        matchOrders<OrderType::Limit, OrderSide::BUY>(amended, sink);
+    else
+        matchOrders<OrderType::Limit, OrderSide::SELL>(amended, sink);
+    recordCycles(&BookStats::modifyOrderCycles, start);
+    return true;
+}
+
+template <OrderType Type, OrderSide Side, typename TradeSink>
+uint32_t OrderBook::matchOrders(Order orderToMatch, TradeSink& sink) {
+    //Logic for fulfilling orders
+    using Traits = SideTraits<Side>;
+    constexpr OrderSide kOppositeSide = Side == OrderSide::BUY ? OrderSide::SELL : OrderSide::BUY;
+    auto& opposite = Traits::opposite(*this);
+
+    //Distinct opposite levels traded against (only read by the instrumentation)
+    uint64_t levelsWalked = 0;
+    Price walkedPrice = 0;
+
+    //Whether self-trade prevention cancelled the rest of this order
+    bool cancelNewest = false;
+
+    //Whether this order traded, and its last trade price (for the stops)
+    uint64_t firstTradeId = nextTradeId_;
+    Price lastTradePrice = 0;
+
+    /*
+    Continue to complete orders until the current order no longer has quantity nor
+    its price reaches the best price on the other side
+    */
+    while (orderToMatch.quantity > 0 && crosses<Side, Type>(orderToMatch.price)) {
+        //Grab all the orders at the best level of the opposite book (SAME price)
+        Price bestPrice = Traits::best(opposite);
+        auto& bestLevel = *opposite.find(bestPrice);
+        noteLevel(kOppositeSide, bestPrice, &bestLevel);
+        if (levelsWalked == 0 || bestPrice != walkedPrice) {
+            ++levelsWalked;
+            walkedPrice = bestPrice;
+        }
+
+        //Get the oldest order from that level, freeing any lazily cancelled ones ahead of it
+        OrderHandle oldestHandle = bestLevel.head;
+        while (pool_[oldestHandle].dead) {
+            reclaim(bestLevel, oldestHandle);
+            oldestHandle = bestLevel.head;
+        }
+        OrderNode& oldest = pool_[oldestHandle];
+
+        //Find the lowest trade quantity between both orders
+        uint32_t tradeQuantity = std::min(orderToMatch.quantity, oldest.quantity);
+
+        //The owner sits beside the slab: only read for an incoming order that has one
+        if (orderToMatch.owner != kNoOwner && pool_.owner(oldestHandle) == orderToMatch.owner) {
+            //Self-trade prevention: the two never trade, the incoming order's mode decides who gives way
+            count(&BookCounters::selfTradesPrevented);
+            if (orderToMatch.selfTrade == SelfTradePrevention::CancelNewest) {
+                logEvent(BookEventType::SelfTradePrevented, orderToMatch.orderId, oldest.orderId, orderToMatch.side, oldest.price, orderToMatch.quantity);
+                cancelNewest = true;
+                break;
+            }
+            bool decrement = orderToMatch.selfTrade == SelfTradePrevention::DecrementBoth;
+            uint32_t removed = decrement ? tradeQuantity : oldest.quantity;
+            logEvent(BookEventType::SelfTradePrevented, orderToMatch.orderId, oldest.orderId, orderToMatch.side, oldest.price, removed);
+            noteExposure(oldestHandle, -static_cast<int64_t>(removed));
+            oldest.quantity -= removed;
+            bestLevel.totalQuantity -= removed;
+            reportSelfTrade(sink, oldest.orderId, orderToMatch.owner, removed, oldest.quantity, true);
+            if (decrement) {
+                orderToMatch.quantity -= tradeQuantity;
+                reportSelfTrade(sink, orderToMatch.orderId, orderToMatch.owner, tradeQuantity, orderToMatch.quantity, false);
+            }
+        } else {
+            sink(Traits::trade(nextTradeId_++, orderToMatch, oldest, tradeQuantity));
+            logEvent(BookEventType::Trade, orderToMatch.orderId, oldest.orderId, orderToMatch.side, oldest.price, tradeQuantity);
+            count(&BookCounters::fills);
+            count(&BookCounters::filledQuantity, tradeQuantity);
+
+            //Subtract the quantity for both orders (and the level's running total)
+            noteExposure(oldestHandle, -static_cast<int64_t>(tradeQuantity));
+            orderToMatch.quantity -= tradeQuantity;
+            oldest.quantity -= tradeQuantity;
+            bestLevel.totalQuantity -= tradeQuantity;
+            lastTradePrice = bestPrice;
+        }
+
+        //If the oldest order's quantity is zero, remove it from the book and map
+        if (oldest.quantity == 0) {
+            unlinkOwner(oldestHandle);
+            orderMap_.erase(oldest.orderId);
+            bestLevel.erase(pool_, oldestHandle);
+            pool_.release(oldestHandle);
+        }
+
+        //If the level is empty, remove the level as well
+        if (bestLevel.empty())
+            retireLevel(opposite, bestPrice, bestLevel);
+    }
+    recordWalk(levelsWalked);
+    if (nextTradeId_ != firstTradeId)
+        noteTrade(lastTradePrice);
+
+    //If the orderToMatch hasn't been fulfilled, rest it in the book and map (or cancel the rest)
+    uint32_t cancelled = 0;
+    if (cancelNewest)
+        cancelled = cancelRemainder(orderToMatch);
+    else if (orderToMatch.quantity > 0)
+        cancelled = restOrCancel<Type>(Traits::book(*this), orderToMatch);
+
+    //Stops go off once the order is done. Two compares unless a trigger was reached.
+    if (nextTradeId_ != firstTradeId && (lastTradePrice >= buyStopFloor_ || lastTradePrice <= sellStopCeiling_))
+        triggerStops(lastTradePrice, sink);
+    return cancelled;
+}
+
+template <typename TradeSink>
+void OrderBook::triggerStops(Price tradePrice, TradeSink& sink) {
+    //A triggered order traded through more triggers: the loop below takes them next
+    if (firingStops_) {
+        stopsReached_ = true;
+        stopTradePrice_ = tradePrice;
+        return;
+    }
+
+    //A queue rather than recursion, so a long cascade cannot run out of stack
+    firingStops_ = true;
+    triggered_.clear();
+    popStops(tradePrice);
+    for (std::size_t i = 0; i < triggered_.size(); ++i) {
+        OrderHandle handle = triggered_[i];
+        Order order = pool_.order(handle);
+        unlinkOwner(ownerStops_, handle);
+        stopMap_.erase(order.orderId);
+        pool_.release(handle);
+        logEvent(BookEventType::StopTriggered, order.orderId, 0, order.side, order.price, order.quantity);
+        count(&BookCounters::stopsTriggered);
+
+        stopsReached_ = false;
+        //The book may have moved away from a stop-limit's price since it was placed
+        bool rests = order.type == OrderType::Limit || order.type == OrderType::PostOnly;
+        if (rests && !acceptsPrice(order.side, order.price))
+            cancelRemainder(order);
+        else
+            processOrder(order, sink);
+        if (stopsReached_)
+            popStops(stopTradePrice_);
+    }
+    triggered_.clear();
+    firingStops_ = false;
+}
+
+template <typename TradeSink>
+AuctionResult OrderBook::uncrossAuction(Price referencePrice, TradeSink&& sink) {
+    AuctionCurves curves;
+    AuctionResult result;
+    if (buildAuctionCurves(curves))
+        result = curves.equilibrium(referencePrice);
+    phase_ = TradingPhase::Continuous;
+
+    //Demand and supply at the price both cover the volume, so the best bid stays at or
+    //above it and the best ask at or below it until the volume is done
+    uint64_t remaining = result.volume;
+    while (remaining > 0) {
+        Price bidPrice = bids_.highest();
+        Price askPrice = asks_.lowest();
+        PriceLevel& bidLevel = *bids_.find(bidPrice);
+        PriceLevel& askLevel = *asks_.find(askPrice);
+        noteLevel(OrderSide::BUY, bidPrice, &bidLevel);
+        noteLevel(OrderSide::SELL, askPrice, &askLevel);
+
+        OrderHandle buyHandle = liveHead(bidLevel);
+        OrderHandle sellHandle = liveHead(askLevel);
+        OrderNode& buy = pool_[buyHandle];
+        OrderNode& sell = pool_[sellHandle];
+        uint32_t quantity = static_cast<uint32_t>(std::min<uint64_t>(remaining, std::min(buy.quantity, sell.quantity)));
+
+        sink(Trade(nextTradeId_++, buy.orderId, sell.orderId, result.price, quantity));
+        logEvent(BookEventType::Trade, buy.orderId, sell.orderId, OrderSide::BUY, result.price, quantity);
+        count(&BookCounters::fills);
+        count(&BookCounters::filledQuantity, quantity);
+        ++result.trades;
+
+        noteExposure(buyHandle, -static_cast<int64_t>(quantity));
+        noteExposure(sellHandle, -static_cast<int64_t>(quantity));
+        buy.quantity -= quantity;
+        sell.quantity -= quantity;
+        bidLevel.totalQuantity -= quantity;
+        askLevel.totalQuantity -= quantity;
+        remaining -= quantity;
+
+        if (buy.quantity == 0)
+            removeFilled(bidLevel, buyHandle);
+        if (bidLevel.empty())
+            retireLevel(bids_, bidPrice, bidLevel);
+        if (sell.quantity == 0)
+            removeFilled(askLevel, sellHandle);
+        if (askLevel.empty())
+            retireLevel(asks_, askPrice, askLevel);
+    }
+
+    if (result.trades > 0)
+        noteTrade(result.price);
+    if (result.trades > 0 && (result.price >= buyStopFloor_ || result.price <= sellStopCeiling_))
+        triggerStops(result.price, sink);
+    return result;
+}
+
+template <typename Fn>
+std::size_t DepthPublisher::publish(const OrderBook& book, Fn&& fn) {
+    std::size_t emitted = 0;
+    for (const Touched& touched : dirty_) {
+        DepthLevel now;
+        bool exists = book.getLevel(touched.side, touched.price, now);
+        DepthUpdate update{DepthUpdate::Action::Update, touched.side, touched.price, 0, 0};
+        if (exists) {
+            //A level can be touched and end up as it started (e.g. an order rested and was cancelled)
+            if (touched.existed && now.quantity == touched.quantity && now.orderCount == touched.orderCount)
+                continue;
+            update.action = touched.existed ? DepthUpdate::Action::Update : DepthUpdate::Action::Add;
+            update.quantity = now.quantity;
+            update.orderCount = now.orderCount;
+        } else {
+            //Created and emptied within the same round: nobody ever saw it
+            if (!touched.existed)
+                continue;
+            update.action = DepthUpdate::Action::Delete;
+        }
+        fn(update);
+        ++emitted;
+    }
+    for (const Touched& touched : dirty_)
+        dirtyIndex_.erase(levelKey(touched.side, touched.price));
+    dirty_.clear();
+    return emitted;
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "OrderBook.h"
+#include "Protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+/*
+Drives one OrderBook from a binary order-entry stream (see Protocol.h).
+
+Inbound bytes are decoded in place and applied straight to the book; acks and
+trade reports are written into a caller-owned output buffer. When the buffer
+fills, 'flush(const uint8_t* data, std::size_t size)' is called to send it and
+the buffer is reused, so a session allocates nothing per message.
+
+A Replace is applied with OrderBook::modifyOrder, so a quantity reduction at the
+same price keeps the order's queue position.
+
+Orders are stamped with the session's owner ID, so self-trade prevention applies
+between them and disconnect() can pull all of them at once. When it takes quantity off
+one of them, resting or incoming, that order gets a Reduced ack with what it has left,
+or a Cancelled ack if nothing is left. A Cancel or Replace only
+reaches orders this session owns: any other ID is an UnknownOrder. A NewOrder whose ID
+is still resting or pending as a stop, whoever owns it, is a DuplicateOrder. Any message
+carrying OrderBook::kReservedOrderId is an InvalidOrderId and never reaches the book.
+
+If the book has a RiskGate attached, new orders and replaces are checked against
+it first and refused with the matching RejectReason, before they reach the book.
+A price the book's ladder cannot take (OrderBook::acceptsPrice) is refused with
+PriceOutOfRange the same way.
+*/
+template <typename Flush>
+class OrderEntrySession {
+    public:
+        OrderEntrySession(OrderBook& book, InstrumentId instrument, uint8_t* outBuffer, std::size_t outCapacity, Flush flush,
+            OwnerId owner = kNoOwner)
+            : book_{book}, instrument_{instrument}, owner_{owner}, writer_{outBuffer, outCapacity}, flush_{std::move(flush)} {
+            if (outCapacity < protocol::kMaxMessageSize)
+                throw std::length_error("OrderEntrySession: output buffer smaller than one message");
+        }
+
+        //Applies every whole message in [data, data + size) to the book. Returns the bytes
+        //consumed; a trailing partial message is left for the caller to resubmit with more data.
+        //Throws protocol::ProtocolError on a malformed stream.
+        std::size_t onData(const uint8_t* data, std::size_t size) {
+            return protocol::decodeOrderEntry(data, size, *this);
+        }
+
+        //Answers one whole order-entry message, as onData() takes it, with a reject. For a
+        //caller that caught an exception onData() let through for that message.
+        void rejectMessage(const uint8_t* message, protocol::RejectReason reason) {
+            //Every order-entry message has the order ID at the same offset
+            static_assert(offsetof(protocol::NewOrderMessage, orderId) == offsetof(protocol::CancelMessage, orderId)
+                && offsetof(protocol::ReplaceMessage, orderId) == offsetof(protocol::CancelMessage, orderId));
+            uint64_t orderId;
+            std::memcpy(&orderId, message + offsetof(protocol::CancelMessage, orderId), sizeof(orderId));
+            reject(orderId, reason);
+        }
+
+        //Sends whatever is buffered
+        void flush() {
+            if (writer_.size() > 0) {
+                flush_(writer_.data(), writer_.size());
+                writer_.clear();
+            }
+        }
+
+        //Cancels every order this session has resting (cancel-on-disconnect). Sends no acks:
+        //the client is gone. Returns how many orders were cancelled; 0 without an owner ID.
+        std::size_t disconnect() { return book_.cancelAllForOwner(owner_); }
+
+        //Decoder callbacks
+        void onNewOrder(const protocol::NewOrderMessage& message) {
+            if (!accept(message.instrument, message.orderId, message.quantity))
+                return;
+            if (book_.findOrder(message.orderId) != nullptr || book_.findStop(message.orderId) != nullptr) {
+                reject(message.orderId, protocol::RejectReason::DuplicateOrder);
+                return;
+            }
+            Order order = protocol::toOrder(message, owner_);
+            bool rests = order.type == OrderType::Limit || order.type == OrderType::PostOnly;
+            if (rests && !book_.acceptsPrice(order.side, order.price)) {
+                reject(order.orderId, protocol::RejectReason::PriceOutOfRange);
+                return;
+            }
+            if (const RiskGate* risk = book_.riskGate()) {
+                if (RiskCheck check = risk->check(order); check != RiskCheck::Passed) {
+                    reject(order.orderId, rejectReason(check));
+                    return;
+                }
+            }
+            submit(order, protocol::AckStatus::Accepted);
+        }
+
+        void onCancel(const protocol::CancelMessage& message) {
+            if (message.instrument != instrument_) {
+                reject(message.orderId, protocol::RejectReason::UnknownInstrument);
+                return;
+            }
+            if (message.orderId == OrderBook::kReservedOrderId) {
+                reject(message.orderId, protocol::RejectReason::InvalidOrderId);
+                return;
+            }
+            const Order* order = book_.findOrder(message.orderId);
+            if (order == nullptr)
+                order = book_.findStop(message.orderId);
+            if (order == nullptr || order->owner != owner_) {
+                reject(message.orderId, protocol::RejectReason::UnknownOrder);
+                return;
+            }
+            book_.cancelOrder(message.orderId);
+            ack(message.orderId, protocol::AckStatus::Cancelled);
+        }
+
+        void onReplace(const protocol::ReplaceMessage& message) {
+            if (!accept(message.instrument, message.orderId, message.quantity))
+                return;
+            const Order* resting = book_.findOrder(message.orderId);
+            if (resting == nullptr || resting->owner != owner_) {
+                reject(message.orderId, protocol::RejectReason::UnknownOrder);
+                return;
+            }
+            if (message.price != resting->price && !book_.acceptsPrice(resting->side, message.price)) {
+                reject(message.orderId, protocol::RejectReason::PriceOutOfRange);
+                return;
+            }
+            if (const RiskGate* risk = book_.riskGate()) {
+                if (RiskCheck check = risk->checkModify(*resting, message.price, message.quantity); check != RiskCheck::Passed) {
+                    reject(message.orderId, rejectReason(check));
+                    return;
+                }
+            }
+            //Acked lazily, like submit(): ahead of the first fill, or once the book has applied
+            //the amend, so an amend the book throws on gets only the caller's reject.
+            //A post-only order amended to cross is cancelled instead.
+            bool postOnly = resting->type == OrderType::PostOnly;
+            Reports reports{*this, message.orderId, protocol::AckStatus::Replaced};
+            book_.modifyOrder(message.orderId, message.price, message.quantity, reports);
+            reports.ackOnce();
+            if (postOnly && book_.findOrder(message.orderId) == nullptr)
+                ack(message.orderId, protocol::AckStatus::Cancelled);
+        }
+
+    private:
+        //The book's sink for one order: acks the order once, ahead of its first fill or
+        //self-trade step, then reports each of them
+        struct Reports {
+            OrderEntrySession& session;
+            uint64_t orderId;
+            protocol::AckStatus status;
+            bool acked = false;
+
+            void ackOnce() {
+                if (!acked) {
+                    session.ack(orderId, status);
+                    acked = true;
+                }
+            }
+
+            void operator()(const Trade& trade) {
+                ackOnce();
+                session.report(trade);
+            }
+
+            void operator()(const SelfTradeAction& action) {
+                ackOnce();
+                //A triggered stop of another owner may meet its own orders too: not ours to ack
+                if (action.owner != session.owner_)
+                    return;
+                if (action.remaining == 0)
+                    session.ack(action.orderId, protocol::AckStatus::Cancelled);
+                else
+                    session.ack(action.orderId, protocol::AckStatus::Reduced, protocol::RejectReason::None, action.remaining);
+            }
+        };
+
+        //Common checks for messages that carry a quantity
+        bool accept(InstrumentId instrument, uint64_t orderId, uint32_t quantity) {
+            if (instrument != instrument_) {
+                reject(orderId, protocol::RejectReason::UnknownInstrument);
+                return false;
+            }
+            if (orderId == OrderBook::kReservedOrderId) {
+                reject(orderId, protocol::RejectReason::InvalidOrderId);
+                return false;
+            }
+            if (quantity == 0) {
+                reject(orderId, protocol::RejectReason::InvalidQuantity);
+                return false;
+            }
+            return true;
+        }
+
+        //Acks first, then reports the fills, so a client always sees its order before its trades.
+        //The ack is written lazily so a refused order never gets one. An order whose remainder
+        //was cancelled (IOC, market, killed FOK, crossing post-only) gets a Cancelled ack last.
+        void submit(const Order& order, protocol::AckStatus status) {
+            Reports reports{*this, order.orderId, status};
+            uint32_t cancelled = 0;
+            try {
+                cancelled = book_.processOrder(order, reports);
+            } catch (const std::length_error&) {
+                //A full, non-growing pool is an ordinary reject, not a session error
+                reject(order.orderId, protocol::RejectReason::BookFull);
+                return;
+            }
+            reports.ackOnce();
+            if (cancelled > 0)
+                ack(order.orderId, protocol::AckStatus::Cancelled);
+        }
+
+        void report(const Trade& trade) {
+            if (!writer_.writeTrade(instrument_, trade)) {
+                flush();
+                writer_.writeTrade(instrument_, trade);
+            }
+        }
+
+        void ack(uint64_t orderId, protocol::AckStatus status, protocol::RejectReason reason = protocol::RejectReason::None,
+            uint32_t quantity = 0) {
+            if (!writer_.writeAck(instrument_, orderId, status, reason, quantity)) {
+                flush();
+                writer_.writeAck(instrument_, orderId, status, reason, quantity);
+            }
+        }
+
+        void reject(uint64_t orderId, protocol::RejectReason reason) {
+            ack(orderId, protocol::AckStatus::Rejected, reason);
+        }
+
+        static protocol::RejectReason rejectReason(RiskCheck check) {
+            switch (check) {
+                case RiskCheck::OrderQuantity:
+                    return protocol::RejectReason::OrderQuantityLimit;
+                case RiskCheck::PriceBand:
+                    return protocol::RejectReason::PriceBand;
+                case RiskCheck::OpenQuantity:
+                    return protocol::RejectReason::OpenQuantityLimit;
+                case RiskCheck::OpenNotional:
+                    return protocol::RejectReason::OpenNotionalLimit;
+                default:
+                    return protocol::RejectReason::None;
+            }
+        }
+
+        OrderBook& book_;
+        InstrumentId instrument_;
+        OwnerId owner_;
+        protocol::MessageWriter writer_;
+        Flush flush_;
+};
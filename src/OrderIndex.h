@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+Flat, open-addressing hash index from order ID to a small value (an OrderHandle in the book).
+
+ - Slots live in one contiguous array, so a lookup is usually a single cache miss.
+ - Fibonacci hashing spreads the mostly-monotonic IDs exchanges hand out evenly.
+ - Linear probing with backward-shift deletion: erase moves later entries of the
+   probe run back instead of leaving tombstones, so cancel-heavy flow never
+   degrades lookups and never needs a rehash to clean up.
+ - reserve() presizes the table so a book that stays within its capacity never
+   reallocates.
+
+Order ID kEmptyKey (UINT64_MAX) is reserved to mark free slots. It is never stored:
+find() and erase() report it as absent and insert() ignores it.
+*/
+template <typename Value>
+class OrderIndex {
+    public:
+        static constexpr uint64_t kEmptyKey = UINT64_MAX;
+
+        explicit OrderIndex(std::size_t expected = 0) { reserve(expected); }
+
+        std::size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        std::size_t capacity() const { return slots_.size(); }
+
+        //Makes room for 'count' entries without exceeding the maximum load factor
+        void reserve(std::size_t count) {
+            std::size_t wanted = 16;
+            while (wanted * kMaxLoadNum < count * kMaxLoadDen)
+                wanted <<= 1;
+            if (wanted > slots_.size())
+                rehash(wanted);
+        }
+
+        //Returns a pointer to the value stored for 'key', or nullptr
+        Value* find(uint64_t key) {
+            //The reserved key would match the first free slot in its probe run
+            if (key == kEmptyKey)
+                return nullptr;
+            for (std::size_t i = home(key);; i = (i + 1) & mask_) {
+                Slot& slot = slots_[i];
+                if (slot.key == key)
+                    return &slot.value;
+                if (slot.key == kEmptyKey)
+                    return nullptr;
+            }
+        }
+        const Value* find(uint64_t key) const { return const_cast<OrderIndex*>(this)->find(key); }
+
+        bool contains(uint64_t key) const { return find(key) != nullptr; }
+
+        //Starts loading the slot 'key' hashes to, for a find() a little later
+        void prefetch(uint64_t key) const { __builtin_prefetch(&slots_[home(key)]); }
+
+        //Inserts 'key' or overwrites its value. Returns true if the key was new
+        //(false, storing nothing, for kEmptyKey).
+        bool insert(uint64_t key, const Value& value) {
+            if (key == kEmptyKey)
+                return false;
+            if ((size_ + 1) * kMaxLoadDen > slots_.size() * kMaxLoadNum)
+                rehash(slots_.size() * 2);
+            for (std::size_t i = home(key);; i = (i + 1) & mask_) {
+                Slot& slot = slots_[i];
+                if (slot.key == key) {
+                    slot.value = value;
+                    return false;
+                }
+                if (slot.key == kEmptyKey) {
+                    slot.key = key;
+                    slot.value = value;
+                    ++size_;
+                    return true;
+                }
+            }
+        }
+
+        //Removes 'key'. Returns false if it was not present.
+        bool erase(uint64_t key) {
+            if (key == kEmptyKey)
+                return false;
+            std::size_t i = home(key);
+            for (;; i = (i + 1) & mask_) {
+                if (slots_[i].key == key)
+                    break;
+                if (slots_[i].key == kEmptyKey)
+                    return false;
+            }
+
+            //Backward-shift: pull every later entry of this probe run that is allowed
+            //to sit in the hole back into it, then continue from where it came from
+            std::size_t hole = i;
+            for (std::size_t j = (i + 1) & mask_; slots_[j].key != kEmptyKey; j = (j + 1) & mask_) {
+                std::size_t want = home(slots_[j].key);
+                //Entry j may move to 'hole' only if its home is not in (hole, j]
+                if (((j - want) & mask_) >= ((j - hole) & mask_)) {
+                    slots_[hole] = slots_[j];
+                    hole = j;
+                }
+            }
+            slots_[hole].key = kEmptyKey;
+            --size_;
+            return true;
+        }
+
+        void clear() {
+            for (Slot& slot : slots_)
+                slot.key = kEmptyKey;
+            size_ = 0;
+        }
+
+        //Calls fn(key, value) for every entry, in table order
+        template <typename Fn>
+        void forEach(Fn&& fn) const {
+            for (const Slot& slot : slots_)
+                if (slot.key != kEmptyKey)
+                    fn(slot.key, slot.value);
+        }
+
+    private:
+        struct Slot {
+            uint64_t key = kEmptyKey;
+            Value value{};
+        };
+
+        //Maximum load factor of 1/2 keeps probe runs short
+        static constexpr std::size_t kMaxLoadNum = 1;
+        static constexpr std::size_t kMaxLoadDen = 2;
+
+        //Fibonacci hashing: multiply by 2^64 / golden ratio and keep the top bits.
+        //Consecutive IDs land far apart, so monotonic IDs never build probe runs.
+        std::size_t home(uint64_t key) const {
+            return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+        }
+
+        void rehash(std::size_t newCapacity) {
+            std::vector<Slot> old;
+            old.swap(slots_);
+            slots_.assign(newCapacity, Slot{});
+            mask_ = newCapacity - 1;
+            shift_ = 64;
+            for (std::size_t n = newCapacity; n > 1; n >>= 1)
+                --shift_;
+            size_ = 0;
+            for (const Slot& slot : old)
+                if (slot.key != kEmptyKey)
+                    insert(slot.key, slot.value);
+        }
+
+        std::vector<Slot> slots_;
+        std::size_t size_ = 0;
+        std::size_t mask_ = 0;
+        unsigned shift_ = 64;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Order.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+//Index of an OrderNode inside its OrderPool. Indices stay valid when the pool grows.
+using OrderHandle = uint32_t;
+constexpr OrderHandle kNullOrder = UINT32_MAX;
+
+//A resting order's matching fields plus its intrusive links in its price level's FIFO queue.
+//The order's owner and self-trade mode live beside the slab (OwnerEntry); OrderPool::order()
+//puts the whole Order back together.
+//'dead' marks a lazily cancelled order still linked in its level (see CancelMode::Lazy).
+struct OrderNode {
+    uint64_t orderId;
+    Price price;
+    uint32_t quantity;
+    OrderSide side;
+    OrderType type;
+    uint8_t flags;
+    bool dead;
+    OrderHandle prev;
+    OrderHandle next;
+};
+
+static_assert(sizeof(OrderNode) == 32, "OrderNode must stay 32 bytes: two per cache line");
+
+//A node's owner, its self-trade mode and its links in the list of resting orders with the same
+//owner (the links are unused for orders without one). Kept beside the slab, not in the node:
+//matching reads the owner only when the incoming order has one, and only resting, leaving and
+//mass cancel touch the links.
+struct OwnerEntry {
+    OwnerId owner;
+    SelfTradePrevention selfTrade;
+    OrderHandle prev;
+    OrderHandle next;
+};
+
+//What the pool does when every node is in use
+enum class PoolExhaustion {
+    Grow,   //Double the slab (one allocation, off the steady-state path)
+    Throw   //Refuse the order with std::length_error
+};
+
+/*
+Preallocated slab of OrderNodes with an intrusive free list.
+
+Allocating and releasing a node is a couple of index writes, so a book sized for
+its steady-state depth never calls malloc/free on the order path.
+*/
+class OrderPool {
+    public:
+        OrderPool(std::size_t capacity, PoolExhaustion policy)
+            : policy_{policy} {
+            grow(capacity == 0 ? 1 : capacity);
+        }
+
+        std::size_t capacity() const { return nodes_.size(); }
+        std::size_t size() const { return used_; }
+
+        //Grows the slab so at least 'count' nodes exist, e.g. before restoring a large book
+        void reserve(std::size_t count) {
+            if (count > nodes_.size())
+                grow(count - nodes_.size());
+        }
+
+        //True when the next allocate() would throw
+        bool exhausted() const { return freeHead_ == kNullOrder && policy_ == PoolExhaustion::Throw; }
+
+        OrderNode& operator[](OrderHandle handle) { return nodes_[handle]; }
+        const OrderNode& operator[](OrderHandle handle) const { return nodes_[handle]; }
+
+        void prefetch(OrderHandle handle) const { __builtin_prefetch(&nodes_[handle]); }
+
+        OwnerEntry& ownerEntry(OrderHandle handle) { return owners_[handle]; }
+        const OwnerEntry& ownerEntry(OrderHandle handle) const { return owners_[handle]; }
+        OwnerId owner(OrderHandle handle) const { return owners_[handle].owner; }
+
+        //The node's order as processOrder took it, with the quantity it has left
+        Order order(OrderHandle handle) const {
+            const OrderNode& node = nodes_[handle];
+            Order order(node.orderId, node.side, node.quantity, node.price, node.type);
+            order.owner = owners_[handle].owner;
+            order.selfTrade = owners_[handle].selfTrade;
+            order.flags = node.flags;
+            return order;
+        }
+
+        //Takes a node off the free list and stores 'order' in it.
+        //Note: growing the pool invalidates references to nodes, never handles.
+        OrderHandle allocate(const Order& order) {
+            if (freeHead_ == kNullOrder) {
+                if (policy_ == PoolExhaustion::Throw)
+                    throw std::length_error("OrderPool: capacity exhausted");
+                grow(nodes_.size());
+            }
+            OrderHandle handle = freeHead_;
+            OrderNode& node = nodes_[handle];
+            freeHead_ = node.next;
+            node = OrderNode{order.orderId, order.price, order.quantity, order.side, order.type, order.flags, false, kNullOrder, kNullOrder};
+            owners_[handle] = OwnerEntry{order.owner, order.selfTrade, kNullOrder, kNullOrder};
+            ++used_;
+            return handle;
+        }
+
+        //Returns a node to the free list. The node must already be unlinked from its level.
+        void release(OrderHandle handle) {
+            nodes_[handle].next = freeHead_;
+            freeHead_ = handle;
+            --used_;
+        }
+
+    private:
+        void grow(std::size_t extra) {
+            std::size_t first = nodes_.size();
+            nodes_.resize(first + extra, OrderNode{0, 0, 0, OrderSide::BUY, OrderType::Limit, 0, false, kNullOrder, kNullOrder});
+            owners_.resize(nodes_.size(), OwnerEntry{kNoOwner, SelfTradePrevention::CancelNewest, kNullOrder, kNullOrder});
+            //Thread the new nodes onto the free list in index order
+            for (std::size_t i = nodes_.size(); i-- > first;) {
+                nodes_[i].next = freeHead_;
+                freeHead_ = static_cast<OrderHandle>(i);
+            }
+        }
+
+        std::vector<OrderNode> nodes_;
+        std::vector<OwnerEntry> owners_;    //Parallel to nodes_
+        OrderHandle freeHead_ = kNullOrder;
+        std::size_t used_ = 0;
+        PoolExhaustion policy_;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+In-place inclusive prefix sums over uint64_t arrays: data[i] becomes data[0] + ... + data[i].
+
+On x86-64 CPUs with AVX2 (checked once at run time, so the build needs no -mavx2)
+each block of four is summed inside a register with two shift-and-add steps, then
+the running total of the blocks before it is broadcast and added. Anything else
+takes the scalar loop.
+*/
+inline void prefixSumScalar(uint64_t* data, std::size_t count) {
+    uint64_t sum = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        sum += data[i];
+        data[i] = sum;
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+inline void prefixSumAvx2(uint64_t* data, std::size_t count) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i carry = zero;
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        //[a b c d] + [0 a b c] = [a, a+b, b+c, c+d]
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x93), zero, 0x03));
+        //... + [0 0 a a+b] = [a, a+b, a+b+c, a+b+c+d]
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x4E), zero, 0x0F));
+        x = _mm256_add_epi64(x, carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), x);
+        carry = _mm256_permute4x64_epi64(x, 0xFF);
+    }
+    uint64_t sum = i > 0 ? data[i - 1] : 0;
+    for (; i < count; ++i) {
+        sum += data[i];
+        data[i] = sum;
+    }
+}
+#endif
+
+inline void prefixSum(uint64_t* data, std::size_t count) {
+#if defined(__x86_64__)
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2) {
+        prefixSumAvx2(data, count);
+        return;
+    }
+#endif
+    prefixSumScalar(data, count);
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "TickBitmap.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/*
+One side of the book as a contiguous array of price levels indexed by integer tick.
+
+Slot i holds the level for tick baseTick_ + i, and a TickBitmap marks which slots
+are live, so inserting/erasing a level and finding the best price are O(1) and
+never touch the heap. The window is centred on the first price it sees; a price
+outside the window re-centres an empty ladder or grows a non-empty one (a rare,
+amortised reallocation that keeps every live level).
+
+Growth is bounded: the live levels may span at most 'maxSpanTicks' ticks, so the
+array never exceeds about twice that. fits() says whether a tick can be added;
+operator[] throws std::out_of_range for one that cannot.
+*/
+template <typename Level>
+class PriceLadder {
+    public:
+        static constexpr std::size_t kDefaultMaxSpan = std::size_t{1} << 20;
+
+        //Ticks further than this from zero are never accepted, so window arithmetic cannot overflow
+        static constexpr int64_t kMaxTick = int64_t{1} << 61;
+
+        explicit PriceLadder(std::size_t windowTicks = 4096, std::size_t maxSpanTicks = kDefaultMaxSpan)
+            : levels_(roundUp(windowTicks)), occupied_(levels_.size()), maxSpan_{maxSpanTicks} {}
+
+        bool empty() const { return occupied_.empty(); }
+        std::size_t size() const { return count_; }
+
+        //Lowest/highest live tick. Only valid when the ladder is not empty.
+        int64_t lowest() const { return baseTick_ + static_cast<int64_t>(occupied_.findFirst()); }
+        int64_t highest() const { return baseTick_ + static_cast<int64_t>(occupied_.findLast()); }
+
+        //Returns the level at 'tick', or nullptr if there is no live level there
+        Level* find(int64_t tick) {
+            std::size_t slot;
+            if (!slotOf(tick, slot) || !occupied_.test(slot))
+                return nullptr;
+            return &levels_[slot];
+        }
+        const Level* find(int64_t tick) const { return const_cast<PriceLadder*>(this)->find(tick); }
+
+        //Starts loading the level at 'tick' (if it is inside the window), for a later access
+        void prefetch(int64_t tick) const {
+            std::size_t slot;
+            if (slotOf(tick, slot))
+                __builtin_prefetch(&levels_[slot]);
+        }
+
+        //True if operator[] can create a level at 'tick': it is inside the window, or the live
+        //levels plus 'tick' span at most maxSpanTicks. One range check for a tick in the window.
+        bool fits(int64_t tick) const {
+            std::size_t slot;
+            if (slotOf(tick, slot))
+                return true;
+            if (tick < -kMaxTick || tick > kMaxTick)
+                return false;
+            if (empty())
+                return true;
+            int64_t low = std::min(lowest(), tick);
+            int64_t high = std::max(highest(), tick);
+            return static_cast<uint64_t>(high - low) < maxSpan_;
+        }
+
+        //Returns the level at 'tick', creating it if needed (like std::map::operator[]).
+        //Throws std::out_of_range, changing nothing, if it does not fit().
+        Level& operator[](int64_t tick) {
+            std::size_t slot;
+            if (!slotOf(tick, slot))
+                slot = makeRoom(tick);
+            if (!occupied_.test(slot)) {
+                occupied_.set(slot);
+                ++count_;
+            }
+            return levels_[slot];
+        }
+
+        //Retires the level at 'tick'. The level must already be empty.
+        void erase(int64_t tick) {
+            std::size_t slot;
+            if (slotOf(tick, slot) && occupied_.test(slot)) {
+                occupied_.reset(slot);
+                --count_;
+            }
+        }
+
+        //Next live tick strictly above/below 'tick', used to walk the book in price order.
+        //Returns false when there is none.
+        bool next(int64_t tick, int64_t& out) const { return step(tick, out, &TickBitmap::findNext); }
+        bool prev(int64_t tick, int64_t& out) const { return step(tick, out, &TickBitmap::findPrev); }
+
+        //Calls fn(tick, level) for every tick in [from, to] inside the window, in ascending
+        //order, straight off the slot array with no bitmap lookups: for passes that want
+        //every tick. Ticks without a live level come with an empty Level (levels are only
+        //ever retired once empty); ticks outside the window are skipped.
+        template <typename Fn>
+        void forEachTick(int64_t from, int64_t to, Fn&& fn) const {
+            int64_t first = std::max(from, baseTick_);
+            int64_t last = std::min(to, baseTick_ + static_cast<int64_t>(levels_.size()) - 1);
+            for (int64_t tick = first; tick <= last; ++tick)
+                fn(tick, levels_[static_cast<std::size_t>(tick - baseTick_)]);
+        }
+
+    private:
+        static std::size_t roundUp(std::size_t n) {
+            std::size_t size = 64;
+            while (size < n)
+                size <<= 1;
+            return size;
+        }
+
+        bool slotOf(int64_t tick, std::size_t& slot) const {
+            if (tick < baseTick_)
+                return false;
+            //Unsigned, so a tick far above the window cannot overflow the difference
+            uint64_t offset = static_cast<uint64_t>(tick) - static_cast<uint64_t>(baseTick_);
+            if (offset >= levels_.size())
+                return false;
+            slot = static_cast<std::size_t>(offset);
+            return true;
+        }
+
+        bool step(int64_t tick, int64_t& out, std::size_t (TickBitmap::*find)(std::size_t) const) const {
+            std::size_t slot;
+            if (!slotOf(tick, slot))
+                return false;
+            std::size_t found = (occupied_.*find)(slot);
+            if (found == TickBitmap::npos)
+                return false;
+            out = baseTick_ + static_cast<int64_t>(found);
+            return true;
+        }
+
+        //Moves the window so that 'tick' fits, growing it if the live levels plus 'tick'
+        //do not fit in the current size. Returns the slot for 'tick'.
+        std::size_t makeRoom(int64_t tick) {
+            if (!fits(tick))
+                throw std::out_of_range("PriceLadder: price too far from the live levels");
+            if (empty()) {
+                baseTick_ = tick - static_cast<int64_t>(levels_.size() / 2);
+                return static_cast<std::size_t>(tick - baseTick_);
+            }
+
+            int64_t low = std::min(lowest(), tick);
+            int64_t high = std::max(highest(), tick);
+            std::size_t span = static_cast<std::size_t>(high - low) + 1;
+            std::size_t size = levels_.size();
+            while (size < span * 2)
+                size <<= 1;
+
+            int64_t newBase = low - static_cast<int64_t>((size - span) / 2);
+            std::vector<Level> levels(size);
+            TickBitmap occupied(size);
+            for (std::size_t slot = occupied_.findFirst(); slot != TickBitmap::npos; slot = occupied_.findNext(slot)) {
+                std::size_t moved = static_cast<std::size_t>(baseTick_ + static_cast<int64_t>(slot) - newBase);
+                levels[moved] = std::move(levels_[slot]);
+                occupied.set(moved);
+            }
+            levels_ = std::move(levels);
+            occupied_ = std::move(occupied);
+            baseTick_ = newBase;
+            return static_cast<std::size_t>(tick - baseTick_);
+        }
+
+        int64_t baseTick_ = 0;
+        std::vector<Level> levels_;
+        TickBitmap occupied_;
+
+        //Number of live levels
+        std::size_t count_ = 0;
+
+        //Widest span of live ticks allowed
+        std::size_t maxSpan_;
+};
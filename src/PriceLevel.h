@@ -0,0 +1,189 @@
+#pragma once
+
+#include "OrderPool.h"
+#include "PriceLadder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+/*
+Header of one price level: a FIFO queue of OrderNodes linked through the pool,
+plus running totals so the level's size is known without walking it.
+
+With lazy cancels the queue can also hold dead nodes (tombstones). They are not
+part of 'count' or 'totalQuantity', so the aggregates always describe the live
+orders only; 'dead' says how many tombstones are still linked.
+*/
+struct PriceLevel {
+    OrderHandle head = kNullOrder;
+    OrderHandle tail = kNullOrder;
+    uint32_t count = 0;
+    uint32_t dead = 0;
+    uint64_t totalQuantity = 0;
+
+    //No live orders. Tombstones may still be linked; the book frees them before retiring the level.
+    bool empty() const { return count == 0; }
+
+    //Appends an allocated node to the back of the queue (time priority)
+    void pushBack(OrderPool& pool, OrderHandle handle) {
+        OrderNode& node = pool[handle];
+        node.prev = tail;
+        node.next = kNullOrder;
+        if (tail == kNullOrder)
+            head = handle;
+        else
+            pool[tail].next = handle;
+        tail = handle;
+        ++count;
+        totalQuantity += node.quantity;
+    }
+
+    //Unlinks a live node from anywhere in the queue. The caller releases it back to the pool.
+    void erase(OrderPool& pool, OrderHandle handle) {
+        unlink(pool, handle);
+        --count;
+        totalQuantity -= pool[handle].quantity;
+    }
+
+    //Takes a live node out of the aggregates but leaves it linked, touching no other node
+    void markDead(OrderPool& pool, OrderHandle handle) {
+        OrderNode& node = pool[handle];
+        node.dead = true;
+        --count;
+        ++dead;
+        totalQuantity -= node.quantity;
+    }
+
+    //Unlinks a tombstone. The caller releases it back to the pool.
+    void eraseDead(OrderPool& pool, OrderHandle handle) {
+        unlink(pool, handle);
+        --dead;
+    }
+
+    private:
+        void unlink(OrderPool& pool, OrderHandle handle) {
+            OrderNode& node = pool[handle];
+            if (node.prev == kNullOrder)
+                head = node.next;
+            else
+                pool[node.prev].next = node.next;
+            if (node.next == kNullOrder)
+                tail = node.prev;
+            else
+                pool[node.next].prev = node.prev;
+        }
+};
+
+//Read-only view of one price level's live orders, oldest first (tombstones are skipped)
+class PriceLevelView {
+    public:
+        PriceLevelView(const PriceLevel& level, const OrderPool& pool)
+            : level_{&level}, pool_{&pool} {}
+
+        class iterator {
+            public:
+                iterator(const OrderPool* pool, OrderHandle handle) : pool_{pool}, handle_{skipDead(pool, handle)} {}
+
+                //By value: the node holds only the matching fields (see OrderNode)
+                Order operator*() const { return pool_->order(handle_); }
+                iterator& operator++() {
+                    handle_ = skipDead(pool_, (*pool_)[handle_].next);
+                    return *this;
+                }
+                bool operator==(const iterator& other) const { return handle_ == other.handle_; }
+                bool operator!=(const iterator& other) const { return handle_ != other.handle_; }
+
+            private:
+                const OrderPool* pool_;
+                OrderHandle handle_;
+        };
+
+        bool empty() const { return level_->empty(); }
+        std::size_t size() const { return level_->count; }
+        uint64_t totalQuantity() const { return level_->totalQuantity; }
+
+        Order front() const { return pool_->order(skipDead(pool_, level_->head)); }
+        Order back() const {
+            OrderHandle handle = level_->tail;
+            while ((*pool_)[handle].dead)
+                handle = (*pool_)[handle].prev;
+            return pool_->order(handle);
+        }
+
+        iterator begin() const { return {pool_, level_->head}; }
+        iterator end() const { return {pool_, kNullOrder}; }
+
+    private:
+        static OrderHandle skipDead(const OrderPool* pool, OrderHandle handle) {
+            while (handle != kNullOrder && (*pool)[handle].dead)
+                handle = (*pool)[handle].next;
+            return handle;
+        }
+
+        const PriceLevel* level_;
+        const OrderPool* pool_;
+};
+
+/*
+Read-only, best-price-first view over one side of the book, shaped like the
+std::map the book used to expose: empty(), size(), at(price) and range-for
+over (price, level) pairs.
+*/
+class BookSideView {
+    public:
+        BookSideView(const PriceLadder<PriceLevel>& ladder, const OrderPool& pool, bool descending)
+            : ladder_{&ladder}, pool_{&pool}, descending_{descending} {}
+
+        class iterator {
+            public:
+                iterator(const BookSideView* side, bool valid, int64_t tick)
+                    : ladder_{side->ladder_}, pool_{side->pool_}, descending_{side->descending_},
+                      valid_{valid}, tick_{tick} {}
+
+                std::pair<Price, PriceLevelView> operator*() const {
+                    return {tick_, PriceLevelView(*ladder_->find(tick_), *pool_)};
+                }
+
+                iterator& operator++() {
+                    valid_ = descending_ ? ladder_->prev(tick_, tick_) : ladder_->next(tick_, tick_);
+                    return *this;
+                }
+
+                bool operator==(const iterator& other) const {
+                    return valid_ == other.valid_ && (!valid_ || tick_ == other.tick_);
+                }
+                bool operator!=(const iterator& other) const { return !(*this == other); }
+
+            private:
+                const PriceLadder<PriceLevel>* ladder_;
+                const OrderPool* pool_;
+                bool descending_;
+                bool valid_;
+                int64_t tick_;
+        };
+
+        bool empty() const { return ladder_->empty(); }
+        std::size_t size() const { return ladder_->size(); }
+
+        iterator begin() const {
+            if (empty())
+                return end();
+            return {this, true, descending_ ? ladder_->highest() : ladder_->lowest()};
+        }
+        iterator end() const { return {this, false, 0}; }
+
+        //Throws std::out_of_range if there is no level at 'price', like std::map::at
+        PriceLevelView at(Price price) const {
+            const PriceLevel* level = ladder_->find(price);
+            if (level == nullptr)
+                throw std::out_of_range("BookSideView::at: no level at price");
+            return {*level, *pool_};
+        }
+
+    private:
+        const PriceLadder<PriceLevel>* ladder_;
+        const OrderPool* pool_;
+        bool descending_;
+};
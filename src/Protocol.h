@@ -0,0 +1,323 @@
+#pragma once
+
+#include "Order.h"
+#include "Trade.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+/*
+Agora binary order-entry protocol.
+
+Every message is a fixed-layout, little-endian struct that starts with a
+MessageHeader; messages are sent back to back with no other framing. All
+message sizes are multiples of 8, so a stream that starts 8-byte aligned keeps
+every message aligned. Decoding is zero-copy: handlers get a reference to the
+message where it sits in the receive buffer.
+
+Inbound (client -> engine): NewOrder, Cancel, Replace.
+Outbound (engine -> client): Ack, TradeReport.
+*/
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "The wire format is read in place and is little-endian");
+
+namespace protocol {
+
+enum class MessageType : uint8_t {
+    NewOrder = 'N',
+    Cancel = 'X',
+    Replace = 'R',
+    Ack = 'A',
+    TradeReport = 'T'
+};
+
+enum class AckStatus : uint8_t {
+    Accepted = 0,   //NewOrder reached the book
+    Cancelled = 1,
+    Replaced = 2,
+    Rejected = 3,
+    Reduced = 4     //Self-trade prevention took quantity off a live order; 'quantity' is what it has left
+};
+
+enum class RejectReason : uint8_t {
+    None = 0,
+    UnknownOrder = 1,       //Cancel/Replace for an order that is not resting
+    UnknownInstrument = 2,
+    InvalidQuantity = 3,
+    BookFull = 4,
+    OrderQuantityLimit = 5, //Risk gate: larger than the account's largest allowed order
+    PriceBand = 6,          //Risk gate: too far from the last trade
+    OpenQuantityLimit = 7,  //Risk gate: the account's resting quantity would exceed its limit
+    OpenNotionalLimit = 8,  //Risk gate: the account's resting notional would exceed its limit
+    DuplicateOrder = 9,     //NewOrder reusing the ID of an order still resting or pending
+    PriceOutOfRange = 10,   //Priced too far from the book's other levels (OrderBook::acceptsPrice)
+    BookError = 11,         //The book failed to apply it (e.g. out of memory)
+    InvalidOrderId = 12     //The order ID the book reserves (OrderBook::kReservedOrderId)
+};
+
+#pragma pack(push, 1)
+
+struct MessageHeader {
+    uint16_t length;    //Size of the whole message, header included
+    MessageType type;
+    uint8_t reserved;
+};
+
+struct NewOrderMessage {
+    MessageHeader header;
+    InstrumentId instrument;
+    uint64_t orderId;
+    Price price;
+    uint32_t quantity;
+    OrderSide side;
+    uint8_t flags;
+    OrderType type;
+    SelfTradePrevention selfTrade;  //Applies against the sending session's own orders
+};
+
+struct CancelMessage {
+    MessageHeader header;
+    InstrumentId instrument;
+    uint64_t orderId;
+};
+
+//Changes the price and/or quantity of a resting order, keeping its ID and side
+struct ReplaceMessage {
+    MessageHeader header;
+    InstrumentId instrument;
+    uint64_t orderId;
+    Price price;
+    uint32_t quantity;
+    uint32_t reserved;
+};
+
+struct AckMessage {
+    MessageHeader header;
+    InstrumentId instrument;
+    uint64_t orderId;
+    AckStatus status;
+    RejectReason reason;
+    uint8_t reserved[2];
+    uint32_t quantity;  //Reduced only: the order's quantity left to fill
+};
+
+struct TradeReportMessage {
+    MessageHeader header;
+    InstrumentId instrument;
+    uint64_t tradeId;
+    uint64_t buyOrderId;
+    uint64_t sellOrderId;
+    Price price;
+    uint32_t quantity;
+    uint32_t reserved;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(MessageHeader) == 4, "wire layout");
+static_assert(sizeof(NewOrderMessage) == 32, "wire layout");
+static_assert(sizeof(CancelMessage) == 16, "wire layout");
+static_assert(sizeof(ReplaceMessage) == 32, "wire layout");
+static_assert(sizeof(AckMessage) == 24, "wire layout");
+static_assert(sizeof(TradeReportMessage) == 48, "wire layout");
+
+//Largest message of either direction, for sizing buffers
+constexpr std::size_t kMaxMessageSize = sizeof(TradeReportMessage);
+
+//Thrown on a malformed stream: unknown type, wrong length or bad field value.
+//The session that sent it should be dropped; its stream cannot be re-synchronised.
+class ProtocolError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+};
+
+/*
+Writes messages straight into a caller-owned byte buffer.
+
+Each write*() returns false, writing nothing, if the message does not fit;
+the caller then sends/flushes data()..size() and calls clear().
+*/
+class MessageWriter {
+    public:
+        MessageWriter(uint8_t* buffer, std::size_t capacity)
+            : buffer_{buffer}, capacity_{capacity} {}
+
+        const uint8_t* data() const { return buffer_; }
+        std::size_t size() const { return size_; }
+        std::size_t remaining() const { return capacity_ - size_; }
+        void clear() { size_ = 0; }
+
+        bool writeNewOrder(InstrumentId instrument, const Order& order) {
+            NewOrderMessage* message = reserve<NewOrderMessage>(MessageType::NewOrder);
+            if (message == nullptr)
+                return false;
+            message->instrument = instrument;
+            message->orderId = order.orderId;
+            message->price = order.price;
+            message->quantity = order.quantity;
+            message->side = order.side;
+            message->flags = order.flags;
+            message->type = order.type;
+            message->selfTrade = order.selfTrade;
+            return true;
+        }
+
+        bool writeCancel(InstrumentId instrument, uint64_t orderId) {
+            CancelMessage* message = reserve<CancelMessage>(MessageType::Cancel);
+            if (message == nullptr)
+                return false;
+            message->instrument = instrument;
+            message->orderId = orderId;
+            return true;
+        }
+
+        bool writeReplace(InstrumentId instrument, uint64_t orderId, Price price, uint32_t quantity) {
+            ReplaceMessage* message = reserve<ReplaceMessage>(MessageType::Replace);
+            if (message == nullptr)
+                return false;
+            message->instrument = instrument;
+            message->orderId = orderId;
+            message->price = price;
+            message->quantity = quantity;
+            return true;
+        }
+
+        bool writeAck(InstrumentId instrument, uint64_t orderId, AckStatus status, RejectReason reason = RejectReason::None,
+            uint32_t quantity = 0) {
+            AckMessage* message = reserve<AckMessage>(MessageType::Ack);
+            if (message == nullptr)
+                return false;
+            message->instrument = instrument;
+            message->orderId = orderId;
+            message->status = status;
+            message->reason = reason;
+            message->quantity = quantity;
+            return true;
+        }
+
+        bool writeTrade(InstrumentId instrument, const Trade& trade) {
+            TradeReportMessage* message = reserve<TradeReportMessage>(MessageType::TradeReport);
+            if (message == nullptr)
+                return false;
+            message->instrument = instrument;
+            message->tradeId = trade.tradeId;
+            message->buyOrderId = trade.buyOrderId;
+            message->sellOrderId = trade.sellOrderId;
+            message->price = trade.price;
+            message->quantity = trade.quantity;
+            return true;
+        }
+
+    private:
+        //Claims space for a message in place, zeroed and with its header filled in
+        template <typename Message>
+        Message* reserve(MessageType type) {
+            if (remaining() < sizeof(Message))
+                return nullptr;
+            Message* message = reinterpret_cast<Message*>(buffer_ + size_);
+            std::memset(message, 0, sizeof(Message));
+            message->header.length = static_cast<uint16_t>(sizeof(Message));
+            message->header.type = type;
+            size_ += sizeof(Message);
+            return message;
+        }
+
+        uint8_t* buffer_;
+        std::size_t capacity_;
+        std::size_t size_ = 0;
+};
+
+namespace detail {
+
+//Checks a message's declared length against its type's fixed size
+template <typename Message>
+const Message& view(const uint8_t* data, const MessageHeader& header) {
+    if (header.length != sizeof(Message))
+        throw ProtocolError("protocol: bad message length");
+    return *reinterpret_cast<const Message*>(data);
+}
+
+//Splits [data, data + size) into whole messages and calls dispatch(header, bytes) for each.
+//Returns how many bytes were consumed; a trailing partial message is left for the next call.
+template <typename Dispatch>
+std::size_t frame(const uint8_t* data, std::size_t size, Dispatch&& dispatch) {
+    std::size_t offset = 0;
+    while (size - offset >= sizeof(MessageHeader)) {
+        const MessageHeader& header = *reinterpret_cast<const MessageHeader*>(data + offset);
+        if (header.length < sizeof(MessageHeader))
+            throw ProtocolError("protocol: bad message length");
+        if (size - offset < header.length)
+            break;
+        dispatch(header, data + offset);
+        offset += header.length;
+    }
+    return offset;
+}
+
+} // namespace detail
+
+/*
+Decodes inbound (client -> engine) messages in place. 'handler' needs:
+    onNewOrder(const NewOrderMessage&), onCancel(const CancelMessage&), onReplace(const ReplaceMessage&)
+Returns the number of bytes consumed. Throws ProtocolError on a malformed stream.
+*/
+template <typename Handler>
+std::size_t decodeOrderEntry(const uint8_t* data, std::size_t size, Handler& handler) {
+    return detail::frame(data, size, [&handler](const MessageHeader& header, const uint8_t* bytes) {
+        switch (header.type) {
+            case MessageType::NewOrder: {
+                const NewOrderMessage& message = detail::view<NewOrderMessage>(bytes, header);
+                if (message.side != OrderSide::BUY && message.side != OrderSide::SELL)
+                    throw ProtocolError("protocol: bad side");
+                if (message.type > OrderType::PostOnly)
+                    throw ProtocolError("protocol: bad order type");
+                if (message.selfTrade > SelfTradePrevention::DecrementBoth)
+                    throw ProtocolError("protocol: bad self-trade prevention mode");
+                handler.onNewOrder(message);
+                break;
+            }
+            case MessageType::Cancel:
+                handler.onCancel(detail::view<CancelMessage>(bytes, header));
+                break;
+            case MessageType::Replace:
+                handler.onReplace(detail::view<ReplaceMessage>(bytes, header));
+                break;
+            default:
+                throw ProtocolError("protocol: unexpected message type");
+        }
+    });
+}
+
+/*
+Decodes outbound (engine -> client) messages in place. 'handler' needs:
+    onAck(const AckMessage&), onTrade(const TradeReportMessage&)
+*/
+template <typename Handler>
+std::size_t decodeReports(const uint8_t* data, std::size_t size, Handler& handler) {
+    return detail::frame(data, size, [&handler](const MessageHeader& header, const uint8_t* bytes) {
+        switch (header.type) {
+            case MessageType::Ack:
+                handler.onAck(detail::view<AckMessage>(bytes, header));
+                break;
+            case MessageType::TradeReport:
+                handler.onTrade(detail::view<TradeReportMessage>(bytes, header));
+                break;
+            default:
+                throw ProtocolError("protocol: unexpected message type");
+        }
+    });
+}
+
+//Builds the book's Order from a NewOrder message. The owner is not on the wire: the
+//session that received the message supplies it.
+inline Order toOrder(const NewOrderMessage& message, OwnerId owner = kNoOwner) {
+    Order order(message.orderId, message.side, message.quantity, message.price, message.type);
+    order.flags = message.flags;
+    order.owner = owner;
+    order.selfTrade = message.selfTrade;
+    return order;
+}
+
+} // namespace protocol
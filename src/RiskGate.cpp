@@ -0,0 +1,127 @@
+#include "RiskGate.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+std::string trim(const std::string& text) {
+    std::size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+        return {};
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+//Parses all of 'text' as a non-negative integer no larger than 'max'
+bool parseNumber(const std::string& text, uint64_t max, uint64_t& out) {
+    if (text.empty() || text[0] == '-')
+        return false;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || value > max)
+        return false;
+    out = value;
+    return true;
+}
+
+//Parses all of 'text' as a Price, optionally negative
+bool parsePrice(const std::string& text, Price& out) {
+    if (text.empty())
+        return false;
+    char* end = nullptr;
+    errno = 0;
+    long long value = std::strtoll(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0')
+        return false;
+    out = value;
+    return true;
+}
+
+} // namespace
+
+RiskConfig RiskConfig::parse(std::istream& in) {
+    RiskConfig config;
+    RiskLimits* limits = &config.defaults;
+    std::string line;
+    for (std::size_t number = 1; std::getline(in, line); ++number) {
+        auto fail = [number](const std::string& what) {
+            throw std::runtime_error("RiskConfig: line " + std::to_string(number) + ": " + what);
+        };
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+
+        //[account <owner>]
+        if (line.front() == '[') {
+            uint64_t owner;
+            if (line.back() != ']' || line.compare(0, 9, "[account ") != 0
+                || !parseNumber(trim(line.substr(9, line.size() - 10)), std::numeric_limits<OwnerId>::max(), owner)
+                || owner == kNoOwner)
+                fail("expected [account <owner ID>]");
+            config.accounts.emplace_back(static_cast<OwnerId>(owner), config.defaults);
+            limits = &config.accounts.back().second;
+            continue;
+        }
+
+        std::size_t equals = line.find('=');
+        if (equals == std::string::npos)
+            fail("expected key = value");
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+        uint64_t parsed;
+        if (key == "price_band" && limits == &config.defaults) {
+            if (!parseNumber(value, static_cast<uint64_t>(kMaxPriceBand), parsed))
+                fail("bad price_band");
+            config.priceBand = static_cast<Price>(parsed);
+        } else if (key == "reference_price" && limits == &config.defaults) {
+            Price price;
+            if (!parsePrice(value, price))
+                fail("bad reference_price");
+            config.referencePrice = price;
+        } else if (key == "max_order_quantity") {
+            if (!parseNumber(value, std::numeric_limits<uint32_t>::max(), parsed))
+                fail("bad max_order_quantity");
+            limits->maxOrderQuantity = static_cast<uint32_t>(parsed);
+        } else if (key == "max_open_quantity") {
+            if (!parseNumber(value, std::numeric_limits<uint64_t>::max(), parsed))
+                fail("bad max_open_quantity");
+            limits->maxOpenQuantity = parsed;
+        } else if (key == "max_open_notional") {
+            if (!parseNumber(value, std::numeric_limits<uint64_t>::max(), parsed))
+                fail("bad max_open_notional");
+            limits->maxOpenNotional = parsed;
+        } else {
+            fail("unknown key '" + key + "'");
+        }
+    }
+    return config;
+}
+
+RiskConfig RiskConfig::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("RiskConfig: cannot open " + path);
+    return parse(in);
+}
+
+RiskGate::RiskGate(const RiskConfig& config)
+    : defaults_{config.defaults}, priceBand_{config.priceBand}, lastPrice_{config.referencePrice.value_or(0)},
+      banded_{config.priceBand != 0 && config.referencePrice.has_value()}, accounts_{config.accounts.size()} {
+    if (priceBand_ < 0 || priceBand_ > RiskConfig::kMaxPriceBand)
+        throw std::invalid_argument("RiskGate: price band out of range");
+    for (const auto& [owner, limits] : config.accounts)
+        accounts_.insert(owner, Account{limits, 0, 0});
+}
+
+uint64_t RiskGate::openQuantity(OwnerId owner) const {
+    const Account* account = accounts_.find(owner);
+    return account != nullptr ? account->openQuantity : 0;
+}
+
+uint64_t RiskGate::openNotional(OwnerId owner) const {
+    const Account* account = accounts_.find(owner);
+    return account != nullptr ? account->openNotional : 0;
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "Order.h"
+#include "OrderIndex.h"
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Outcome of a pre-trade risk check
+enum class RiskCheck : uint8_t {
+    Passed,
+    OrderQuantity,  //Larger than the account's largest allowed order
+    PriceBand,      //Priced further from the last trade than the band allows
+    OpenQuantity,   //Would take the account's resting quantity over its limit
+    OpenNotional    //Would take the account's resting notional over its limit, or price x
+                    //quantity does not fit in 64 bits
+};
+
+//One account's limits. The defaults mean "no limit".
+struct RiskLimits {
+    uint32_t maxOrderQuantity = std::numeric_limits<uint32_t>::max();
+    uint64_t maxOpenQuantity = std::numeric_limits<uint64_t>::max();
+    uint64_t maxOpenNotional = std::numeric_limits<uint64_t>::max();   //Price (in ticks) x quantity
+};
+
+/*
+Risk limits for one instrument, usually loaded from a text file:
+
+    # Anything after '#' is a comment
+    price_band = 50             # ticks either side of the last trade; 0 or absent: no band
+    reference_price = 1000      # band centre until the first trade; absent: no band until then
+    max_order_quantity = 10000  # limits for every account...
+    max_open_quantity = 100000
+    max_open_notional = 500000000
+
+    [account 42]                # ...except these ones
+    max_open_quantity = 2000
+
+An account section starts from the defaults given above it and overrides what it names.
+*/
+struct RiskConfig {
+    //Widest band the parser takes: any wider already admits every price a book accepts
+    static constexpr Price kMaxPriceBand = Price{1} << 62;
+
+    Price priceBand = 0;
+    std::optional<Price> referencePrice;
+    RiskLimits defaults;
+    std::vector<std::pair<OwnerId, RiskLimits>> accounts;
+
+    //Throw std::runtime_error naming the line on anything they do not understand
+    static RiskConfig parse(std::istream& in);
+    static RiskConfig load(const std::string& path);
+};
+
+/*
+Pre-trade risk checks for one book, in O(1) per order.
+
+The gate keeps each account's open (resting) quantity and notional as running
+totals. The book it is attached to (OrderBook::setRiskGate) updates them as
+orders rest, fill, get amended and get cancelled, and reports its last trade
+price, so a check is a hash lookup and a few compares: it never looks at
+resting orders.
+
+The book does not call check() itself. Whoever accepts orders does, before
+handing them over (OrderEntrySession does when its book has a gate). An order
+is checked as if all of it were going to rest; pending stops are not counted
+until they trigger and rest.
+
+The band is centred on the last trade. Before the first one it is centred on
+RiskConfig::referencePrice if there is one; without it no band applies until
+the book trades.
+
+Orders without an owner are held to the default per-order limits only. Like the
+book, a gate is used from one thread.
+*/
+class RiskGate {
+    public:
+        explicit RiskGate(const RiskConfig& config = RiskConfig{});
+
+        //Checks a new order. Market orders have no price: the band does not apply and
+        //their notional is taken at the last trade price.
+        RiskCheck check(const Order& order) const {
+            const Account* account = order.owner == kNoOwner ? nullptr : accounts_.find(order.owner);
+            const RiskLimits& limits = account != nullptr ? account->limits : defaults_;
+            if (order.quantity > limits.maxOrderQuantity)
+                return RiskCheck::OrderQuantity;
+            Price price = lastPrice_;
+            if (order.type != OrderType::Market) {
+                if (outsideBand(order.price))
+                    return RiskCheck::PriceBand;
+                price = order.price;
+            }
+            if (order.owner == kNoOwner)
+                return RiskCheck::Passed;
+            uint64_t added;
+            if (!checkedNotional(price, order.quantity, added))
+                return RiskCheck::OpenNotional;
+            uint64_t openQuantity = account != nullptr ? account->openQuantity : 0;
+            uint64_t openNotional = account != nullptr ? account->openNotional : 0;
+            return checkOpen(limits, openQuantity, order.quantity, openNotional, added);
+        }
+
+        //Checks amending the resting order 'resting' to 'newQuantity' at 'newPrice', with
+        //the order's current exposure taken out first
+        RiskCheck checkModify(const Order& resting, Price newPrice, uint32_t newQuantity) const {
+            const Account* account = resting.owner == kNoOwner ? nullptr : accounts_.find(resting.owner);
+            const RiskLimits& limits = account != nullptr ? account->limits : defaults_;
+            if (newQuantity > limits.maxOrderQuantity)
+                return RiskCheck::OrderQuantity;
+            if (outsideBand(newPrice))
+                return RiskCheck::PriceBand;
+            if (account == nullptr)
+                return RiskCheck::Passed;
+            uint64_t added;
+            if (!checkedNotional(newPrice, newQuantity, added))
+                return RiskCheck::OpenNotional;
+            return checkOpen(limits, account->openQuantity - resting.quantity, newQuantity,
+                account->openNotional - notional(resting.price, resting.quantity), added);
+        }
+
+        //Book hooks: 'quantity' of a resting order of 'owner' at 'price' appeared (> 0) or
+        //went away (< 0), and a trade printed at 'price'
+        void onResting(OwnerId owner, Price price, int64_t quantity) {
+            if (owner == kNoOwner)
+                return;
+            Account* account = accounts_.find(owner);
+            if (account == nullptr) {
+                accounts_.insert(owner, Account{defaults_, 0, 0});
+                account = accounts_.find(owner);
+            }
+            uint64_t amount = quantity < 0 ? static_cast<uint64_t>(-quantity) : static_cast<uint64_t>(quantity);
+            if (quantity < 0) {
+                account->openQuantity -= amount;
+                account->openNotional -= notional(price, amount);
+            } else {
+                account->openQuantity += amount;
+                account->openNotional += notional(price, amount);
+            }
+        }
+        void onTrade(Price price) {
+            lastPrice_ = price;
+            traded_ = true;
+            banded_ = priceBand_ != 0;
+        }
+
+        //Running totals of 'owner's resting orders
+        uint64_t openQuantity(OwnerId owner) const;
+        uint64_t openNotional(OwnerId owner) const;
+
+        //Last trade price the book reported; false before the first trade
+        bool lastTrade(Price& out) const {
+            out = lastPrice_;
+            return traded_;
+        }
+
+    private:
+        struct Account {
+            RiskLimits limits;
+            uint64_t openQuantity = 0;
+            uint64_t openNotional = 0;
+        };
+
+        //|price| without the overflow of negating the lowest Price
+        static uint64_t magnitude(Price price) {
+            return price < 0 ? 0 - static_cast<uint64_t>(price) : static_cast<uint64_t>(price);
+        }
+
+        //Notional for the running totals: modulo 2^64, which adding and later subtracting
+        //the same order undoes exactly. Orders a check passed never wrap.
+        static uint64_t notional(Price price, uint64_t quantity) {
+            return magnitude(price) * quantity;
+        }
+
+        //Notional for a check: false if it does not fit, which the check refuses
+        static bool checkedNotional(Price price, uint64_t quantity, uint64_t& out) {
+            return !__builtin_mul_overflow(magnitude(price), quantity, &out);
+        }
+
+        //Compares the distance to the band's centre, which cannot overflow, never centre +/- band
+        bool outsideBand(Price price) const {
+            if (!banded_)
+                return false;
+            uint64_t distance = price > lastPrice_ ? static_cast<uint64_t>(price) - static_cast<uint64_t>(lastPrice_)
+                : static_cast<uint64_t>(lastPrice_) - static_cast<uint64_t>(price);
+            return distance > static_cast<uint64_t>(priceBand_);
+        }
+
+        //Written as differences so the "no limit" maximums cannot overflow
+        static RiskCheck checkOpen(const RiskLimits& limits, uint64_t openQuantity, uint64_t quantity,
+                uint64_t openNotional, uint64_t addedNotional) {
+            if (openQuantity > limits.maxOpenQuantity || quantity > limits.maxOpenQuantity - openQuantity)
+                return RiskCheck::OpenQuantity;
+            if (openNotional > limits.maxOpenNotional || addedNotional > limits.maxOpenNotional - openNotional)
+                return RiskCheck::OpenNotional;
+            return RiskCheck::Passed;
+        }
+
+        RiskLimits defaults_;
+        Price priceBand_;
+        Price lastPrice_ = 0;       //Band centre: the last trade, or the reference price before one
+        bool traded_ = false;
+        bool banded_ = false;       //A band is configured and has a centre
+
+        //Every account seen so far: the configured ones up front, the rest from their first
+        //resting order on, with the default limits
+        OrderIndex<Account> accounts_;
+};
@@ -0,0 +1,74 @@
+#include "SharedMarketData.h"
+
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SharedRegion SharedRegion::create(const std::string& name, std::size_t size) {
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        throw std::runtime_error("SharedRegion: cannot create " + name);
+
+    //Truncating to 0 first zeroes a region left behind by an earlier run
+    bool ok = ::ftruncate(fd, 0) == 0 && ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+    void* data = ok ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw std::runtime_error("SharedRegion: cannot map " + name);
+    return SharedRegion(static_cast<uint8_t*>(data), size);
+}
+
+SharedRegion SharedRegion::open(const std::string& name) {
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        throw std::runtime_error("SharedRegion: cannot open " + name);
+
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0)
+        data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw std::runtime_error("SharedRegion: cannot map " + name);
+    return SharedRegion(static_cast<uint8_t*>(data), static_cast<std::size_t>(info.st_size));
+}
+
+void SharedRegion::unlink(const std::string& name) {
+    ::shm_unlink(name.c_str());
+}
+
+SharedRegion::SharedRegion(SharedRegion&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)}, size_{std::exchange(other.size_, 0)} {}
+
+SharedRegion& SharedRegion::operator=(SharedRegion&& other) noexcept {
+    if (this != &other) {
+        if (data_ != nullptr)
+            ::munmap(data_, size_);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+SharedRegion::~SharedRegion() {
+    if (data_ != nullptr)
+        ::munmap(data_, size_);
+}
+
+SharedMarketDataReader::SharedMarketDataReader(const std::string& name)
+    : region_{SharedRegion::open(name)} {
+    header_ = reinterpret_cast<const ShmHeader*>(region_.data());
+    if (region_.size() < SharedLayout::kSlots || header_->magic != kSharedMarketDataMagic
+        || region_.size() < SharedLayout::size(header_->tradeCapacity))
+        throw std::runtime_error("SharedMarketDataReader: " + name + " is not a market-data region");
+
+    depth_ = reinterpret_cast<const ShmDepth*>(region_.data() + SharedLayout::kDepth);
+    cursor_ = reinterpret_cast<const ShmTradeCursor*>(region_.data() + SharedLayout::kCursor);
+    slots_ = reinterpret_cast<const ShmTradeSlot*>(region_.data() + SharedLayout::kSlots);
+    mask_ = header_->tradeCapacity - 1;
+    next_ = cursor_->published.load(std::memory_order_acquire) + 1;
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "MarketData.h"
+#include "Trade.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/*
+Shared-memory market data: the layout of the region an engine publishes one book's
+depth and trades into, and the reader side other processes on the box link against
+(library agora-md-reader, no dependency on the engine).
+
+The region is a POSIX shared-memory object ("/name", see shm_open) laid out as:
+
+    ShmHeader | ShmDepth | ShmTradeCursor | ShmTradeSlot[tradeCapacity]
+
+ - Depth is a seqlock-protected top-N snapshot. The writer never waits; a reader
+   copies it and retries if the sequence moved while it was copying.
+ - Trades go into a broadcast ring. Every trade gets a sequence number (from 1) and
+   overwrites the slot of the trade 'tradeCapacity' earlier. Each reader keeps its
+   own cursor, so any number of readers consume without locks and without the
+   writer knowing they exist; a reader that falls a whole ring behind is told how
+   many trades it missed.
+
+Everything in the region is written by one thread of one process.
+*/
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared-memory atomics must be lock-free (and so address-free)");
+
+//Most levels per side a region can carry
+constexpr std::size_t kMaxSharedDepth = 32;
+
+constexpr uint64_t kSharedMarketDataMagic = 0x31444D41524F4741ull; //"AGORAMD1"
+
+struct ShmHeader {
+    uint64_t magic;
+    InstrumentId instrument;
+    uint32_t depthLevels;   //Levels per side published, at most kMaxSharedDepth
+    uint64_t tradeCapacity; //Slots in the trade ring, a power of two
+};
+
+//Top-N depth of both sides, best first. Consistent only between two equal, even
+//'sequence' values: odd means the writer is in the middle of an update.
+struct alignas(64) ShmDepth {
+    std::atomic<uint64_t> sequence;
+    uint32_t bidCount;
+    uint32_t askCount;
+    DepthLevel bids[kMaxSharedDepth];
+    DepthLevel asks[kMaxSharedDepth];
+};
+
+//Sequence of the last trade in the ring, 0 before the first. On its own line: every
+//reader polls it.
+struct alignas(64) ShmTradeCursor {
+    std::atomic<uint64_t> published;
+};
+
+//One trade of the ring. 'sequence' is the trade's sequence number once it is fully
+//written, 0 while the writer is replacing it.
+struct ShmTradeSlot {
+    std::atomic<uint64_t> sequence;
+    Trade trade;
+};
+
+//A reader's consistent copy of the depth
+struct SharedDepth {
+    uint64_t version = 0;   //Number of depth updates published so far
+    uint32_t bidCount = 0;
+    uint32_t askCount = 0;
+    DepthLevel bids[kMaxSharedDepth];
+    DepthLevel asks[kMaxSharedDepth];
+};
+
+//Byte offsets of each part of a region with 'tradeCapacity' slots
+struct SharedLayout {
+    static constexpr std::size_t kDepth = (sizeof(ShmHeader) + 63) / 64 * 64;
+    static constexpr std::size_t kCursor = kDepth + sizeof(ShmDepth);
+    static constexpr std::size_t kSlots = kCursor + sizeof(ShmTradeCursor);
+
+    static std::size_t size(std::size_t tradeCapacity) { return kSlots + tradeCapacity * sizeof(ShmTradeSlot); }
+};
+
+//A mapped POSIX shared-memory object. Move-only; unmaps on destruction.
+class SharedRegion {
+    public:
+        //Creates (or truncates and reuses) 'name' with 'size' zeroed bytes, mapped read-write.
+        //Throws std::runtime_error on failure.
+        static SharedRegion create(const std::string& name, std::size_t size);
+
+        //Maps an existing 'name' read-only. Throws std::runtime_error if it does not exist.
+        static SharedRegion open(const std::string& name);
+
+        //Removes 'name'; processes that have it mapped keep their mapping
+        static void unlink(const std::string& name);
+
+        SharedRegion(SharedRegion&& other) noexcept;
+        SharedRegion& operator=(SharedRegion&& other) noexcept;
+        SharedRegion(const SharedRegion&) = delete;
+        SharedRegion& operator=(const SharedRegion&) = delete;
+        ~SharedRegion();
+
+        uint8_t* data() const { return data_; }
+        std::size_t size() const { return size_; }
+
+    private:
+        SharedRegion(uint8_t* data, std::size_t size) : data_{data}, size_{size} {}
+
+        uint8_t* data_ = nullptr;
+        std::size_t size_ = 0;
+};
+
+/*
+Reads one book's depth and trades from a region published by SharedMarketDataPublisher.
+
+Never blocks or writes to the region, so it cannot slow the engine down; each
+reader (thread or process) needs its own instance.
+*/
+class SharedMarketDataReader {
+    public:
+        //Maps region 'name'. Throws std::runtime_error if it does not exist or is not a
+        //market-data region. Trades published before this point are skipped.
+        explicit SharedMarketDataReader(const std::string& name);
+
+        InstrumentId instrument() const { return header_->instrument; }
+        uint32_t depthLevels() const { return header_->depthLevels; }
+
+        //Copies the latest depth into 'out', retrying while the writer is mid-update
+        void readDepth(SharedDepth& out) const {
+            for (;;) {
+                uint64_t before = depth_->sequence.load(std::memory_order_acquire);
+                if (before & 1) {
+                    pause();
+                    continue;
+                }
+                out.bidCount = depth_->bidCount;
+                out.askCount = depth_->askCount;
+                if (out.bidCount > kMaxSharedDepth || out.askCount > kMaxSharedDepth) {
+                    pause();
+                    continue;   //Torn counts: the sequence check below would fail anyway
+                }
+                std::memcpy(out.bids, depth_->bids, out.bidCount * sizeof(DepthLevel));
+                std::memcpy(out.asks, depth_->asks, out.askCount * sizeof(DepthLevel));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (depth_->sequence.load(std::memory_order_relaxed) == before) {
+                    out.version = before / 2;
+                    return;
+                }
+            }
+        }
+
+        //Hands every trade published since the last call to fn(const Trade&), oldest first,
+        //and returns how many there were. Trades overwritten before this reader got to them
+        //are skipped and counted in missedTrades().
+        template <typename Fn>
+        std::size_t pollTrades(Fn&& fn) {
+            uint64_t published = cursor_->published.load(std::memory_order_acquire);
+            std::size_t delivered = 0;
+            while (next_ <= published) {
+                //Lapped: jump to the oldest trade still in the ring
+                if (published - next_ >= header_->tradeCapacity) {
+                    uint64_t oldest = published - header_->tradeCapacity + 1;
+                    missed_ += oldest - next_;
+                    next_ = oldest;
+                }
+                const ShmTradeSlot& slot = slots_[next_ & mask_];
+                Trade trade;
+                if (!readSlot(slot, next_, trade)) {
+                    //Overwritten while we looked, so the writer is a whole ring ahead: this
+                    //trade is gone, and the lap check above deals with the rest
+                    ++missed_;
+                    ++next_;
+                    published = cursor_->published.load(std::memory_order_acquire);
+                    continue;
+                }
+                fn(static_cast<const Trade&>(trade));
+                ++next_;
+                ++delivered;
+            }
+            return delivered;
+        }
+
+        //Sequence number of the next trade this reader expects
+        uint64_t nextTrade() const { return next_; }
+
+        //Trades this reader lost to being overwritten
+        uint64_t missedTrades() const { return missed_; }
+
+    private:
+        static bool readSlot(const ShmTradeSlot& slot, uint64_t sequence, Trade& out) {
+            if (slot.sequence.load(std::memory_order_acquire) != sequence)
+                return false;
+            std::memcpy(&out, &slot.trade, sizeof(Trade));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return slot.sequence.load(std::memory_order_relaxed) == sequence;
+        }
+
+        static void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+
+        SharedRegion region_;
+        const ShmHeader* header_;
+        const ShmDepth* depth_;
+        const ShmTradeCursor* cursor_;
+        const ShmTradeSlot* slots_;
+        uint64_t mask_;
+        uint64_t next_;
+        uint64_t missed_ = 0;
+};
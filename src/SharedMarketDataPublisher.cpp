@@ -0,0 +1,58 @@
+#include "SharedMarketDataPublisher.h"
+
+#include "OrderBook.h"
+
+#include <new>
+#include <stdexcept>
+
+namespace {
+
+std::size_t roundUpToPowerOfTwo(std::size_t value) {
+    std::size_t power = 1;
+    while (power < value)
+        power <<= 1;
+    return power;
+}
+
+} // namespace
+
+SharedMarketDataPublisher::SharedMarketDataPublisher(const std::string& name, InstrumentId instrument, const SharedMarketDataConfig& config)
+    : name_{name},
+    region_{[&] {
+        if (config.depthLevels > kMaxSharedDepth)
+            throw std::invalid_argument("SharedMarketDataPublisher: depthLevels above kMaxSharedDepth");
+        return SharedRegion::create(name, SharedLayout::size(roundUpToPowerOfTwo(config.tradeCapacity)));
+    }()} {
+    uint8_t* base = region_.data();
+    header_ = reinterpret_cast<ShmHeader*>(base);
+    depth_ = new (base + SharedLayout::kDepth) ShmDepth{};
+    cursor_ = new (base + SharedLayout::kCursor) ShmTradeCursor{};
+    std::size_t capacity = roundUpToPowerOfTwo(config.tradeCapacity);
+    slots_ = reinterpret_cast<ShmTradeSlot*>(base + SharedLayout::kSlots);
+    for (std::size_t i = 0; i < capacity; ++i)
+        new (&slots_[i]) ShmTradeSlot{};
+    mask_ = capacity - 1;
+
+    header_->instrument = instrument;
+    header_->depthLevels = static_cast<uint32_t>(config.depthLevels);
+    header_->tradeCapacity = capacity;
+    //The magic goes in last: a reader that sees it sees a fully initialised region
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = kSharedMarketDataMagic;
+}
+
+SharedMarketDataPublisher::~SharedMarketDataPublisher() {
+    SharedRegion::unlink(name_);
+}
+
+void SharedMarketDataPublisher::publishDepth(const OrderBook& book) {
+    uint64_t sequence = depth_->sequence.load(std::memory_order_relaxed);
+    depth_->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    //getDepth writes the levels straight into the shared snapshot
+    depth_->bidCount = static_cast<uint32_t>(book.getDepth(OrderSide::BUY, header_->depthLevels, depth_->bids));
+    depth_->askCount = static_cast<uint32_t>(book.getDepth(OrderSide::SELL, header_->depthLevels, depth_->asks));
+
+    depth_->sequence.store(sequence + 2, std::memory_order_release);
+}
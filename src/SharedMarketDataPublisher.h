@@ -0,0 +1,67 @@
+#pragma once
+
+#include "SharedMarketData.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class OrderBook;
+
+struct SharedMarketDataConfig {
+    //Levels per side in the depth snapshot, at most kMaxSharedDepth
+    std::size_t depthLevels = 10;
+
+    //Trades the ring holds before a slow reader starts missing them. Rounded up to a power of two.
+    std::size_t tradeCapacity = 1 << 16;
+};
+
+/*
+Publishes one book's top-N depth and its trades into a shared-memory region
+(layout in SharedMarketData.h) for readers in other processes.
+
+Call it from the thread that drives the book: publishTrade() from the book's
+trade sink, publishDepth() after each command or batch. Neither waits for or
+even knows about readers: a depth update is a seqlock write of N levels a side,
+a trade is one slot write and two release stores.
+
+The region is created on construction and unlinked on destruction.
+*/
+class SharedMarketDataPublisher {
+    public:
+        //Throws std::runtime_error if the region cannot be created, std::invalid_argument
+        //if depthLevels is above kMaxSharedDepth
+        SharedMarketDataPublisher(const std::string& name, InstrumentId instrument, const SharedMarketDataConfig& config = SharedMarketDataConfig{});
+        ~SharedMarketDataPublisher();
+
+        SharedMarketDataPublisher(const SharedMarketDataPublisher&) = delete;
+        SharedMarketDataPublisher& operator=(const SharedMarketDataPublisher&) = delete;
+
+        //Writes the book's current top levels. Costs O(depthLevels), never walks orders.
+        void publishDepth(const OrderBook& book);
+
+        void publishTrade(const Trade& trade) {
+            uint64_t sequence = ++tradesPublished_;
+            ShmTradeSlot& slot = slots_[sequence & mask_];
+            //Invalidate the slot first, so a reader of the trade being replaced cannot
+            //mistake a half-written slot for it
+            slot.sequence.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.trade = trade;
+            slot.sequence.store(sequence, std::memory_order_release);
+            cursor_->published.store(sequence, std::memory_order_release);
+        }
+
+        uint64_t tradesPublished() const { return tradesPublished_; }
+        const std::string& name() const { return name_; }
+
+    private:
+        std::string name_;
+        SharedRegion region_;
+        ShmHeader* header_;
+        ShmDepth* depth_;
+        ShmTradeCursor* cursor_;
+        ShmTradeSlot* slots_;
+        uint64_t mask_;
+        uint64_t tradesPublished_ = 0;
+};
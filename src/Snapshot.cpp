@@ -0,0 +1,177 @@
+#include "Snapshot.h"
+
+#include "Journal.h"
+#include "OrderBook.h"
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <type_traits>
+
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t kSnapshotMagic = 0x34304E5041534741ull; //"AGSNAP04": 32-byte orders with owners, then stops, and the phase
+
+struct SnapshotHeader {
+    uint64_t magic;
+    uint64_t journalSequence;
+    uint64_t nextTradeId;
+    uint64_t phase;         //TradingPhase
+    uint64_t orderCount;
+    uint64_t stopCount;
+    uint64_t checksum;      //Of the order and stop records
+};
+
+static_assert(std::is_trivially_copyable<Order>::value, "Orders are written as raw records");
+static_assert(std::is_trivially_copyable<StopOrder>::value && sizeof(StopOrder) == 40, "Stops are written as raw records");
+
+//Word-at-a-time multiplicative hash: cheap enough to run over millions of orders
+template <typename Record>
+uint64_t checksum(const std::vector<Record>& records, uint64_t hash = 0xCBF29CE484222325ull) {
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(records.data());
+    std::size_t count = records.size() * sizeof(Record) / sizeof(uint64_t);
+    for (std::size_t i = 0; i < count; ++i)
+        hash = (hash ^ words[i]) * 0x100000001B3ull;
+    return hash;
+}
+
+uint64_t checksum(const BookSnapshot& snapshot) {
+    return checksum(snapshot.stops, checksum(snapshot.orders));
+}
+
+//True if the record counts in 'header' describe exactly the bytes left in 'file' after it.
+//Checked before sizing any buffer, so a corrupt count cannot ask for terabytes.
+bool countsMatchFile(std::FILE* file, const SnapshotHeader& header) {
+    long here = std::ftell(file);
+    if (here < 0 || std::fseek(file, 0, SEEK_END) != 0)
+        return false;
+    long end = std::ftell(file);
+    if (end < here || std::fseek(file, here, SEEK_SET) != 0)
+        return false;
+    uint64_t remaining = static_cast<uint64_t>(end - here);
+    if (header.orderCount > remaining / sizeof(Order))
+        return false;
+    remaining -= header.orderCount * sizeof(Order);
+    return header.stopCount <= remaining / sizeof(StopOrder) && header.stopCount * sizeof(StopOrder) == remaining;
+}
+
+} // namespace
+
+void writeSnapshot(const std::string& path, const BookSnapshot& snapshot) {
+    std::string tmpPath = path + ".tmp";
+    std::FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (file == nullptr)
+        throw std::runtime_error("Snapshot: cannot open " + tmpPath);
+
+    SnapshotHeader header{kSnapshotMagic, snapshot.journalSequence, snapshot.nextTradeId,
+        static_cast<uint64_t>(snapshot.phase), snapshot.orders.size(), snapshot.stops.size(), checksum(snapshot)};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(snapshot.orders.data(), sizeof(Order), snapshot.orders.size(), file) == snapshot.orders.size()
+        && std::fwrite(snapshot.stops.data(), sizeof(StopOrder), snapshot.stops.size(), file) == snapshot.stops.size()
+        && std::fflush(file) == 0
+        && ::fsync(::fileno(file)) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("Snapshot: cannot write " + path);
+    }
+}
+
+BookSnapshot readSnapshot(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        throw std::runtime_error("Snapshot: cannot open " + path);
+
+    BookSnapshot snapshot;
+    SnapshotHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == kSnapshotMagic
+        && header.phase <= static_cast<uint64_t>(TradingPhase::Auction) && countsMatchFile(file, header);
+    if (ok) {
+        snapshot.journalSequence = header.journalSequence;
+        snapshot.nextTradeId = header.nextTradeId;
+        snapshot.phase = static_cast<TradingPhase>(header.phase);
+        snapshot.orders.resize(header.orderCount);
+        snapshot.stops.resize(header.stopCount);
+        ok = std::fread(snapshot.orders.data(), sizeof(Order), snapshot.orders.size(), file) == snapshot.orders.size()
+            && std::fread(snapshot.stops.data(), sizeof(StopOrder), snapshot.stops.size(), file) == snapshot.stops.size()
+            && checksum(snapshot) == header.checksum;
+    }
+    std::fclose(file);
+    if (!ok)
+        throw std::runtime_error("Snapshot: corrupt snapshot " + path);
+    return snapshot;
+}
+
+Snapshotter::~Snapshotter() {
+    if (writing_.valid())
+        writing_.wait();
+}
+
+bool Snapshotter::busy() const {
+    return writing_.valid() && writing_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+void Snapshotter::wait() {
+    if (writing_.valid())
+        writing_.get();
+}
+
+bool Snapshotter::takeSnapshot(const OrderBook& book, uint64_t journalSequence) {
+    if (busy())
+        return false;
+    //Surfaces the previous write's error, if it had one; its buffer is free again
+    wait();
+
+    book.captureSnapshot(snapshot_);
+    snapshot_.journalSequence = journalSequence;
+    writing_ = std::async(std::launch::async, [this] { writeSnapshot(path_, snapshot_); });
+    return true;
+}
+
+RecoveryStats recoverBook(OrderBook& book, const std::string& snapshotPath, const std::string& journalPath) {
+    RecoveryStats stats;
+    if (std::FILE* probe = std::fopen(snapshotPath.c_str(), "rb")) {
+        std::fclose(probe);
+        BookSnapshot snapshot = readSnapshot(snapshotPath);
+        book.restoreSnapshot(snapshot);
+        stats.snapshotOrders = snapshot.orders.size();
+        stats.lastSequence = snapshot.journalSequence;
+    }
+
+    auto noTrades = [](const Trade&) {};
+    stats.replayedCommands = Journal::replay(journalPath, stats.lastSequence, [&](const JournalRecord& record) {
+        //The book throws before changing anything, so a refused command is only counted
+        try {
+            if (record.command == JournalCommand::NewOrder || record.command == JournalCommand::NewStop) {
+                Order order(record.orderId, record.side, record.quantity, record.price, record.type);
+                order.flags = record.flags;
+                order.owner = record.owner;
+                order.selfTrade = record.selfTrade;
+                if (record.command == JournalCommand::NewStop)
+                    book.placeStop(order, record.triggerPrice);
+                else
+                    book.processOrder(order, noTrades);
+            } else if (record.command == JournalCommand::Modify) {
+                book.modifyOrder(record.orderId, record.price, record.quantity, noTrades);
+            } else if (record.command == JournalCommand::CancelAllForOwner) {
+                book.cancelAllForOwner(record.owner);
+            } else if (record.command == JournalCommand::StartAuction) {
+                book.startAuction();
+            } else if (record.command == JournalCommand::UncrossAuction) {
+                book.uncrossAuction(record.price, noTrades);
+            } else {
+                book.cancelOrder(record.orderId);
+            }
+        } catch (const std::invalid_argument&) {
+            ++stats.refusedCommands;
+        } catch (const std::out_of_range&) {
+            ++stats.refusedCommands;
+        } catch (const std::length_error&) {
+            ++stats.refusedCommands;
+        }
+        stats.lastSequence = record.sequence;
+    });
+    return stats;
+}
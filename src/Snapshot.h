@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Auction.h"
+#include "Order.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+class OrderBook;
+
+//Everything needed to rebuild an OrderBook's resting state
+struct BookSnapshot {
+    //Last journal command reflected in this snapshot; recovery replays from the next one
+    uint64_t journalSequence = 0;
+
+    //The book's next trade ID, so replayed trades get the same IDs they had originally
+    uint64_t nextTradeId = 1;
+
+    //Taken mid-auction, the orders may cross: the restored book resumes the auction
+    TradingPhase phase = TradingPhase::Continuous;
+
+    //Resting orders in priority order: asks from LOWEST to HIGHEST price, then bids from
+    //HIGHEST to LOWEST, oldest first within a level. Quantities are what is left to fill.
+    std::vector<Order> orders;
+
+    //Pending stops: buys then sells, each by trigger price from LOWEST, oldest first
+    std::vector<StopOrder> stops;
+};
+
+/*
+On-disk snapshot format: a fixed header followed by the orders as a plain array
+of Order records, then the stops as StopOrder records, so writing and loading are
+one bulk fwrite/fread per array.
+
+Snapshots are written to '<path>.tmp', fsynced and renamed over 'path', so a crash
+mid-write always leaves the previous snapshot intact.
+*/
+void writeSnapshot(const std::string& path, const BookSnapshot& snapshot);
+
+//Throws std::runtime_error if the file is missing, truncated or fails its checksum
+BookSnapshot readSnapshot(const std::string& path);
+
+/*
+Takes snapshots of a live book without holding up matching for the write.
+
+takeSnapshot() copies the resting orders on the caller's (matching) thread - a
+linear walk of the book into a reused buffer - then serialises and fsyncs the
+copy on a background thread while matching carries on.
+*/
+class Snapshotter {
+    public:
+        explicit Snapshotter(std::string path) : path_{std::move(path)} {}
+
+        //Waits for an in-flight write
+        ~Snapshotter();
+
+        Snapshotter(const Snapshotter&) = delete;
+        Snapshotter& operator=(const Snapshotter&) = delete;
+
+        //Returns false, capturing nothing, if the previous snapshot is still being written
+        bool takeSnapshot(const OrderBook& book, uint64_t journalSequence);
+
+        //True while a snapshot is being written
+        bool busy() const;
+
+        //Blocks until the in-flight write (if any) finishes. Rethrows its error, if it had one.
+        void wait();
+
+    private:
+        std::string path_;
+        BookSnapshot snapshot_;
+        std::future<void> writing_;
+};
+
+struct RecoveryStats {
+    std::size_t snapshotOrders = 0;     //Orders loaded from the snapshot
+    std::size_t replayedCommands = 0;   //Journal commands replayed on top of it
+    std::size_t refusedCommands = 0;    //Of those, commands the book refused by throwing (as it did live)
+    uint64_t lastSequence = 0;          //Last journal sequence now reflected in the book
+};
+
+/*
+Rebuilds an empty 'book' from the latest snapshot plus the journal tail after it.
+Either file may be missing: no snapshot means replay the whole journal.
+
+Commands are journaled before they are applied, so the journal also holds commands the
+live book refused (a reserved order ID, a price outside the ladder window, a full pool).
+Replay refuses them the same way and counts them instead of giving up. Any other
+exception, such as bad_alloc part way through a command, ends recovery. Throws std::runtime_error if the
+journal does not continue exactly where the snapshot ends (see Journal::replay).
+*/
+RecoveryStats recoverBook(OrderBook& book, const std::string& snapshotPath, const std::string& journalPath);
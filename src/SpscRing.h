@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*
+Bounded, lock-free, single-producer/single-consumer ring buffer.
+
+Each side owns one index and keeps a cached copy of the other side's index, so
+the common case of tryPush/tryPop touches no cache line written by the other
+thread. Both indices sit on their own cache line to avoid false sharing.
+*/
+template <typename T>
+class SpscRing {
+    public:
+        explicit SpscRing(std::size_t capacity)
+            : slots_(roundUp(capacity)), mask_{slots_.size() - 1} {}
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        std::size_t capacity() const { return slots_.size(); }
+
+        //Producer only. Returns false (and drops nothing) if the ring is full.
+        bool tryPush(const T& value) {
+            std::size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - headCache_ == slots_.size()) {
+                headCache_ = head_.load(std::memory_order_acquire);
+                if (tail - headCache_ == slots_.size())
+                    return false;
+            }
+            slots_[tail & mask_] = value;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        //Consumer only. Returns false if the ring is empty.
+        bool tryPop(T& value) {
+            std::size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tailCache_) {
+                tailCache_ = tail_.load(std::memory_order_acquire);
+                if (head == tailCache_)
+                    return false;
+            }
+            value = slots_[head & mask_];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        //Consumer only. Pops up to 'max' values into 'out' and returns how many.
+        std::size_t popBatch(T* out, std::size_t max) {
+            std::size_t head = head_.load(std::memory_order_relaxed);
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            std::size_t count = tailCache_ - head;
+            if (count > max)
+                count = max;
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] = slots_[(head + i) & mask_];
+            head_.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        //Approximate when called from a thread that is neither side
+        bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+    private:
+        static std::size_t roundUp(std::size_t n) {
+            std::size_t size = 2;
+            while (size < n)
+                size <<= 1;
+            return size;
+        }
+
+        std::vector<T> slots_;
+        std::size_t mask_;
+
+        //Producer side
+        alignas(64) std::atomic<std::size_t> tail_{0};
+        std::size_t headCache_ = 0;
+
+        //Consumer side
+        alignas(64) std::atomic<std::size_t> head_{0};
+        std::size_t tailCache_ = 0;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+A hierarchical bitset with one bit per price tick.
+
+Layer 0 holds one bit per tick. Every layer above holds one bit per 64-bit word
+of the layer below, set when that word is non-zero. The top layer is always a
+single word, so finding the lowest/highest occupied tick is one count-zeros per
+layer (3 layers cover 262,144 ticks) no matter how sparse the ladder is.
+*/
+class TickBitmap {
+    public:
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        explicit TickBitmap(std::size_t bits = 0) { resize(bits); }
+
+        //Clears every bit and resizes the bitset to hold 'bits' ticks
+        void resize(std::size_t bits) {
+            bits_ = bits;
+            layers_.clear();
+            std::size_t words = wordsFor(bits);
+            do {
+                layers_.emplace_back(words, 0);
+                words = wordsFor(words);
+            } while (layers_.back().size() > 1);
+        }
+
+        std::size_t bits() const { return bits_; }
+
+        bool empty() const { return layers_.back()[0] == 0; }
+
+        bool test(std::size_t i) const { return (layers_[0][i >> 6] >> (i & 63)) & 1; }
+
+        void set(std::size_t i) {
+            for (auto& layer : layers_) {
+                uint64_t& word = layer[i >> 6];
+                uint64_t bit = uint64_t{1} << (i & 63);
+                //Parent bits are already set if this word was non-zero
+                bool wasEmpty = word == 0;
+                word |= bit;
+                if (!wasEmpty)
+                    return;
+                i >>= 6;
+            }
+        }
+
+        void reset(std::size_t i) {
+            for (auto& layer : layers_) {
+                uint64_t& word = layer[i >> 6];
+                word &= ~(uint64_t{1} << (i & 63));
+                //Only propagate upwards once a whole word has drained
+                if (word != 0)
+                    return;
+                i >>= 6;
+            }
+        }
+
+        //Index of the lowest set bit, or npos
+        std::size_t findFirst() const {
+            if (empty())
+                return npos;
+            std::size_t i = 0;
+            for (std::size_t l = layers_.size(); l-- > 0;)
+                i = (i << 6) | lowBit(layers_[l][i]);
+            return i;
+        }
+
+        //Index of the highest set bit, or npos
+        std::size_t findLast() const {
+            if (empty())
+                return npos;
+            std::size_t i = 0;
+            for (std::size_t l = layers_.size(); l-- > 0;)
+                i = (i << 6) | highBit(layers_[l][i]);
+            return i;
+        }
+
+        //Index of the lowest set bit strictly above 'i', or npos
+        std::size_t findNext(std::size_t i) const {
+            //Climb until a word has a set bit to the right of our position
+            std::size_t l = 0;
+            for (;; ++l) {
+                if (l == layers_.size())
+                    return npos;
+                std::size_t shift = (i & 63) + 1;
+                uint64_t word = shift == 64 ? 0 : layers_[l][i >> 6] >> shift << shift;
+                if (word != 0) {
+                    i = (i & ~std::size_t{63}) | lowBit(word);
+                    break;
+                }
+                i >>= 6;
+            }
+            //Then descend, always taking the lowest child
+            while (l-- > 0)
+                i = (i << 6) | lowBit(layers_[l][i]);
+            return i;
+        }
+
+        //Index of the highest set bit strictly below 'i', or npos
+        std::size_t findPrev(std::size_t i) const {
+            std::size_t l = 0;
+            for (;; ++l) {
+                if (l == layers_.size())
+                    return npos;
+                std::size_t keep = i & 63;
+                uint64_t word = keep == 0 ? 0 : layers_[l][i >> 6] & ((uint64_t{1} << keep) - 1);
+                if (word != 0) {
+                    i = (i & ~std::size_t{63}) | highBit(word);
+                    break;
+                }
+                i >>= 6;
+            }
+            while (l-- > 0)
+                i = (i << 6) | highBit(layers_[l][i]);
+            return i;
+        }
+
+    private:
+        static std::size_t wordsFor(std::size_t bits) { return bits == 0 ? 1 : (bits + 63) / 64; }
+        static std::size_t lowBit(uint64_t word) { return static_cast<std::size_t>(__builtin_ctzll(word)); }
+        static std::size_t highBit(uint64_t word) { return 63 - static_cast<std::size_t>(__builtin_clzll(word)); }
+
+        std::size_t bits_ = 0;
+
+        //layers_[0] is the leaf layer; layers_.back() is always a single word
+        std::vector<std::vector<uint64_t>> layers_;
+};
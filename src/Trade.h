@@ -1,20 +1,33 @@
 #pragma once
+#include "Order.h"
+
 #include <cstdint>
 
 struct Trade {
-    // A simple static counter for unique trade IDs
-    inline static uint64_t nextTradeId = 1;
-
+    // Unique per book: each OrderBook numbers its trades 1, 2, 3, ...
     uint64_t tradeId;
     uint64_t buyOrderId;
     uint64_t sellOrderId;
-    double price;
+    Price price;
     uint32_t quantity;
 
-    Trade(uint64_t bId, uint64_t sId, double p, uint32_t q)
-        : tradeId{++nextTradeId}, 
+    Trade() = default;
+
+    Trade(uint64_t id, uint64_t bId, uint64_t sId, Price p, uint32_t q)
+        : tradeId{id}, 
         buyOrderId{bId}, 
         sellOrderId{sId},
         price{p},
         quantity{q} {}
-};
\ No newline at end of file
+};
+
+//Self-trade prevention taking quantity off an order without a trade (see SelfTradePrevention).
+//Handed to a processOrder/modifyOrder sink that also takes sink(const SelfTradeAction&);
+//sinks that only take trades never see it. Both orders of a self-trade have the same owner.
+struct SelfTradeAction {
+    uint64_t orderId;
+    OwnerId owner;
+    uint32_t removed;
+    uint32_t remaining;     //What the order has left; 0 if it is gone
+    bool resting;           //The resting order (CancelOldest, DecrementBoth) or the incoming one (DecrementBoth)
+};
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include "../src/OrderBook.h"
+#include "../src/PrefixSum.h"
+
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+// Test that the dispatched prefix sum (AVX2 where the CPU has it) matches the scalar loop at every tail length.
+TEST(PrefixSumTest, MatchesScalar) {
+    std::mt19937_64 rng(7);
+    for (std::size_t count = 0; count < 40; ++count) {
+        std::vector<uint64_t> data(count);
+        for (uint64_t& value : data)
+            value = rng() % 100000;
+        std::vector<uint64_t> expected = data;
+        prefixSumScalar(expected.data(), count);
+        prefixSum(data.data(), count);
+        EXPECT_EQ(data, expected) << "count " << count;
+    }
+}
+
+// Test the tie-break rules on hand-built curves over ticks 100..102.
+TEST(AuctionCurvesTest, TieBreaks) {
+    auto equilibrium = [](uint64_t bidAt102, uint64_t askAt100, Price reference) {
+        AuctionCurves curves;
+        curves.reset(100, 102);
+        curves.bids()[0] = bidAt102;
+        curves.asks()[0] = askAt100;
+        curves.accumulate();
+        return curves.equilibrium(reference);
+    };
+
+    // Balanced at every price: the reference price decides, clamped to the range.
+    EXPECT_EQ(equilibrium(10, 10, 101).price, 101);
+    EXPECT_EQ(equilibrium(10, 10, 50).price, 100);
+    EXPECT_EQ(equilibrium(10, 10, 500).price, 102);
+
+    // A buy surplus everywhere pushes the price up, a sell surplus down.
+    AuctionResult buySurplus = equilibrium(15, 10, 100);
+    EXPECT_EQ(buySurplus.price, 102);
+    EXPECT_EQ(buySurplus.volume, 10);
+    EXPECT_EQ(buySurplus.imbalance, 5);
+    AuctionResult sellSurplus = equilibrium(10, 15, 102);
+    EXPECT_EQ(sellSurplus.price, 100);
+    EXPECT_EQ(sellSurplus.imbalance, -5);
+}
+
+// Test that orders accumulate crossed during the auction and the uncross fills them at one price.
+TEST(AuctionTest, AccumulatesThenUncrosses) {
+    OrderBook orderBook;
+    orderBook.startAuction();
+    EXPECT_EQ(orderBook.phase(), TradingPhase::Auction);
+
+    EXPECT_TRUE(orderBook.processOrder(Order(1, OrderSide::BUY, 10, 1005)).empty());
+    EXPECT_TRUE(orderBook.processOrder(Order(2, OrderSide::BUY, 10, 1002)).empty());
+    EXPECT_TRUE(orderBook.processOrder(Order(3, OrderSide::SELL, 5, 998)).empty());
+    EXPECT_TRUE(orderBook.processOrder(Order(4, OrderSide::SELL, 10, 1001)).empty());
+    EXPECT_TRUE(orderBook.processOrder(Order(5, OrderSide::SELL, 10, 1004)).empty());
+
+    // Types that only ever match on arrival are cancelled; amends re-queue without matching.
+    EXPECT_EQ(orderBook.processOrder(Order(6, OrderSide::BUY, 7, 0, OrderType::Market), [](const Trade&) {}), 7);
+    EXPECT_TRUE(orderBook.modifyOrder(5, 1003, 10));
+    EXPECT_EQ(orderBook.getBids().at(1005).front().orderId, 1);
+    EXPECT_EQ(orderBook.getAsks().at(998).front().orderId, 3);
+
+    // Demand 20 down to 1002, supply 15 from 1001 and 25 from 1003: 1002 executes 15.
+    AuctionResult indicative = orderBook.indicativeAuction(1000);
+    EXPECT_EQ(indicative.price, 1002);
+    EXPECT_EQ(indicative.volume, 15);
+    EXPECT_EQ(indicative.imbalance, 5);
+
+    std::vector<Trade> trades;
+    AuctionResult result = orderBook.uncrossAuction(1000, trades);
+    EXPECT_EQ(result.price, 1002);
+    EXPECT_EQ(result.volume, 15);
+    EXPECT_EQ(result.trades, trades.size());
+    EXPECT_EQ(orderBook.phase(), TradingPhase::Continuous);
+
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].buyOrderId, 1);
+    EXPECT_EQ(trades[0].sellOrderId, 3);
+    EXPECT_EQ(trades[0].quantity, 5);
+    EXPECT_EQ(trades[1].buyOrderId, 1);
+    EXPECT_EQ(trades[1].sellOrderId, 4);
+    EXPECT_EQ(trades[2].buyOrderId, 2);
+    EXPECT_EQ(trades[2].sellOrderId, 4);
+    for (const Trade& trade : trades)
+        EXPECT_EQ(trade.price, 1002);
+
+    // What is left is uncrossed, and matching is continuous again.
+    EXPECT_EQ(orderBook.findOrder(2)->quantity, 5);
+    EXPECT_EQ(orderBook.findOrder(4), nullptr);
+    EXPECT_EQ(orderBook.getAsks().at(1003).front().orderId, 5);
+    EXPECT_EQ(orderBook.processOrder(Order(7, OrderSide::SELL, 5, 1002)).size(), 1);
+}
+
+// Test that the uncross matches a brute-force search over random books.
+TEST(AuctionTest, MatchesBruteForce) {
+    std::mt19937_64 rng(11);
+    for (int round = 0; round < 200; ++round) {
+        OrderBook orderBook(OrderBookConfig{64, 256});
+        std::map<Price, uint64_t> bids;
+        std::map<Price, uint64_t> asks;
+        orderBook.startAuction();
+        for (uint64_t id = 1; id <= 60; ++id) {
+            OrderSide side = rng() % 2 == 0 ? OrderSide::BUY : OrderSide::SELL;
+            Price price = 990 + static_cast<Price>(rng() % 21);
+            uint32_t quantity = 1 + static_cast<uint32_t>(rng() % 50);
+            orderBook.processOrder(Order(id, side, quantity, price));
+            (side == OrderSide::BUY ? bids : asks)[price] += quantity;
+        }
+
+        // Every price from 980 to 1020, by the rules in full
+        Price reference = 990 + static_cast<Price>(rng() % 21);
+        uint64_t bestVolume = 0;
+        uint64_t bestSurplus = 0;
+        std::vector<std::pair<Price, int64_t>> candidates;
+        for (Price price = 980; price <= 1020; ++price) {
+            uint64_t demand = 0;
+            uint64_t supply = 0;
+            for (const auto& [level, quantity] : bids)
+                demand += level >= price ? quantity : 0;
+            for (const auto& [level, quantity] : asks)
+                supply += level <= price ? quantity : 0;
+            uint64_t volume = std::min(demand, supply);
+            int64_t imbalance = static_cast<int64_t>(demand) - static_cast<int64_t>(supply);
+            uint64_t surplus = static_cast<uint64_t>(std::abs(imbalance));
+            if (volume == 0)
+                continue;
+            if (volume > bestVolume || (volume == bestVolume && surplus < bestSurplus)) {
+                bestVolume = volume;
+                bestSurplus = surplus;
+                candidates.clear();
+            }
+            if (volume == bestVolume && surplus == bestSurplus)
+                candidates.emplace_back(price, imbalance);
+        }
+
+        std::vector<Trade> trades;
+        AuctionResult result = orderBook.uncrossAuction(reference, trades);
+        ASSERT_EQ(result.volume, bestVolume) << "round " << round;
+        if (bestVolume == 0)
+            continue;
+
+        bool allBuy = true;
+        bool allSell = true;
+        Price nearest = candidates.front().first;
+        for (const auto& [price, imbalance] : candidates) {
+            allBuy &= imbalance > 0;
+            allSell &= imbalance < 0;
+            if (std::abs(price - reference) < std::abs(nearest - reference))
+                nearest = price;
+        }
+        Price expected = allBuy ? candidates.back().first : allSell ? candidates.front().first : nearest;
+        EXPECT_EQ(result.price, expected) << "round " << round;
+
+        uint64_t traded = 0;
+        for (const Trade& trade : trades) {
+            EXPECT_EQ(trade.price, result.price);
+            traded += trade.quantity;
+        }
+        EXPECT_EQ(traded, bestVolume);
+        EXPECT_TRUE(orderBook.getBids().empty() || orderBook.getAsks().empty()
+                    || (*orderBook.getBids().begin()).first < (*orderBook.getAsks().begin()).first) << "round " << round;
+    }
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "../src/MatchingEngine.h"
+#include "../src/OrderBook.h"
+
+#include <chrono>
+#include <thread>
+
+// Test that the book counts what happens on the matching path.
+TEST(BookStatsTest, BookCountsOrdersFillsLevelsAndCancels) {
+    if (!AGORA_BOOK_STATS)
+        GTEST_SKIP() << "built without AGORA_BOOK_STATS";
+
+    OrderBook orderBook;
+    orderBook.processOrder(Order(1, OrderSide::SELL, 50, 1001));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 50, 1002));
+    orderBook.processOrder(Order(3, OrderSide::SELL, 50, 1002));
+    // Walks two levels: empties 1001 and takes 20 from the front of 1002.
+    orderBook.processOrder(Order(4, OrderSide::BUY, 70, 1002));
+    orderBook.cancelOrder(3);
+    orderBook.cancelOrder(42);
+    orderBook.modifyOrder(2, 1002, 10);
+    orderBook.modifyOrder(43, 1002, 10);
+    // IOC with nothing left to take is cancelled outright.
+    orderBook.processOrder(Order(5, OrderSide::BUY, 100, 1001, OrderType::ImmediateOrCancel));
+
+    BookStats stats;
+    orderBook.collectStats(stats);
+    const BookCounters& counters = stats.counters;
+    EXPECT_EQ(counters.ordersReceived, 5u);
+    EXPECT_EQ(counters.ordersRested, 3u);
+    EXPECT_EQ(counters.ordersCancelled, 1u);
+    EXPECT_EQ(counters.fills, 2u);
+    EXPECT_EQ(counters.filledQuantity, 70u);
+    EXPECT_EQ(counters.levelsCreated, 2u);
+    EXPECT_EQ(counters.levelsDestroyed, 1u);
+    EXPECT_EQ(counters.cancelHits, 1u);
+    EXPECT_EQ(counters.cancelMisses, 1u);
+    EXPECT_EQ(counters.modifyHits, 1u);
+    EXPECT_EQ(counters.modifyMisses, 1u);
+    EXPECT_EQ(counters.aggressiveOrders, 1u);
+    EXPECT_EQ(counters.levelsWalked, 2u);
+    EXPECT_EQ(stats.levelsWalkedPerOrder.max(), 2u);
+    EXPECT_EQ(stats.processOrderCycles.count(), 5u);
+    EXPECT_EQ(stats.cancelOrderCycles.count(), 2u);
+    EXPECT_EQ(stats.modifyOrderCycles.count(), 1u);
+
+    // Collecting twice sums; reset starts over.
+    orderBook.collectStats(stats);
+    EXPECT_EQ(stats.counters.ordersReceived, 10u);
+    orderBook.resetStats();
+    BookStats fresh;
+    orderBook.collectStats(fresh);
+    EXPECT_EQ(fresh.counters.ordersReceived, 0u);
+    EXPECT_EQ(fresh.processOrderCycles.count(), 0u);
+}
+
+// Test that the engine aggregates every shard's books while it is running.
+TEST(BookStatsTest, EngineScrapesShardsWhileRunning) {
+    EngineConfig config;
+    config.shards = 2;
+    MatchingEngine engine(config);
+    engine.addInstrument(1);
+    engine.addInstrument(2);
+    engine.start();
+
+    for (InstrumentId instrument : {1u, 2u}) {
+        engine.submit(EngineCommand::newOrder(instrument, Order(1, OrderSide::SELL, 10, 1000)));
+        engine.submit(EngineCommand::newOrder(instrument, Order(2, OrderSide::BUY, 10, 1000)));
+        engine.submit(EngineCommand::cancel(instrument, 1));
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (engine.processedCount() < 6 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+
+    BookStats stats;
+    engine.collectStats(stats);
+    if (!AGORA_BOOK_STATS) {
+        EXPECT_EQ(stats.counters.ordersReceived, 0u);
+        return;
+    }
+    EXPECT_EQ(stats.counters.ordersReceived, 4u);
+    EXPECT_EQ(stats.counters.fills, 2u);
+    EXPECT_EQ(stats.counters.cancelMisses, 2u);
+
+    engine.stop();
+    BookStats stopped;
+    engine.collectStats(stopped);
+    EXPECT_EQ(stopped.counters.fills, 2u);
+}
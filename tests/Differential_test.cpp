@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include "../fuzz/Differential.h"
+
+#include <random>
+#include <vector>
+
+// Test that the book agrees with the reference on the plain benchmark flow (limit orders and cancels).
+TEST(DifferentialTest, LimitOrderFlowMatchesReference) {
+    for (uint64_t seed : {1, 2, 3}) {
+        FlowConfig config;
+        config.seed = seed;
+        differential::Report report = differential::compare(differential::generateCommands(config, 100'000));
+        EXPECT_TRUE(report.ok()) << "seed " << seed << ": " << report.mismatch;
+        EXPECT_GT(report.trades, 0u);
+    }
+}
+
+// Test that it also agrees once amends, every order type and (seed 9) self-trade prevention are mixed in.
+TEST(DifferentialTest, TypedOrdersAndAmendsMatchReference) {
+    for (uint64_t seed : {7, 8, 9}) {
+        FlowConfig config;
+        config.seed = seed;
+        config.cancelRatio = 0.4;
+        config.modifyRatio = 0.15;
+        config.typedRatio = 0.2;
+        config.marketableRatio = 0.15;
+        config.owners = seed == 9 ? 5 : 0;
+        differential::Report report = differential::compare(differential::generateCommands(config, 100'000));
+        EXPECT_TRUE(report.ok()) << "seed " << seed << ": " << report.mismatch;
+    }
+}
+
+// Test that stops and stop-limits, and the cascades they set off, match the reference.
+TEST(DifferentialTest, StopOrdersMatchReference) {
+    for (uint64_t seed : {11, 12}) {
+        FlowConfig config;
+        config.seed = seed;
+        config.cancelRatio = 0.3;
+        config.modifyRatio = 0.1;
+        config.marketableRatio = 0.15;
+        config.stopRatio = 0.1;
+        config.owners = seed == 12 ? 5 : 0;
+        differential::Report report = differential::compare(differential::generateCommands(config, 100'000));
+        EXPECT_TRUE(report.ok()) << "seed " << seed << ": " << report.mismatch;
+    }
+}
+
+// Test that the fuzzer's byte decoder yields streams both books agree on.
+TEST(DifferentialTest, DecodedRandomBytesMatchReference) {
+    std::mt19937_64 rng(123);
+    for (int round = 0; round < 20; ++round) {
+        std::vector<uint8_t> bytes(8 * 2000);
+        for (uint8_t& byte : bytes)
+            byte = static_cast<uint8_t>(rng());
+        differential::Report report = differential::compare(differential::decodeCommands(bytes.data(), bytes.size()));
+        EXPECT_TRUE(report.ok()) << "round " << round << ": " << report.mismatch;
+    }
+}
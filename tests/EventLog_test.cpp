@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include "../src/EventLog.h"
+#include "../src/OrderBook.h"
+#include "../src/SpscRing.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// Test FIFO order and the full/empty edges of the ring.
+TEST(SpscRingTest, FifoAndBounds) {
+    SpscRing<int> ring(4);
+    EXPECT_EQ(ring.capacity(), 4);
+
+    int value = 0;
+    EXPECT_FALSE(ring.tryPop(value));
+    for (int i = 1; i <= 4; ++i)
+        EXPECT_TRUE(ring.tryPush(i));
+    EXPECT_FALSE(ring.tryPush(5));
+
+    EXPECT_TRUE(ring.tryPop(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_TRUE(ring.tryPush(5));
+
+    int batch[8];
+    ASSERT_EQ(ring.popBatch(batch, 8), 4);
+    EXPECT_EQ(batch[0], 2);
+    EXPECT_EQ(batch[3], 5);
+    EXPECT_TRUE(ring.empty());
+}
+
+// Test that every value crosses from one thread to another exactly once and in order.
+TEST(SpscRingTest, CrossThreadTransfer) {
+    SpscRing<uint64_t> ring(64);
+    constexpr uint64_t kCount = 200000;
+
+    std::thread producer([&] {
+        for (uint64_t i = 1; i <= kCount; ++i)
+            while (!ring.tryPush(i))
+                std::this_thread::yield();
+    });
+
+    uint64_t expected = 1;
+    while (expected <= kCount) {
+        uint64_t value = 0;
+        if (ring.tryPop(value)) {
+            ASSERT_EQ(value, expected);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+// Test that the book journals accepts, trades, cancels and rejected cancels.
+TEST(EventLogTest, BookEventsAreJournaled) {
+    if (!AGORA_EVENT_LOG)
+        GTEST_SKIP() << "built without AGORA_EVENT_LOG";
+
+    std::string path = ::testing::TempDir() + "agora_event_log_test.bin";
+    {
+        EventLog log(path);
+        OrderBook orderBook;
+        orderBook.setEventLog(&log);
+
+        orderBook.processOrder(Order(1, OrderSide::SELL, 100, 1000));
+        orderBook.processOrder(Order(2, OrderSide::BUY, 40, 1000));
+        orderBook.cancelOrder(1);
+        orderBook.cancelOrder(1);
+
+        log.flush();
+        EXPECT_EQ(EventLog::readFile(path).size(), 5);
+        orderBook.setEventLog(nullptr);
+    }
+
+    std::vector<BookEvent> events = EventLog::readFile(path);
+    std::remove(path.c_str());
+
+    ASSERT_EQ(events.size(), 5);
+    EXPECT_EQ(events[0].type, BookEventType::OrderAccepted);
+    EXPECT_EQ(events[0].orderId, 1);
+    EXPECT_EQ(events[1].type, BookEventType::OrderAccepted);
+    EXPECT_EQ(events[2].type, BookEventType::Trade);
+    EXPECT_EQ(events[2].orderId, 2);
+    EXPECT_EQ(events[2].otherOrderId, 1);
+    EXPECT_EQ(events[2].quantity, 40);
+    EXPECT_EQ(events[3].type, BookEventType::OrderCancelled);
+    EXPECT_EQ(events[3].quantity, 60);
+    EXPECT_EQ(events[4].type, BookEventType::CancelRejected);
+    EXPECT_EQ(events[4].orderId, 1);
+
+    for (std::size_t i = 0; i < events.size(); ++i)
+        EXPECT_EQ(events[i].sequence, i + 1);
+}
+
+// Test that events the disk refuses are counted instead of vanishing.
+TEST(EventLogTest, CountsFailedWrites) {
+    std::FILE* probe = std::fopen("/dev/full", "wb");
+    if (probe == nullptr)
+        GTEST_SKIP() << "no /dev/full";
+    std::fclose(probe);
+
+    EventLog log("/dev/full");
+    for (uint64_t id = 1; id <= 10; ++id)
+        log.record(BookEventType::OrderAccepted, id, 0, OrderSide::BUY, 1000, 10);
+    log.flush();
+    EXPECT_EQ(log.dropped(), 0);
+    EXPECT_EQ(log.writeFailures(), 10);
+}
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include "../src/Gateway.h"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+//A blocking test client that gives up on reads after two seconds
+int connectTo(int family, const sockaddr* address, socklen_t length) {
+    int fd = ::socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    timeval timeout{2, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (::connect(fd, address, length) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int connectTcp(uint16_t port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return connectTo(AF_INET, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+}
+
+int connectUnix(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return connectTo(AF_UNIX, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+}
+
+void sendAll(int fd, const protocol::MessageWriter& writer) {
+    ASSERT_EQ(::send(fd, writer.data(), writer.size(), MSG_NOSIGNAL), static_cast<ssize_t>(writer.size()));
+}
+
+struct Reports {
+    std::vector<protocol::AckMessage> acks;
+    std::vector<protocol::TradeReportMessage> trades;
+    void onAck(const protocol::AckMessage& message) { acks.push_back(message); }
+    void onTrade(const protocol::TradeReportMessage& message) { trades.push_back(message); }
+};
+
+//Reads until 'acks' acks have arrived, the peer closes or the read times out
+Reports readAcks(int fd, std::size_t acks) {
+    Reports reports;
+    alignas(8) uint8_t buffer[4096];
+    std::size_t buffered = 0;
+    while (reports.acks.size() < acks) {
+        ssize_t n = ::recv(fd, buffer + buffered, sizeof(buffer) - buffered, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        buffered += static_cast<std::size_t>(n);
+        std::size_t used = protocol::decodeReports(buffer, buffered, reports);
+        std::memmove(buffer, buffer + used, buffered - used);
+        buffered -= used;
+    }
+    return reports;
+}
+
+} // namespace
+
+// Test orders, acks and trade reports end to end over TCP, with each available backend.
+TEST(GatewayTest, RoundTripOverTcp) {
+    for (IoBackend backend : {IoBackend::Epoll, IoBackend::IoUring}) {
+        if (backend == IoBackend::IoUring && !EventLoop::ioUringSupported())
+            continue;
+        GatewayConfig config;
+        config.backend = backend;
+        Gateway gateway(config);
+        EXPECT_EQ(gateway.backend(), backend);
+        ASSERT_NE(gateway.port(), 0);
+        gateway.start();
+
+        int buyer = connectTcp(gateway.port());
+        int seller = connectTcp(gateway.port());
+        ASSERT_GE(buyer, 0);
+        ASSERT_GE(seller, 0);
+
+        alignas(8) uint8_t out[256];
+        protocol::MessageWriter writer(out, sizeof(out));
+        writer.writeNewOrder(1, Order(1, OrderSide::BUY, 10, 1000));
+        writer.writeNewOrder(1, Order(2, OrderSide::BUY, 10, 999));
+        sendAll(buyer, writer);
+        Reports bought = readAcks(buyer, 2);
+        ASSERT_EQ(bought.acks.size(), 2);
+        EXPECT_EQ(bought.acks[0].orderId, 1);
+        EXPECT_EQ(bought.acks[1].status, protocol::AckStatus::Accepted);
+
+        // Both replies to one batch come back together, trades after the ack.
+        writer.clear();
+        writer.writeNewOrder(1, Order(3, OrderSide::SELL, 4, 1000));
+        writer.writeCancel(1, 77);
+        sendAll(seller, writer);
+        Reports sold = readAcks(seller, 2);
+        ASSERT_EQ(sold.acks.size(), 2);
+        EXPECT_EQ(sold.acks[0].status, protocol::AckStatus::Accepted);
+        EXPECT_EQ(sold.acks[1].reason, protocol::RejectReason::UnknownOrder);
+        ASSERT_EQ(sold.trades.size(), 1);
+        EXPECT_EQ(sold.trades[0].buyOrderId, 1);
+        EXPECT_EQ(sold.trades[0].quantity, 4);
+
+        ::close(buyer);
+        ::close(seller);
+        gateway.stop();
+    }
+}
+
+// Test a Unix socket client, and that a disconnect cancels what the connection left resting.
+TEST(GatewayTest, UnixSocketCancelsOnDisconnect) {
+    GatewayConfig config;
+    config.listenTcp = false;
+    config.unixPath = "/tmp/agora-gateway-test-" + std::to_string(::getpid()) + ".sock";
+    Gateway gateway(config);
+    EXPECT_EQ(gateway.port(), 0);
+    gateway.start();
+
+    int leaver = connectUnix(config.unixPath);
+    int stayer = connectUnix(config.unixPath);
+    ASSERT_GE(leaver, 0);
+    ASSERT_GE(stayer, 0);
+    alignas(8) uint8_t out[256];
+    protocol::MessageWriter writer(out, sizeof(out));
+    writer.writeNewOrder(1, Order(1, OrderSide::BUY, 10, 1000));
+    sendAll(leaver, writer);
+    ASSERT_EQ(readAcks(leaver, 1).acks.size(), 1);
+    writer.clear();
+    writer.writeNewOrder(1, Order(2, OrderSide::SELL, 10, 1005));
+    sendAll(stayer, writer);
+    ASSERT_EQ(readAcks(stayer, 1).acks.size(), 1);
+
+    // The other connection's close reaches the book at some point: its order ID stays taken
+    // (DuplicateOrder) until order 1 is gone.
+    ::close(leaver);
+    bool gone = false;
+    for (int attempt = 0; attempt < 1000 && !gone; ++attempt) {
+        writer.clear();
+        writer.writeNewOrder(1, Order(1, OrderSide::BUY, 10, 1000));
+        sendAll(stayer, writer);
+        Reports reports = readAcks(stayer, 1);
+        ASSERT_EQ(reports.acks.size(), 1);
+        gone = reports.acks[0].status == protocol::AckStatus::Accepted;
+        if (!gone) {
+            EXPECT_EQ(reports.acks[0].reason, protocol::RejectReason::DuplicateOrder);
+            ::usleep(1000);
+        }
+    }
+    EXPECT_TRUE(gone);
+
+    // A malformed stream gets the connection dropped; its order goes with it.
+    writer.clear();
+    writer.writeAck(1, 2, protocol::AckStatus::Accepted);
+    sendAll(stayer, writer);
+    alignas(8) uint8_t in[64];
+    ssize_t received;
+    do
+        received = ::recv(stayer, in, sizeof(in), 0);
+    while (received < 0 && errno == EINTR);
+    EXPECT_EQ(received, 0);
+    ::close(stayer);
+
+    gateway.stop();
+    EXPECT_EQ(gateway.book().findOrder(1), nullptr);
+    EXPECT_EQ(gateway.book().findOrder(2), nullptr);
+}
+
+// Test that a price the book cannot hold is refused with a reason and the gateway keeps serving.
+TEST(GatewayTest, FarPriceIsRejectedNotFatal) {
+    Gateway gateway;
+    gateway.start();
+    int client = connectTcp(gateway.port());
+    ASSERT_GE(client, 0);
+
+    alignas(8) uint8_t out[256];
+    protocol::MessageWriter writer(out, sizeof(out));
+    writer.writeNewOrder(1, Order(1, OrderSide::BUY, 10, 100));
+    writer.writeNewOrder(1, Order(2, OrderSide::BUY, 10, int64_t{1} << 40));
+    writer.writeReplace(1, 1, int64_t{1} << 40, 10);
+    writer.writeNewOrder(1, Order(3, OrderSide::BUY, 10, 101));
+    sendAll(client, writer);
+    Reports reports = readAcks(client, 4);
+    ASSERT_EQ(reports.acks.size(), 4);
+    EXPECT_EQ(reports.acks[0].status, protocol::AckStatus::Accepted);
+    EXPECT_EQ(reports.acks[1].reason, protocol::RejectReason::PriceOutOfRange);
+    EXPECT_EQ(reports.acks[2].reason, protocol::RejectReason::PriceOutOfRange);
+    EXPECT_EQ(reports.acks[3].status, protocol::AckStatus::Accepted);
+
+    // Stopped with the connection still open, so its orders stay in the book.
+    gateway.stop();
+    ASSERT_NE(gateway.book().findOrder(1), nullptr);
+    EXPECT_EQ(gateway.book().findOrder(1)->price, 100);
+    EXPECT_EQ(gateway.book().findOrder(2), nullptr);
+    ::close(client);
+}
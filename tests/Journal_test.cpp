@@ -0,0 +1,353 @@
+#include <gtest/gtest.h>
+#include "../src/Journal.h"
+#include "../src/OrderBook.h"
+#include "../src/Snapshot.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+//Every resting order of a book, in priority order, for comparing two books
+std::vector<Order> restingOrders(const OrderBook& book) {
+    BookSnapshot snapshot;
+    book.captureSnapshot(snapshot);
+    return snapshot.orders;
+}
+
+bool sameOrders(const std::vector<Order>& a, const std::vector<Order>& b) {
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        if (a[i].orderId != b[i].orderId || a[i].price != b[i].price || a[i].quantity != b[i].quantity || a[i].side != b[i].side)
+            return false;
+    return true;
+}
+
+} // namespace
+
+// Test that reopening a journal continues its sequence and drops a torn trailing record.
+TEST(JournalTest, ReopenContinuesSequence) {
+    std::string path = ::testing::TempDir() + "agora_journal_reopen.bin";
+    std::remove(path.c_str());
+    {
+        Journal journal(path);
+        EXPECT_EQ(journal.appendNewOrder(Order(1, OrderSide::BUY, 100, 1000)), 1);
+        EXPECT_EQ(journal.appendCancel(1), 2);
+        journal.commit();
+    }
+
+    //Simulate a crash part way through writing a third record
+    std::FILE* file = std::fopen(path.c_str(), "ab");
+    std::fputs("torn", file);
+    std::fclose(file);
+
+    {
+        Journal journal(path);
+        EXPECT_EQ(journal.lastSequence(), 2);
+        EXPECT_EQ(journal.appendCancel(5), 3);
+    }
+
+    std::vector<JournalRecord> records;
+    EXPECT_EQ(Journal::replay(path, 1, [&](const JournalRecord& record) { records.push_back(record); }), 2);
+    std::remove(path.c_str());
+
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0].sequence, 2);
+    EXPECT_EQ(records[0].command, JournalCommand::Cancel);
+    EXPECT_EQ(records[1].sequence, 3);
+    EXPECT_EQ(records[1].orderId, 5);
+}
+
+// Test that a snapshot round-trips through disk and restores time priority and trade IDs.
+TEST(SnapshotTest, RoundTripPreservesPriority) {
+    std::string path = ::testing::TempDir() + "agora_snapshot_roundtrip.bin";
+    OrderBook original;
+    original.processOrder(Order(1, OrderSide::SELL, 100, 1010));
+    original.processOrder(Order(2, OrderSide::SELL, 50, 1010));
+    original.processOrder(Order(3, OrderSide::SELL, 70, 1005));
+    original.processOrder(Order(4, OrderSide::BUY, 20, 1005));
+    original.processOrder(Order(5, OrderSide::BUY, 30, 990));
+    original.placeStop(Order(7, OrderSide::BUY, 10, 0, OrderType::Market), 1010);
+    original.placeStop(Order(8, OrderSide::BUY, 10, 1020), 1010);
+
+    BookSnapshot snapshot;
+    original.captureSnapshot(snapshot);
+    snapshot.journalSequence = 5;
+    writeSnapshot(path, snapshot);
+
+    BookSnapshot loaded = readSnapshot(path);
+    std::remove(path.c_str());
+    EXPECT_EQ(loaded.journalSequence, 5);
+    EXPECT_EQ(loaded.nextTradeId, 2);
+    ASSERT_EQ(loaded.stops.size(), 2);
+    EXPECT_EQ(loaded.stops[0].order.orderId, 7);
+    EXPECT_EQ(loaded.stops[1].triggerPrice, 1010);
+
+    OrderBook restored;
+    restored.restoreSnapshot(loaded);
+    EXPECT_TRUE(sameOrders(restingOrders(restored), restingOrders(original)));
+    EXPECT_THROW(restored.restoreSnapshot(loaded), std::logic_error);
+
+    //Order 1 is still ahead of order 2 at 1010, and the trade IDs carry on
+    std::vector<Trade> trades = restored.processOrder(Order(6, OrderSide::BUY, 220, 1010));
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[1].sellOrderId, 1);
+    EXPECT_EQ(trades[2].sellOrderId, 2);
+    EXPECT_EQ(trades[0].tradeId, 2);
+
+    //The last trade at 1010 sets both stops off, in their original order: 8 rests at 1020
+    EXPECT_EQ(restored.pendingStops(), 0);
+    EXPECT_EQ(restored.getBids().at(1020).front().orderId, 8);
+}
+
+// Test that a corrupted snapshot is refused.
+TEST(SnapshotTest, RejectsCorruptSnapshot) {
+    std::string path = ::testing::TempDir() + "agora_snapshot_corrupt.bin";
+    BookSnapshot snapshot;
+    snapshot.orders.push_back(Order(1, OrderSide::BUY, 100, 1000));
+    writeSnapshot(path, snapshot);
+
+    std::FILE* file = std::fopen(path.c_str(), "r+b");
+    std::fseek(file, -4, SEEK_END);
+    std::fputc(0x7F, file);
+    std::fclose(file);
+
+    EXPECT_THROW(readSnapshot(path), std::runtime_error);
+
+    // A record count far beyond the file is refused before anything is allocated for it.
+    writeSnapshot(path, snapshot);
+    file = std::fopen(path.c_str(), "r+b");
+    uint64_t hugeCount = uint64_t{1} << 60;
+    std::fseek(file, 4 * sizeof(uint64_t), SEEK_SET);
+    std::fwrite(&hugeCount, sizeof(hugeCount), 1, file);
+    std::fclose(file);
+
+    EXPECT_THROW(readSnapshot(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+// Test recovery from a background snapshot plus the journal tail written after it.
+TEST(SnapshotTest, RecoverFromSnapshotAndJournalTail) {
+    std::string snapshotPath = ::testing::TempDir() + "agora_recover_snapshot.bin";
+    std::string journalPath = ::testing::TempDir() + "agora_recover_journal.bin";
+    std::remove(snapshotPath.c_str());
+    std::remove(journalPath.c_str());
+
+    OrderBook live;
+    {
+        JournalConfig config;
+        config.fsync = FsyncPolicy::None;
+        Journal journal(journalPath, config);
+        Snapshotter snapshotter(snapshotPath);
+
+        auto submit = [&](const Order& order) {
+            journal.appendNewOrder(order);
+            live.processOrder(order);
+        };
+        for (uint64_t id = 1; id <= 200; ++id) {
+            Order order(id, id % 2 ? OrderSide::BUY : OrderSide::SELL, 10, id % 2 ? 1000 - static_cast<Price>(id % 7) : 1001 + static_cast<Price>(id % 5));
+            order.owner = static_cast<OwnerId>(id % 3);
+            submit(order);
+        }
+        journal.commit();
+        ASSERT_TRUE(snapshotter.takeSnapshot(live, journal.lastSequence()));
+
+        //Keep trading while the snapshot is written: these must come from the journal
+        submit(Order(201, OrderSide::BUY, 35, 1002));
+        journal.appendCancel(4);
+        live.cancelOrder(4);
+        submit(Order(202, OrderSide::SELL, 25, 998));
+        journal.appendModify(6, 1003, 5);
+        live.modifyOrder(6, 1003, 5);
+        journal.appendCancelAllForOwner(2);
+        live.cancelAllForOwner(2);
+
+        //Stops placed after the snapshot: one still pending, one cancelled, one set off
+        auto stop = [&](const Order& order, Price trigger) {
+            journal.appendNewStop(order, trigger);
+            live.placeStop(order, trigger);
+        };
+        Order ownedStop(203, OrderSide::SELL, 15, 990);
+        ownedStop.owner = 1;
+        stop(ownedStop, 980);
+        stop(Order(204, OrderSide::BUY, 5, 0, OrderType::Market), 1050);
+        journal.appendCancel(204);
+        live.cancelOrder(204);
+        stop(Order(205, OrderSide::SELL, 20, 995), 1010);
+        submit(Order(206, OrderSide::SELL, 5, 0, OrderType::Market));
+        journal.commit();
+        snapshotter.wait();
+    }
+
+    OrderBook recovered;
+    RecoveryStats stats = recoverBook(recovered, snapshotPath, journalPath);
+    std::remove(snapshotPath.c_str());
+    std::remove(journalPath.c_str());
+
+    EXPECT_EQ(stats.replayedCommands, 10);
+    EXPECT_EQ(stats.lastSequence, 210);
+    EXPECT_EQ(stats.refusedCommands, 0);
+    EXPECT_TRUE(sameOrders(restingOrders(recovered), restingOrders(live)));
+    ASSERT_EQ(live.pendingStops(), 1);
+    EXPECT_EQ(recovered.pendingStops(), 1);
+    ASSERT_NE(recovered.findStop(203), nullptr);
+    EXPECT_EQ(recovered.findStop(203)->owner, 1);
+    EXPECT_EQ(live.findStop(205), nullptr);
+    EXPECT_EQ(recovered.findStop(205), nullptr);
+
+    //Owners survive the snapshot, so a mass cancel after recovery finds the same orders
+    EXPECT_GT(live.cancelAllForOwner(1), 0u);
+    recovered.cancelAllForOwner(1);
+    EXPECT_TRUE(sameOrders(restingOrders(recovered), restingOrders(live)));
+}
+
+// Test that commands the live book refused are refused again on replay, and counted, instead
+// of aborting recovery.
+TEST(SnapshotTest, RecoverySkipsCommandsTheBookRefused) {
+    std::string snapshotPath = ::testing::TempDir() + "agora_refused_snapshot.bin";
+    std::string journalPath = ::testing::TempDir() + "agora_refused_journal.bin";
+    std::remove(snapshotPath.c_str());
+    std::remove(journalPath.c_str());
+
+    OrderBookConfig config;
+    config.maxLadderTicks = 1000;
+    OrderBook live(config);
+    {
+        JournalConfig journalConfig;
+        journalConfig.fsync = FsyncPolicy::None;
+        Journal journal(journalPath, journalConfig);
+        auto submit = [&](const Order& order) {
+            journal.appendNewOrder(order);
+            try {
+                live.processOrder(order);
+            } catch (const std::out_of_range&) {
+            }
+        };
+        submit(Order(1, OrderSide::BUY, 10, 1000));
+        submit(Order(2, OrderSide::BUY, 10, int64_t{1} << 40));
+        journal.appendModify(1, int64_t{1} << 40, 10);
+        EXPECT_THROW(live.modifyOrder(1, int64_t{1} << 40, 10), std::out_of_range);
+        submit(Order(3, OrderSide::SELL, 4, 1000));
+    }
+
+    OrderBook recovered(config);
+    RecoveryStats stats = recoverBook(recovered, snapshotPath, journalPath);
+    std::remove(journalPath.c_str());
+
+    EXPECT_EQ(stats.replayedCommands, 4);
+    EXPECT_EQ(stats.refusedCommands, 2);
+    EXPECT_EQ(stats.lastSequence, 4);
+    EXPECT_EQ(recovered.findOrder(2), nullptr);
+    EXPECT_TRUE(sameOrders(restingOrders(recovered), restingOrders(live)));
+}
+
+// Test that a journal missing sequences, inside it or between it and the snapshot, is refused.
+TEST(SnapshotTest, RecoveryRefusesSequenceGaps) {
+    std::string snapshotPath = ::testing::TempDir() + "agora_gap_snapshot.bin";
+    std::string journalPath = ::testing::TempDir() + "agora_gap_journal.bin";
+    std::remove(snapshotPath.c_str());
+    std::remove(journalPath.c_str());
+
+    std::vector<JournalRecord> records;
+    {
+        JournalConfig journalConfig;
+        journalConfig.fsync = FsyncPolicy::None;
+        Journal journal(journalPath, journalConfig);
+        for (uint64_t id = 1; id <= 4; ++id)
+            journal.appendNewOrder(Order(id, OrderSide::BUY, 10, 1000));
+    }
+    Journal::replay(journalPath, 0, [&](const JournalRecord& record) { records.push_back(record); });
+    ASSERT_EQ(records.size(), 4);
+    auto rewrite = [&](std::initializer_list<std::size_t> keep) {
+        std::FILE* file = std::fopen(journalPath.c_str(), "wb");
+        for (std::size_t i : keep)
+            std::fwrite(&records[i], sizeof(JournalRecord), 1, file);
+        std::fclose(file);
+    };
+
+    //Sequence 2 lost from the middle
+    rewrite({0, 2, 3});
+    OrderBook middle;
+    EXPECT_THROW(recoverBook(middle, snapshotPath, journalPath), std::runtime_error);
+
+    //The snapshot covers up to 1, but the journal resumes at 3
+    BookSnapshot snapshot;
+    snapshot.journalSequence = 1;
+    snapshot.orders.push_back(Order(1, OrderSide::BUY, 10, 1000));
+    writeSnapshot(snapshotPath, snapshot);
+    rewrite({2, 3});
+    OrderBook behind;
+    EXPECT_THROW(recoverBook(behind, snapshotPath, journalPath), std::runtime_error);
+
+    //Resuming right after the snapshot is fine
+    rewrite({1, 2, 3});
+    OrderBook recovered;
+    RecoveryStats stats = recoverBook(recovered, snapshotPath, journalPath);
+    EXPECT_EQ(stats.replayedCommands, 3);
+    EXPECT_EQ(recovered.getBids().at(1000).size(), 4);
+    std::remove(snapshotPath.c_str());
+    std::remove(journalPath.c_str());
+}
+
+// Test that a book snapshotted mid-auction comes back in the auction, and that journaled
+// auction transitions replay to the same book and trade IDs.
+TEST(SnapshotTest, RecoverAcrossAnAuction) {
+    std::string snapshotPath = ::testing::TempDir() + "agora_auction_snapshot.bin";
+    std::string journalPath = ::testing::TempDir() + "agora_auction_journal.bin";
+    std::remove(snapshotPath.c_str());
+    std::remove(journalPath.c_str());
+
+    OrderBook live;
+    BookSnapshot midAuction;
+    {
+        JournalConfig config;
+        config.fsync = FsyncPolicy::None;
+        Journal journal(journalPath, config);
+        auto submit = [&](const Order& order) {
+            journal.appendNewOrder(order);
+            live.processOrder(order);
+        };
+        submit(Order(1, OrderSide::SELL, 10, 1000));
+        journal.appendStartAuction();
+        live.startAuction();
+        submit(Order(2, OrderSide::BUY, 15, 1005));
+        submit(Order(3, OrderSide::SELL, 10, 1002));
+
+        live.captureSnapshot(midAuction);
+        midAuction.journalSequence = journal.lastSequence();
+        writeSnapshot(snapshotPath, midAuction);
+
+        submit(Order(4, OrderSide::BUY, 10, 1003));
+        journal.appendUncrossAuction(1001);
+        live.uncrossAuction(1001, [](const Trade&) {});
+        submit(Order(5, OrderSide::BUY, 5, 1010));
+    }
+    EXPECT_EQ(readSnapshot(snapshotPath).phase, TradingPhase::Auction);
+
+    //Snapshot plus tail, and the whole journal on its own, both end where the live book did
+    OrderBook fromSnapshot;
+    RecoveryStats stats = recoverBook(fromSnapshot, snapshotPath, journalPath);
+    EXPECT_EQ(stats.replayedCommands, 3);
+    OrderBook fromJournal;
+    recoverBook(fromJournal, snapshotPath + ".missing", journalPath);
+
+    //Restoring the snapshot alone resumes the auction, with its crossed orders still waiting
+    OrderBook restored;
+    restored.restoreSnapshot(midAuction);
+    EXPECT_EQ(restored.phase(), TradingPhase::Auction);
+    EXPECT_EQ(restored.indicativeAuction(1001).volume, 15);
+    std::remove(snapshotPath.c_str());
+    std::remove(journalPath.c_str());
+
+    BookSnapshot expected;
+    live.captureSnapshot(expected);
+    for (const OrderBook* recovered : {&fromSnapshot, &fromJournal}) {
+        BookSnapshot actual;
+        recovered->captureSnapshot(actual);
+        EXPECT_EQ(actual.phase, TradingPhase::Continuous);
+        EXPECT_EQ(actual.nextTradeId, expected.nextTradeId);
+        EXPECT_TRUE(sameOrders(actual.orders, expected.orders));
+    }
+}
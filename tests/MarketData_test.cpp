@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "../src/MarketData.h"
+#include "../src/OrderBook.h"
+
+#include <vector>
+
+// Test fixture: a book with a depth publisher attached, collecting every update.
+class MarketDataTest : public ::testing::Test {
+protected:
+    void SetUp() override { orderBook.setDepthPublisher(&publisher); }
+
+    std::vector<DepthUpdate> publish() {
+        std::vector<DepthUpdate> updates;
+        publisher.publish(orderBook, [&updates](const DepthUpdate& update) { updates.push_back(update); });
+        return updates;
+    }
+
+    OrderBook orderBook;
+    DepthPublisher publisher;
+};
+
+// Test that levels keep their aggregates and the top-N view walks them best first.
+TEST_F(MarketDataTest, LevelAggregatesAndTopOfBook) {
+    orderBook.processOrder(Order(1, OrderSide::BUY, 100, 1000));
+    orderBook.processOrder(Order(2, OrderSide::BUY, 50, 1000));
+    orderBook.processOrder(Order(3, OrderSide::BUY, 70, 998));
+    orderBook.processOrder(Order(4, OrderSide::BUY, 10, 995));
+    orderBook.processOrder(Order(5, OrderSide::SELL, 30, 1003));
+
+    DepthLevel level;
+    ASSERT_TRUE(orderBook.getLevel(OrderSide::BUY, 1000, level));
+    EXPECT_EQ(level.quantity, 150);
+    EXPECT_EQ(level.orderCount, 2);
+    EXPECT_FALSE(orderBook.getLevel(OrderSide::SELL, 1000, level));
+
+    DepthLevel bids[2];
+    ASSERT_EQ(orderBook.getDepth(OrderSide::BUY, 2, bids), 2);
+    EXPECT_EQ(bids[0].price, 1000);
+    EXPECT_EQ(bids[1].price, 998);
+    EXPECT_EQ(bids[1].quantity, 70);
+
+    DepthLevel asks[5];
+    ASSERT_EQ(orderBook.getDepth(OrderSide::SELL, 5, asks), 1);
+    EXPECT_EQ(asks[0].price, 1003);
+    EXPECT_EQ(orderBook.getDepth(OrderSide::SELL, 0, asks), 0);
+}
+
+// Test that one command that sweeps levels emits one update per changed level.
+TEST_F(MarketDataTest, PublishesOnlyChangedLevels) {
+    orderBook.processOrder(Order(1, OrderSide::SELL, 100, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 40, 1000));
+    orderBook.processOrder(Order(3, OrderSide::SELL, 50, 1001));
+    orderBook.processOrder(Order(4, OrderSide::SELL, 60, 1005));
+
+    std::vector<DepthUpdate> updates = publish();
+    ASSERT_EQ(updates.size(), 3);
+    EXPECT_EQ(updates[0].action, DepthUpdate::Action::Add);
+    EXPECT_EQ(updates[0].price, 1000);
+    EXPECT_EQ(updates[0].quantity, 140);
+    EXPECT_EQ(updates[0].orderCount, 2);
+
+    //Clears 1000, clears 1001, rests the remainder as a new bid at 1002. 1005 is untouched.
+    orderBook.processOrder(Order(5, OrderSide::BUY, 200, 1002));
+    updates = publish();
+    ASSERT_EQ(updates.size(), 3);
+    EXPECT_EQ(updates[0].action, DepthUpdate::Action::Delete);
+    EXPECT_EQ(updates[0].side, OrderSide::SELL);
+    EXPECT_EQ(updates[0].price, 1000);
+    EXPECT_EQ(updates[1].action, DepthUpdate::Action::Delete);
+    EXPECT_EQ(updates[1].price, 1001);
+    EXPECT_EQ(updates[2].action, DepthUpdate::Action::Add);
+    EXPECT_EQ(updates[2].side, OrderSide::BUY);
+    EXPECT_EQ(updates[2].quantity, 10);
+
+    //A rejected cancel and a round that leaves a level as it was emit nothing
+    orderBook.cancelOrder(99);
+    EXPECT_TRUE(publish().empty());
+
+    orderBook.processOrder(Order(6, OrderSide::SELL, 5, 1005));
+    orderBook.cancelOrder(6);
+    EXPECT_TRUE(publish().empty());
+
+    orderBook.cancelOrder(4);
+    updates = publish();
+    ASSERT_EQ(updates.size(), 1);
+    EXPECT_EQ(updates[0].action, DepthUpdate::Action::Delete);
+    EXPECT_EQ(updates[0].price, 1005);
+}
+
+// Test that a partial fill is reported as an update with the new aggregates.
+TEST_F(MarketDataTest, PartialFillIsAnUpdate) {
+    orderBook.processOrder(Order(1, OrderSide::BUY, 100, 1000));
+    orderBook.processOrder(Order(2, OrderSide::BUY, 100, 1000));
+    publish();
+
+    orderBook.processOrder(Order(3, OrderSide::SELL, 130, 1000));
+    std::vector<DepthUpdate> updates = publish();
+    ASSERT_EQ(updates.size(), 1);
+    EXPECT_EQ(updates[0].action, DepthUpdate::Action::Update);
+    EXPECT_EQ(updates[0].quantity, 70);
+    EXPECT_EQ(updates[0].orderCount, 1);
+}
+
+// Test that levels touched again out of order, on either side, are reported once per round.
+TEST_F(MarketDataTest, InterleavedTouchesAreReportedOnce) {
+    for (int round = 0; round < 2; ++round) {
+        uint64_t id = static_cast<uint64_t>(round) * 100;
+        for (Price price = 990; price < 1000; ++price)
+            orderBook.processOrder(Order(++id, OrderSide::BUY, 10, price));
+        for (Price price = 990; price < 1000; ++price)
+            orderBook.processOrder(Order(++id, OrderSide::BUY, 5, price));
+        orderBook.processOrder(Order(++id, OrderSide::SELL, 5, 1990));
+        std::vector<DepthUpdate> updates = publish();
+        ASSERT_EQ(updates.size(), 11);
+        EXPECT_EQ(updates[9].price, 999);
+        EXPECT_EQ(updates[10].side, OrderSide::SELL);
+    }
+}
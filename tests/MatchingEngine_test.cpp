@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "../src/MatchingEngine.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//Submits, retrying while the shard's ring is full
+void submitAll(MatchingEngine& engine, const std::vector<EngineCommand>& commands) {
+    for (const EngineCommand& command : commands)
+        while (!engine.submit(command))
+            std::this_thread::yield();
+}
+
+//Waits until the workers have applied 'count' commands
+void waitForProcessed(MatchingEngine& engine, uint64_t count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (engine.processedCount() < count && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+    ASSERT_EQ(engine.processedCount(), count);
+}
+
+} // namespace
+
+// Test that instruments are spread evenly over the shards.
+TEST(MatchingEngineTest, InstrumentsAreBalancedAcrossShards) {
+    EngineConfig config;
+    config.shards = 3;
+    MatchingEngine engine(config);
+    for (InstrumentId id = 1; id <= 6; ++id)
+        engine.addInstrument(id);
+
+    std::vector<int> perShard(3, 0);
+    for (InstrumentId id = 1; id <= 6; ++id)
+        ++perShard[engine.shardOf(id)];
+    EXPECT_EQ(perShard, (std::vector<int>{2, 2, 2}));
+
+    EXPECT_THROW(engine.addInstrument(1), std::logic_error);
+    EXPECT_THROW(engine.submit(EngineCommand::cancel(99, 1)), std::out_of_range);
+}
+
+// Test that each instrument matches only against its own book and fills come out tagged.
+TEST(MatchingEngineTest, BooksAreIndependent) {
+    EngineConfig config;
+    config.shards = 2;
+    MatchingEngine engine(config);
+    engine.addInstrument(10);
+    engine.addInstrument(20);
+    engine.start();
+
+    submitAll(engine, {
+        EngineCommand::newOrder(10, Order(1, OrderSide::SELL, 100, 1000)),
+        EngineCommand::newOrder(20, Order(1, OrderSide::SELL, 100, 5000)),
+        // Crosses instrument 10's ask only; instrument 20 has no bid at 1000 to touch.
+        EngineCommand::newOrder(10, Order(2, OrderSide::BUY, 40, 1000)),
+        EngineCommand::newOrder(20, Order(2, OrderSide::BUY, 100, 4900)),
+        EngineCommand::cancel(20, 1),
+    });
+    waitForProcessed(engine, 5);
+
+    std::vector<EngineTrade> trades;
+    engine.pollTrades([&](const EngineTrade& trade) { trades.push_back(trade); });
+    engine.stop();
+
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].instrument, 10);
+    EXPECT_EQ(trades[0].trade.quantity, 40);
+
+    EXPECT_EQ(engine.book(10).getAsks().at(1000).front().quantity, 60);
+    EXPECT_TRUE(engine.book(20).getAsks().empty());
+    EXPECT_EQ(engine.book(20).getBids().at(4900).front().orderId, 2);
+}
+
+// Test that stop() applies everything submitted before it, and fills are never dropped
+// even when the trade ring is much smaller than the number of fills.
+TEST(MatchingEngineTest, StopDrainsAndTradesAreNotDropped) {
+    EngineConfig config;
+    config.shards = 2;
+    config.tradeRingCapacity = 8;
+    MatchingEngine engine(config);
+    engine.addInstrument(1);
+    engine.addInstrument(2);
+    engine.start();
+
+    constexpr int kPairs = 2000;
+    std::size_t fills = 0;
+    for (int i = 0; i < kPairs; ++i) {
+        for (InstrumentId instrument = 1; instrument <= 2; ++instrument) {
+            uint64_t id = static_cast<uint64_t>(i) * 2;
+            submitAll(engine, {
+                EngineCommand::newOrder(instrument, Order(id + 1, OrderSide::SELL, 10, 1000)),
+                EngineCommand::newOrder(instrument, Order(id + 2, OrderSide::BUY, 10, 1000)),
+            });
+        }
+        fills += engine.pollTrades([](const EngineTrade&) {});
+    }
+
+    while (fills < 2 * kPairs)
+        fills += engine.pollTrades([](const EngineTrade&) {});
+    engine.stop();
+
+    EXPECT_EQ(fills, 2 * kPairs);
+    EXPECT_EQ(engine.processedCount(), 4 * kPairs);
+}
+
+// Test that an order its book refuses is counted as rejected and the shard keeps going.
+TEST(MatchingEngineTest, RefusedOrdersAreCountedNotFatal) {
+    MatchingEngine engine;
+    OrderBookConfig bookConfig;
+    bookConfig.orderCapacity = 2;
+    bookConfig.onPoolExhausted = PoolExhaustion::Throw;
+    engine.addInstrument(1, bookConfig);
+    engine.start();
+
+    submitAll(engine, {
+        EngineCommand::newOrder(1, Order(1, OrderSide::BUY, 10, 990)),
+        EngineCommand::newOrder(1, Order(2, OrderSide::BUY, 10, 991)),
+        EngineCommand::newOrder(1, Order(3, OrderSide::BUY, 10, 992)),   // Pool full
+        EngineCommand::cancel(1, 1),
+        EngineCommand::newOrder(1, Order(4, OrderSide::BUY, 10, 993)),
+    });
+    waitForProcessed(engine, 5);
+    engine.stop();
+
+    EXPECT_EQ(engine.rejectedCount(), 1);
+    const OrderBook& book = engine.book(1);
+    EXPECT_EQ(book.findOrder(3), nullptr);
+    EXPECT_NE(book.findOrder(4), nullptr);
+}
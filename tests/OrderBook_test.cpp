@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "../src/OrderBook.h" 
 
+// Prices throughout are integer ticks: with a 0.01 tick size, 1000 is 10.00.
+
 // Test Fixture: A class to set up a clean OrderBook for each test
 class OrderBookTest : public ::testing::Test {
 protected:
@@ -10,7 +12,7 @@ protected:
 // Test that a single BUY order correctly rests in an empty book.
 TEST_F(OrderBookTest, AddBuyOrderToEmptyBook) {
     // 1. SETUP: Create a new BUY order
-    Order newOrder(1, OrderSide::BUY, 100, 10.00);
+    Order newOrder(1, OrderSide::BUY, 100, 1000);
 
     // 2. ACTION: Process the order
     orderBook.processOrder(newOrder);
@@ -23,7 +25,7 @@ TEST_F(OrderBookTest, AddBuyOrderToEmptyBook) {
     EXPECT_TRUE(asks.empty());
     EXPECT_EQ(bids.size(), 1);
 
-    const auto& orderList = bids.at(10.00);
+    const auto& orderList = bids.at(1000);
     EXPECT_EQ(orderList.size(), 1);
 
     const auto& placedOrder = orderList.front();
@@ -34,7 +36,7 @@ TEST_F(OrderBookTest, AddBuyOrderToEmptyBook) {
 // Test that a single SELL order correctly rests in an empty book.
 TEST_F(OrderBookTest, AddSellOrderToEmptyBook) {
     // 1. SETUP: Create a new SELL order
-    Order newOrder(1, OrderSide::SELL, 100, 10.00);
+    Order newOrder(1, OrderSide::SELL, 100, 1000);
 
     // 2. ACTION: Process the order
     orderBook.processOrder(newOrder);
@@ -47,7 +49,7 @@ TEST_F(OrderBookTest, AddSellOrderToEmptyBook) {
     EXPECT_FALSE(asks.empty());
     EXPECT_EQ(asks.size(), 1);
 
-    const auto& orderList = asks.at(10.00);
+    const auto& orderList = asks.at(1000);
     EXPECT_EQ(orderList.size(), 1);
 
     const auto& placedOrder = orderList.front();
@@ -58,11 +60,11 @@ TEST_F(OrderBookTest, AddSellOrderToEmptyBook) {
 // --- TEST 3: Test a simple one-to-one full match ---
 TEST_F(OrderBookTest, SimpleFullMatchBuyInitiated) {
     // 1. SETUP: Add a resting SELL order to the book
-    Order sellOrder(1, OrderSide::SELL, 100, 10.00);
+    Order sellOrder(1, OrderSide::SELL, 100, 1000);
     orderBook.processOrder(sellOrder);
 
     // 2. ACTION: Process a new BUY order that should completely fill the SELL order
-    Order buyOrder(2, OrderSide::BUY, 100, 10.00);
+    Order buyOrder(2, OrderSide::BUY, 100, 1000);
     std::vector<Trade> trades = orderBook.processOrder(buyOrder);
 
     // 3. VERIFICATION: The most important part!
@@ -80,11 +82,11 @@ TEST_F(OrderBookTest, SimpleFullMatchBuyInitiated) {
 // --- TEST 4: Test a simple one-to-one full match ---
 TEST_F(OrderBookTest, SimpleFullMatchSellInitiated) {
     // 1. SETUP: Add a resting BUY order to the book
-    Order buyOrder(1, OrderSide::BUY, 100, 10.00);
+    Order buyOrder(1, OrderSide::BUY, 100, 1000);
     orderBook.processOrder(buyOrder);
 
     // 2. ACTION: Process a new SELL order that should completely fill the BUY order
-    Order sellOrder(2, OrderSide::SELL, 100, 10.00);
+    Order sellOrder(2, OrderSide::SELL, 100, 1000);
     std::vector<Trade> trades = orderBook.processOrder(sellOrder);
 
     // 3. VERIFICATION: The most important part!
@@ -102,11 +104,11 @@ TEST_F(OrderBookTest, SimpleFullMatchSellInitiated) {
 // --- TEST 5: Test a partial fill where the incoming order is larger ---
 TEST_F(OrderBookTest, PartialFillIncomingBuyLarger) {
     // 1. SETUP: Add a resting SELL order for 100 shares
-    Order sellOrder(1, OrderSide::SELL, 100, 10.00);
+    Order sellOrder(1, OrderSide::SELL, 100, 1000);
     orderBook.processOrder(sellOrder);
 
     // 2. ACTION: Process a new, larger BUY order
-    Order buyOrder(2, OrderSide::BUY, 150, 10.00);
+    Order buyOrder(2, OrderSide::BUY, 150, 1000);
     orderBook.processOrder(buyOrder);
 
     // 3. VERIFICATION:
@@ -121,23 +123,23 @@ TEST_F(OrderBookTest, PartialFillIncomingBuyLarger) {
     EXPECT_EQ(bids.size(), 1);
 
     // Check the details of the remaining order.
-    const auto& orderList = bids.at(10.00);
+    const auto& orderList = bids.at(1000);
     EXPECT_EQ(orderList.size(), 1);
 
     const auto& placedOrder = orderList.front();
     EXPECT_EQ(placedOrder.orderId, 2);      // It's the buyer's order
     EXPECT_EQ(placedOrder.quantity, 50);    // The remaining quantity should be 50
-    EXPECT_EQ(placedOrder.price, 10.00);    // At the original price
+    EXPECT_EQ(placedOrder.price, 1000);    // At the original price
 }
 
 // --- TEST 6: Test a partial fill where the incoming order is larger ---
 TEST_F(OrderBookTest, PartialFillIncomingSellLarger) {
     // 1. SETUP: Add a resting BUY order for 100 shares
-    Order buyOrder(1, OrderSide::BUY, 100, 10.00);
+    Order buyOrder(1, OrderSide::BUY, 100, 1000);
     orderBook.processOrder(buyOrder);
 
     // 2. ACTION: Process a new, larger SELL order
-    Order sellOrder(2, OrderSide::SELL, 150, 10.00);
+    Order sellOrder(2, OrderSide::SELL, 150, 1000);
     orderBook.processOrder(sellOrder);
 
     // 3. VERIFICATION:
@@ -152,23 +154,23 @@ TEST_F(OrderBookTest, PartialFillIncomingSellLarger) {
     EXPECT_EQ(asks.size(), 1);
 
     // Check the details of the remaining order.
-    const auto& orderList = asks.at(10.00);
+    const auto& orderList = asks.at(1000);
     EXPECT_EQ(orderList.size(), 1);
 
     const auto& placedOrder = orderList.front();
     EXPECT_EQ(placedOrder.orderId, 2);      // It's the seller's order
     EXPECT_EQ(placedOrder.quantity, 50);    // The remaining quantity should be 50
-    EXPECT_EQ(placedOrder.price, 10.00);    // At the original price
+    EXPECT_EQ(placedOrder.price, 1000);    // At the original price
 }
 
 // --- TEST 7: Test a partial fill where the RESTING BUY order is larger ---
 TEST_F(OrderBookTest, PartialFillRestingBuyLarger) {
     // 1. SETUP: Add a large resting BUY order for 200 shares
-    Order buyOrder(1, OrderSide::BUY, 200, 10.00);
+    Order buyOrder(1, OrderSide::BUY, 200, 1000);
     orderBook.processOrder(buyOrder);
 
     // 2. ACTION: Process a new, smaller BUY order
-    Order sellOrder(2, OrderSide::SELL, 75, 10.00);
+    Order sellOrder(2, OrderSide::SELL, 75, 1000);
     orderBook.processOrder(sellOrder);
 
     // 3. VERIFICATION:
@@ -183,7 +185,7 @@ TEST_F(OrderBookTest, PartialFillRestingBuyLarger) {
     EXPECT_EQ(bids.size(), 1);
 
     // Check the details of the remaining resting order.
-    const auto& orderList = bids.at(10.00);
+    const auto& orderList = bids.at(1000);
     EXPECT_EQ(orderList.size(), 1);
 
     const auto& placedOrder = orderList.front();
@@ -194,9 +196,9 @@ TEST_F(OrderBookTest, PartialFillRestingBuyLarger) {
 // --- TEST 8: Test a partial fill where the RESTING SELL order is larger ---
 // This test name in your file was a duplicate. I've corrected it.
 TEST_F(OrderBookTest, PartialFillRestingSellLarger) {
-    Order sellOrder(1, OrderSide::SELL, 200, 10.00);
+    Order sellOrder(1, OrderSide::SELL, 200, 1000);
     orderBook.processOrder(sellOrder);
-    Order buyOrder(2, OrderSide::BUY, 75, 10.00);
+    Order buyOrder(2, OrderSide::BUY, 75, 1000);
     orderBook.processOrder(buyOrder);
 
     const auto& bids = orderBook.getBids();
@@ -206,7 +208,7 @@ TEST_F(OrderBookTest, PartialFillRestingSellLarger) {
     EXPECT_FALSE(asks.empty());
     EXPECT_EQ(asks.size(), 1);
 
-    const auto& orderList = asks.at(10.00);
+    const auto& orderList = asks.at(1000);
     EXPECT_EQ(orderList.size(), 1);
     const auto& placedOrder = orderList.front();
     EXPECT_EQ(placedOrder.orderId, 1);
@@ -215,12 +217,12 @@ TEST_F(OrderBookTest, PartialFillRestingSellLarger) {
 
 // --- TEST 9: Test a multi-level match that "walks the book" for an aggressive BUY ---
 TEST_F(OrderBookTest, WalkTheBookBuyInitiated) {
-    Order sellOrder1(1, OrderSide::SELL, 50, 10.00);
-    Order sellOrder2(2, OrderSide::SELL, 50, 10.01);
+    Order sellOrder1(1, OrderSide::SELL, 50, 1000);
+    Order sellOrder2(2, OrderSide::SELL, 50, 1001);
     orderBook.processOrder(sellOrder1);
     orderBook.processOrder(sellOrder2);
 
-    Order buyOrder(3, OrderSide::BUY, 100, 10.01);
+    Order buyOrder(3, OrderSide::BUY, 100, 1001);
     orderBook.processOrder(buyOrder);
 
     const auto& bids = orderBook.getBids();
@@ -234,13 +236,13 @@ TEST_F(OrderBookTest, WalkTheBookBuyInitiated) {
 // Renamed from "TEST 9" to "TEST 10"
 TEST_F(OrderBookTest, WalkTheBookSellInitiated) {
     // SETUP: The best buy price should be the HIGHEST price.
-    Order buyOrder1(1, OrderSide::BUY, 50, 10.01); // Best price
-    Order buyOrder2(2, OrderSide::BUY, 50, 10.00); // Second best price
+    Order buyOrder1(1, OrderSide::BUY, 50, 1001); // Best price
+    Order buyOrder2(2, OrderSide::BUY, 50, 1000); // Second best price
     orderBook.processOrder(buyOrder1);
     orderBook.processOrder(buyOrder2);
 
     // ACTION: An aggressive SELL order that should fill both.
-    Order sellOrder(3, OrderSide::SELL, 100, 10.00); // Price is low enough to match both
+    Order sellOrder(3, OrderSide::SELL, 100, 1000); // Price is low enough to match both
     orderBook.processOrder(sellOrder);
 
     // VERIFICATION: After both trades, the book should be completely empty.
@@ -254,13 +256,13 @@ TEST_F(OrderBookTest, WalkTheBookSellInitiated) {
 // Test that we can cancel one of multiple BUY orders at a price level.
 TEST_F(OrderBookTest, CancelRestingBuyOrder) {
     // 1. SETUP: Add two BUY orders.
-    Order buyOrder1(1, OrderSide::BUY, 100, 10.00);
-    Order buyOrder2(2, OrderSide::BUY, 100, 10.00);
+    Order buyOrder1(1, OrderSide::BUY, 100, 1000);
+    Order buyOrder2(2, OrderSide::BUY, 100, 1000);
     orderBook.processOrder(buyOrder1);
     orderBook.processOrder(buyOrder2);
     
     // Verify initial state
-    EXPECT_EQ(orderBook.getBids().at(10.00).size(), 2);
+    EXPECT_EQ(orderBook.getBids().at(1000).size(), 2);
 
     // 2. ACTION: Cancel the first order.
     orderBook.cancelOrder(1);
@@ -269,7 +271,7 @@ TEST_F(OrderBookTest, CancelRestingBuyOrder) {
     const auto& bids = orderBook.getBids();
     EXPECT_FALSE(bids.empty());
     EXPECT_EQ(bids.size(), 1);
-    const auto& orderList = bids.at(10.00);
+    const auto& orderList = bids.at(1000);
     EXPECT_EQ(orderList.size(), 1);
     EXPECT_EQ(orderList.front().orderId, 2); // The remaining order should be order #2
 }
@@ -277,13 +279,13 @@ TEST_F(OrderBookTest, CancelRestingBuyOrder) {
 // Test that we can cancel one of multiple SELL orders at a price level.
 TEST_F(OrderBookTest, CancelRestingSellOrder) {
     // 1. SETUP: Add two SELL orders.
-    Order sellOrder1(1, OrderSide::SELL, 100, 10.25);
-    Order sellOrder2(2, OrderSide::SELL, 100, 10.25);
+    Order sellOrder1(1, OrderSide::SELL, 100, 1025);
+    Order sellOrder2(2, OrderSide::SELL, 100, 1025);
     orderBook.processOrder(sellOrder1);
     orderBook.processOrder(sellOrder2);
 
     // Verify initial state
-    EXPECT_EQ(orderBook.getAsks().at(10.25).size(), 2);
+    EXPECT_EQ(orderBook.getAsks().at(1025).size(), 2);
 
     // 2. ACTION: Cancel the second order.
     orderBook.cancelOrder(2);
@@ -292,7 +294,7 @@ TEST_F(OrderBookTest, CancelRestingSellOrder) {
     const auto& asks = orderBook.getAsks();
     EXPECT_FALSE(asks.empty());
     EXPECT_EQ(asks.size(), 1);
-    const auto& orderList = asks.at(10.25);
+    const auto& orderList = asks.at(1025);
     EXPECT_EQ(orderList.size(), 1);
     EXPECT_EQ(orderList.front().orderId, 1); // The remaining order should be order #1
 }
@@ -300,7 +302,7 @@ TEST_F(OrderBookTest, CancelRestingSellOrder) {
 // Test that cancelling the ONLY BUY order at a price level cleans up the map.
 TEST_F(OrderBookTest, CancelBuyOrderClearsPriceLevel) {
     // 1. SETUP: Add a single BUY order.
-    Order buyOrder(1, OrderSide::BUY, 100, 10.00);
+    Order buyOrder(1, OrderSide::BUY, 100, 1000);
     orderBook.processOrder(buyOrder);
     
     // Verify initial state
@@ -316,7 +318,7 @@ TEST_F(OrderBookTest, CancelBuyOrderClearsPriceLevel) {
 // Test that cancelling the ONLY SELL order at a price level cleans up the map.
 TEST_F(OrderBookTest, CancelSellOrderClearsPriceLevel) {
     // 1. SETUP: Add a single SELL order.
-    Order sellOrder(1, OrderSide::SELL, 100, 10.25);
+    Order sellOrder(1, OrderSide::SELL, 100, 1025);
     orderBook.processOrder(sellOrder);
     
     // Verify initial state
@@ -332,7 +334,7 @@ TEST_F(OrderBookTest, CancelSellOrderClearsPriceLevel) {
 // Test cancelling an order ID that does not exist in the book.
 TEST_F(OrderBookTest, CancelNonExistentOrder) {
     // 1. SETUP: Add a single BUY order with ID 1.
-    Order buyOrder(1, OrderSide::BUY, 100, 10.00);
+    Order buyOrder(1, OrderSide::BUY, 100, 1000);
     orderBook.processOrder(buyOrder);
 
     // 2. ACTION: Attempt to cancel a bogus order ID (999).
@@ -342,14 +344,14 @@ TEST_F(OrderBookTest, CancelNonExistentOrder) {
     // 3. VERIFICATION: Verify that the state of the book is unchanged.
     const auto& bids = orderBook.getBids();
     EXPECT_FALSE(bids.empty());
-    EXPECT_EQ(bids.at(10.00).front().orderId, 1);
+    EXPECT_EQ(bids.at(1000).front().orderId, 1);
 }
 
 // Test cancelling an order that has already been fully filled.
 TEST_F(OrderBookTest, CancelAlreadyFilledOrder) {
     // 1. SETUP: Add a sell order (ID 1) and fill it with a buy order (ID 2).
-    Order sellOrder(1, OrderSide::SELL, 100, 10.00);
-    Order buyOrder(2, OrderSide::BUY, 100, 10.00);
+    Order sellOrder(1, OrderSide::SELL, 100, 1000);
+    Order buyOrder(2, OrderSide::BUY, 100, 1000);
     orderBook.processOrder(sellOrder);
     orderBook.processOrder(buyOrder);
     
@@ -363,4 +365,672 @@ TEST_F(OrderBookTest, CancelAlreadyFilledOrder) {
     // 3. VERIFICATION: The book should remain empty.
     EXPECT_TRUE(orderBook.getAsks().empty());
     EXPECT_TRUE(orderBook.getBids().empty());
-}
\ No newline at end of file
+}
+// Test that prices spread far beyond the initial ladder window still match in price order.
+TEST(OrderBookLadderTest, WalkTheBookAcrossDistantLevels) {
+    OrderBookConfig config;
+    config.ladderTicks = 64;
+    OrderBook orderBook(config);
+
+    orderBook.processOrder(Order(1, OrderSide::SELL, 10, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 10, 50000));
+    orderBook.processOrder(Order(3, OrderSide::SELL, 10, 100));
+    EXPECT_EQ(orderBook.getAsks().size(), 3);
+
+    std::vector<Trade> trades = orderBook.processOrder(Order(4, OrderSide::BUY, 25, 50000));
+
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].price, 100);
+    EXPECT_EQ(trades[1].price, 1000);
+    EXPECT_EQ(trades[2].price, 50000);
+    EXPECT_EQ(trades[2].quantity, 5);
+    EXPECT_EQ(orderBook.getAsks().at(50000).front().quantity, 5);
+}
+
+// Test that the views iterate best price first on both sides.
+TEST(OrderBookLadderTest, ViewsIterateBestPriceFirst) {
+    OrderBook orderBook;
+
+    orderBook.processOrder(Order(1, OrderSide::BUY, 10, 990));
+    orderBook.processOrder(Order(2, OrderSide::BUY, 10, 995));
+    orderBook.processOrder(Order(3, OrderSide::SELL, 10, 1010));
+    orderBook.processOrder(Order(4, OrderSide::SELL, 10, 1005));
+
+    std::vector<uint64_t> bidIds;
+    for (auto level : orderBook.getBids())
+        bidIds.push_back(level.second.front().orderId);
+    EXPECT_EQ(bidIds, (std::vector<uint64_t>{2, 1}));
+
+    std::vector<uint64_t> askIds;
+    for (auto level : orderBook.getAsks())
+        askIds.push_back(level.second.front().orderId);
+    EXPECT_EQ(askIds, (std::vector<uint64_t>{4, 3}));
+}
+
+// Test that a book configured not to grow refuses new orders once its pool is full,
+// without touching the book, and accepts them again after a cancel frees a node.
+TEST(OrderBookPoolTest, RejectsWhenPoolIsFull) {
+    OrderBookConfig config;
+    config.orderCapacity = 2;
+    config.onPoolExhausted = PoolExhaustion::Throw;
+    OrderBook orderBook(config);
+
+    orderBook.processOrder(Order(1, OrderSide::BUY, 100, 1000));
+    orderBook.processOrder(Order(2, OrderSide::BUY, 100, 999));
+
+    EXPECT_THROW(orderBook.processOrder(Order(3, OrderSide::SELL, 100, 1000)), std::length_error);
+    EXPECT_EQ(orderBook.getBids().size(), 2);
+    EXPECT_EQ(orderBook.getBids().at(1000).front().quantity, 100);
+
+    orderBook.cancelOrder(2);
+    EXPECT_NO_THROW(orderBook.processOrder(Order(3, OrderSide::SELL, 100, 1001)));
+    EXPECT_EQ(orderBook.getAsks().size(), 1);
+}
+
+// Test that a level's running total follows fills and cancels.
+TEST(OrderBookPoolTest, LevelTotalQuantity) {
+    OrderBook orderBook;
+    orderBook.processOrder(Order(1, OrderSide::SELL, 100, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 50, 1000));
+    orderBook.processOrder(Order(3, OrderSide::SELL, 25, 1000));
+    EXPECT_EQ(orderBook.getAsks().at(1000).totalQuantity(), 175);
+
+    orderBook.processOrder(Order(4, OrderSide::BUY, 30, 1000));
+    EXPECT_EQ(orderBook.getAsks().at(1000).totalQuantity(), 145);
+
+    orderBook.cancelOrder(2);
+    EXPECT_EQ(orderBook.getAsks().at(1000).totalQuantity(), 95);
+    EXPECT_EQ(orderBook.getAsks().at(1000).size(), 2);
+}
+
+// Test that a sink sees every fill, in order, and no vector is involved.
+TEST(OrderBookSinkTest, SinkReceivesEveryFill) {
+    OrderBook orderBook;
+    orderBook.processOrder(Order(1, OrderSide::SELL, 50, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 50, 1001));
+
+    uint64_t filled = 0;
+    std::vector<uint64_t> restingIds;
+    orderBook.processOrder(Order(3, OrderSide::BUY, 80, 1001), [&](const Trade& trade) {
+        filled += trade.quantity;
+        restingIds.push_back(trade.sellOrderId);
+    });
+
+    EXPECT_EQ(filled, 80);
+    EXPECT_EQ(restingIds, (std::vector<uint64_t>{1, 2}));
+    EXPECT_EQ(orderBook.getAsks().at(1001).front().quantity, 20);
+}
+
+// Test that a sink is never called for an order that only rests.
+TEST(OrderBookSinkTest, SinkNotCalledWithoutMatch) {
+    OrderBook orderBook;
+    int calls = 0;
+    orderBook.processOrder(Order(1, OrderSide::BUY, 50, 1000), [&](const Trade&) { ++calls; });
+    orderBook.processOrder(Order(2, OrderSide::SELL, 50, 1001), [&](const Trade&) { ++calls; });
+    EXPECT_EQ(calls, 0);
+}
+
+// Test that the buffer overload appends to, and never clears, the caller's vector.
+TEST(OrderBookSinkTest, ReusableBufferAppends) {
+    OrderBook orderBook;
+    std::vector<Trade> trades;
+    trades.reserve(16);
+
+    orderBook.processOrder(Order(1, OrderSide::SELL, 50, 1000), trades);
+    orderBook.processOrder(Order(2, OrderSide::BUY, 20, 1000), trades);
+    orderBook.processOrder(Order(3, OrderSide::BUY, 20, 1000), trades);
+
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].buyOrderId, 2);
+    EXPECT_EQ(trades[1].buyOrderId, 3);
+    EXPECT_EQ(trades.capacity(), 16);
+}
+
+// Test that every book numbers its own trades from 1, independently of other books.
+TEST(OrderBookTradeTest, TradeIdsArePerBook) {
+    OrderBook first;
+    OrderBook second;
+    std::vector<Trade> trades;
+
+    first.processOrder(Order(1, OrderSide::SELL, 100, 1000));
+    first.processOrder(Order(2, OrderSide::BUY, 30, 1000), trades);
+    first.processOrder(Order(3, OrderSide::BUY, 30, 1000), trades);
+    second.processOrder(Order(1, OrderSide::SELL, 100, 1000));
+    second.processOrder(Order(2, OrderSide::BUY, 30, 1000), trades);
+
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].tradeId, 1);
+    EXPECT_EQ(trades[1].tradeId, 2);
+    EXPECT_EQ(trades[2].tradeId, 1);
+}
+
+// Test that a sell-initiated trade reports the resting bid as the buyer.
+TEST(OrderBookTradeTest, SellInitiatedTradeSides) {
+    OrderBook orderBook;
+    orderBook.processOrder(Order(1, OrderSide::BUY, 100, 1000));
+    std::vector<Trade> trades = orderBook.processOrder(Order(2, OrderSide::SELL, 100, 999));
+
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buyOrderId, 1);
+    EXPECT_EQ(trades[0].sellOrderId, 2);
+    EXPECT_EQ(trades[0].price, 1000);
+}
+
+// Test that cancelOrder reports whether it removed anything, and findOrder sees resting orders.
+TEST_F(OrderBookTest, CancelReportsResultAndFindOrder) {
+    orderBook.processOrder(Order(1, OrderSide::BUY, 100, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 40, 1000));
+
+    const Order* resting = orderBook.findOrder(1);
+    ASSERT_NE(resting, nullptr);
+    EXPECT_EQ(resting->quantity, 60);
+    EXPECT_EQ(orderBook.findOrder(2), nullptr);
+
+    EXPECT_FALSE(orderBook.cancelOrder(2));
+    EXPECT_TRUE(orderBook.cancelOrder(1));
+    EXPECT_FALSE(orderBook.cancelOrder(1));
+    EXPECT_EQ(orderBook.findOrder(1), nullptr);
+}
+
+// Test that reducing an order's quantity at the same price keeps its queue position.
+TEST_F(OrderBookTest, ModifyReduceKeepsPriority) {
+    orderBook.processOrder(Order(1, OrderSide::SELL, 100, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 100, 1000));
+
+    EXPECT_TRUE(orderBook.modifyOrder(1, 1000, 40));
+
+    const auto& level = orderBook.getAsks().at(1000);
+    EXPECT_EQ(level.front().orderId, 1);
+    EXPECT_EQ(level.front().quantity, 40);
+    EXPECT_EQ(level.totalQuantity(), 140);
+
+    std::vector<Trade> trades = orderBook.processOrder(Order(3, OrderSide::BUY, 50, 1000));
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].sellOrderId, 1);
+    EXPECT_EQ(trades[0].quantity, 40);
+}
+
+// Test that increasing quantity or changing price sends the order to the back of its new level.
+TEST_F(OrderBookTest, ModifyIncreaseOrRepriceLosesPriority) {
+    orderBook.processOrder(Order(1, OrderSide::BUY, 100, 1000));
+    orderBook.processOrder(Order(2, OrderSide::BUY, 100, 1000));
+    orderBook.processOrder(Order(3, OrderSide::BUY, 100, 995));
+
+    EXPECT_TRUE(orderBook.modifyOrder(1, 1000, 150));
+    EXPECT_EQ(orderBook.getBids().at(1000).front().orderId, 2);
+    EXPECT_EQ(orderBook.getBids().at(1000).back().orderId, 1);
+    EXPECT_EQ(orderBook.getBids().at(1000).totalQuantity(), 250);
+
+    EXPECT_TRUE(orderBook.modifyOrder(2, 995, 100));
+    EXPECT_EQ(orderBook.getBids().at(1000).size(), 1);
+    EXPECT_EQ(orderBook.getBids().at(995).back().orderId, 2);
+
+    //Emptying a level by moving its last order away removes the level
+    EXPECT_TRUE(orderBook.modifyOrder(1, 990, 150));
+    EXPECT_THROW(orderBook.getBids().at(1000), std::out_of_range);
+    EXPECT_EQ(orderBook.findOrder(1)->price, 990);
+}
+
+// Test that a modify whose new price crosses matches, and that misses and zero quantity behave.
+TEST_F(OrderBookTest, ModifyCrossingMatchesAndEdgeCases) {
+    orderBook.processOrder(Order(1, OrderSide::SELL, 60, 1005));
+    orderBook.processOrder(Order(2, OrderSide::BUY, 100, 1000));
+
+    std::vector<Trade> trades;
+    EXPECT_TRUE(orderBook.modifyOrder(2, 1005, 100, [&trades](const Trade& trade) { trades.push_back(trade); }));
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buyOrderId, 2);
+    EXPECT_EQ(trades[0].quantity, 60);
+    EXPECT_TRUE(orderBook.getAsks().empty());
+    EXPECT_EQ(orderBook.getBids().at(1005).front().quantity, 40);
+
+    EXPECT_FALSE(orderBook.modifyOrder(1, 1000, 10));
+    EXPECT_TRUE(orderBook.modifyOrder(2, 1005, 0));
+    EXPECT_TRUE(orderBook.getBids().empty());
+    EXPECT_EQ(orderBook.findOrder(2), nullptr);
+}
+
+// Test that a market order sweeps at any price and never rests its remainder.
+TEST_F(OrderBookTest, MarketOrderSweepsAndCancelsRemainder) {
+    orderBook.processOrder(Order(1, OrderSide::SELL, 50, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 50, 1100));
+
+    std::vector<Trade> trades;
+    uint32_t cancelled = orderBook.processOrder(Order(3, OrderSide::BUY, 150, 0, OrderType::Market), trades);
+
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[1].price, 1100);
+    EXPECT_EQ(cancelled, 50);
+    EXPECT_TRUE(orderBook.getAsks().empty());
+    EXPECT_TRUE(orderBook.getBids().empty());
+
+    //Into an empty side the whole order is cancelled
+    EXPECT_EQ(orderBook.processOrder(Order(4, OrderSide::SELL, 10, 0, OrderType::Market), trades), 10);
+}
+
+// Test that an IOC order fills up to its limit and cancels the rest.
+TEST_F(OrderBookTest, ImmediateOrCancelRespectsLimit) {
+    orderBook.processOrder(Order(1, OrderSide::BUY, 50, 1000));
+    orderBook.processOrder(Order(2, OrderSide::BUY, 50, 990));
+
+    std::vector<Trade> trades;
+    EXPECT_EQ(orderBook.processOrder(Order(3, OrderSide::SELL, 80, 995, OrderType::ImmediateOrCancel), trades), 30);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].quantity, 50);
+    EXPECT_TRUE(orderBook.getAsks().empty());
+    EXPECT_EQ(orderBook.getBids().size(), 1);
+}
+
+// Test that fill-or-kill either fills completely or leaves the book untouched.
+TEST_F(OrderBookTest, FillOrKillAllOrNothing) {
+    orderBook.processOrder(Order(1, OrderSide::SELL, 50, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 50, 1001));
+    orderBook.processOrder(Order(3, OrderSide::SELL, 50, 1005));
+
+    std::vector<Trade> trades;
+    EXPECT_EQ(orderBook.processOrder(Order(4, OrderSide::BUY, 120, 1001, OrderType::FillOrKill), trades), 120);
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(orderBook.getAsks().size(), 3);
+
+    EXPECT_EQ(orderBook.processOrder(Order(5, OrderSide::BUY, 120, 1005, OrderType::FillOrKill), trades), 0);
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[2].quantity, 20);
+    EXPECT_EQ(orderBook.getAsks().at(1005).totalQuantity(), 30);
+    EXPECT_TRUE(orderBook.getBids().empty());
+}
+
+// Test that post-only orders rest when passive and are cancelled, untraded, when they would cross.
+TEST_F(OrderBookTest, PostOnlyNeverTakes) {
+    orderBook.processOrder(Order(1, OrderSide::SELL, 50, 1000));
+
+    std::vector<Trade> trades;
+    EXPECT_EQ(orderBook.processOrder(Order(2, OrderSide::BUY, 30, 1000, OrderType::PostOnly), trades), 30);
+    EXPECT_TRUE(trades.empty());
+    EXPECT_TRUE(orderBook.getBids().empty());
+
+    EXPECT_EQ(orderBook.processOrder(Order(3, OrderSide::BUY, 30, 999, OrderType::PostOnly), trades), 0);
+    EXPECT_EQ(orderBook.getBids().at(999).front().orderId, 3);
+
+    //The compile-time entry point ignores newOrder.type
+    EXPECT_EQ(orderBook.processOrderAs<OrderType::Limit>(Order(4, OrderSide::BUY, 10, 1000, OrderType::PostOnly), [](const Trade&) {}), 0);
+    EXPECT_EQ(orderBook.getAsks().at(1000).totalQuantity(), 40);
+}
+
+// Test that amending a post-only order to a crossing price cancels it instead of taking liquidity.
+TEST_F(OrderBookTest, PostOnlyAmendThatCrossesIsCancelled) {
+    orderBook.processOrder(Order(1, OrderSide::SELL, 50, 1000));
+    orderBook.processOrder(Order(2, OrderSide::BUY, 30, 995, OrderType::PostOnly));
+    orderBook.processOrder(Order(3, OrderSide::BUY, 30, 990, OrderType::PostOnly));
+
+    //A passive amend re-queues as usual
+    EXPECT_TRUE(orderBook.modifyOrder(3, 996, 40));
+    EXPECT_EQ(orderBook.getBids().at(996).front().orderId, 3);
+
+    std::vector<Trade> trades;
+    EXPECT_TRUE(orderBook.modifyOrder(2, 1000, 30, [&trades](const Trade& trade) { trades.push_back(trade); }));
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(orderBook.findOrder(2), nullptr);
+    EXPECT_EQ(orderBook.getAsks().at(1000).totalQuantity(), 50);
+    EXPECT_THROW(orderBook.getBids().at(995), std::out_of_range);
+    EXPECT_EQ(orderBook.getBids().size(), 1);
+}
+
+// Test that a batch gives exactly the trades and final book of the same commands applied one by one.
+TEST(OrderBookBatchTest, BatchMatchesSequential) {
+    std::vector<BookCommand> commands;
+    uint64_t nextId = 1;
+    for (int round = 0; round < 200; ++round) {
+        Price offset = static_cast<Price>(round % 9);
+        commands.push_back(BookCommand::newOrder(Order(nextId++, OrderSide::SELL, 30, 1001 + offset)));
+        commands.push_back(BookCommand::newOrder(Order(nextId++, OrderSide::BUY, 30, 999 - offset)));
+        if (round % 3 == 0)
+            commands.push_back(BookCommand::newOrder(Order(nextId++, OrderSide::BUY, 45, 1003)));
+        if (round % 4 == 1)
+            commands.push_back(BookCommand::cancel(nextId - 4));
+        if (round % 5 == 2)
+            commands.push_back(BookCommand::modify(nextId - 3, 1000 + offset, 20));
+        commands.push_back(BookCommand::cancel(999999)); //Never resting
+    }
+
+    OrderBook sequential;
+    std::vector<Trade> expected;
+    for (const BookCommand& command : commands) {
+        if (command.type == BookCommand::Type::NewOrder)
+            sequential.processOrder(command.order, expected);
+        else if (command.type == BookCommand::Type::Cancel)
+            sequential.cancelOrder(command.order.orderId);
+        else
+            sequential.modifyOrder(command.order.orderId, command.order.price, command.order.quantity,
+                [&expected](const Trade& trade) { expected.push_back(trade); });
+    }
+
+    OrderBook batched;
+    std::vector<Trade> trades;
+    batched.processBatch(commands.data(), commands.size(), [&trades](const Trade& trade) { trades.push_back(trade); });
+
+    ASSERT_EQ(trades.size(), expected.size());
+    ASSERT_FALSE(trades.empty());
+    for (std::size_t i = 0; i < trades.size(); ++i) {
+        EXPECT_EQ(trades[i].tradeId, expected[i].tradeId);
+        EXPECT_EQ(trades[i].buyOrderId, expected[i].buyOrderId);
+        EXPECT_EQ(trades[i].sellOrderId, expected[i].sellOrderId);
+        EXPECT_EQ(trades[i].price, expected[i].price);
+        EXPECT_EQ(trades[i].quantity, expected[i].quantity);
+    }
+
+    BookSnapshot want;
+    BookSnapshot got;
+    sequential.captureSnapshot(want);
+    batched.captureSnapshot(got);
+    ASSERT_EQ(got.orders.size(), want.orders.size());
+    for (std::size_t i = 0; i < got.orders.size(); ++i) {
+        EXPECT_EQ(got.orders[i].orderId, want.orders[i].orderId);
+        EXPECT_EQ(got.orders[i].quantity, want.orders[i].quantity);
+    }
+}
+
+namespace {
+
+Order ownedOrder(uint64_t id, OrderSide side, uint32_t quantity, Price price, OwnerId owner,
+    SelfTradePrevention selfTrade = SelfTradePrevention::CancelNewest, OrderType type = OrderType::Limit) {
+    Order order(id, side, quantity, price, type);
+    order.owner = owner;
+    order.selfTrade = selfTrade;
+    return order;
+}
+
+} // namespace
+
+// Test the three self-trade prevention modes against a resting order of the same owner.
+TEST_F(OrderBookTest, SelfTradePreventionModes) {
+    // Owner 7 rests 50 at 1000 behind another firm's 20.
+    orderBook.processOrder(ownedOrder(1, OrderSide::SELL, 20, 1000, 8));
+    orderBook.processOrder(ownedOrder(2, OrderSide::SELL, 50, 1000, 7));
+
+    // Cancel newest: trades with the other firm, then the rest of the incoming order is cancelled.
+    std::vector<Trade> trades;
+    EXPECT_EQ(orderBook.processOrder(ownedOrder(3, OrderSide::BUY, 40, 1000, 7), trades), 20);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].sellOrderId, 1);
+    EXPECT_EQ(orderBook.findOrder(2)->quantity, 50);
+    EXPECT_TRUE(orderBook.getBids().empty());
+
+    // Decrement both: 30 comes off each side, no trade, nothing rests and nothing is cancelled.
+    trades.clear();
+    EXPECT_EQ(orderBook.processOrder(ownedOrder(4, OrderSide::BUY, 30, 1000, 7, SelfTradePrevention::DecrementBoth), trades), 0);
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(orderBook.findOrder(2)->quantity, 20);
+    EXPECT_EQ(orderBook.getAsks().at(1000).totalQuantity(), 20);
+
+    // Cancel oldest: the resting order goes, and the incoming order carries on to the next level.
+    orderBook.processOrder(ownedOrder(5, OrderSide::SELL, 10, 1001, 9));
+    trades.clear();
+    EXPECT_EQ(orderBook.processOrder(ownedOrder(6, OrderSide::BUY, 15, 1001, 7, SelfTradePrevention::CancelOldest), trades), 0);
+    EXPECT_EQ(orderBook.findOrder(2), nullptr);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].sellOrderId, 5);
+    EXPECT_EQ(orderBook.getBids().at(1001).front().quantity, 5);
+
+    // Orders without an owner are never prevented from trading.
+    trades.clear();
+    orderBook.processOrder(Order(10, OrderSide::SELL, 5, 1001), trades);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buyOrderId, 6);
+}
+
+// Test that fill-or-kill counts only what self-trade prevention would let it fill.
+TEST_F(OrderBookTest, FillOrKillWithSelfTradePrevention) {
+    orderBook.processOrder(ownedOrder(1, OrderSide::SELL, 50, 1000, 7));
+    orderBook.processOrder(ownedOrder(2, OrderSide::SELL, 50, 1000, 8));
+
+    std::vector<Trade> trades;
+    EXPECT_EQ(orderBook.processOrder(ownedOrder(3, OrderSide::BUY, 50, 1000, 7, SelfTradePrevention::CancelNewest, OrderType::FillOrKill), trades), 50);
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(orderBook.getAsks().at(1000).totalQuantity(), 100);
+
+    EXPECT_EQ(orderBook.processOrder(ownedOrder(4, OrderSide::BUY, 50, 1000, 7, SelfTradePrevention::CancelOldest, OrderType::FillOrKill), trades), 0);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].sellOrderId, 2);
+    EXPECT_TRUE(orderBook.getAsks().empty());
+
+    // The owner's bids never get in its way; an offer of its own back on the ask side does.
+    orderBook.processOrder(ownedOrder(5, OrderSide::BUY, 10, 990, 7));
+    orderBook.processOrder(ownedOrder(6, OrderSide::SELL, 30, 1001, 8));
+    trades.clear();
+    EXPECT_EQ(orderBook.processOrder(ownedOrder(7, OrderSide::BUY, 20, 1001, 7, SelfTradePrevention::CancelNewest, OrderType::FillOrKill), trades), 0);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].sellOrderId, 6);
+
+    orderBook.processOrder(ownedOrder(8, OrderSide::SELL, 5, 1001, 7));
+    trades.clear();
+    EXPECT_EQ(orderBook.processOrder(ownedOrder(9, OrderSide::BUY, 15, 1001, 7, SelfTradePrevention::CancelNewest, OrderType::FillOrKill), trades), 15);
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(orderBook.getAsks().at(1001).totalQuantity(), 15);
+}
+
+// Test that a mass cancel removes exactly one owner's resting orders, wherever they rest.
+TEST_F(OrderBookTest, CancelAllForOwner) {
+    orderBook.processOrder(ownedOrder(1, OrderSide::BUY, 10, 998, 7));
+    orderBook.processOrder(ownedOrder(2, OrderSide::BUY, 10, 999, 8));
+    orderBook.processOrder(ownedOrder(3, OrderSide::BUY, 10, 999, 7));
+    orderBook.processOrder(ownedOrder(4, OrderSide::SELL, 10, 1003, 7));
+    orderBook.processOrder(Order(5, OrderSide::SELL, 20, 1002));
+    orderBook.processOrder(ownedOrder(6, OrderSide::SELL, 5, 1010, 7));
+    orderBook.processOrder(ownedOrder(7, OrderSide::BUY, 10, 997, 8));
+
+    // Orders leave the owner's list when they are cancelled, fill, or cross on an amend.
+    orderBook.processOrder(ownedOrder(8, OrderSide::SELL, 10, 1004, 7));
+    orderBook.cancelOrder(8);
+    orderBook.processOrder(Order(9, OrderSide::SELL, 20, 999));
+    orderBook.processOrder(ownedOrder(10, OrderSide::BUY, 10, 995, 7));
+    orderBook.modifyOrder(10, 1002, 10);
+    EXPECT_EQ(orderBook.findOrder(3), nullptr);
+    EXPECT_EQ(orderBook.findOrder(10), nullptr);
+
+    EXPECT_EQ(orderBook.cancelAllForOwner(7), 3);
+    EXPECT_EQ(orderBook.findOrder(1), nullptr);
+    EXPECT_EQ(orderBook.findOrder(4), nullptr);
+    EXPECT_EQ(orderBook.findOrder(6), nullptr);
+    EXPECT_NE(orderBook.findOrder(7), nullptr);
+    EXPECT_EQ(orderBook.getBids().size(), 1);
+    ASSERT_EQ(orderBook.getAsks().size(), 1);
+    EXPECT_EQ(orderBook.getAsks().at(1002).totalQuantity(), 10);
+
+    EXPECT_EQ(orderBook.cancelAllForOwner(7), 0);
+    EXPECT_EQ(orderBook.cancelAllForOwner(kNoOwner), 0);
+    orderBook.processOrder(ownedOrder(11, OrderSide::BUY, 10, 990, 7));
+    EXPECT_EQ(orderBook.cancelAllForOwner(7), 1);
+}
+
+// Test that an order priced beyond the ladder's span cap is refused before the book changes.
+TEST(OrderBookWindowTest, RefusesPricesOutsideTheWindow) {
+    OrderBookConfig config;
+    config.maxLadderTicks = 1000;
+    OrderBook orderBook(config);
+    orderBook.processOrder(Order(1, OrderSide::BUY, 10, 100));
+
+    EXPECT_FALSE(orderBook.acceptsPrice(OrderSide::BUY, int64_t{1} << 40));
+    EXPECT_TRUE(orderBook.acceptsPrice(OrderSide::SELL, int64_t{1} << 40));
+    EXPECT_THROW(orderBook.processOrder(Order(2, OrderSide::BUY, 10, int64_t{1} << 40)), std::out_of_range);
+    EXPECT_THROW(orderBook.modifyOrder(1, 5000, 10), std::out_of_range);
+    EXPECT_THROW(orderBook.placeStop(Order(3, OrderSide::BUY, 10, 100), int64_t{1} << 62), std::out_of_range);
+
+    EXPECT_EQ(orderBook.findOrder(2), nullptr);
+    EXPECT_EQ(orderBook.pendingStops(), 0);
+    ASSERT_EQ(orderBook.getBids().size(), 1);
+    EXPECT_EQ(orderBook.getBids().at(100).totalQuantity(), 10);
+    EXPECT_EQ(orderBook.findOrder(1)->price, 100);
+}
+
+// Test that the order ID the index reserves is refused and never reaches another order.
+TEST_F(OrderBookTest, RefusesReservedOrderId) {
+    constexpr uint64_t reserved = OrderBook::kReservedOrderId;
+    orderBook.processOrder(Order(5, OrderSide::BUY, 10, 1000));
+    orderBook.processOrder(Order(6, OrderSide::BUY, 10, 999));
+    EXPECT_TRUE(orderBook.cancelOrder(6));
+
+    EXPECT_THROW(orderBook.processOrder(Order(reserved, OrderSide::BUY, 10, 1000)), std::invalid_argument);
+    EXPECT_THROW(orderBook.processOrder(Order(reserved, OrderSide::SELL, 10, 0, OrderType::Market)), std::invalid_argument);
+    EXPECT_THROW(orderBook.placeStop(Order(reserved, OrderSide::BUY, 10, 0, OrderType::Market), 1010), std::invalid_argument);
+    EXPECT_EQ(orderBook.findOrder(reserved), nullptr);
+    EXPECT_EQ(orderBook.findStop(reserved), nullptr);
+    EXPECT_FALSE(orderBook.cancelOrder(reserved));
+    EXPECT_FALSE(orderBook.modifyOrder(reserved, 1000, 5));
+
+    ASSERT_NE(orderBook.findOrder(5), nullptr);
+    EXPECT_EQ(orderBook.getBids().at(1000).totalQuantity(), 10);
+    EXPECT_EQ(orderBook.pendingStops(), 0);
+}
+
+// Test that lazy cancels leave depth, best prices and the views exactly as eager ones would,
+// and that matching frees the tombstones it reaches.
+TEST(OrderBookLazyCancelTest, ObservableStateStaysExact) {
+    OrderBookConfig config;
+    config.cancelMode = CancelMode::Lazy;
+    OrderBook orderBook(config);
+    orderBook.processOrder(Order(1, OrderSide::SELL, 10, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 20, 1000));
+    orderBook.processOrder(Order(3, OrderSide::SELL, 30, 1000));
+    orderBook.processOrder(Order(4, OrderSide::SELL, 40, 1001));
+
+    EXPECT_TRUE(orderBook.cancelOrder(1));
+    EXPECT_TRUE(orderBook.cancelOrder(3));
+    EXPECT_EQ(orderBook.tombstones(), 2);
+    EXPECT_FALSE(orderBook.cancelOrder(1));
+    EXPECT_FALSE(orderBook.modifyOrder(3, 1000, 5));
+    EXPECT_EQ(orderBook.findOrder(1), nullptr);
+
+    PriceLevelView level = orderBook.getAsks().at(1000);
+    EXPECT_EQ(level.size(), 1);
+    EXPECT_EQ(level.totalQuantity(), 20);
+    EXPECT_EQ(level.front().orderId, 2);
+    EXPECT_EQ(level.back().orderId, 2);
+    std::vector<uint64_t> ids;
+    for (const Order& order : level)
+        ids.push_back(order.orderId);
+    EXPECT_EQ(ids, (std::vector<uint64_t>{2}));
+
+    // The buy skips tombstone 1, fills 2, and the emptied level takes tombstone 3 with it.
+    auto trades = orderBook.processOrder(Order(5, OrderSide::BUY, 25, 1001));
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].sellOrderId, 2);
+    EXPECT_EQ(trades[1].sellOrderId, 4);
+    EXPECT_EQ(orderBook.tombstones(), 0);
+    EXPECT_EQ(orderBook.getAsks().size(), 1);
+    EXPECT_EQ(orderBook.getAsks().at(1001).totalQuantity(), 35);
+
+    // Cancelling a level's last live order retires the level at once.
+    orderBook.processOrder(Order(6, OrderSide::BUY, 10, 990));
+    orderBook.processOrder(Order(7, OrderSide::BUY, 10, 990));
+    orderBook.cancelOrder(6);
+    orderBook.cancelOrder(7);
+    EXPECT_TRUE(orderBook.getBids().empty());
+    EXPECT_EQ(orderBook.tombstones(), 0);
+
+    // A level that is mostly tombstones is swept by the cancel that tips it over.
+    for (uint64_t id = 100; id < 200; ++id)
+        orderBook.processOrder(Order(id, OrderSide::SELL, 1, 1010));
+    for (uint64_t id = 100; id < 150; ++id)
+        orderBook.cancelOrder(id);
+    EXPECT_EQ(orderBook.tombstones(), 50);
+    orderBook.cancelOrder(150);
+    EXPECT_EQ(orderBook.tombstones(), 0);
+    EXPECT_EQ(orderBook.getAsks().at(1010).size(), 49);
+    EXPECT_EQ(orderBook.getAsks().at(1010).front().orderId, 151);
+}
+
+// Test that tombstones are freed by compact(), before a full pool refuses an order, and
+// by cancelAllForOwner.
+TEST(OrderBookLazyCancelTest, TombstonesAreReclaimed) {
+    OrderBookConfig config;
+    config.cancelMode = CancelMode::Lazy;
+    config.orderCapacity = 4;
+    config.onPoolExhausted = PoolExhaustion::Throw;
+    OrderBook orderBook(config);
+    orderBook.processOrder(Order(1, OrderSide::BUY, 10, 1000));
+    orderBook.processOrder(Order(2, OrderSide::BUY, 10, 1000));
+    orderBook.processOrder(Order(3, OrderSide::BUY, 10, 999));
+    orderBook.processOrder(Order(4, OrderSide::BUY, 10, 999));
+    orderBook.cancelOrder(1);
+    orderBook.cancelOrder(3);
+    EXPECT_EQ(orderBook.compact(), 2);
+    EXPECT_EQ(orderBook.compact(), 0);
+
+    orderBook.processOrder(Order(5, OrderSide::BUY, 10, 998));
+    orderBook.processOrder(Order(6, OrderSide::BUY, 10, 998));
+    orderBook.cancelOrder(5);
+    EXPECT_EQ(orderBook.tombstones(), 1);
+    EXPECT_NO_THROW(orderBook.processOrder(Order(7, OrderSide::BUY, 10, 997)));
+    EXPECT_EQ(orderBook.tombstones(), 0);
+
+    orderBook.cancelOrder(6);
+    orderBook.cancelOrder(7);
+    Order owned(8, OrderSide::SELL, 10, 1005);
+    owned.owner = 3;
+    orderBook.processOrder(owned);
+    owned.orderId = 9;
+    orderBook.processOrder(owned);
+    orderBook.cancelOrder(8);
+    EXPECT_EQ(orderBook.cancelAllForOwner(3), 1);
+    EXPECT_EQ(orderBook.tombstones(), 0);
+    EXPECT_TRUE(orderBook.getAsks().empty());
+    EXPECT_EQ(orderBook.getBids().size(), 2);
+}
+
+// Test that stops wait for a trade through their trigger and then cascade: a triggered
+// stop-limit trades through a second trigger, whose market stop then enters too.
+TEST(OrderBookStopTest, TriggeredStopsCascade) {
+    OrderBook orderBook;
+    orderBook.processOrder(Order(1, OrderSide::SELL, 10, 1000));
+    orderBook.processOrder(Order(2, OrderSide::SELL, 10, 1001));
+    orderBook.processOrder(Order(3, OrderSide::SELL, 10, 1002));
+    orderBook.processOrder(Order(4, OrderSide::SELL, 10, 1005));
+
+    orderBook.placeStop(Order(10, OrderSide::BUY, 10, 0, OrderType::Market), 1001);
+    orderBook.placeStop(Order(11, OrderSide::BUY, 5, 1003), 1000);
+    orderBook.placeStop(Order(12, OrderSide::BUY, 10, 0, OrderType::Market), 1005);
+    orderBook.placeStop(Order(13, OrderSide::SELL, 10, 0, OrderType::Market), 980);
+    EXPECT_EQ(orderBook.pendingStops(), 4);
+    EXPECT_TRUE(orderBook.getBids().empty());
+    EXPECT_EQ(orderBook.findOrder(10), nullptr);
+
+    auto trades = orderBook.processOrder(Order(20, OrderSide::BUY, 20, 1000));
+    ASSERT_EQ(trades.size(), 4);
+    EXPECT_EQ(trades[0].buyOrderId, 20);
+    EXPECT_EQ(trades[1].buyOrderId, 11);
+    EXPECT_EQ(trades[1].price, 1001);
+    EXPECT_EQ(trades[2].buyOrderId, 10);
+    EXPECT_EQ(trades[3].buyOrderId, 10);
+    EXPECT_EQ(trades[3].price, 1002);
+    EXPECT_EQ(trades[3].quantity, 5);
+
+    // Order 20's remainder rested before any stop went off; stops 12 and 13 were not reached.
+    EXPECT_EQ(orderBook.getBids().at(1000).front().orderId, 20);
+    EXPECT_EQ(orderBook.pendingStops(), 2);
+    EXPECT_TRUE(orderBook.cancelOrder(12));
+    EXPECT_FALSE(orderBook.cancelOrder(12));
+    EXPECT_EQ(orderBook.pendingStops(), 1);
+}
+
+// Test that one trade releases the stops it reaches lowest trigger first (oldest first at a
+// trigger), and that cancelAllForOwner takes pending stops too.
+TEST(OrderBookStopTest, TriggerOrderAndOwnerCancel) {
+    OrderBook orderBook;
+    orderBook.placeStop(Order(30, OrderSide::BUY, 5, 995), 1001);
+    orderBook.placeStop(Order(31, OrderSide::BUY, 5, 995), 1000);
+    orderBook.placeStop(Order(32, OrderSide::BUY, 5, 995), 1000);
+    Order owned(33, OrderSide::SELL, 5, 1100);
+    owned.owner = 4;
+    orderBook.placeStop(owned, 990);
+
+    orderBook.processOrder(Order(40, OrderSide::SELL, 5, 1001));
+    orderBook.processOrder(Order(41, OrderSide::BUY, 1, 1001));
+    std::vector<uint64_t> ids;
+    for (const Order& order : orderBook.getBids().at(995))
+        ids.push_back(order.orderId);
+    EXPECT_EQ(ids, (std::vector<uint64_t>{31, 32, 30}));
+    EXPECT_EQ(orderBook.pendingStops(), 1);
+
+    EXPECT_EQ(orderBook.cancelAllForOwner(4), 1);
+    EXPECT_EQ(orderBook.pendingStops(), 0);
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "../src/OrderIndex.h"
+
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+
+// Test basic insert, overwrite, find and erase.
+TEST(OrderIndexTest, InsertFindErase) {
+    OrderIndex<uint32_t> index;
+    EXPECT_TRUE(index.empty());
+    EXPECT_EQ(index.find(1), nullptr);
+
+    EXPECT_TRUE(index.insert(1, 10));
+    EXPECT_TRUE(index.insert(2, 20));
+    EXPECT_FALSE(index.insert(1, 11));
+    EXPECT_EQ(index.size(), 2);
+    ASSERT_NE(index.find(1), nullptr);
+    EXPECT_EQ(*index.find(1), 11);
+    EXPECT_EQ(*index.find(2), 20);
+
+    EXPECT_TRUE(index.erase(1));
+    EXPECT_FALSE(index.erase(1));
+    EXPECT_EQ(index.find(1), nullptr);
+    EXPECT_EQ(*index.find(2), 20);
+    EXPECT_EQ(index.size(), 1);
+}
+
+// Test that the reserved empty-slot key is never found, stored or erased.
+TEST(OrderIndexTest, ReservedKeyIsNeverStored) {
+    OrderIndex<uint32_t> index;
+    constexpr uint64_t reserved = OrderIndex<uint32_t>::kEmptyKey;
+    index.insert(5, 50);
+    index.insert(6, 60);
+    index.erase(6);
+
+    EXPECT_EQ(index.find(reserved), nullptr);
+    EXPECT_FALSE(index.contains(reserved));
+    EXPECT_FALSE(index.insert(reserved, 1));
+    EXPECT_EQ(index.find(reserved), nullptr);
+    EXPECT_FALSE(index.erase(reserved));
+    EXPECT_EQ(index.size(), 1);
+    ASSERT_NE(index.find(5), nullptr);
+    EXPECT_EQ(*index.find(5), 50);
+}
+
+// Test that reserve() presizes the table so inserts up to that count never rehash.
+TEST(OrderIndexTest, ReservePresizes) {
+    OrderIndex<uint32_t> index(1000);
+    std::size_t capacity = index.capacity();
+    for (uint64_t id = 1; id <= 1000; ++id)
+        index.insert(id, static_cast<uint32_t>(id));
+    EXPECT_EQ(index.capacity(), capacity);
+    EXPECT_EQ(index.size(), 1000);
+}
+
+// Test that growing past the reserved size keeps every entry.
+TEST(OrderIndexTest, GrowsAndKeepsEntries) {
+    OrderIndex<uint32_t> index;
+    for (uint64_t id = 1; id <= 10000; ++id)
+        index.insert(id * 7, static_cast<uint32_t>(id));
+    for (uint64_t id = 1; id <= 10000; ++id) {
+        ASSERT_NE(index.find(id * 7), nullptr);
+        EXPECT_EQ(*index.find(id * 7), id);
+    }
+}
+
+// Test that erasing from the middle of probe runs (backward-shift deletion)
+// never loses an entry, by mirroring random operations into std::unordered_map.
+TEST(OrderIndexTest, RandomOperationsMatchUnorderedMap) {
+    OrderIndex<uint32_t> index(64);
+    std::unordered_map<uint64_t, uint32_t> reference;
+    std::mt19937_64 rng(42);
+
+    for (int step = 0; step < 200000; ++step) {
+        // A small key space forces long probe runs and frequent collisions.
+        uint64_t key = rng() % 512;
+        switch (rng() % 3) {
+            case 0:
+                EXPECT_EQ(index.insert(key, static_cast<uint32_t>(step)), reference.count(key) == 0);
+                reference[key] = static_cast<uint32_t>(step);
+                break;
+            case 1:
+                EXPECT_EQ(index.erase(key), reference.erase(key) == 1);
+                break;
+            default: {
+                auto it = reference.find(key);
+                const uint32_t* found = index.find(key);
+                ASSERT_EQ(found != nullptr, it != reference.end());
+                if (found != nullptr) {
+                    EXPECT_EQ(*found, it->second);
+                }
+            }
+        }
+        ASSERT_EQ(index.size(), reference.size());
+    }
+
+    std::size_t visited = 0;
+    index.forEach([&](uint64_t key, uint32_t value) {
+        EXPECT_EQ(reference.at(key), value);
+        ++visited;
+    });
+    EXPECT_EQ(visited, reference.size());
+}
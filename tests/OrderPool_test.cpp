@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "../src/OrderPool.h"
+#include "../src/PriceLevel.h"
+
+#include <stdexcept>
+#include <vector>
+
+// Test that released nodes are reused before the pool grows.
+TEST(OrderPoolTest, ReusesReleasedNodes) {
+    OrderPool pool(2, PoolExhaustion::Throw);
+    OrderHandle a = pool.allocate(Order(1, OrderSide::BUY, 10, 1000));
+    OrderHandle b = pool.allocate(Order(2, OrderSide::BUY, 10, 1000));
+    EXPECT_EQ(pool.size(), 2);
+    EXPECT_TRUE(pool.exhausted());
+
+    pool.release(a);
+    EXPECT_FALSE(pool.exhausted());
+    OrderHandle c = pool.allocate(Order(3, OrderSide::BUY, 10, 1000));
+    EXPECT_EQ(c, a);
+    EXPECT_EQ(pool[b].orderId, 2);
+    EXPECT_EQ(pool[c].orderId, 3);
+}
+
+// Test that a Throw pool refuses to allocate past its capacity.
+TEST(OrderPoolTest, ThrowPolicyRefusesWhenFull) {
+    OrderPool pool(1, PoolExhaustion::Throw);
+    pool.allocate(Order(1, OrderSide::SELL, 10, 1000));
+    EXPECT_THROW(pool.allocate(Order(2, OrderSide::SELL, 10, 1000)), std::length_error);
+}
+
+// Test that a Grow pool keeps every existing handle valid when it grows.
+TEST(OrderPoolTest, GrowPolicyKeepsHandles) {
+    OrderPool pool(1, PoolExhaustion::Grow);
+    std::vector<OrderHandle> handles;
+    for (uint64_t id = 1; id <= 100; ++id)
+        handles.push_back(pool.allocate(Order(id, OrderSide::SELL, 10, 1000)));
+
+    EXPECT_GE(pool.capacity(), 100);
+    for (uint64_t id = 1; id <= 100; ++id)
+        EXPECT_EQ(pool[handles[id - 1]].orderId, id);
+}
+
+// Test that a level keeps FIFO order and running totals through erases from any position.
+TEST(PriceLevelTest, FifoAndTotals) {
+    OrderPool pool(4, PoolExhaustion::Throw);
+    PriceLevel level;
+    OrderHandle a = pool.allocate(Order(1, OrderSide::BUY, 10, 1000));
+    OrderHandle b = pool.allocate(Order(2, OrderSide::BUY, 20, 1000));
+    OrderHandle c = pool.allocate(Order(3, OrderSide::BUY, 30, 1000));
+    level.pushBack(pool, a);
+    level.pushBack(pool, b);
+    level.pushBack(pool, c);
+
+    EXPECT_EQ(level.count, 3);
+    EXPECT_EQ(level.totalQuantity, 60);
+
+    level.erase(pool, b);
+    std::vector<uint64_t> ids;
+    for (const Order& order : PriceLevelView(level, pool))
+        ids.push_back(order.orderId);
+    EXPECT_EQ(ids, (std::vector<uint64_t>{1, 3}));
+    EXPECT_EQ(level.totalQuantity, 40);
+
+    level.erase(pool, a);
+    level.erase(pool, c);
+    EXPECT_TRUE(level.empty());
+    EXPECT_EQ(level.totalQuantity, 0);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "../src/PriceLadder.h"
+#include "../src/TickBitmap.h"
+
+#include <vector>
+
+// Test that the bitmap finds the lowest/highest bit across leaf words and layers.
+TEST(TickBitmapTest, FindFirstAndLast) {
+    TickBitmap bitmap(100000);
+    EXPECT_TRUE(bitmap.empty());
+    EXPECT_EQ(bitmap.findFirst(), TickBitmap::npos);
+
+    bitmap.set(70000);
+    bitmap.set(5);
+    bitmap.set(4096);
+
+    EXPECT_FALSE(bitmap.empty());
+    EXPECT_EQ(bitmap.findFirst(), 5);
+    EXPECT_EQ(bitmap.findLast(), 70000);
+
+    // Clearing a bit drains the upper layers only when its whole word is empty.
+    bitmap.reset(5);
+    EXPECT_EQ(bitmap.findFirst(), 4096);
+    bitmap.reset(70000);
+    EXPECT_EQ(bitmap.findLast(), 4096);
+    bitmap.reset(4096);
+    EXPECT_TRUE(bitmap.empty());
+}
+
+// Test walking set bits in both directions.
+TEST(TickBitmapTest, FindNextAndPrev) {
+    TickBitmap bitmap(10000);
+    std::vector<std::size_t> bits = {0, 63, 64, 200, 4095, 4096, 9999};
+    for (std::size_t bit : bits)
+        bitmap.set(bit);
+
+    std::vector<std::size_t> forward;
+    for (std::size_t i = bitmap.findFirst(); i != TickBitmap::npos; i = bitmap.findNext(i))
+        forward.push_back(i);
+    EXPECT_EQ(forward, bits);
+
+    std::vector<std::size_t> backward;
+    for (std::size_t i = bitmap.findLast(); i != TickBitmap::npos; i = bitmap.findPrev(i))
+        backward.insert(backward.begin(), i);
+    EXPECT_EQ(backward, bits);
+}
+
+// Test that the ladder tracks best prices as levels come and go.
+TEST(PriceLadderTest, LowestAndHighest) {
+    PriceLadder<int> ladder(64);
+    ladder[1000] = 1;
+    ladder[1005] = 2;
+    ladder[998] = 3;
+
+    EXPECT_EQ(ladder.size(), 3);
+    EXPECT_EQ(ladder.lowest(), 998);
+    EXPECT_EQ(ladder.highest(), 1005);
+
+    ladder.erase(998);
+    EXPECT_EQ(ladder.lowest(), 1000);
+    EXPECT_EQ(ladder.find(998), nullptr);
+    EXPECT_EQ(*ladder.find(1005), 2);
+}
+
+// Test that a price far outside the window grows the ladder and keeps every live level.
+TEST(PriceLadderTest, GrowsToFitDistantPrice) {
+    PriceLadder<int> ladder(64);
+    ladder[1000] = 1;
+    ladder[1010] = 2;
+    ladder[50000] = 3;
+
+    EXPECT_EQ(ladder.size(), 3);
+    EXPECT_EQ(*ladder.find(1000), 1);
+    EXPECT_EQ(*ladder.find(1010), 2);
+    EXPECT_EQ(*ladder.find(50000), 3);
+    EXPECT_EQ(ladder.lowest(), 1000);
+    EXPECT_EQ(ladder.highest(), 50000);
+
+    int64_t tick = 0;
+    ASSERT_TRUE(ladder.next(1000, tick));
+    EXPECT_EQ(tick, 1010);
+    ASSERT_TRUE(ladder.next(tick, tick));
+    EXPECT_EQ(tick, 50000);
+    EXPECT_FALSE(ladder.next(tick, tick));
+}
+
+// Test that an empty ladder re-centres on a new price instead of growing.
+TEST(PriceLadderTest, RecentresWhenEmpty) {
+    PriceLadder<int> ladder(64);
+    ladder[1000] = 1;
+    ladder.erase(1000);
+
+    ladder[-500] = 2;
+    EXPECT_EQ(ladder.size(), 1);
+    EXPECT_EQ(ladder.lowest(), -500);
+    EXPECT_EQ(ladder.highest(), -500);
+}
+
+// Test that a price that would stretch the live levels past the span cap is refused untouched.
+TEST(PriceLadderTest, RefusesPricesBeyondMaxSpan) {
+    PriceLadder<int> ladder(64, 1000);
+    ladder[100] = 1;
+    EXPECT_TRUE(ladder.fits(1099));
+    EXPECT_FALSE(ladder.fits(1100));
+    EXPECT_FALSE(ladder.fits(int64_t{1} << 40));
+    EXPECT_THROW(ladder[int64_t{1} << 40], std::out_of_range);
+    EXPECT_THROW(ladder[INT64_MIN], std::out_of_range);
+    EXPECT_EQ(ladder.size(), 1);
+    EXPECT_EQ(ladder.highest(), 100);
+
+    // An empty ladder takes any price within the tick limit.
+    ladder.erase(100);
+    EXPECT_TRUE(ladder.fits(int64_t{1} << 40));
+    EXPECT_FALSE(ladder.fits(INT64_MAX));
+}
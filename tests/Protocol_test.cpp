@@ -0,0 +1,330 @@
+#include <gtest/gtest.h>
+#include "../src/OrderEntrySession.h"
+#include "../src/Protocol.h"
+
+#include <vector>
+
+using namespace protocol;
+
+namespace {
+
+//Collects decoded reports for checking
+struct ReportCollector {
+    std::vector<AckMessage> acks;
+    std::vector<TradeReportMessage> trades;
+    std::vector<MessageType> order;
+
+    void onAck(const AckMessage& message) { acks.push_back(message); order.push_back(MessageType::Ack); }
+    void onTrade(const TradeReportMessage& message) { trades.push_back(message); order.push_back(MessageType::TradeReport); }
+};
+
+//Collects decoded order-entry messages for checking
+struct EntryCollector {
+    std::vector<NewOrderMessage> newOrders;
+    std::vector<CancelMessage> cancels;
+    std::vector<ReplaceMessage> replaces;
+
+    void onNewOrder(const NewOrderMessage& message) { newOrders.push_back(message); }
+    void onCancel(const CancelMessage& message) { cancels.push_back(message); }
+    void onReplace(const ReplaceMessage& message) { replaces.push_back(message); }
+};
+
+} // namespace
+
+// Test that every message type round-trips through the writer and decoder.
+TEST(ProtocolTest, RoundTripsOrderEntryMessages) {
+    alignas(8) uint8_t buffer[256];
+    MessageWriter writer(buffer, sizeof(buffer));
+    ASSERT_TRUE(writer.writeNewOrder(7, Order(1, OrderSide::SELL, 100, 1005)));
+    ASSERT_TRUE(writer.writeCancel(7, 1));
+    ASSERT_TRUE(writer.writeReplace(7, 2, 990, 50));
+    EXPECT_EQ(writer.size(), sizeof(NewOrderMessage) + sizeof(CancelMessage) + sizeof(ReplaceMessage));
+
+    EntryCollector collector;
+    EXPECT_EQ(decodeOrderEntry(writer.data(), writer.size(), collector), writer.size());
+
+    ASSERT_EQ(collector.newOrders.size(), 1);
+    EXPECT_EQ(collector.newOrders[0].instrument, 7);
+    EXPECT_EQ(collector.newOrders[0].orderId, 1);
+    EXPECT_EQ(collector.newOrders[0].side, OrderSide::SELL);
+    EXPECT_EQ(collector.newOrders[0].price, 1005);
+    EXPECT_EQ(collector.newOrders[0].quantity, 100);
+    ASSERT_EQ(collector.cancels.size(), 1);
+    EXPECT_EQ(collector.cancels[0].orderId, 1);
+    ASSERT_EQ(collector.replaces.size(), 1);
+    EXPECT_EQ(collector.replaces[0].price, 990);
+    EXPECT_EQ(collector.replaces[0].quantity, 50);
+}
+
+// Test that a partial trailing message is left unconsumed and that the writer refuses to overflow.
+TEST(ProtocolTest, LeavesPartialMessageAndRefusesOverflow) {
+    alignas(8) uint8_t buffer[48];
+    MessageWriter writer(buffer, sizeof(buffer));
+    ASSERT_TRUE(writer.writeCancel(1, 5));
+    ASSERT_TRUE(writer.writeNewOrder(1, Order(6, OrderSide::BUY, 10, 1000)));
+    EXPECT_FALSE(writer.writeCancel(1, 7));
+
+    EntryCollector collector;
+    EXPECT_EQ(decodeOrderEntry(writer.data(), writer.size() - 1, collector), sizeof(CancelMessage));
+    EXPECT_EQ(collector.cancels.size(), 1);
+    EXPECT_TRUE(collector.newOrders.empty());
+}
+
+// Test that malformed streams are rejected.
+TEST(ProtocolTest, RejectsMalformedMessages) {
+    alignas(8) uint8_t buffer[64];
+    MessageWriter writer(buffer, sizeof(buffer));
+    writer.writeNewOrder(1, Order(1, OrderSide::BUY, 10, 1000));
+    EntryCollector collector;
+
+    reinterpret_cast<NewOrderMessage*>(buffer)->side = static_cast<OrderSide>(9);
+    EXPECT_THROW(decodeOrderEntry(buffer, writer.size(), collector), ProtocolError);
+
+    reinterpret_cast<NewOrderMessage*>(buffer)->side = OrderSide::BUY;
+    reinterpret_cast<MessageHeader*>(buffer)->length = sizeof(CancelMessage);
+    EXPECT_THROW(decodeOrderEntry(buffer, writer.size(), collector), ProtocolError);
+
+    reinterpret_cast<MessageHeader*>(buffer)->length = 0;
+    EXPECT_THROW(decodeOrderEntry(buffer, writer.size(), collector), ProtocolError);
+
+    reinterpret_cast<MessageHeader*>(buffer)->length = sizeof(NewOrderMessage);
+    reinterpret_cast<MessageHeader*>(buffer)->type = MessageType::Ack;
+    EXPECT_THROW(decodeOrderEntry(buffer, writer.size(), collector), ProtocolError);
+}
+
+// Test a session end to end: acks precede trades, and cancel/replace/reject are reported.
+TEST(ProtocolTest, SessionAppliesMessagesToBook) {
+    OrderBook book;
+    std::vector<uint8_t> sent;
+    alignas(8) uint8_t out[64]; //Small on purpose, so the session has to flush mid-message
+    auto flush = [&sent](const uint8_t* data, std::size_t size) { sent.insert(sent.end(), data, data + size); };
+    OrderEntrySession<decltype(flush)> session(book, 3, out, sizeof(out), flush);
+
+    alignas(8) uint8_t in[256];
+    MessageWriter writer(in, sizeof(in));
+    writer.writeNewOrder(3, Order(1, OrderSide::SELL, 100, 1000));
+    writer.writeNewOrder(3, Order(2, OrderSide::BUY, 40, 1000));
+    writer.writeReplace(3, 1, 1010, 30);
+    writer.writeCancel(3, 99);
+    writer.writeNewOrder(4, Order(3, OrderSide::BUY, 10, 1000));
+    EXPECT_EQ(session.onData(writer.data(), writer.size()), writer.size());
+    session.flush();
+
+    ReportCollector reports;
+    EXPECT_EQ(decodeReports(sent.data(), sent.size(), reports), sent.size());
+
+    std::vector<MessageType> expected = {MessageType::Ack, MessageType::Ack, MessageType::TradeReport,
+        MessageType::Ack, MessageType::Ack, MessageType::Ack};
+    EXPECT_EQ(reports.order, expected);
+    ASSERT_EQ(reports.acks.size(), 5);
+    EXPECT_EQ(reports.acks[0].status, AckStatus::Accepted);
+    EXPECT_EQ(reports.acks[2].status, AckStatus::Replaced);
+    EXPECT_EQ(reports.acks[3].status, AckStatus::Rejected);
+    EXPECT_EQ(reports.acks[3].reason, RejectReason::UnknownOrder);
+    EXPECT_EQ(reports.acks[4].reason, RejectReason::UnknownInstrument);
+    ASSERT_EQ(reports.trades.size(), 1);
+    EXPECT_EQ(reports.trades[0].buyOrderId, 2);
+    EXPECT_EQ(reports.trades[0].sellOrderId, 1);
+    EXPECT_EQ(reports.trades[0].quantity, 40);
+
+    //The replace moved order 1 to 1010 with the new quantity
+    const Order* replaced = book.findOrder(1);
+    ASSERT_NE(replaced, nullptr);
+    EXPECT_EQ(replaced->price, 1010);
+    EXPECT_EQ(replaced->quantity, 30);
+}
+
+// Test that a session stamps its owner ID on orders and pulls them all on disconnect.
+TEST(ProtocolTest, SessionCancelsItsOrdersOnDisconnect) {
+    OrderBook book;
+    alignas(8) uint8_t out[256];
+    auto flush = [](const uint8_t*, std::size_t) {};
+    OrderEntrySession<decltype(flush)> first(book, 3, out, sizeof(out), flush, 1);
+    OrderEntrySession<decltype(flush)> second(book, 3, out, sizeof(out), flush, 2);
+
+    alignas(8) uint8_t in[256];
+    MessageWriter writer(in, sizeof(in));
+    writer.writeNewOrder(3, Order(1, OrderSide::SELL, 100, 1000));
+    writer.writeNewOrder(3, Order(2, OrderSide::BUY, 100, 990));
+    first.onData(writer.data(), writer.size());
+    writer.clear();
+    writer.writeNewOrder(3, Order(3, OrderSide::SELL, 100, 1001));
+    second.onData(writer.data(), writer.size());
+
+    EXPECT_EQ(book.findOrder(1)->owner, 1);
+    EXPECT_EQ(first.disconnect(), 2);
+    EXPECT_EQ(book.findOrder(1), nullptr);
+    EXPECT_EQ(book.findOrder(2), nullptr);
+    EXPECT_NE(book.findOrder(3), nullptr);
+}
+
+// Test that a replace is acked ahead of the fills it causes, and that a post-only order
+// replaced to a crossing price is reported cancelled after its ack.
+TEST(ProtocolTest, SessionAcksReplaceBeforeItsFills) {
+    OrderBook book;
+    alignas(8) uint8_t out[256];
+    std::vector<uint8_t> sent;
+    auto collect = [&sent](const uint8_t* data, std::size_t size) { sent.insert(sent.end(), data, data + size); };
+    OrderEntrySession<decltype(collect)> session(book, 3, out, sizeof(out), collect);
+    book.processOrder(Order(1, OrderSide::SELL, 10, 1000));
+    book.processOrder(Order(2, OrderSide::SELL, 10, 1001));
+
+    alignas(8) uint8_t in[256];
+    MessageWriter writer(in, sizeof(in));
+    writer.writeNewOrder(3, Order(3, OrderSide::BUY, 20, 990));
+    writer.writeNewOrder(3, Order(4, OrderSide::BUY, 5, 995, OrderType::PostOnly));
+    session.onData(writer.data(), writer.size());
+    session.flush();
+    sent.clear();
+
+    writer.clear();
+    writer.writeReplace(3, 3, 1000, 20);
+    writer.writeReplace(3, 4, 1001, 5);
+    session.onData(writer.data(), writer.size());
+    session.flush();
+
+    ReportCollector reports;
+    decodeReports(sent.data(), sent.size(), reports);
+    std::vector<MessageType> expected = {MessageType::Ack, MessageType::TradeReport, MessageType::Ack, MessageType::Ack};
+    EXPECT_EQ(reports.order, expected);
+    ASSERT_EQ(reports.acks.size(), 3);
+    EXPECT_EQ(reports.acks[0].orderId, 3);
+    EXPECT_EQ(reports.acks[0].status, AckStatus::Replaced);
+    EXPECT_EQ(reports.acks[1].orderId, 4);
+    EXPECT_EQ(reports.acks[1].status, AckStatus::Replaced);
+    EXPECT_EQ(reports.acks[2].status, AckStatus::Cancelled);
+    EXPECT_EQ(book.findOrder(4), nullptr);
+    EXPECT_EQ(book.getAsks().at(1001).totalQuantity(), 10);
+    EXPECT_EQ(book.findOrder(3)->quantity, 10);
+}
+
+// Test that a session cannot cancel or replace another session's order, and that a live ID
+// cannot be reused by anyone.
+TEST(ProtocolTest, SessionOnlyTouchesItsOwnOrders) {
+    OrderBook book;
+    alignas(8) uint8_t out[256];
+    std::vector<uint8_t> sent;
+    auto ignore = [](const uint8_t*, std::size_t) {};
+    auto collect = [&sent](const uint8_t* data, std::size_t size) { sent.insert(sent.end(), data, data + size); };
+    OrderEntrySession<decltype(ignore)> owner(book, 3, out, sizeof(out), ignore, 1);
+    OrderEntrySession<decltype(collect)> other(book, 3, out, sizeof(out), collect, 2);
+
+    alignas(8) uint8_t in[256];
+    MessageWriter writer(in, sizeof(in));
+    writer.writeNewOrder(3, Order(1, OrderSide::SELL, 100, 1000));
+    owner.onData(writer.data(), writer.size());
+    book.placeStop(Order(2, OrderSide::BUY, 10, 1005), 1005);
+
+    writer.clear();
+    writer.writeCancel(3, 1);
+    writer.writeReplace(3, 1, 1000, 10);
+    writer.writeCancel(3, 2);
+    writer.writeNewOrder(3, Order(1, OrderSide::BUY, 5, 990));
+    writer.writeNewOrder(3, Order(2, OrderSide::BUY, 5, 990));
+    other.onData(writer.data(), writer.size());
+    other.flush();
+
+    ReportCollector reports;
+    decodeReports(sent.data(), sent.size(), reports);
+    ASSERT_EQ(reports.acks.size(), 5);
+    EXPECT_EQ(reports.acks[0].reason, RejectReason::UnknownOrder);
+    EXPECT_EQ(reports.acks[1].reason, RejectReason::UnknownOrder);
+    EXPECT_EQ(reports.acks[2].reason, RejectReason::UnknownOrder);
+    EXPECT_EQ(reports.acks[3].reason, RejectReason::DuplicateOrder);
+    EXPECT_EQ(reports.acks[4].reason, RejectReason::DuplicateOrder);
+
+    ASSERT_NE(book.findOrder(1), nullptr);
+    EXPECT_EQ(book.findOrder(1)->owner, 1);
+    EXPECT_EQ(book.findOrder(1)->quantity, 100);
+    EXPECT_EQ(book.pendingStops(), 1);
+}
+
+// Test that the order ID the book reserves is rejected for every message type and never
+// reaches the book.
+TEST(ProtocolTest, SessionRejectsReservedOrderId) {
+    OrderBook book;
+    alignas(8) uint8_t out[256];
+    std::vector<uint8_t> sent;
+    auto collect = [&sent](const uint8_t* data, std::size_t size) { sent.insert(sent.end(), data, data + size); };
+    OrderEntrySession<decltype(collect)> session(book, 3, out, sizeof(out), collect, 1);
+
+    alignas(8) uint8_t in[256];
+    MessageWriter writer(in, sizeof(in));
+    writer.writeNewOrder(3, Order(5, OrderSide::BUY, 10, 1000));
+    writer.writeNewOrder(3, Order(OrderBook::kReservedOrderId, OrderSide::BUY, 10, 1000));
+    writer.writeReplace(3, OrderBook::kReservedOrderId, 999, 5);
+    writer.writeCancel(3, OrderBook::kReservedOrderId);
+    session.onData(writer.data(), writer.size());
+    session.flush();
+
+    ReportCollector reports;
+    decodeReports(sent.data(), sent.size(), reports);
+    ASSERT_EQ(reports.acks.size(), 4);
+    EXPECT_EQ(reports.acks[0].status, AckStatus::Accepted);
+    for (std::size_t i = 1; i < 4; ++i) {
+        EXPECT_EQ(reports.acks[i].status, AckStatus::Rejected);
+        EXPECT_EQ(reports.acks[i].reason, RejectReason::InvalidOrderId);
+    }
+
+    ASSERT_NE(book.findOrder(5), nullptr);
+    EXPECT_EQ(book.findOrder(5)->quantity, 10);
+    EXPECT_EQ(book.getBids().at(1000).totalQuantity(), 10);
+    EXPECT_EQ(book.findOrder(OrderBook::kReservedOrderId), nullptr);
+}
+
+// Test that self-trade prevention reports what it did to each of the session's orders: a
+// Reduced ack with what is left, or a Cancelled ack for an order it took out, never a
+// Cancelled ack for an order that is still live.
+TEST(ProtocolTest, SessionReportsSelfTradePrevention) {
+    OrderBook book;
+    alignas(8) uint8_t out[512];
+    std::vector<uint8_t> sent;
+    auto collect = [&sent](const uint8_t* data, std::size_t size) { sent.insert(sent.end(), data, data + size); };
+    OrderEntrySession<decltype(collect)> session(book, 3, out, sizeof(out), collect, 1);
+
+    Order decrement(2, OrderSide::BUY, 40, 1000);
+    decrement.selfTrade = SelfTradePrevention::DecrementBoth;
+    Order decrementAll(4, OrderSide::BUY, 20, 1005);
+    decrementAll.selfTrade = SelfTradePrevention::DecrementBoth;
+    Order cancelOldest(5, OrderSide::BUY, 10, 1005);
+    cancelOldest.selfTrade = SelfTradePrevention::CancelOldest;
+
+    alignas(8) uint8_t in[256];
+    MessageWriter writer(in, sizeof(in));
+    writer.writeNewOrder(3, Order(1, OrderSide::SELL, 30, 1000));
+    writer.writeNewOrder(3, decrement);
+    writer.writeNewOrder(3, Order(3, OrderSide::SELL, 50, 1005));
+    writer.writeNewOrder(3, decrementAll);
+    writer.writeNewOrder(3, cancelOldest);
+    session.onData(writer.data(), writer.size());
+    session.flush();
+
+    ReportCollector reports;
+    decodeReports(sent.data(), sent.size(), reports);
+    EXPECT_TRUE(reports.trades.empty());
+    ASSERT_EQ(reports.acks.size(), 10);
+    auto expectAck = [&reports](std::size_t i, uint64_t orderId, AckStatus status, uint32_t quantity) {
+        EXPECT_EQ(reports.acks[i].orderId, orderId) << i;
+        EXPECT_EQ(reports.acks[i].status, status) << i;
+        EXPECT_EQ(reports.acks[i].quantity, quantity) << i;
+    };
+    expectAck(0, 1, AckStatus::Accepted, 0);
+    // Decrement both, BUY 40 against the session's own SELL 30: the sell is used up, 10 of the buy rests.
+    expectAck(1, 2, AckStatus::Accepted, 0);
+    expectAck(2, 1, AckStatus::Cancelled, 0);
+    expectAck(3, 2, AckStatus::Reduced, 10);
+    expectAck(4, 3, AckStatus::Accepted, 0);
+    // Decrement both, BUY 20 against SELL 50: the sell is left with 30, the buy with nothing.
+    expectAck(5, 4, AckStatus::Accepted, 0);
+    expectAck(6, 3, AckStatus::Reduced, 30);
+    expectAck(7, 4, AckStatus::Cancelled, 0);
+    // Cancel oldest: the sell goes and the buy rests whole.
+    expectAck(8, 5, AckStatus::Accepted, 0);
+    expectAck(9, 3, AckStatus::Cancelled, 0);
+
+    EXPECT_EQ(book.findOrder(1), nullptr);
+    EXPECT_EQ(book.findOrder(2)->quantity, 10);
+    EXPECT_EQ(book.findOrder(3), nullptr);
+    EXPECT_EQ(book.findOrder(4), nullptr);
+    EXPECT_EQ(book.findOrder(5)->quantity, 10);
+}
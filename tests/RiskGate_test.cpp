@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include "../src/OrderBook.h"
+#include "../src/OrderEntrySession.h"
+#include "../src/RiskGate.h"
+
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+// Test that the config parser reads defaults and account overrides, and names the bad line.
+TEST(RiskGateTest, ParsesConfig) {
+    std::istringstream text(
+        "# limits\n"
+        "price_band = 50\n"
+        "max_order_quantity = 100   # per order\n"
+        "\n"
+        "[account 7]\n"
+        "max_open_quantity = 300\n");
+    RiskConfig config = RiskConfig::parse(text);
+    EXPECT_EQ(config.priceBand, 50);
+    EXPECT_EQ(config.defaults.maxOrderQuantity, 100);
+    ASSERT_EQ(config.accounts.size(), 1);
+    EXPECT_EQ(config.accounts[0].first, 7);
+    EXPECT_EQ(config.accounts[0].second.maxOrderQuantity, 100);
+    EXPECT_EQ(config.accounts[0].second.maxOpenQuantity, 300);
+
+    std::istringstream bad("price_band = 5\nmax_open_quantity = lots\n");
+    try {
+        RiskConfig::parse(bad);
+        FAIL() << "expected a parse error";
+    } catch (const std::runtime_error& error) {
+        EXPECT_NE(std::string(error.what()).find("line 2"), std::string::npos);
+    }
+    EXPECT_THROW(RiskConfig::load("/nonexistent/risk.conf"), std::runtime_error);
+}
+
+// Test each limit against counters the book keeps current.
+TEST(RiskGateTest, ChecksLimits) {
+    RiskConfig config;
+    config.priceBand = 10;
+    config.defaults.maxOrderQuantity = 100;
+    config.accounts.push_back({1, RiskLimits{100, 150, 120'000}});
+    RiskGate gate(config);
+    OrderBook book;
+    book.setRiskGate(&gate);
+
+    Order order(1, OrderSide::BUY, 100, 1000);
+    order.owner = 1;
+    EXPECT_EQ(gate.check(order), RiskCheck::Passed);
+    book.processOrder(order);
+    EXPECT_EQ(gate.openQuantity(1), 100);
+    EXPECT_EQ(gate.openNotional(1), 100'000);
+
+    // No band before the first trade; after it, 10 ticks either side.
+    order = Order(2, OrderSide::BUY, 10, 500);
+    order.owner = 1;
+    EXPECT_EQ(gate.check(order), RiskCheck::Passed);
+    book.processOrder(Order(3, OrderSide::SELL, 40, 1000));
+    EXPECT_EQ(gate.openQuantity(1), 60);
+    EXPECT_EQ(gate.check(order), RiskCheck::PriceBand);
+
+    order = Order(4, OrderSide::BUY, 101, 1005);
+    EXPECT_EQ(gate.check(order), RiskCheck::OrderQuantity);
+    order.owner = 1;
+    order.quantity = 91;
+    EXPECT_EQ(gate.check(order), RiskCheck::OpenQuantity);
+    order.quantity = 60;
+    EXPECT_EQ(gate.check(order), RiskCheck::OpenNotional);
+    order.quantity = 50;
+    EXPECT_EQ(gate.check(order), RiskCheck::Passed);
+
+    // An amend is checked with the order's own exposure taken out.
+    const Order* resting = book.findOrder(1);
+    EXPECT_EQ(gate.checkModify(*resting, 1000, 100), RiskCheck::Passed);
+    EXPECT_EQ(gate.checkModify(*resting, 1000, 101), RiskCheck::OrderQuantity);
+}
+
+// Test that extreme prices and quantities are refused rather than wrapping, and that a
+// reference price centres the band before the first trade.
+TEST(RiskGateTest, ExtremesDoNotWrap) {
+    RiskConfig config;
+    config.priceBand = RiskConfig::kMaxPriceBand;
+    config.referencePrice = 1000;
+    RiskGate gate(config);
+
+    Order order(1, OrderSide::BUY, 8, INT64_MAX / 2);
+    order.owner = 1;
+    EXPECT_EQ(gate.check(order), RiskCheck::OpenNotional);
+    order.price = INT64_MIN;
+    order.quantity = 1;
+    EXPECT_EQ(gate.check(order), RiskCheck::PriceBand);
+    order.price = -(int64_t{1} << 61);
+    EXPECT_EQ(gate.check(order), RiskCheck::Passed);
+
+    std::istringstream narrow("price_band = 10\nreference_price = -500\n");
+    RiskGate banded(RiskConfig::parse(narrow));
+    order = Order(2, OrderSide::SELL, 1, -489);
+    EXPECT_EQ(banded.check(order), RiskCheck::PriceBand);
+    order.price = -490;
+    EXPECT_EQ(banded.check(order), RiskCheck::Passed);
+    Price last;
+    EXPECT_FALSE(banded.lastTrade(last));
+
+    std::istringstream wide("price_band = 9223372036854775807\n");
+    EXPECT_THROW(RiskConfig::parse(wide), std::runtime_error);
+}
+
+// Test that the running counters always equal the resting orders, through every way an order changes.
+TEST(RiskGateTest, CountersMatchRestingOrders) {
+    for (CancelMode mode : {CancelMode::Eager, CancelMode::Lazy}) {
+        OrderBookConfig bookConfig;
+        bookConfig.cancelMode = mode;
+        OrderBook book(bookConfig);
+        RiskGate gate;
+        book.setRiskGate(&gate);
+
+        std::mt19937_64 rng(5);
+        for (uint64_t id = 1; id <= 20000; ++id) {
+            uint64_t pick = rng() % 100;
+            if (pick < 55) {
+                OrderType type = rng() % 5 == 0 ? OrderType::ImmediateOrCancel : OrderType::Limit;
+                Order order(id, rng() % 2 ? OrderSide::BUY : OrderSide::SELL, 1 + rng() % 50, 990 + static_cast<Price>(rng() % 20), type);
+                order.owner = static_cast<OwnerId>(rng() % 4);
+                order.selfTrade = static_cast<SelfTradePrevention>(rng() % 3);
+                book.processOrder(order, [](const Trade&) {});
+            } else if (pick < 80) {
+                book.cancelOrder(1 + rng() % id);
+            } else if (pick < 98) {
+                book.modifyOrder(1 + rng() % id, 990 + static_cast<Price>(rng() % 20), static_cast<uint32_t>(rng() % 50));
+            } else {
+                book.cancelAllForOwner(static_cast<OwnerId>(1 + rng() % 3));
+            }
+        }
+        book.startAuction();
+        book.processOrder(Order(30000, OrderSide::BUY, 500, 1010));
+        book.uncrossAuction(1000, [](const Trade&) {});
+
+        std::map<OwnerId, uint64_t> quantity;
+        std::map<OwnerId, uint64_t> notional;
+        for (const BookSideView& side : {book.getBids(), book.getAsks()})
+            for (const auto& [price, level] : side)
+                for (const Order& order : level) {
+                    quantity[order.owner] += order.quantity;
+                    notional[order.owner] += order.quantity * static_cast<uint64_t>(price);
+                }
+        for (OwnerId owner = 1; owner < 4; ++owner) {
+            EXPECT_EQ(gate.openQuantity(owner), quantity[owner]) << "owner " << owner;
+            EXPECT_EQ(gate.openNotional(owner), notional[owner]) << "owner " << owner;
+        }
+    }
+}
+
+// Test that a session refuses orders the book's gate fails, with the reason, before they reach the book.
+TEST(RiskGateTest, SessionRejectsWithReason) {
+    RiskConfig config;
+    config.defaults.maxOrderQuantity = 50;
+    RiskGate gate(config);
+    OrderBook book;
+    book.setRiskGate(&gate);
+
+    std::vector<uint8_t> sent;
+    alignas(8) uint8_t out[256];
+    auto flush = [&sent](const uint8_t* data, std::size_t size) { sent.insert(sent.end(), data, data + size); };
+    OrderEntrySession<decltype(flush)> session(book, 3, out, sizeof(out), flush, 9);
+
+    alignas(8) uint8_t in[256];
+    protocol::MessageWriter writer(in, sizeof(in));
+    writer.writeNewOrder(3, Order(1, OrderSide::BUY, 60, 1000));
+    writer.writeNewOrder(3, Order(2, OrderSide::BUY, 40, 1000));
+    writer.writeReplace(3, 2, 1000, 70);
+    session.onData(writer.data(), writer.size());
+    session.flush();
+
+    struct Acks {
+        std::vector<protocol::AckMessage> acks;
+        void onAck(const protocol::AckMessage& message) { acks.push_back(message); }
+        void onTrade(const protocol::TradeReportMessage&) {}
+    } reports;
+    protocol::decodeReports(sent.data(), sent.size(), reports);
+    ASSERT_EQ(reports.acks.size(), 3);
+    EXPECT_EQ(reports.acks[0].reason, protocol::RejectReason::OrderQuantityLimit);
+    EXPECT_EQ(reports.acks[1].status, protocol::AckStatus::Accepted);
+    EXPECT_EQ(reports.acks[2].reason, protocol::RejectReason::OrderQuantityLimit);
+    EXPECT_EQ(book.findOrder(1), nullptr);
+    EXPECT_EQ(book.findOrder(2)->quantity, 40);
+    EXPECT_EQ(gate.openQuantity(9), 40);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "../src/OrderBook.h"
+#include "../src/SharedMarketData.h"
+#include "../src/SharedMarketDataPublisher.h"
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+namespace {
+
+std::string regionName(const char* test) {
+    return std::string("/agora-test-") + test + "-" + std::to_string(::getpid());
+}
+
+} // namespace
+
+// Test that a reader sees the book's top levels and every trade published after it attached.
+TEST(SharedMarketDataTest, ReaderSeesDepthAndTrades) {
+    std::string name = regionName("basic");
+    SharedMarketDataConfig config;
+    config.depthLevels = 2;
+    SharedMarketDataPublisher publisher(name, 7, config);
+
+    OrderBook book;
+    book.processOrder(Order(1, OrderSide::BUY, 100, 999));
+    book.processOrder(Order(2, OrderSide::BUY, 50, 998));
+    book.processOrder(Order(3, OrderSide::BUY, 10, 997));
+    book.processOrder(Order(4, OrderSide::SELL, 70, 1001));
+    publisher.publishDepth(book);
+    publisher.publishTrade(Trade(1, 10, 11, 1000, 5));
+
+    SharedMarketDataReader reader(name);
+    EXPECT_EQ(reader.instrument(), 7);
+    SharedDepth depth;
+    reader.readDepth(depth);
+    EXPECT_EQ(depth.version, 1);
+    ASSERT_EQ(depth.bidCount, 2);
+    ASSERT_EQ(depth.askCount, 1);
+    EXPECT_EQ(depth.bids[0].price, 999);
+    EXPECT_EQ(depth.bids[1].quantity, 50);
+    EXPECT_EQ(depth.asks[0].orderCount, 1);
+
+    // The trade from before the reader attached is not replayed.
+    book.processOrder(Order(5, OrderSide::SELL, 30, 999), [&publisher](const Trade& trade) { publisher.publishTrade(trade); });
+    std::vector<Trade> trades;
+    EXPECT_EQ(reader.pollTrades([&trades](const Trade& trade) { trades.push_back(trade); }), 1);
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buyOrderId, 1);
+    EXPECT_EQ(trades[0].quantity, 30);
+    EXPECT_EQ(reader.pollTrades([](const Trade&) {}), 0);
+
+    EXPECT_THROW(SharedMarketDataReader(regionName("missing")), std::runtime_error);
+}
+
+// Test that a reader that falls more than a ring behind skips to the oldest trade left and counts the rest.
+TEST(SharedMarketDataTest, SlowReaderIsToldWhatItMissed) {
+    std::string name = regionName("lapped");
+    SharedMarketDataConfig config;
+    config.tradeCapacity = 8;
+    SharedMarketDataPublisher publisher(name, 1, config);
+    SharedMarketDataReader reader(name);
+
+    for (uint64_t id = 1; id <= 20; ++id)
+        publisher.publishTrade(Trade(id, 1, 2, 1000, 1));
+    std::vector<uint64_t> ids;
+    EXPECT_EQ(reader.pollTrades([&ids](const Trade& trade) { ids.push_back(trade.tradeId); }), 8);
+    EXPECT_EQ(reader.missedTrades(), 12);
+    EXPECT_EQ(ids.front(), 13);
+    EXPECT_EQ(ids.back(), 20);
+}
+
+// Test that concurrent readers never see a torn depth snapshot or an out-of-order trade.
+TEST(SharedMarketDataTest, ConcurrentReadersSeeConsistentData) {
+    std::string name = regionName("concurrent");
+    SharedMarketDataConfig config;
+    config.tradeCapacity = 1024;
+    SharedMarketDataPublisher publisher(name, 1, config);
+    constexpr uint64_t kUpdates = 20000;
+
+    auto read = [&] {
+        SharedMarketDataReader reader(name);
+        uint64_t first = reader.nextTrade();
+        SharedDepth depth;
+        uint64_t lastTrade = 0;
+        uint64_t delivered = 0;
+        bool ok = true;
+        while (reader.nextTrade() <= kUpdates) {
+            // Every update adds 1 to both sides, so any consistent copy has equal touches.
+            reader.readDepth(depth);
+            if (depth.bidCount == 1 && depth.askCount == 1 && depth.bids[0].quantity != depth.asks[0].quantity)
+                ok = false;
+            delivered += reader.pollTrades([&](const Trade& trade) {
+                if (trade.tradeId <= lastTrade)
+                    ok = false;
+                lastTrade = trade.tradeId;
+            });
+        }
+        EXPECT_TRUE(ok);
+        EXPECT_EQ(delivered + reader.missedTrades(), kUpdates - first + 1);
+    };
+
+    std::thread first(read);
+    std::thread second(read);
+    OrderBook book;
+    for (uint64_t i = 1; i <= kUpdates; ++i) {
+        book.processOrder(Order(2 * i, OrderSide::BUY, 1, 1000));
+        book.processOrder(Order(2 * i + 1, OrderSide::SELL, 1, 1010));
+        publisher.publishDepth(book);
+        publisher.publishTrade(Trade(i, 1, 2, 1005, 1));
+    }
+    first.join();
+    second.join();
+}